@@ -3,6 +3,8 @@
 import os
 import sys
 import re
+import io
+import struct
 import zstandard
 import zlib
 import shutil
@@ -35,30 +37,92 @@ from taiseilib.common import (
 
 zstd_decompressor = zstandard.ZstdDecompressor()
 
+# Uncompressed size of each independent frame in zstd-compressed entries.
+# Seeking within an entry only needs to decompress up to this much data.
+SEEKABLE_FRAME_SIZE = 1 << 17
 
-def write_zst_file(zf, zst_path, arcname):
+SEEKABLE_MAGIC = 0x8F92EAB1
+SKIPPABLE_FRAME_MAGIC = 0x184D2A5E
+
+
+def zstd_compress_seekable(data, level):
     '''
-    Add a file pre-compressed with zstd to the archive
+    Compress data in the zstd seekable format: independent frames followed by a seek table
+    in a skippable frame. Regular zstd decoders read it like any multi-frame stream.
+    Data that fits in a single frame is compressed normally, since seeking wouldn't benefit.
+    '''
+
+    cctx = zstandard.ZstdCompressor(level=level)
+
+    if len(data) <= SEEKABLE_FRAME_SIZE:
+        return cctx.compress(data)
+
+    frames = []
+    seek_table = []
+
+    for ofs in range(0, len(data), SEEKABLE_FRAME_SIZE):
+        chunk = data[ofs:ofs + SEEKABLE_FRAME_SIZE]
+        frame = cctx.compress(chunk)
+        frames.append(frame)
+        seek_table.append(struct.pack('<II', len(frame), len(chunk)))
+
+    # Number_Of_Frames, Seek_Table_Descriptor (no checksums), Seekable_Magic_Number
+    seek_table.append(struct.pack('<IBI', len(frames), 0, SEEKABLE_MAGIC))
+    seek_table = b''.join(seek_table)
+
+    frames.append(struct.pack('<II', SKIPPABLE_FRAME_MAGIC, len(seek_table)))
+    frames.append(seek_table)
+    return b''.join(frames)
+
+
+def write_zst_stream(zf, zst_file, zi):
+    '''
+    Add pre-compressed zstd data to the archive, under the prepared ZipInfo.
     Of course zipfile doesn't support this use-case (because it sucks),
     so abuse generous access to its internals to implement it here.
     '''
 
-    log_file(zst_path, arcname, ZIP_ZSTANDARD)
-
     zip64 = False
 
-    with zst_path.open('rb') as zst_file:
-        zst_size = zst_file.seek(0, 2)
-        zst_file.seek(0, 0)
+    zi.compress_type = ZIP_ZSTANDARD
+    zi.create_version = ZSTANDARD_VERSION
+    zi.extract_version = ZSTANDARD_VERSION
+    zi.compress_size = zst_file.seek(0, 2)
+    zst_file.seek(0, 0)
 
-        zi = ZipInfo.from_file(str(zst_path), arcname=arcname)
-        zi.compress_type = ZIP_ZSTANDARD
-        zi.create_version = ZSTANDARD_VERSION
-        zi.extract_version = ZSTANDARD_VERSION
-        zi.compress_size = zst_size
+    if not zi.external_attr:
+        zi.external_attr = 0o600 << 16  # permissions: ?rw-------
+
+    if zf._seekable:
+        zf.fp.seek(zf.start_dir)
 
-        if not zi.external_attr:
-            zi.external_attr = 0o600 << 16  # permissions: ?rw-------
+    zi.header_offset = zf.fp.tell()
+
+    zf._writecheck(zi)
+    zf._didModify = True
+    zf.fp.write(zi.FileHeader(zip64))
+    zf._writing = True
+
+    try:
+        shutil.copyfileobj(zst_file, zf.fp)
+        assert zst_file.tell() == zi.compress_size
+
+        zf.filelist.append(zi)
+        zf.NameToInfo[zi.filename] = zi
+        zf.start_dir = zf.fp.tell()
+    finally:
+        zf._writing = False
+
+
+def write_zst_file(zf, zst_path, arcname):
+    '''
+    Add a file pre-compressed with zstd to the archive
+    '''
+
+    log_file(zst_path, arcname, ZIP_ZSTANDARD)
+
+    with zst_path.open('rb') as zst_file:
+        zi = ZipInfo.from_file(str(zst_path), arcname=arcname)
 
         # Unfortunately we must decompress it to compute crc32.
         # We'll also compute file size from decompressed data instead of relying on frame headers.
@@ -70,26 +134,22 @@ def write_zst_file(zf, zst_path, arcname):
             zi.file_size += len(chunk)
             zi.CRC = zlib.crc32(chunk, zi.CRC)
 
-        if zf._seekable:
-            zf.fp.seek(zf.start_dir)
+        write_zst_stream(zf, zst_file, zi)
+
 
-        zi.header_offset = zf.fp.tell()
+def write_seekable_zst_file(zf, path, arcname, level):
+    '''
+    Compress a file in the zstd seekable format and add it to the archive
+    '''
 
-        zf._writecheck(zi)
-        zf._didModify = True
-        zf.fp.write(zi.FileHeader(zip64))
-        zf._writing = True
+    log_file(path, arcname, ZIP_ZSTANDARD)
 
-        try:
-            zst_file.seek(0, 0)
-            shutil.copyfileobj(zst_file, zf.fp)
-            assert zst_file.tell() == zi.compress_size
+    data = path.read_bytes()
+    zi = ZipInfo.from_file(str(path), arcname=arcname)
+    zi.file_size = len(data)
+    zi.CRC = zlib.crc32(data)
 
-            zf.filelist.append(zi)
-            zf.NameToInfo[zi.filename] = zi
-            zf.start_dir = zf.fp.tell()
-        finally:
-            zf._writing = False
+    write_zst_stream(zf, io.BytesIO(zstd_compress_seekable(data, level)), zi)
 
 
 def log_file(path, arcname, comp_type=None):
@@ -149,8 +209,11 @@ def pack(args):
                             ctype = ZIP_STORED
                             break
 
-                    log_file(path, relpath, ctype)
-                    zf.write(str(path), str(relpath), compress_type=ctype)
+                    if ctype == ZIP_ZSTANDARD:
+                        write_seekable_zst_file(zf, path, str(relpath), comp_level)
+                    else:
+                        log_file(path, relpath, ctype)
+                        zf.write(str(path), str(relpath), compress_type=ctype)
 
     if args.depfile is not None:
         if nocompress_file is not None:
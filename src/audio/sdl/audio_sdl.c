@@ -293,6 +293,7 @@ static BGM *audio_sdl_bgm_load(const char *vfspath) {
 
 static void audio_sdl_bgm_unload(BGM *bgm) {
 	WITH_AUDIO_LOCK((mixer_notify_bgm_unload(audio.mixer, &bgm->mbgm), 0));
+	mixer_wait_bgm_released(audio.mixer, &bgm->mbgm);
 	mixerbgm_unload(&bgm->mbgm);
 }
 
@@ -0,0 +1,487 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#include "taisei.h"
+
+#include "decoder.h"
+#include "thread.h"
+#include "util.h"
+
+// In frames; must be a power of two. About 0.34 seconds at 48 kHz.
+#define RING_FRAMES (1 << 14)
+
+// How much to decode at once, in frames. sdecoder_wait_released may have to wait for this long.
+#define CHUNK_FRAMES 1024
+
+// How long the decoder sleeps at most if nobody wakes it up, in milliseconds.
+#define IDLE_TIMEOUT 10
+
+struct StreamDecoder {
+	Thread *thread;
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+
+	// Everything below is protected by mutex, except where noted
+	AudioStream *stream;
+	SDL_AudioStream *pipe;  // owned by the decoder; converts from pipe_spec to spec
+	AudioStreamSpec spec;
+	AudioStreamSpec pipe_spec;
+	bool loop;
+	bool wrapped;  // looped back to loop_start since the last reset
+	bool error;
+	bool quit;
+
+	// Set while the decoder thread works on a chunk without holding the mutex. It owns the stream
+	// and the pipe meanwhile; nothing else may touch them.
+	bool busy;
+
+	// Source to switch to once the decoder thread is done with its current chunk
+	struct {
+		AudioStream *stream;
+		size_t pos;
+		bool loop;
+		bool set;
+	} pending;
+
+	// Bumped on every reset. A chunk decoded across a reset is stale and gets discarded.
+	uint32_t generation;
+
+	// Work deferred to the decoder thread, because the stream or the pipe was busy
+	ssize_t seek_pos;  // -1 if none
+	bool clear_pipe;
+
+	// Source position and frames left in the pipe as of the last published chunk, so that
+	// sdecoder_tell doesn't have to touch the stream.
+	ssize_t src_pos;
+	uint32_t pipe_frames;
+
+	// Free-running frame counters; only the producer writes write_pos, and only the consumer
+	// writes read_pos (except in sdecoder_reset, which never runs concurrently with the consumer).
+	SDL_atomic_t write_pos;
+	SDL_atomic_t read_pos;
+	SDL_atomic_t eos;
+
+	uint8_t *ring;
+};
+
+typedef struct DecodedChunk {
+	size_t size;
+	ssize_t src_pos;
+	uint32_t pipe_frames;
+	bool end;
+	bool error;
+	bool wrapped;
+} DecodedChunk;
+
+INLINE uint32_t ring_used(StreamDecoder *dec) {
+	return (uint32_t)SDL_AtomicGet(&dec->write_pos) - (uint32_t)SDL_AtomicGet(&dec->read_pos);
+}
+
+static void ring_write(StreamDecoder *dec, const uint8_t *data, uint32_t num_frames) {
+	uint32_t frame_size = dec->spec.frame_size;
+	uint32_t w = SDL_AtomicGet(&dec->write_pos);
+	uint32_t ofs = w & (RING_FRAMES - 1);
+	uint32_t first = min(num_frames, RING_FRAMES - ofs);
+
+	assert(num_frames <= RING_FRAMES - ring_used(dec));
+
+	memcpy(dec->ring + ofs * frame_size, data, first * frame_size);
+	memcpy(dec->ring, data + first * frame_size, (num_frames - first) * frame_size);
+
+	// publish only after the data is in place
+	SDL_AtomicSet(&dec->write_pos, w + num_frames);
+}
+
+// Must be called with the mutex locked
+static void sdecoder_reset(StreamDecoder *dec) {
+	SDL_AtomicSet(&dec->read_pos, 0);
+	SDL_AtomicSet(&dec->write_pos, 0);
+	SDL_AtomicSet(&dec->eos, 0);
+	dec->wrapped = false;
+	dec->error = false;
+	dec->seek_pos = -1;
+	dec->clear_pipe = dec->pipe != NULL;
+	dec->pipe_frames = 0;
+	++dec->generation;
+}
+
+// Switches to a new source, positioned at pos. Must be called with the mutex locked, and only
+// while the decoder thread is not busy. Unlike sdecoder_reset, this doesn't touch the ring, so the
+// decoder thread may call it while the consumer is running.
+static void sdecoder_attach(StreamDecoder *dec, AudioStream *stream, size_t pos, bool loop) {
+	dec->stream = stream;
+	dec->loop = loop;
+	dec->src_pos = -1;
+	dec->clear_pipe = false;
+
+	if(!stream) {
+		return;
+	}
+
+	if(astream_spec_equals(&stream->spec, &dec->spec)) {
+		SDL_FreeAudioStream(dec->pipe);
+		dec->pipe = NULL;
+	} else if(dec->pipe && astream_spec_equals(&stream->spec, &dec->pipe_spec)) {
+		SDL_AudioStreamClear(dec->pipe);
+	} else {
+		SDL_FreeAudioStream(dec->pipe);
+		dec->pipe = astream_create_sdl_stream(stream, &dec->spec);
+		dec->pipe_spec = stream->spec;
+
+		if(UNLIKELY(!dec->pipe)) {
+			log_sdl_error(LOG_ERROR, "SDL_NewAudioStream");
+			dec->error = true;
+			return;
+		}
+	}
+
+	if(UNLIKELY((dec->src_pos = astream_seek(stream, pos)) < 0)) {
+		log_error("astream_seek() failed");
+		dec->error = true;
+	}
+}
+
+// Same as what the audio callback used to do synchronously. Runs without the mutex held, so it
+// must not touch the decoder itself.
+static DecodedChunk sdecoder_decode_chunk(
+	AudioStream *astream, SDL_AudioStream *pipe, bool loop, size_t bufsize, uint8_t *buffer
+) {
+	AudioStreamReadFlags rflags = loop ? ASTREAM_READ_LOOP : 0;
+	uint8_t *buf = buffer;
+	uint8_t *buf_end = buf + bufsize;
+	ssize_t pos_before = loop ? astream_tell(astream) : -1;
+	DecodedChunk result = { };
+
+	if(pipe) {
+		// convert/resample
+
+		do {
+			uint8_t staging_buffer[bufsize];
+			ssize_t read = SDL_AudioStreamGet(pipe, buf, buf_end - buf);
+
+			if(UNLIKELY(read < 0)) {
+				log_sdl_error(LOG_ERROR, "SDL_AudioStreamGet");
+				result.error = true;
+				break;
+			}
+
+			buf += read;
+
+			if(buf >= buf_end) {
+				break;
+			}
+
+			read = astream_read_into_sdl_stream(astream, pipe, sizeof(staging_buffer), staging_buffer, rflags);
+
+			if(read <= 0) {
+				SDL_AudioStreamFlush(pipe);
+
+				if(SDL_AudioStreamAvailable(pipe) <= 0)  {
+					result.end = true;
+					break;
+				}
+			}
+		} while(buf < buf_end);
+	} else {
+		// direct stream
+
+		ssize_t read = astream_read(astream, bufsize, buf, rflags | ASTREAM_READ_MAX_FILL);
+
+		if(read > 0) {
+			buf += read;
+		} else if(read == 0) {
+			result.end = true;
+		} else {
+			result.error = true;
+		}
+	}
+
+	result.src_pos = astream_tell(astream);
+
+	if(pos_before >= 0 && result.src_pos < pos_before) {
+		result.wrapped = true;
+	}
+
+	assert(buf <= buf_end);
+	result.size = buf - buffer;
+	return result;
+}
+
+static void *sdecoder_thread(void *arg) {
+	StreamDecoder *dec = arg;
+	uint32_t frame_size = dec->spec.frame_size;
+	uint8_t *chunk = mem_alloc(CHUNK_FRAMES * frame_size);
+
+	SDL_LockMutex(dec->mutex);
+
+	while(!dec->quit) {
+		if(
+			!dec->stream ||
+			dec->error ||
+			SDL_AtomicGet(&dec->eos) ||
+			RING_FRAMES - ring_used(dec) < CHUNK_FRAMES
+		) {
+			// Full, finished, failed, or idle. Errors are retried after a reset, like they used to be
+			// retried on the next callback.
+			SDL_CondWaitTimeout(dec->cond, dec->mutex, IDLE_TIMEOUT);
+			continue;
+		}
+
+		AudioStream *stream = dec->stream;
+		SDL_AudioStream *pipe = dec->pipe;
+		bool loop = dec->loop;
+		bool clear_pipe = dec->clear_pipe;
+		ssize_t seek_pos = dec->seek_pos;
+		uint32_t generation = dec->generation;
+
+		dec->clear_pipe = false;
+		dec->seek_pos = -1;
+		dec->busy = true;
+
+		// Do all I/O and decoding without the lock, so that seeking and telling don't stall on it
+		SDL_UnlockMutex(dec->mutex);
+
+		if(clear_pipe) {
+			SDL_AudioStreamClear(pipe);
+		}
+
+		DecodedChunk decoded;
+
+		if(seek_pos >= 0 && astream_seek(stream, seek_pos) < 0) {
+			decoded = (DecodedChunk) { .error = true, .src_pos = -1 };
+		} else {
+			decoded = sdecoder_decode_chunk(stream, pipe, loop, CHUNK_FRAMES * frame_size, chunk);
+
+			if(pipe) {
+				decoded.pipe_frames = max(0, SDL_AudioStreamAvailable(pipe)) / frame_size;
+			}
+		}
+
+		SDL_LockMutex(dec->mutex);
+		dec->busy = false;
+
+		if(dec->pending.set) {
+			// Whatever has just been decoded belongs to the old source; the generation has changed.
+			dec->pending.set = false;
+			sdecoder_attach(dec, dec->pending.stream, dec->pending.pos, dec->pending.loop);
+		}
+
+		if(generation == dec->generation) {
+			assert(decoded.size % frame_size == 0);
+			ring_write(dec, chunk, decoded.size / frame_size);
+
+			dec->src_pos = decoded.src_pos;
+			dec->pipe_frames = decoded.pipe_frames;
+			dec->wrapped |= decoded.wrapped;
+			dec->error |= decoded.error;
+
+			if(decoded.end) {
+				SDL_AtomicSet(&dec->eos, 1);
+			}
+		}
+
+		// sdecoder_wait_released may be waiting for the stream to be released
+		SDL_CondBroadcast(dec->cond);
+	}
+
+	SDL_UnlockMutex(dec->mutex);
+	mem_free(chunk);
+
+	return NULL;
+}
+
+StreamDecoder *sdecoder_create(const AudioStreamSpec *dst_spec, const char *name) {
+	auto dec = ALLOC(StreamDecoder, {
+		.seek_pos = -1,
+		.src_pos = -1,
+	});
+	dec->spec = *dst_spec;
+	dec->ring = mem_alloc(RING_FRAMES * dst_spec->frame_size);
+
+	if(!(dec->mutex = SDL_CreateMutex())) {
+		log_sdl_error(LOG_ERROR, "SDL_CreateMutex");
+		goto fail;
+	}
+
+	if(!(dec->cond = SDL_CreateCond())) {
+		log_sdl_error(LOG_ERROR, "SDL_CreateCond");
+		goto fail;
+	}
+
+	if(!(dec->thread = thread_create(name, sdecoder_thread, dec, THREAD_PRIO_HIGH))) {
+		log_warn("Failed to create the decoder thread, will decode %s synchronously", name);
+		goto fail;
+	}
+
+	return dec;
+
+fail:
+	if(dec->cond) {
+		SDL_DestroyCond(dec->cond);
+	}
+
+	if(dec->mutex) {
+		SDL_DestroyMutex(dec->mutex);
+	}
+
+	mem_free(dec->ring);
+	mem_free(dec);
+	return NULL;
+}
+
+void sdecoder_destroy(StreamDecoder *dec) {
+	SDL_LockMutex(dec->mutex);
+	dec->quit = true;
+	SDL_CondBroadcast(dec->cond);
+	SDL_UnlockMutex(dec->mutex);
+
+	thread_wait(dec->thread);
+
+	SDL_FreeAudioStream(dec->pipe);
+	SDL_DestroyCond(dec->cond);
+	SDL_DestroyMutex(dec->mutex);
+	mem_free(dec->ring);
+	mem_free(dec);
+}
+
+// The stream that is or is about to be attached. Must be called with the mutex locked.
+static AudioStream *sdecoder_source(StreamDecoder *dec) {
+	return dec->pending.set ? dec->pending.stream : dec->stream;
+}
+
+bool sdecoder_set_source(StreamDecoder *dec, AudioStream *stream, size_t pos, bool loop) {
+	if(stream && stream->length >= 0 && pos >= stream->length) {
+		log_error("Position %zu out of range", pos);
+		return false;
+	}
+
+	SDL_LockMutex(dec->mutex);
+	sdecoder_reset(dec);
+
+	if(dec->busy) {
+		// The decoder thread is still reading from the old stream. Leave the switch to it, and
+		// don't wait: we may be holding up the audio callback.
+		dec->pending.stream = stream;
+		dec->pending.pos = pos;
+		dec->pending.loop = loop;
+		dec->pending.set = true;
+		dec->src_pos = stream ? pos : -1;
+	} else {
+		dec->pending.set = false;
+		sdecoder_attach(dec, stream, pos, loop);
+	}
+
+	SDL_CondBroadcast(dec->cond);
+	SDL_UnlockMutex(dec->mutex);
+	return true;
+}
+
+void sdecoder_wait_released(StreamDecoder *dec, AudioStream *stream) {
+	SDL_LockMutex(dec->mutex);
+	assert(sdecoder_source(dec) != stream);
+
+	// A pending switch is applied as soon as the chunk is done, before the mutex is released
+	while(dec->busy && dec->stream == stream) {
+		SDL_CondWait(dec->cond, dec->mutex);
+	}
+
+	SDL_UnlockMutex(dec->mutex);
+}
+
+ssize_t sdecoder_seek(StreamDecoder *dec, size_t pos) {
+	ssize_t ofs = -1;
+
+	SDL_LockMutex(dec->mutex);
+
+	if(!sdecoder_source(dec)) {
+		// nothing to do
+	} else if(dec->pending.set) {
+		// Not attached yet; just start from the new position
+		if(dec->pending.stream->length >= 0 && pos >= dec->pending.stream->length) {
+			log_error("Position %zu out of range", pos);
+		} else {
+			dec->pending.pos = ofs = pos;
+		}
+	} else if(dec->busy) {
+		// Let the decoder thread do it before its next chunk; this one will be discarded
+		if(dec->stream->length >= 0 && pos >= dec->stream->length) {
+			log_error("Position %zu out of range", pos);
+		} else {
+			sdecoder_reset(dec);
+			dec->seek_pos = ofs = pos;
+		}
+	} else if((ofs = astream_seek(dec->stream, pos)) >= 0) {
+		sdecoder_reset(dec);
+	}
+
+	if(ofs >= 0) {
+		dec->src_pos = ofs;
+		SDL_CondBroadcast(dec->cond);
+	}
+
+	SDL_UnlockMutex(dec->mutex);
+
+	return ofs;
+}
+
+ssize_t sdecoder_tell(StreamDecoder *dec) {
+	ssize_t ofs = -1;
+
+	SDL_LockMutex(dec->mutex);
+
+	AudioStream *stream = sdecoder_source(dec);
+
+	if(stream && (ofs = dec->src_pos) >= 0) {
+		// Frames that have been decoded, but not played yet
+		uint32_t lag_frames = ring_used(dec) + dec->pipe_frames;
+
+		ofs -= astream_util_time_to_offset(stream, lag_frames / (double)dec->spec.sample_rate);
+
+		ssize_t loop_start = max(0, stream->loop_start);
+
+		if(dec->wrapped && ofs < loop_start && stream->length > 0) {
+			// Still playing the tail end from before the loop point
+			ofs += stream->length - loop_start;
+		}
+
+		ofs = max(0, ofs);
+	}
+
+	SDL_UnlockMutex(dec->mutex);
+
+	return ofs;
+}
+
+size_t sdecoder_read(StreamDecoder *dec, size_t bufsize, void *buffer, bool *ended) {
+	uint32_t frame_size = dec->spec.frame_size;
+
+	// Check for the end before looking at the available data: the producer sets eos only after
+	// publishing its last frames.
+	bool eos = SDL_AtomicGet(&dec->eos);
+	uint32_t r = SDL_AtomicGet(&dec->read_pos);
+	uint32_t avail = (uint32_t)SDL_AtomicGet(&dec->write_pos) - r;
+	uint32_t wanted = bufsize / frame_size;
+	uint32_t num_frames = min(avail, wanted);
+	uint32_t ofs = r & (RING_FRAMES - 1);
+	uint32_t first = min(num_frames, RING_FRAMES - ofs);
+	uint8_t *out = buffer;
+
+	memcpy(out, dec->ring + ofs * frame_size, first * frame_size);
+	memcpy(out + first * frame_size, dec->ring, (num_frames - first) * frame_size);
+
+	SDL_AtomicSet(&dec->read_pos, r + num_frames);
+
+	*ended = eos && num_frames == avail && num_frames < wanted;
+
+	if(!eos) {
+		// Doesn't block. If the wakeup gets lost, the decoder's timeout picks up the slack.
+		SDL_CondSignal(dec->cond);
+	}
+
+	return num_frames * frame_size;
+}
@@ -0,0 +1,60 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#pragma once
+#include "taisei.h"
+
+#include "stream.h"
+
+/*
+ * Background decoder for a streaming player channel.
+ *
+ * A dedicated thread decodes (and, if needed, converts) the source stream ahead of time into a
+ * single-producer single-consumer ring buffer of output frames. The audio callback only copies
+ * already decoded PCM out of the ring, so a slow decoder frame or an I/O stall no longer results
+ * in an underrun, as long as the ring doesn't run dry.
+ *
+ * The consumer side (sdecoder_read) never blocks. Everything else, except sdecoder_wait_released,
+ * must be called with the audio device locked, i.e. never concurrently with sdecoder_read. The
+ * decoder thread doesn't hold that lock while decoding, and none of these wait for it to finish a
+ * chunk. A source switch requested in the middle of one is applied by the decoder thread right
+ * after it.
+ *
+ * If reading or converting the source fails, decoding stops and the channel stays silent until
+ * the next sdecoder_set_source or sdecoder_seek, which clear the error.
+ */
+
+typedef struct StreamDecoder StreamDecoder;
+
+// Returns NULL if threads are not available; the caller should decode synchronously then.
+StreamDecoder *sdecoder_create(const AudioStreamSpec *dst_spec, const char *name) attr_nonnull_all;
+void sdecoder_destroy(StreamDecoder *dec) attr_nonnull_all;
+
+// Starts decoding stream from offset pos, converting it to the output spec if needed. The decoder
+// seeks the stream by itself, since it may still be reading from it (e.g. when restarting the same
+// stream). Passing a NULL stream detaches the decoder from its current source. Either way, all
+// previously buffered data is discarded. Returns false if pos is out of range.
+// The caller must not touch the old stream until sdecoder_wait_released says it's safe.
+bool sdecoder_set_source(StreamDecoder *dec, AudioStream *stream, size_t pos, bool loop) attr_nonnull(1);
+
+// Waits until the decoder thread is no longer reading from stream, which must have been detached
+// with sdecoder_set_source. Call this without the audio device locked before closing the stream.
+void sdecoder_wait_released(StreamDecoder *dec, AudioStream *stream) attr_nonnull_all;
+
+// Seeks the source stream and discards buffered data. Returns the new offset, or -1 on error.
+// If the decoder thread is busy with the stream, the seek is left to it; a failure then shows up
+// as the stream ending early.
+ssize_t sdecoder_seek(StreamDecoder *dec, size_t pos) attr_nonnull_all;
+
+// Returns the offset of the source stream that is about to be played (i.e. the decoder position
+// minus whatever is still buffered), or -1 on error.
+ssize_t sdecoder_tell(StreamDecoder *dec) attr_nonnull_all;
+
+// Copies up to bufsize bytes of decoded frames into buffer and returns the amount copied.
+// Sets *ended if the source has been fully consumed.
+size_t sdecoder_read(StreamDecoder *dec, size_t bufsize, void *buffer, bool *ended) attr_nonnull_all;
@@ -90,17 +90,17 @@ bool mixer_group_get_channels_range(AudioChannelGroup group, int *first, int *la
 bool mixer_init(Mixer *mx, const AudioStreamSpec *spec) {
 	memset(mx, 0, sizeof(*mx));
 
-	if(!splayer_init(mx->players + CHANGROUP_BGM, MIXER_NUM_BGM_CHANNELS, spec)) {
+	if(!splayer_init(mx->players + CHANGROUP_BGM, MIXER_NUM_BGM_CHANNELS, spec, true)) {
 		log_error("splayer_init() failed");
 		return false;
 	}
 
-	if(!splayer_init(mx->players + CHANGROUP_SFX_GAME, MIXER_NUM_SFX_MAIN_CHANNELS, spec)) {
+	if(!splayer_init(mx->players + CHANGROUP_SFX_GAME, MIXER_NUM_SFX_MAIN_CHANNELS, spec, false)) {
 		log_error("splayer_init() failed");
 		return false;
 	}
 
-	if(!splayer_init(mx->players + CHANGROUP_SFX_UI, MIXER_NUM_SFX_UI_CHANNELS, spec)) {
+	if(!splayer_init(mx->players + CHANGROUP_SFX_UI, MIXER_NUM_SFX_UI_CHANNELS, spec, false)) {
 		log_error("splayer_init() failed");
 		return false;
 	}
@@ -358,11 +358,15 @@ void mixerbgm_unload(MixerBGMImpl *bgm) {
 void mixer_notify_bgm_unload(Mixer *mx, MixerBGMImpl *bgm) {
 	StreamPlayer *plr = GPLR(mx, CHANGROUP_BGM);
 
-	if(plr->channels[0].stream == &bgm->stream) {
+	if(splayer_uses_stream(plr, 0, &bgm->stream)) {
 		splayer_halt(plr, 0);
 	}
 }
 
+void mixer_wait_bgm_released(Mixer *mx, MixerBGMImpl *bgm) {
+	splayer_wait_stream_released(GPLR(mx, CHANGROUP_BGM), &bgm->stream);
+}
+
 MixerSFXImpl *mixersfx_load(const char *vfspath, const AudioStreamSpec *spec) {
 	SDL_RWops *rw = vfs_open(vfspath, VFS_MODE_READ | VFS_MODE_SEEKABLE);
 
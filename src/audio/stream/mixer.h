@@ -79,6 +79,8 @@ void mixersfx_unload(MixerSFXImpl *sfx) attr_nonnull(1);
 bool mixersfx_set_volume(MixerSFXImpl *sfx, double vol) attr_nonnull(1);
 
 void mixer_notify_bgm_unload(Mixer *mx, MixerBGMImpl *bgm) attr_nonnull_all;
+// Call without the audio device locked, after mixer_notify_bgm_unload and before mixerbgm_unload.
+void mixer_wait_bgm_released(Mixer *mx, MixerBGMImpl *bgm) attr_nonnull_all;
 void mixer_notify_sfx_unload(Mixer *mx, MixerSFXImpl *sfx) attr_nonnull_all;
 
 void mixer_process(Mixer *mx, size_t bufsize, void *buffer);
@@ -26,7 +26,7 @@ union audio_buffer {
 	struct stereo_frame *frames;
 };
 
-bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec) {
+bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec, bool async_decode) {
 	memset(plr, 0, sizeof(*plr));
 
 	if(dst_spec->sample_format != AUDIO_F32SYS) {
@@ -50,6 +50,12 @@ bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *ds
 		chan->gain = 1;
 		chan->paused = true;
 		alist_append(&plr->channel_history, chan);
+
+		if(async_decode) {
+			char name[32];
+			snprintf(name, sizeof(name), "audio decoder %i", i);
+			chan->decoder = sdecoder_create(dst_spec, name);
+		}
 	}
 
 	log_debug("Player spec: %iHz; %i chans; format=%i",
@@ -72,6 +78,10 @@ static inline void splayer_history_move_to_back(StreamPlayer *plr, StreamPlayerC
 }
 
 static void free_channel(StreamPlayerChannel *chan) {
+	if(chan->decoder) {
+		sdecoder_destroy(chan->decoder);
+	}
+
 	SDL_FreeAudioStream(chan->pipe);
 }
 
@@ -83,9 +93,24 @@ void splayer_shutdown(StreamPlayer *plr) {
 	mem_free(plr->channels);
 }
 
+static void splayer_halt_channel(StreamPlayer *plr, StreamPlayerChannel *pchan) {
+	pchan->stream = NULL;
+	pchan->paused = true;
+	pchan->looping = false;
+	pchan->gain = 0;
+	pchan->fade.gain = 0;
+	pchan->fade.step = 0;
+	pchan->fade.num_steps = 0;
+	pchan->fade.target = 0;
+	splayer_history_move_to_front(plr, pchan);
+}
+
 static inline void splayer_stream_ended(StreamPlayer *plr, int chan) {
 	SPAM("Audio stream ended on channel %i", chan);
-	splayer_halt(plr, chan);
+
+	// Called from the audio callback, which must not wait for the decoder thread; it stays
+	// attached to the stream until the channel is halted or reused from the outside.
+	splayer_halt_channel(plr, plr->channels + chan);
 }
 
 static size_t splayer_process_channel(StreamPlayer *plr, int chan, size_t bufsize, void *buffer) {
@@ -96,6 +121,17 @@ static size_t splayer_process_channel(StreamPlayer *plr, int chan, size_t bufsiz
 		return 0;
 	}
 
+	if(pchan->decoder) {
+		bool ended;
+		size_t read = sdecoder_read(pchan->decoder, bufsize, buffer, &ended);
+
+		if(ended) {
+			splayer_stream_ended(plr, chan);
+		}
+
+		return read;
+	}
+
 	if(pchan->looping) {
 		rflags |= ASTREAM_READ_LOOP;
 	}
@@ -240,7 +276,18 @@ bool splayer_play(StreamPlayer *plr, int chan, AudioStream *stream, bool loop, f
 		return false;
 	}
 
-	if(UNLIKELY(astream_seek(stream, astream_util_time_to_offset(stream, position)) < 0)) {
+	StreamPlayerChannel *pchan = plr->channels + chan;
+	ssize_t ofs = astream_util_time_to_offset(stream, position);
+
+	if(pchan->decoder) {
+		// The decoder may still be reading this very stream, so let it do the seeking, as well as
+		// the conversion.
+		if(UNLIKELY(!sdecoder_set_source(pchan->decoder, stream, ofs, loop))) {
+			goto fail;
+		}
+
+		pchan->decoder_source = stream;
+	} else if(UNLIKELY(astream_seek(stream, ofs) < 0)) {
 		log_error("astream_seek() failed");
 		goto fail;
 	}
@@ -250,8 +297,6 @@ bool splayer_play(StreamPlayer *plr, int chan, AudioStream *stream, bool loop, f
 		goto fail;
 	}
 
-	StreamPlayerChannel *pchan = plr->channels + chan;
-
 	pchan->stream = stream;
 	pchan->looping = loop;
 	pchan->paused = false;
@@ -272,7 +317,9 @@ bool splayer_play(StreamPlayer *plr, int chan, AudioStream *stream, bool loop, f
 		plr->dst_spec.sample_format
 	);
 
-	if(LIKELY(astream_spec_equals(&stream->spec, &plr->dst_spec))) {
+	if(pchan->decoder) {
+		// nothing to do
+	} else if(LIKELY(astream_spec_equals(&stream->spec, &plr->dst_spec))) {
 		SPAM("Stream needs no conversion");
 
 		if(pchan->pipe) {
@@ -347,15 +394,23 @@ void splayer_halt(StreamPlayer *plr, int chan) {
 	}
 
 	StreamPlayerChannel *pchan = plr->channels + chan;
-	pchan->stream = NULL;
-	pchan->paused = true;
-	pchan->looping = false;
-	pchan->gain = 0;
-	pchan->fade.gain = 0;
-	pchan->fade.step = 0;
-	pchan->fade.num_steps = 0;
-	pchan->fade.target = 0;
-	splayer_history_move_to_front(plr, pchan);
+
+	if(pchan->decoder) {
+		sdecoder_set_source(pchan->decoder, NULL, 0, false);
+		pchan->decoder_source = NULL;
+	}
+
+	splayer_halt_channel(plr, pchan);
+}
+
+void splayer_wait_stream_released(StreamPlayer *plr, AudioStream *stream) {
+	for(int i = 0; i < plr->num_channels; ++i) {
+		StreamDecoder *dec = plr->channels[i].decoder;
+
+		if(dec) {
+			sdecoder_wait_released(dec, stream);
+		}
+	}
 }
 
 static bool splayer_fade(StreamPlayer *plr, int chan, double fadetime, double fadetarget) {
@@ -396,7 +451,12 @@ double splayer_seek(StreamPlayer *plr, int chan, double position) {
 	}
 
 	ssize_t ofs = astream_util_time_to_offset(pchan->stream, position);
-	ofs = astream_seek(pchan->stream, ofs);
+
+	if(pchan->decoder) {
+		ofs = sdecoder_seek(pchan->decoder, ofs);
+	} else {
+		ofs = astream_seek(pchan->stream, ofs);
+	}
 
 	if(UNLIKELY(ofs < 0)) {
 		log_error("astream_seek() failed");
@@ -419,7 +479,13 @@ double splayer_tell(StreamPlayer *plr, int chan) {
 		return -1;
 	}
 
-	ssize_t ofs = astream_tell(pchan->stream);
+	ssize_t ofs;
+
+	if(pchan->decoder) {
+		ofs = sdecoder_tell(pchan->decoder);
+	} else {
+		ofs = astream_tell(pchan->stream);
+	}
 
 	if(UNLIKELY(ofs < 0)) {
 		log_error("astream_tell() failed");
@@ -461,6 +527,15 @@ bool splayer_is_looping(StreamPlayer *plr, int chan) {
 	return loop;
 }
 
+bool splayer_uses_stream(StreamPlayer *plr, int chan, AudioStream *stream) {
+	if(!splayer_validate_channel(plr, chan)) {
+		return false;
+	}
+
+	StreamPlayerChannel *pchan = plr->channels + chan;
+	return pchan->stream == stream || (pchan->decoder && pchan->decoder_source == stream);
+}
+
 static bool is_fading_out(StreamPlayerChannel *pchan) {
 	return pchan->fade.num_steps && pchan->fade.target == 0;
 }
@@ -11,6 +11,7 @@
 
 #include "stream.h"
 #include "list.h"
+#include "decoder.h"
 
 typedef struct StreamPlayerChannel StreamPlayerChannel;
 typedef struct StreamPlayer StreamPlayer;
@@ -19,6 +20,8 @@ struct StreamPlayerChannel {
 	LIST_INTERFACE(StreamPlayerChannel);
 	AudioStream *stream;
 	SDL_AudioStream *pipe;
+	StreamDecoder *decoder;
+	AudioStream *decoder_source;  // may outlive stream if the callback ended playback
 	AudioStreamSpec src_spec;
 	float gain;
 	struct {
@@ -40,7 +43,7 @@ struct StreamPlayer {
 	bool paused;
 };
 
-bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec) attr_nonnull_all;
+bool splayer_init(StreamPlayer *plr, int num_channels, const AudioStreamSpec *dst_spec, bool async_decode) attr_nonnull_all;
 void splayer_shutdown(StreamPlayer *plr) attr_nonnull_all;
 void splayer_process(StreamPlayer *plr, size_t bufsize, void *buffer) attr_nonnull_all;
 bool splayer_play(StreamPlayer *plr, int chan, AudioStream *stream, bool loop, float gain, double position, double fadein) attr_nonnull_all;
@@ -52,6 +55,9 @@ bool splayer_fadein(StreamPlayer *plr, int chan, double fadetime) attr_nonnull_a
 double splayer_seek(StreamPlayer *plr, int chan, double position) attr_nonnull_all;
 double splayer_tell(StreamPlayer *plr, int chan) attr_nonnull_all;
 bool splayer_is_looping(StreamPlayer *plr, int chan) attr_nonnull_all;
+bool splayer_uses_stream(StreamPlayer *plr, int chan, AudioStream *stream) attr_nonnull_all;
+// Must be called without the audio device locked, after halting every channel that used stream.
+void splayer_wait_stream_released(StreamPlayer *plr, AudioStream *stream) attr_nonnull_all;
 bool splayer_global_pause(StreamPlayer *plr) attr_nonnull_all;
 bool splayer_global_resume(StreamPlayer *plr) attr_nonnull_all;
 int splayer_pick_channel(StreamPlayer *plr) attr_nonnull_all;
@@ -0,0 +1,282 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "benchmark.h"
+#include "hirestime.h"
+#include "util.h"
+
+typedef struct BenchmarkFrame {
+	hrtime_t times[NUM_BENCH_SECTIONS];
+} BenchmarkFrame;
+
+typedef struct BenchmarkRun {
+	char *label;
+	DYNAMIC_ARRAY(BenchmarkFrame) frames;
+} BenchmarkRun;
+
+typedef struct BenchmarkSummary {
+	uint num_frames;
+	hrtime_t p50, p95, p99, max, total;
+} BenchmarkSummary;
+
+static const char *section_names[] = {
+	[BENCH_FRAME]       = "frame",
+	[BENCH_TASKS]       = "tasks",
+	[BENCH_ENEMIES]     = "enemies",
+	[BENCH_PROJECTILES] = "projectiles",
+	[BENCH_ITEMS]       = "items",
+	[BENCH_LASERS]      = "lasers",
+};
+
+static_assert(ARRAY_SIZE(section_names) == NUM_BENCH_SECTIONS, "");
+
+bool _benchmark_active;
+
+static struct {
+	DYNAMIC_ARRAY(BenchmarkRun) runs;
+	BenchmarkFrame current;
+	hrtime_t section_start[NUM_BENCH_SECTIONS];
+	bool frame_started;
+} bench;
+
+void _benchmark_section_begin(BenchmarkSection section) {
+	assert((uint)section < NUM_BENCH_SECTIONS);
+
+	if(section == BENCH_FRAME) {
+		memset(&bench.current, 0, sizeof(bench.current));
+		bench.frame_started = true;
+	}
+
+	bench.section_start[section] = time_get();
+}
+
+void _benchmark_section_end(BenchmarkSection section) {
+	assert((uint)section < NUM_BENCH_SECTIONS);
+	// Sections may be entered more than once per frame (e.g. process_projectiles); accumulate.
+	bench.current.times[section] += time_get() - bench.section_start[section];
+}
+
+void _benchmark_frame_end(void) {
+	if(!bench.frame_started) {
+		return;
+	}
+
+	_benchmark_section_end(BENCH_FRAME);
+	bench.frame_started = false;
+
+	// The subsystems are updated by the stage's main task, so their time is included in the
+	// scheduler's. Report the remainder, so that the sections add up to (roughly) the frame time.
+	hrtime_t *t = bench.current.times;
+	hrtime_t nested = t[BENCH_ENEMIES] + t[BENCH_PROJECTILES] + t[BENCH_ITEMS] + t[BENCH_LASERS];
+	t[BENCH_TASKS] = t[BENCH_TASKS] > nested ? t[BENCH_TASKS] - nested : 0;
+
+	BenchmarkRun *run = dynarray_get_ptr(&bench.runs, bench.runs.num_elements - 1);
+	*dynarray_append(&run->frames) = bench.current;
+}
+
+void benchmark_begin_run(const char *label) {
+	assert(!_benchmark_active);
+
+	*dynarray_append(&bench.runs) = (BenchmarkRun) {
+		.label = strdup(label),
+	};
+
+	bench.frame_started = false;
+	_benchmark_active = true;
+}
+
+void benchmark_end_run(void) {
+	assert(_benchmark_active);
+	_benchmark_active = false;
+
+	BenchmarkRun *run = dynarray_get_ptr(&bench.runs, bench.runs.num_elements - 1);
+	log_info("Benchmark run '%s' finished: %u logic frames", run->label, run->frames.num_elements);
+}
+
+static int hrtime_cmp(const void *ptr1, const void *ptr2) {
+	hrtime_t t1 = *(const hrtime_t*)ptr1;
+	hrtime_t t2 = *(const hrtime_t*)ptr2;
+	return (t1 > t2) - (t1 < t2);
+}
+
+static hrtime_t percentile(const hrtime_t *sorted, uint num, uint pct) {
+	// nearest-rank method
+	uint rank = (num * pct + 99) / 100;
+	return sorted[rank ? rank - 1 : 0];
+}
+
+static void summarize(
+	uint num_runs, BenchmarkRun runs[num_runs], BenchmarkSection section,
+	hrtime_t *scratch, BenchmarkSummary *out
+) {
+	uint n = 0;
+	hrtime_t total = 0;
+
+	for(uint r = 0; r < num_runs; ++r) {
+		dynarray_foreach_elem(&runs[r].frames, BenchmarkFrame *f, {
+			scratch[n++] = f->times[section];
+			total += f->times[section];
+		});
+	}
+
+	*out = (BenchmarkSummary) { .num_frames = n, .total = total };
+
+	if(n == 0) {
+		return;
+	}
+
+	qsort(scratch, n, sizeof(*scratch), hrtime_cmp);
+	out->p50 = percentile(scratch, n, 50);
+	out->p95 = percentile(scratch, n, 95);
+	out->p99 = percentile(scratch, n, 99);
+	out->max = scratch[n - 1];
+}
+
+static double to_usec(hrtime_t t) {
+	return t / (double)(HRTIME_RESOLUTION / 1000000);
+}
+
+static void write_json_string(SDL_RWops *out, const char *s) {
+	SDL_RWprintf(out, "\"");
+
+	for(; *s; ++s) {
+		if(*s == '"' || *s == '\\') {
+			SDL_RWprintf(out, "\\%c", *s);
+		} else if((uchar)*s < 0x20) {
+			SDL_RWprintf(out, "\\u%04x", (uchar)*s);
+		} else {
+			SDL_RWprintf(out, "%c", *s);
+		}
+	}
+
+	SDL_RWprintf(out, "\"");
+}
+
+static void write_csv_string(SDL_RWops *out, const char *s) {
+	if(!strpbrk(s, ",\"\r\n")) {
+		SDL_RWprintf(out, "%s", s);
+		return;
+	}
+
+	SDL_RWprintf(out, "\"");
+
+	for(; *s; ++s) {
+		if(*s == '"') {
+			SDL_RWprintf(out, "\"\"");
+		} else {
+			SDL_RWprintf(out, "%c", *s);
+		}
+	}
+
+	SDL_RWprintf(out, "\"");
+}
+
+static void write_json_group(
+	SDL_RWops *out, const char *label, uint num_runs, BenchmarkRun runs[num_runs], hrtime_t *scratch
+) {
+	SDL_RWprintf(out, "\t\t{\n\t\t\t\"replay\": ");
+	write_json_string(out, label);
+	SDL_RWprintf(out, ",\n\t\t\t\"sections\": {\n");
+
+	for(BenchmarkSection s = 0; s < NUM_BENCH_SECTIONS; ++s) {
+		BenchmarkSummary sum;
+		summarize(num_runs, runs, s, scratch, &sum);
+		SDL_RWprintf(out,
+			"\t\t\t\t\"%s\": { \"frames\": %u, \"p50_us\": %.3f, \"p95_us\": %.3f, "
+			"\"p99_us\": %.3f, \"max_us\": %.3f, \"total_us\": %.3f }%s\n",
+			section_names[s], sum.num_frames,
+			to_usec(sum.p50), to_usec(sum.p95), to_usec(sum.p99), to_usec(sum.max), to_usec(sum.total),
+			s == NUM_BENCH_SECTIONS - 1 ? "" : ","
+		);
+	}
+
+	SDL_RWprintf(out, "\t\t\t}\n\t\t}");
+}
+
+static void write_csv_group(
+	SDL_RWops *out, const char *label, uint num_runs, BenchmarkRun runs[num_runs], hrtime_t *scratch
+) {
+	for(BenchmarkSection s = 0; s < NUM_BENCH_SECTIONS; ++s) {
+		BenchmarkSummary sum;
+		summarize(num_runs, runs, s, scratch, &sum);
+		write_csv_string(out, label);
+		SDL_RWprintf(out, ",%s,%u,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+			section_names[s], sum.num_frames,
+			to_usec(sum.p50), to_usec(sum.p95), to_usec(sum.p99), to_usec(sum.max), to_usec(sum.total)
+		);
+	}
+}
+
+bool benchmark_write_report(const char *path) {
+	assert(!_benchmark_active);
+
+	SDL_RWops *out = SDL_RWFromFile(path, "w");
+
+	if(!out) {
+		log_sdl_error(LOG_ERROR, "SDL_RWFromFile");
+		return false;
+	}
+
+	uint num_runs = bench.runs.num_elements;
+	uint max_frames = 0;
+
+	dynarray_foreach_elem(&bench.runs, BenchmarkRun *run, {
+		max_frames += run->frames.num_elements;
+	});
+
+	hrtime_t *scratch = ALLOC_ARRAY(max(max_frames, 1), typeof(*scratch));
+	bool json = strendswith(path, ".json");
+
+	// One group per replay, followed by an aggregate of all of them if there are several.
+	if(json) {
+		SDL_RWprintf(out, "{\n\t\"time_unit\": \"us\",\n\t\"results\": [\n");
+
+		for(uint i = 0; i < num_runs; ++i) {
+			BenchmarkRun *run = dynarray_get_ptr(&bench.runs, i);
+			write_json_group(out, run->label, 1, run, scratch);
+			SDL_RWprintf(out, i == num_runs - 1 && num_runs < 2 ? "\n" : ",\n");
+		}
+
+		if(num_runs > 1) {
+			write_json_group(out, "*", num_runs, bench.runs.data, scratch);
+			SDL_RWprintf(out, "\n");
+		}
+
+		SDL_RWprintf(out, "\t]\n}\n");
+	} else {
+		SDL_RWprintf(out, "replay,section,frames,p50_us,p95_us,p99_us,max_us,total_us\n");
+
+		for(uint i = 0; i < num_runs; ++i) {
+			BenchmarkRun *run = dynarray_get_ptr(&bench.runs, i);
+			write_csv_group(out, run->label, 1, run, scratch);
+		}
+
+		if(num_runs > 1) {
+			write_csv_group(out, "*", num_runs, bench.runs.data, scratch);
+		}
+	}
+
+	mem_free(scratch);
+	SDL_RWclose(out);
+
+	log_info("Benchmark report written to %s", path);
+	return true;
+}
+
+void benchmark_shutdown(void) {
+	_benchmark_active = false;
+
+	dynarray_foreach_elem(&bench.runs, BenchmarkRun *run, {
+		mem_free(run->label);
+		dynarray_free_data(&run->frames);
+	});
+
+	dynarray_free_data(&bench.runs);
+}
@@ -0,0 +1,63 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#pragma once
+#include "taisei.h"
+
+/*
+ * Logic frame profiler for --benchmark-replay.
+ *
+ * Records the wall time of every logic frame and of the major subsystems updated within it.
+ * Samples are grouped into runs (one per replay) and summarized into percentiles at the end.
+ * When no benchmark is active, the section hooks reduce to a single predictable branch.
+ */
+
+typedef enum BenchmarkSection {
+	BENCH_FRAME,        // the whole logic frame
+	BENCH_TASKS,        // cosched_run_tasks(), excluding the sections below
+	BENCH_ENEMIES,      // process_enemies()
+	BENCH_PROJECTILES,  // process_projectiles(), both projectiles and particles
+	BENCH_ITEMS,        // process_items()
+	BENCH_LASERS,       // process_lasers()
+	NUM_BENCH_SECTIONS,
+} BenchmarkSection;
+
+extern bool _benchmark_active;
+
+void _benchmark_section_begin(BenchmarkSection section);
+void _benchmark_section_end(BenchmarkSection section);
+void _benchmark_frame_end(void);
+
+INLINE void benchmark_section_begin(BenchmarkSection section) {
+	if(UNLIKELY(_benchmark_active)) {
+		_benchmark_section_begin(section);
+	}
+}
+
+INLINE void benchmark_section_end(BenchmarkSection section) {
+	if(UNLIKELY(_benchmark_active)) {
+		_benchmark_section_end(section);
+	}
+}
+
+// Ends the BENCH_FRAME section and commits all samples of the frame.
+INLINE void benchmark_frame_end(void) {
+	if(UNLIKELY(_benchmark_active)) {
+		_benchmark_frame_end();
+	}
+}
+
+// Starts recording a new run. The label is copied.
+void benchmark_begin_run(const char *label) attr_nonnull_all;
+void benchmark_end_run(void);
+
+// Writes the summary of all runs to a system path. The format is JSON if the path ends
+// with ".json", CSV otherwise.
+bool benchmark_write_report(const char *path) attr_nonnull_all;
+
+void benchmark_shutdown(void);
@@ -28,6 +28,8 @@ enum {
 	OPT_CUTSCENE_LIST,
 	OPT_FORCE_INTRO,
 	OPT_REREPLAY,
+	OPT_BENCHMARK_REPLAY,
+	OPT_BENCHMARK_OUTPUT,
 	OPT_POPCACHE,
 	OPT_UNLOCKALL,
 };
@@ -79,6 +81,8 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 		{{"replay",             required_argument,  0, 'r'},            "Play a replay from %s", "FILE"},
 		{{"verify-replay",      required_argument,  0, 'R'},            "Play a replay from %s in headless mode, crash as soon as it desyncs unless --rereplay is used", "FILE"},
 		{{"rereplay",           required_argument,  0, OPT_REREPLAY},   "Re-record replay into %s; specify input with -r or -R", "OUTFILE"},
+		{{"benchmark-replay",   required_argument,  0, OPT_BENCHMARK_REPLAY}, "Play a replay from %s in headless mode at uncapped speed and measure logic frame times; may be repeated", "FILE"},
+		{{"benchmark-output",   required_argument,  0, OPT_BENCHMARK_OUTPUT}, "Write the --benchmark-replay report into %s (JSON if it ends with .json, CSV otherwise)", "OUTFILE"},
 #ifdef DEBUG
 		{{"play",               no_argument,        0, 'p'},            "Play a specific stage"},
 		{{"sid",                required_argument,  0, 'i'},            "Select stage by %s", "ID"},
@@ -160,6 +164,13 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 			a->type = CLI_VerifyReplay;
 			stralloc(&a->filename, optarg);
 			break;
+		case OPT_BENCHMARK_REPLAY:
+			a->type = CLI_BenchmarkReplay;
+			*dynarray_append(&a->benchmark_replays) = strdup(optarg);
+			break;
+		case OPT_BENCHMARK_OUTPUT:
+			stralloc(&a->benchmark_out, optarg);
+			break;
 		case OPT_REREPLAY:
 			stralloc(&a->out_replay, optarg);
 			env_set("TAISEI_REPLAY_DESYNC_CHECK_FREQUENCY", 1, false);
@@ -274,6 +285,7 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 		switch(a->type) {
 			case CLI_PlayReplay:
 			case CLI_VerifyReplay:
+			case CLI_BenchmarkReplay:
 			case CLI_SelectStage:
 				if(stageinfo_get_by_id(stageid) == NULL) {
 					log_fatal("Invalid stage id: %X", stageid);
@@ -304,6 +316,18 @@ int cli_args(int argc, char **argv, CLIAction *a) {
 		log_fatal("--rereplay requires --replay or --verify-replay");
 	}
 
+	if(a->type == CLI_BenchmarkReplay) {
+		if(a->benchmark_replays.num_elements > 1 && a->stageid) {
+			log_fatal("--sid can't be used with multiple --benchmark-replay files");
+		}
+
+		if(!a->benchmark_out) {
+			stralloc(&a->benchmark_out, "benchmark.csv");
+		}
+	} else if(a->benchmark_out) {
+		log_warn("--benchmark-output was ignored");
+	}
+
 	return 0;
 }
 
@@ -312,4 +336,12 @@ void free_cli_action(CLIAction *a) {
 	a->filename = NULL;
 	mem_free(a->out_replay);
 	a->out_replay = NULL;
+	mem_free(a->benchmark_out);
+	a->benchmark_out = NULL;
+
+	dynarray_foreach_elem(&a->benchmark_replays, char **f, {
+		mem_free(*f);
+	});
+
+	dynarray_free_data(&a->benchmark_replays);
 }
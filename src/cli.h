@@ -10,11 +10,13 @@
 #include "taisei.h"
 
 #include "plrmodes.h"
+#include "dynarray.h"
 
 typedef enum {
 	CLI_RunNormally = 0,
 	CLI_PlayReplay,
 	CLI_VerifyReplay,
+	CLI_BenchmarkReplay,
 	CLI_SelectStage,
 	CLI_DumpStages,
 	CLI_DumpVFSTree,
@@ -28,6 +30,8 @@ typedef struct CLIAction CLIAction;
 struct CLIAction {
 	char *filename;
 	char *out_replay;
+	char *benchmark_out;
+	DYNAMIC_ARRAY(char*) benchmark_replays;
 	PlayerMode *plrmode;
 	CLIActionType type;
 	int stageid;
@@ -14,6 +14,16 @@ void coevent_init(CoEvent *evt) {
 	static uint32_t g_uid;
 	uint32_t uid = ++g_uid;
 	EVT_DEBUG("Init event %p (uid = %u)", (void*)evt, uid);
+
+	dynarray_foreach_elem(&evt->subscribers, BoxedTask *sub, {
+		CoTask *task = cotask_unbox_notnull(*sub);
+
+		if(task) {
+			cotask_event_reinitialized(task, evt);
+		}
+	});
+
+	dynarray_free_data(&evt->subscribers);
 	*evt = (CoEvent) { .unique_id = uid };
 	assert(g_uid != 0);
 }
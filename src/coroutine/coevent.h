@@ -40,6 +40,7 @@ typedef COEVENTS_ARRAY(
 	finished
 ) CoTaskEvents;
 
+// The event must be zeroed or previously initialized. Tasks still waiting on it see it as canceled.
 void coevent_init(CoEvent *evt);
 void coevent_signal(CoEvent *evt);
 void coevent_signal_once(CoEvent *evt);
@@ -19,6 +19,14 @@ void coroutines_shutdown(void) {
 	cotask_global_shutdown();
 }
 
+void coroutines_trim_stacks(void) {
+	cotask_trim_stacks();
+}
+
+void coroutines_trim_idle_stacks(void) {
+	cotask_trim_idle_stacks();
+}
+
 #ifdef CO_TASK_STATS
 #include "video.h"
 #include "resource/font.h"
@@ -12,3 +12,5 @@
 void coroutines_init(void);
 void coroutines_shutdown(void);
 void coroutines_draw_stats(void);
+void coroutines_trim_stacks(void);  // release memory held by idle pooled task stacks
+void coroutines_trim_idle_stacks(void);  // same, but only for stacks unused for a while; call once per frame
@@ -14,9 +14,9 @@ void cosched_init(CoSched *sched) {
 	memset(sched, 0, sizeof(*sched));
 }
 
-CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, bool is_subtask, CoTaskDebugInfo debug) {
+CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, bool is_subtask, CoStackClass stack_class, CoTaskDebugInfo debug) {
 	assume(sched != NULL);
-	CoTask *task = cotask_new_internal(cotask_entry);
+	CoTask *task = cotask_new_internal(cotask_entry, stack_class);
 	task->name = debug.label;
 
 #ifdef CO_TASK_DEBUG
@@ -43,28 +43,302 @@ CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg
 	return task;
 }
 
+/*
+ * Tasks are resumed in the order they were created, which is also the order of their unique_ids.
+ * Instead of polling every task on every frame, the scheduler only visits the ones that may be
+ * able to run:
+ *
+ *   - Tasks that yielded, and tasks woken up by their last subtask finishing, are queued for the
+ *     next visit they would have gotten if every task were polled. That's later on the current
+ *     frame if the scheduler hasn't reached them yet, otherwise on the next one.
+ *   - Tasks waiting for a delay sit in a hierarchical timer wheel until the frame they wake up on.
+ *   - Tasks waiting for an event are resumed directly by the event when it's signaled or canceled.
+ *   - Tasks bound to an entity are visited on every frame, because they have to die as soon as the
+ *     entity does. Deciding that doesn't involve touching their stacks, however.
+ *
+ * The observable behavior, including resume order and CoWaitResult.frames, is the same as with
+ * polling, which replays depend on.
+ */
+
+#define TIMER_WHEEL_MASK (COSCHED_TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_RANGE (UINT32_C(1) << (COSCHED_TIMER_WHEEL_BITS * COSCHED_TIMER_WHEEL_LEVELS))
+
+static void run_queue_push(CoTaskQueue *q, BoxedTask box) {
+	dynarray_size_t i = q->num_elements;
+	dynarray_append(q, box);
+	BoxedTask *heap = q->data;
+
+	while(i > 0) {
+		dynarray_size_t parent = (i - 1) / 2;
+
+		if(heap[parent].unique_id <= box.unique_id) {
+			break;
+		}
+
+		heap[i] = heap[parent];
+		i = parent;
+	}
+
+	heap[i] = box;
+}
+
+static bool run_queue_pop(CoTaskQueue *q, BoxedTask *out_box) {
+	if(q->num_elements == 0) {
+		return false;
+	}
+
+	BoxedTask *heap = q->data;
+	*out_box = heap[0];
+
+	dynarray_size_t num = --q->num_elements;
+	BoxedTask last = heap[num];
+	dynarray_size_t i = 0;
+
+	for(;;) {
+		dynarray_size_t child = 2 * i + 1;
+
+		if(child >= num) {
+			break;
+		}
+
+		if(child + 1 < num && heap[child + 1].unique_id < heap[child].unique_id) {
+			++child;
+		}
+
+		if(last.unique_id <= heap[child].unique_id) {
+			break;
+		}
+
+		heap[i] = heap[child];
+		i = child;
+	}
+
+	if(num > 0) {
+		heap[i] = last;
+	}
+
+	return true;
+}
+
+static void timer_wheel_insert(CoSched *sched, BoxedTask box, uint32_t wake_frame) {
+	uint32_t slot_frame = wake_frame;
+	uint32_t delta = wake_frame - sched->timer_frame;
+
+	if(delta >= TIMER_WHEEL_RANGE) {
+		// Park it in the last level for now; it'll be reconsidered when that slot is cascaded.
+		delta = TIMER_WHEEL_RANGE - 1;
+		slot_frame = sched->timer_frame + delta;
+	}
+
+	uint level = 0;
+
+	while(delta >> (COSCHED_TIMER_WHEEL_BITS * (level + 1))) {
+		++level;
+	}
+
+	uint slot = (slot_frame >> (COSCHED_TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+	dynarray_append(&sched->timer_wheel[level][slot], box);
+}
+
+static void schedule_visit(CoSched *sched, CoTask *task, uint32_t frame) {
+	if(task->wait.queued) {
+		// Already queued for the earliest visit it could get
+		return;
+	}
+
+	if(frame <= sched->frame) {
+		assert(sched->running);
+		run_queue_push(&sched->run_queue, cotask_box(task));
+		task->wait.queued = true;
+	} else if(frame == sched->frame + 1) {
+		dynarray_append(&sched->next_queue, cotask_box(task));
+		task->wait.queued = true;
+	} else {
+		timer_wheel_insert(sched, cotask_box(task), frame);
+	}
+}
+
+static void timer_wheel_cascade(CoSched *sched, uint level, uint slot) {
+	CoTaskQueue *q = &sched->timer_wheel[level][slot];
+	CoTaskQueue timers = *q;
+	*q = (CoTaskQueue) { 0 };
+
+	dynarray_foreach_elem(&timers, BoxedTask *box, {
+		CoTask *task = cotask_unbox(*box);
+
+		if(task && task->wait.type == COTASK_WAIT_DELAY) {
+			timer_wheel_insert(sched, *box, task->wait.wake_frame);
+		}
+	});
+
+	dynarray_free_data(&timers);
+}
+
+static void timer_wheel_expire(CoSched *sched) {
+	uint32_t frame = sched->frame;
+	sched->timer_frame = frame;
+
+	for(uint level = 1; level < COSCHED_TIMER_WHEEL_LEVELS; ++level) {
+		uint shift = COSCHED_TIMER_WHEEL_BITS * level;
+
+		if(frame & ((UINT32_C(1) << shift) - 1)) {
+			break;
+		}
+
+		timer_wheel_cascade(sched, level, (frame >> shift) & TIMER_WHEEL_MASK);
+	}
+
+	CoTaskQueue *q = &sched->timer_wheel[0][frame & TIMER_WHEEL_MASK];
+
+	dynarray_foreach_elem(q, BoxedTask *box, {
+		CoTask *task = cotask_unbox(*box);
+
+		// Entries are never removed from the wheel, so this may be a stale one.
+		if(task && task->wait.type == COTASK_WAIT_DELAY && task->wait.wake_frame == frame) {
+			schedule_visit(sched, task, frame);
+		}
+	});
+
+	q->num_elements = 0;
+}
+
+// The last frame on which the task has been visited already, or would have been if it were polled
+static uint32_t last_visit_frame(CoSched *sched, CoTask *task) {
+	if(
+		sched->running &&
+		task->unique_id > sched->cursor &&
+		task->unique_id <= sched->last_listed
+	) {
+		return sched->frame - 1;
+	}
+
+	return sched->frame;
+}
+
+void cosched_task_suspending(CoSched *sched, CoTask *task, int delay) {
+	uint32_t last_visit = last_visit_frame(sched, task);
+	task->wait.start_frame = last_visit;
+
+	if(task->wait.type == COTASK_WAIT_DELAY) {
+		assert(delay > 0);
+		task->wait.wake_frame = last_visit + delay;
+	}
+
+	if(task->bound_ent.ent) {
+		schedule_visit(sched, task, last_visit + 1);
+		return;
+	}
+
+	switch(task->wait.type) {
+		case COTASK_WAIT_NONE:
+			schedule_visit(sched, task, last_visit + 1);
+			break;
+
+		case COTASK_WAIT_DELAY:
+			schedule_visit(sched, task, task->wait.wake_frame);
+			break;
+
+		default:
+			// Woken up by coevent_signal, coevent_cancel, or cosched_task_wake
+			break;
+	}
+}
+
+void cosched_task_wake(CoSched *sched, CoTask *task) {
+	schedule_visit(sched, task, last_visit_frame(sched, task) + 1);
+}
+
+void cosched_task_finalized(CoSched *sched, CoTask *task) {
+	dynarray_append(&sched->dead_tasks, task);
+}
+
+int cosched_task_frames_waited(CoSched *sched, CoTask *task) {
+	uint32_t last_visit = last_visit_frame(sched, task);
+
+	if(sched->running && sched->cursor == task->unique_id) {
+		// The visit that wakes the task up doesn't count
+		--last_visit;
+	}
+
+	return last_visit - task->wait.start_frame + 1;
+}
+
+static bool task_may_wake(CoSched *sched, CoTask *task) {
+	if(task->bound_ent.ent && !ENT_UNBOX(task->bound_ent)) {
+		// cotask_resume will cancel it
+		return true;
+	}
+
+	switch(task->wait.type) {
+		case COTASK_WAIT_NONE:      return true;
+		case COTASK_WAIT_DELAY:     return sched->frame >= task->wait.wake_frame;
+		case COTASK_WAIT_SUBTASKS:  return task->wait.subtasks_done;
+		case COTASK_WAIT_EVENT:     return task->wait.event_reset;
+		default: UNREACHABLE;
+	}
+}
+
+static void release_dead_tasks(CoSched *sched) {
+	dynarray_foreach_elem(&sched->dead_tasks, CoTask **ptask, {
+		CoTask *t = *ptask;
+		TASK_DEBUG("<!> %s", t->debug_label);
+		assert(cotask_status(t) == CO_STATUS_DEAD);
+		alist_unlink(&sched->tasks, t);
+		cotask_free(t);
+	});
+
+	sched->dead_tasks.num_elements = 0;
+}
+
 uint cosched_run_tasks(CoSched *sched) {
 	alist_merge_tail(&sched->tasks, &sched->pending_tasks);
+	release_dead_tasks(sched);
+
+	++sched->frame;
+	sched->last_listed = sched->tasks.last ? sched->tasks.last->unique_id : 0;
+	sched->cursor = 0;
+	sched->running = true;
+
+	timer_wheel_expire(sched);
+
+	dynarray_foreach_elem(&sched->next_queue, BoxedTask *box, {
+		run_queue_push(&sched->run_queue, *box);
+	});
+
+	sched->next_queue.num_elements = 0;
 
 	uint ran = 0;
 
 	TASK_DEBUG("---------------------------------------------------------------");
-	for(CoTask *t = sched->tasks.first, *next; t; t = next) {
-		next = t->next;
+	for(BoxedTask box; run_queue_pop(&sched->run_queue, &box);) {
+		CoTask *t = cotask_unbox(box);
+
+		if(!t) {
+			continue;
+		}
+
+		t->wait.queued = false;
 
 		if(cotask_status(t) == CO_STATUS_DEAD) {
-			TASK_DEBUG("<!> %s", t->debug_label);
-			alist_unlink(&sched->tasks, t);
-			cotask_free(t);
-		} else {
+			continue;
+		}
+
+		assert(t->unique_id <= sched->last_listed);
+		assert(cotask_status(t) == CO_STATUS_SUSPENDED);
+		sched->cursor = t->unique_id;
+		++ran;
+
+		if(task_may_wake(sched, t)) {
 			TASK_DEBUG(">>> %s", t->debug_label);
-			assert(cotask_status(t) == CO_STATUS_SUSPENDED);
 			cotask_resume(t, NULL);
-			++ran;
+		} else if(t->bound_ent.ent) {
+			// Still waiting, but its entity has to be checked again on the next frame
+			schedule_visit(sched, t, sched->frame + 1);
 		}
 	}
 	TASK_DEBUG("---------------------------------------------------------------");
 
+	sched->running = false;
 	return ran;
 }
 
@@ -80,7 +354,7 @@ static uint gather_blocking_events(CoTaskList *tasks, events_hashset *events) {
 
 		CoTaskData *tdata = t->data;
 
-		if(tdata->wait.wait_type != COTASK_WAIT_EVENT) {
+		if(t->wait.type != COTASK_WAIT_EVENT) {
 			continue;
 		}
 
@@ -135,5 +409,17 @@ void cosched_finish(CoSched *sched) {
 	finish_task_list(&sched->pending_tasks);
 	assert(!sched->tasks.first);
 	assert(!sched->pending_tasks.first);
+
+	// Everything left in here refers to tasks that are gone now
+	dynarray_free_data(&sched->run_queue);
+	dynarray_free_data(&sched->next_queue);
+	dynarray_free_data(&sched->dead_tasks);
+
+	for(uint level = 0; level < COSCHED_TIMER_WHEEL_LEVELS; ++level) {
+		for(uint slot = 0; slot < COSCHED_TIMER_WHEEL_SLOTS; ++slot) {
+			dynarray_free_data(&sched->timer_wheel[level][slot]);
+		}
+	}
+
 	memset(sched, 0, sizeof(*sched));
 }
@@ -13,15 +13,35 @@
 
 typedef struct CoSched CoSched;
 
+#define COSCHED_TIMER_WHEEL_LEVELS 4
+#define COSCHED_TIMER_WHEEL_BITS 6
+#define COSCHED_TIMER_WHEEL_SLOTS (1 << COSCHED_TIMER_WHEEL_BITS)
+
+typedef DYNAMIC_ARRAY(BoxedTask) CoTaskQueue;
+
 struct CoSched {
+	// All live tasks, in the order they were created. This is also the order in which they are
+	// resumed within a frame.
 	CoTaskList tasks, pending_tasks;
+
+	// Only tasks that may be runnable are visited on each frame; see cosched.c
+	CoTaskQueue run_queue;   // binary heap ordered by task unique_id
+	CoTaskQueue next_queue;
+	CoTaskQueue timer_wheel[COSCHED_TIMER_WHEEL_LEVELS][COSCHED_TIMER_WHEEL_SLOTS];
+	DYNAMIC_ARRAY(CoTask*) dead_tasks;
+
+	uint32_t frame;        // number of cosched_run_tasks calls so far
+	uint32_t timer_frame;  // last frame whose timers have been expired
+	uint32_t cursor;       // unique_id of the task being visited
+	uint32_t last_listed;  // unique_id of the last task visited on this frame
+	bool running;
 };
 
 void cosched_init(CoSched *sched);
-CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, bool is_subtask, CoTaskDebugInfo debug);  // creates and runs the task, schedules it for resume on cosched_run_tasks if it's still alive
-#define cosched_new_task(sched, func, arg, arg_size, debug_label) \
-	_cosched_new_task(sched, func, arg, arg_size, false, COTASK_DEBUG_INFO(debug_label))
-#define cosched_new_subtask(sched, func, arg, arg_size, debug_label) \
-	_cosched_new_task(sched, func, arg, arg_size, true, COTASK_DEBUG_INFO(debug_label))
-uint cosched_run_tasks(CoSched *sched);  // returns number of tasks ran
+CoTask *_cosched_new_task(CoSched *sched, CoTaskFunc func, void *arg, size_t arg_size, bool is_subtask, CoStackClass stack_class, CoTaskDebugInfo debug);  // creates and runs the task, schedules it for resume on cosched_run_tasks if it's still alive
+#define cosched_new_task(sched, func, arg, arg_size, stack_class, debug_label) \
+	_cosched_new_task(sched, func, arg, arg_size, false, stack_class, COTASK_DEBUG_INFO(debug_label))
+#define cosched_new_subtask(sched, func, arg, arg_size, stack_class, debug_label) \
+	_cosched_new_task(sched, func, arg, arg_size, true, stack_class, COTASK_DEBUG_INFO(debug_label))
+uint cosched_run_tasks(CoSched *sched);  // returns number of tasks visited
 void cosched_finish(CoSched *sched);
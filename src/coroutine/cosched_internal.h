@@ -0,0 +1,23 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#pragma once
+#include "taisei.h"
+
+// Must be called by a task right before it suspends itself, after setting task->wait.type.
+// The delay is only used with COTASK_WAIT_DELAY.
+void cosched_task_suspending(CoSched *sched, CoTask *task, int delay);
+
+// Arranges for a waiting task to be visited as soon as it would have been if it were polled.
+void cosched_task_wake(CoSched *sched, CoTask *task);
+
+// The task will be released on the next cosched_run_tasks call.
+void cosched_task_finalized(CoSched *sched, CoTask *task);
+
+// The value of CoWaitResult.frames for a task that stops waiting right now.
+int cosched_task_frames_waited(CoSched *sched, CoTask *task);
@@ -10,8 +10,13 @@
 
 #include "internal.h"
 
-static CoTaskList task_pool;
+static CoTaskList task_pools[NUM_CO_STACK_CLASSES];
 static koishi_coroutine_t *co_main;
+static uint32_t resume_counter;
+static uint32_t trim_epoch;
+
+// A pooled stack must sit unused through this many cotask_trim_idle_stacks() calls to be trimmed
+#define IDLE_TRIM_INTERVAL 120
 
 #ifdef CO_TASK_DEBUG
 size_t _cotask_debug_event_id;
@@ -21,144 +26,210 @@ size_t _cotask_debug_event_id;
 CoTaskStats cotask_stats;
 #endif
 
-#ifdef CO_TASK_STATS_STACK
+#ifdef CO_STACK_VM
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 /*
- * Crude and simple method to estimate stack usage per task: at init time, fill
- * the entire stack with a known 32-bit pattern (the "canary"). The canary is
- * pseudo-random and depends on the task's unique ID. After the task is finished,
- * try to find the first occurrence of the canary since the base of the stack
- * with a fast binary search. If we happen to find a false canary somewhere
- * in the middle of actually used stack space, well, tough luck. This was never
- * meant to be exact, and it's pretty unlikely anyway. A linear search from the
- * end of the region would fix this potential problem, but is slower.
+ * The stacks are allocated by koishi, so we can't reserve extra address space around them.
+ * Instead, the lowest whole page of the usable region is made inaccessible, so that an overflow
+ * (much more likely with the small stack classes) crashes right away, rather than silently
+ * corrupting whatever lies below. The stacks are allocated one page larger than their class size
+ * to make up for it.
+ *
+ * Pooled stacks keep every page they've ever touched resident. cotask_trim_stacks() hands those
+ * back to the OS; they're zero-filled on demand once the stack is reused. The event loop calls
+ * cotask_trim_idle_stacks() when it has time to spare, which only trims the stacks that haven't
+ * been needed for a while, so that the hot ones at the front of the pools don't keep faulting
+ * their pages back in.
  *
- * Note that we assume that the stack grows down, since that's how it is on most
- * systems.
+ * Note that we assume that the stack grows down, since that's how it is on most systems.
  */
 
-/*
- * Reserve some space for control structures on the stack; we don't want to
- * overwrite that with canaries. fcontext requires this.
- */
-#define STACK_BUFFER_UPPER 64
-#define STACK_BUFFER_LOWER 0
+static size_t page_size;
 
-// for splitmix32
-#include "random.h"
-
-static inline uint32_t get_canary(CoTask *task) {
-	uint32_t temp = task->unique_id;
-	return splitmix32(&temp);
-}
-
-static void *get_stack(CoTask *task, size_t *sz) {
-	char *lower = koishi_get_stack(&task->ko, sz);
+static bool get_stack_pages(CoTask *task, char **lower, char **upper) {
+	size_t sz;
+	char *lo = koishi_get_stack(&task->ko, &sz);
 
 	// Not all koishi backends support stack inspection. Give up in those cases.
-	if(!lower || !*sz) {
-		log_debug("koishi_get_stack() returned NULL");
-		return NULL;
+	if(!lo || !sz) {
+		return false;
 	}
 
-	char *upper = lower + *sz;
-	assert(upper > lower);
+	char *hi = lo + sz;
+	lo = (char*)(((uintptr_t)lo + page_size - 1) & ~(uintptr_t)(page_size - 1));
+	hi = (char*)((uintptr_t)hi & ~(uintptr_t)(page_size - 1));
 
-	lower += STACK_BUFFER_LOWER;
-	upper -= STACK_BUFFER_UPPER;
-	*sz = upper - lower;
+	// guard page + at least a couple of usable ones
+	if(hi <= lo || (hi - lo) / page_size < 4) {
+		return false;
+	}
 
-	// ASan doesn't expect us to access stack memory manually, so we have to dodge false positives.
-	ASAN_UNPOISON_MEMORY_REGION(lower, *sz);
+	*lower = lo;
+	*upper = hi;
+	return true;
+}
 
-	return lower;
+static size_t stack_guard_size(void) {
+	return page_size;
 }
 
-static void setup_stack(CoTask *task) {
-	size_t stack_size;
-	void *stack = get_stack(task, &stack_size);
+static void stack_set_guard(CoTask *task, bool enable) {
+	char *lo, *hi;
 
-	if(!stack) {
+	if(!get_stack_pages(task, &lo, &hi)) {
 		return;
 	}
 
-	uint32_t canary = get_canary(task);
-	assert(stack_size == sizeof(canary) * (stack_size / sizeof(canary)));
+	if(mprotect(lo, page_size, enable ? PROT_NONE : PROT_READ | PROT_WRITE)) {
+		log_debug("mprotect() failed: %s", strerror(errno));
+	}
+}
 
-	for(uint32_t *p = stack; p < (uint32_t*)stack + stack_size / sizeof(canary); ++p) {
-		*p = canary;
+static void stack_trim(CoTask *task) {
+	char *lo, *hi;
+
+	if(!get_stack_pages(task, &lo, &hi)) {
+		return;
 	}
+
+	// Skip the guard page, and the top one, where koishi sets up the initial context.
+	lo += page_size;
+	hi -= page_size;
+
+#ifdef MADV_DONTNEED
+	madvise(lo, hi - lo, MADV_DONTNEED);
+#else
+	posix_madvise(lo, hi - lo, POSIX_MADV_DONTNEED);
+#endif
 }
 
+#else // CO_STACK_VM
+
+static size_t stack_guard_size(void) { return 0; }
+static void stack_set_guard(CoTask *task, bool enable) { }
+static void stack_trim(CoTask *task) { }
+
+#endif // CO_STACK_VM
+
+#ifdef CO_TASK_STATS_STACK
+
 /*
- * Find the first occurrence of a canary since the base of the stack, assuming
- * the base is at the top. Note that since this is essentially a binary search
- * on an array that may or may *not* be sorted, it can sometimes give the wrong
- * answer. This is fine though, since the odds are low and we only care about
- * finding an approximate upper bound on stack usage for all tasks, anyway.
+ * Crude and simple method to estimate stack usage per task: stacks are trimmed after every use,
+ * so the pages that are resident when the task finishes are the ones it has touched. Since this
+ * works with page granularity, it overestimates a little.
  */
-static uint32_t *find_first_canary(uint32_t *region, size_t offset, size_t sz, uint32_t canary) {
-	if(sz == 1) {
-		return region + offset;
-	}
 
-	size_t half_size = sz / 2;
-	size_t mid_index = offset + half_size;
+static void estimate_stack_usage(CoTask *task) {
+	char *lo, *hi;
 
-	if(region[mid_index] == canary) {
-		return find_first_canary(region, offset + half_size, sz - half_size, canary);
-	} else {
-		return find_first_canary(region, offset, half_size, canary);
+	if(!get_stack_pages(task, &lo, &hi)) {
+		return;
 	}
-}
 
-static void estimate_stack_usage(CoTask *task) {
-	size_t stack_size;
-	void *stack = get_stack(task, &stack_size);
+	size_t stack_size = hi - lo;
+	size_t num_pages = stack_size / page_size;
+	uchar residency[num_pages];
 
-	if(!stack) {
+	if(mincore(lo, stack_size, (void*)residency)) {
+		log_debug("mincore() failed: %s", strerror(errno));
 		return;
 	}
 
-	uint32_t canary = get_canary(task);
+	size_t lowest = 0;
 
-	size_t num_segments = stack_size / sizeof(canary);
-	uint32_t *first_segment = stack;
-	uint32_t *p_canary = find_first_canary(stack, 0, num_segments, canary);
-	assert(p_canary[1] != canary);
+	while(lowest < num_pages && !(residency[lowest] & 1)) {
+		++lowest;
+	}
 
-	size_t real_stack_size = stack_size + STACK_BUFFER_LOWER + STACK_BUFFER_UPPER;
-	size_t usage = (uintptr_t)(first_segment + num_segments - p_canary) * sizeof(canary) + STACK_BUFFER_UPPER;
-	double percentage = usage / (double)real_stack_size;
+	size_t usage = (num_pages - lowest) * page_size;
+	double percentage = usage / (double)stack_size;
 
 	if(usage > STAT_VAL(peak_stack_usage)) {
 		TASK_DEBUG(">>> %s <<<", task->debug_label);
-		log_debug("New peak stack usage: %zu out of %zu (%.02f%%); recommended CO_STACK_SIZE >= %zu",
+		log_debug("New peak stack usage: %zu out of %zu (%.02f%%) for stack class %i; recommended size >= %zu",
 			usage,
-			real_stack_size,
+			stack_size,
 			percentage * 100,
+			task->stack_class,
 			(size_t)(topow2_u64(usage) * 2)
 		);
 		STAT_VAL_SET(peak_stack_usage, usage);
 	}
+
+	stack_trim(task);
 }
 
 #else // CO_TASK_STATS_STACK
 
-static void setup_stack(CoTask *task) { }
 static void estimate_stack_usage(CoTask *task) { }
 
 #endif // CO_TASK_STATS_STACK
 
+static size_t stack_class_size(CoStackClass stack_class) {
+	switch(stack_class) {
+		case CO_STACK_SMALL:  return CO_STACK_SIZE_SMALL;
+		case CO_STACK_MEDIUM: return CO_STACK_SIZE_MEDIUM;
+		case CO_STACK_LARGE:  return CO_STACK_SIZE_LARGE;
+		default: UNREACHABLE;
+	}
+}
 
 void cotask_global_init(void) {
 	co_main = koishi_active();
+
+#ifdef CO_STACK_VM
+	page_size = sysconf(_SC_PAGESIZE);
+#endif
 }
 
 void cotask_global_shutdown(void) {
-	for(CoTask *task; (task = alist_pop(&task_pool));) {
-		koishi_deinit(&task->ko);
-		mem_free(task);
+	for(uint i = 0; i < ARRAY_SIZE(task_pools); ++i) {
+		for(CoTask *task; (task = alist_pop(&task_pools[i]));) {
+			stack_set_guard(task, false);
+			koishi_deinit(&task->ko);
+			mem_free(task);
+		}
+	}
+}
+
+static void trim_pools(bool idle_only) {
+	attr_unused uint num_trimmed = 0;
+
+	for(uint i = 0; i < ARRAY_SIZE(task_pools); ++i) {
+		for(CoTask *task = task_pools[i].first; task; task = task->next) {
+			if(!task->stack_dirty) {
+				continue;
+			}
+
+			// Returned to the pool since the previous pass; may well be reused soon
+			if(idle_only && task->pooled_trim_epoch == trim_epoch) {
+				continue;
+			}
+
+			stack_trim(task);
+			task->stack_dirty = false;
+			++num_trimmed;
+		}
+	}
+
+	++trim_epoch;
+	TASK_DEBUG("Trimmed %u pooled stacks", num_trimmed);
+}
+
+void cotask_trim_stacks(void) {
+	trim_pools(false);
+}
+
+void cotask_trim_idle_stacks(void) {
+	static uint num_calls;
+
+	if(++num_calls >= IDLE_TRIM_INTERVAL) {
+		num_calls = 0;
+		trim_pools(true);
 	}
 }
 
@@ -194,11 +265,13 @@ CoTask *cotask_unbox_notnull(BoxedTask box) {
 	return NULL;
 }
 
-CoTask *cotask_new_internal(koishi_entrypoint_t entry_point) {
+CoTask *cotask_new_internal(koishi_entrypoint_t entry_point, CoStackClass stack_class) {
 	CoTask *task;
 	STAT_VAL_ADD(num_tasks_in_use, 1);
 
-	if((task = alist_pop(&task_pool))) {
+	assert((uint)stack_class < NUM_CO_STACK_CLASSES);
+
+	if((task = alist_pop(&task_pools[stack_class]))) {
 		koishi_recycle(&task->ko, entry_point);
 		TASK_DEBUG(
 			"Recycled task %p, entry=%p (%zu tasks allocated / %zu in use)",
@@ -207,7 +280,9 @@ CoTask *cotask_new_internal(koishi_entrypoint_t entry_point) {
 		);
 	} else {
 		task = ALLOC(typeof(*task));
-		koishi_init(&task->ko, CO_STACK_SIZE, entry_point);
+		task->stack_class = stack_class;
+		koishi_init(&task->ko, stack_class_size(stack_class) + stack_guard_size(), entry_point);
+		stack_set_guard(task, true);
 		STAT_VAL_ADD(num_tasks_allocated, 1);
 		TASK_DEBUG(
 			"Created new task %p, entry=%p (%zu tasks allocated / %zu in use)",
@@ -218,10 +293,12 @@ CoTask *cotask_new_internal(koishi_entrypoint_t entry_point) {
 
 	static uint32_t unique_counter = 0;
 	task->unique_id = ++unique_counter;
-	setup_stack(task);
+	task->stack_dirty = false;
 	assert(unique_counter != 0);
 
 	task->data = NULL;
+	task->wait = (typeof(task->wait)) { 0 };
+	task->bound_ent = (BoxedEntity) { 0 };
 
 #ifdef CO_TASK_DEBUG
 	snprintf(task->debug_label, sizeof(task->debug_label), "<unknown at %p; entry=%p>", (void*)task, *(void**)&entry_point);
@@ -234,6 +311,7 @@ void *cotask_resume_internal(CoTask *task, void *arg) {
 	TASK_DEBUG_EVENT(ev);
 	TASK_DEBUG("[%zu] Resuming task %s", ev, task->debug_label);
 	STAT_VAL_ADD(num_switches_this_frame, 1);
+	++resume_counter;
 	arg = koishi_resume(&task->ko, arg);
 	TASK_DEBUG("[%zu] koishi_resume returned (%s)", ev, task->debug_label);
 	return arg;
@@ -245,7 +323,7 @@ static void cancel_task_events(CoTaskData *task_data) {
 	// just for that purpose.
 	// It's ok to unbind the entity like that, because when we get here, the
 	// task is about to die anyway.
-	task_data->bound_ent.ent = 0;
+	task_data->task->bound_ent.ent = 0;
 
 	COEVENT_CANCEL_ARRAY(task_data->events);
 }
@@ -284,11 +362,17 @@ static bool cotask_finalize(CoTask *task) {
 			 task->debug_label, task_data->master->task->debug_label
 		);
 
-		alist_unlink(&task_data->master->slaves, task_data);
+		CoTaskData *master_data = task_data->master;
+		alist_unlink(&master_data->slaves, task_data);
 		task_data->master = NULL;
+
+		if(!master_data->slaves.first && master_data->task->wait.type == COTASK_WAIT_SUBTASKS) {
+			master_data->task->wait.subtasks_done = true;
+			cosched_task_wake(master_data->sched, master_data->task);
+		}
 	}
 
-	if(task_data->wait.wait_type == COTASK_WAIT_EVENT) {
+	if(task->wait.type == COTASK_WAIT_EVENT) {
 		CoEvent *evt = NOT_NULL(task_data->wait.event.pevent);
 
 		if(evt->unique_id == task_data->wait.event.snapshot.unique_id) {
@@ -296,7 +380,7 @@ static bool cotask_finalize(CoTask *task) {
 		}
 	}
 
-	task_data->wait.wait_type = COTASK_WAIT_NONE;
+	task->wait.type = COTASK_WAIT_NONE;
 
 	attr_unused bool had_slaves = false;
 
@@ -329,6 +413,7 @@ static bool cotask_finalize(CoTask *task) {
 		heap_alloc = next;
 	}
 
+	cosched_task_finalized(task_data->sched, task);
 	task->data = NULL;
 	TASK_DEBUG("[%zu] DONE finalizing task %s", ev, task->debug_label);
 
@@ -389,7 +474,9 @@ void cotask_free(CoTask *task) {
 	estimate_stack_usage(task);
 
 	task->unique_id = 0;
-	alist_push(&task_pool, task);
+	task->stack_dirty = true;
+	task->pooled_trim_epoch = trim_epoch;
+	alist_push(&task_pools[task->stack_class], task);
 
 	STAT_VAL_ADD(num_tasks_in_use, -1);
 
@@ -474,7 +561,7 @@ static void cotask_force_cancel(CoTask *task) {
 	// CoTaskData, since we don't need any of the 'advanced' features for this.
 	// This also means we don't need to cotask_finalize it.
 
-	CoTask *cancel_task = cotask_new_internal(cotask_cancel_in_safe_context);
+	CoTask *cancel_task = cotask_new_internal(cotask_cancel_in_safe_context, CO_STACK_DEFAULT);
 
 	// This is basically just koishi_resume + some logging when built with CO_TASK_DEBUG.
 	// We can't use normal cotask_resume here, since we don't have CoTaskData.
@@ -493,75 +580,68 @@ bool cotask_cancel(CoTask *task) {
 }
 
 static void *cotask_force_resume(CoTask *task, void *arg) {
-	attr_unused CoTaskData *task_data = cotask_get_data(task);
-	assert(task_data->wait.wait_type == COTASK_WAIT_NONE);
-	assert(!task_data->bound_ent.ent || ENT_UNBOX(task_data->bound_ent));
+	assert(task->wait.type == COTASK_WAIT_NONE);
+	assert(!task->bound_ent.ent || ENT_UNBOX(task->bound_ent));
 	return cotask_resume_internal(task, arg);
 }
 
-static void *cotask_wake_and_resume(CoTask *task, void *arg) {
-	CoTaskData *task_data = cotask_get_data(task);
-	task_data->wait.wait_type = COTASK_WAIT_NONE;
+static void *cotask_wake_and_resume(CoTask *task, CoTaskData *task_data, void *arg) {
+	if(task->wait.type != COTASK_WAIT_NONE) {
+		task_data->wait.result.frames = cosched_task_frames_waited(task_data->sched, task);
+		task->wait.type = COTASK_WAIT_NONE;
+	}
+
 	return cotask_force_resume(task, arg);
 }
 
-static bool cotask_do_wait(CoTaskData *task_data) {
-	switch(task_data->wait.wait_type) {
+static bool cotask_wait_is_over(CoTask *task, CoTaskData *task_data) {
+	switch(task->wait.type) {
 		case COTASK_WAIT_NONE: {
-			return false;
+			return true;
 		}
 
 		case COTASK_WAIT_DELAY: {
-			if(--task_data->wait.delay.remaining < 0) {
-				return false;
-			}
-
-			break;
+			return task_data->sched->frame >= task->wait.wake_frame;
 		}
 
 		case COTASK_WAIT_EVENT: {
-			// TASK_DEBUG("COTASK_WAIT_EVENT in task %s", task_data->task->debug_label);
+			// TASK_DEBUG("COTASK_WAIT_EVENT in task %s", task->debug_label);
 
 			CoEventStatus stat = coevent_poll(task_data->wait.event.pevent, &task_data->wait.event.snapshot);
 			if(stat != CO_EVENT_PENDING) {
 				task_data->wait.result.event_status = stat;
-				TASK_DEBUG("COTASK_WAIT_EVENT in task %s RESULT = %i", task_data->task->debug_label, stat);
-				return false;
+				TASK_DEBUG("COTASK_WAIT_EVENT in task %s RESULT = %i", task->debug_label, stat);
+				return true;
 			}
 
-			break;
+			return false;
 		}
 
 		case COTASK_WAIT_SUBTASKS: {
-			if(task_data->slaves.first == NULL) {
-				return false;
-			}
-
-			break;
+			return task_data->slaves.first == NULL;
 		}
-	}
 
-	task_data->wait.result.frames++;
-	return true;
+		default: UNREACHABLE;
+	}
 }
 
 void *cotask_resume(CoTask *task, void *arg) {
 	CoTaskData *task_data = cotask_get_data(task);
 
-	if(task_data->bound_ent.ent && !ENT_UNBOX(task_data->bound_ent)) {
+	if(task->bound_ent.ent && !ENT_UNBOX(task->bound_ent)) {
 		cotask_force_cancel(task);
 		return NULL;
 	}
 
-	if(!cotask_do_wait(task_data)) {
-		return cotask_wake_and_resume(task, arg);
+	if(cotask_wait_is_over(task, task_data)) {
+		return cotask_wake_and_resume(task, task_data, arg);
 	}
 
-	assert(task_data->wait.wait_type != COTASK_WAIT_NONE);
+	assert(task->wait.type != COTASK_WAIT_NONE);
 	return NULL;
 }
 
-void *cotask_yield(void *arg) {
+static void *cotask_suspend(void *arg) {
 #ifdef CO_TASK_DEBUG
 	CoTask *task = cotask_active();
 #endif
@@ -573,45 +653,61 @@ void *cotask_yield(void *arg) {
 	return arg;
 }
 
-static inline CoWaitResult cotask_wait_init(CoTaskData *task_data, char wait_type) {
+void *cotask_yield(void *arg) {
+	CoTask *task = cotask_active_unsafe();
+	CoTaskData *task_data = cotask_get_data(task);
+	assert(task->wait.type == COTASK_WAIT_NONE);
+
+	cosched_task_suspending(task_data->sched, task, 0);
+	return cotask_suspend(arg);
+}
+
+static inline CoWaitResult cotask_wait_init(CoTask *task, CoTaskData *task_data, char wait_type) {
 	CoWaitResult wr = task_data->wait.result;
 	memset(&task_data->wait, 0, sizeof(task_data->wait));
-	task_data->wait.wait_type = wait_type;
+	task->wait.type = wait_type;
+	task->wait.subtasks_done = false;
+	task->wait.event_reset = false;
 	return wr;
 }
 
+static void cotask_wait_until_over(CoTask *task, CoTaskData *task_data) {
+	if(!cotask_wait_is_over(task, task_data)) {
+		cosched_task_suspending(task_data->sched, task, 0);
+		cotask_suspend(NULL);
+	}
+}
+
 int cotask_wait(int delay) {
 	CoTask *task = cotask_active_unsafe();
 	CoTaskData *task_data = cotask_get_data(task);
-	assert(task_data->wait.wait_type == COTASK_WAIT_NONE);
+	assert(task->wait.type == COTASK_WAIT_NONE);
+
+	if(delay <= 0) {
+		return 0;
+	}
 
 	if(delay == 1) {
 		cotask_yield(NULL);
 		return 1;
 	}
 
-	cotask_wait_init(task_data, COTASK_WAIT_DELAY);
-	task_data->wait.delay.remaining = delay;
+	cotask_wait_init(task, task_data, COTASK_WAIT_DELAY);
+	cosched_task_suspending(task_data->sched, task, delay);
+	cotask_suspend(NULL);
 
-	if(cotask_do_wait(task_data)) {
-		cotask_yield(NULL);
-	}
-
-	return cotask_wait_init(task_data, COTASK_WAIT_NONE).frames;
+	return cotask_wait_init(task, task_data, COTASK_WAIT_NONE).frames;
 }
 
 int cotask_wait_subtasks(void) {
 	CoTask *task = cotask_active_unsafe();
 	CoTaskData *task_data = cotask_get_data(task);
-	assert(task_data->wait.wait_type == COTASK_WAIT_NONE);
-
-	cotask_wait_init(task_data, COTASK_WAIT_SUBTASKS);
+	assert(task->wait.type == COTASK_WAIT_NONE);
 
-	if(cotask_do_wait(task_data)) {
-		cotask_yield(NULL);
-	}
+	cotask_wait_init(task, task_data, COTASK_WAIT_SUBTASKS);
+	cotask_wait_until_over(task, task_data);
 
-	return cotask_wait_init(task_data, COTASK_WAIT_NONE).frames;
+	return cotask_wait_init(task, task_data, COTASK_WAIT_NONE).frames;
 }
 
 static void *_cotask_malloc(CoTaskData *task_data, size_t size, bool allow_heap_fallback) {
@@ -673,7 +769,7 @@ static CoWaitResult cotask_wait_event_internal(CoEvent *evt, bool once) {
 	// cotask_yield() should land us somewhere inside cotask_finalize(), and the task will not be
 	// resumed again.
 	if(UNLIKELY(task_data->finalizing)) {
-		cotask_yield(NULL);
+		cotask_suspend(NULL);
 		UNREACHABLE;
 	}
 
@@ -687,15 +783,32 @@ static CoWaitResult cotask_wait_event_internal(CoEvent *evt, bool once) {
 
 	coevent_add_subscriber(evt, task);
 
-	cotask_wait_init(task_data, COTASK_WAIT_EVENT);
+	cotask_wait_init(task, task_data, COTASK_WAIT_EVENT);
 	task_data->wait.event.pevent = evt;
 	task_data->wait.event.snapshot = coevent_snapshot(evt);
+	cotask_wait_until_over(task, task_data);
 
-	if(cotask_do_wait(task_data)) {
-		cotask_yield(NULL);
+	return cotask_wait_init(task, task_data, COTASK_WAIT_NONE);
+}
+
+void cotask_event_reinitialized(CoTask *task, CoEvent *evt) {
+	if(
+		cotask_status(task) == CO_STATUS_DEAD ||
+		task->wait.type != COTASK_WAIT_EVENT
+	) {
+		return;
+	}
+
+	CoTaskData *task_data = cotask_get_data(task);
+
+	if(task_data->wait.event.pevent != evt) {
+		return;
 	}
 
-	return cotask_wait_init(task_data, COTASK_WAIT_NONE);
+	// The event's unique_id no longer matches the snapshot, so the task will see it as canceled.
+	// It is not resumed right away, but on its next scheduler visit, as if it were still polled.
+	task->wait.event_reset = true;
+	cosched_task_wake(task_data->sched, task);
 }
 
 CoWaitResult cotask_wait_event(CoEvent *evt) {
@@ -714,7 +827,7 @@ CoWaitResult cotask_wait_event_or_die(CoEvent *evt) {
 		// Edge case: should usually die here, unless the task has already been cancelled and is
 		// currently being finalized. In that case, we should just yield back to cotask_finalize().
 		assert(cotask_active_unsafe()->data->finalizing);
-		cotask_yield(NULL);
+		cotask_suspend(NULL);
 		UNREACHABLE;
 	}
 
@@ -730,15 +843,14 @@ CoSched *cotask_get_sched(CoTask *task) {
 }
 
 EntityInterface *(cotask_bind_to_entity)(CoTask *task, EntityInterface *ent) {
-	CoTaskData *task_data = cotask_get_data(task);
-	assert(task_data->bound_ent.ent == 0);
+	assert(task->bound_ent.ent == 0);
 
 	if(ent == NULL) {
 		cotask_force_cancel(task);
 		UNREACHABLE;
 	}
 
-	task_data->bound_ent = ENT_BOX(ent);
+	task->bound_ent = ENT_BOX(ent);
 	return ent;
 }
 
@@ -760,6 +872,10 @@ void cotask_force_finish(CoTask *task) {
 	cotask_free(task);
 }
 
+uint32_t cotask_get_resume_counter(void) {
+	return resume_counter;
+}
+
 const char *cotask_get_name(CoTask *task) {
 	return task->name;
 }
@@ -28,6 +28,19 @@ typedef enum CoStatus {
 	CO_STATUS_DEAD      = KOISHI_DEAD,
 } CoStatus;
 
+// Stack size classes. The small ones save memory for the swarms of short-lived tasks that control
+// individual projectiles, but must only be used for tasks that never call into anything deep
+// (e.g. on-demand resource loading). Where supported, an overflow hits a guard page and crashes.
+// The sizes are usable stack space; the guard page comes on top.
+typedef enum CoStackClass {
+	CO_STACK_SMALL,   // 16 KiB
+	CO_STACK_MEDIUM,  // 64 KiB
+	CO_STACK_LARGE,   // 256 KiB
+	NUM_CO_STACK_CLASSES,
+
+	CO_STACK_DEFAULT = CO_STACK_LARGE,
+} CoStackClass;
+
 typedef struct BoxedTask {
 	alignas(alignof(void*)) uintptr_t ptr;
 	uint32_t unique_id;
@@ -75,5 +88,9 @@ void cotask_host_events(CoTask *task, uint num_events, CoEvent events[num_events
 CoSched *cotask_get_sched(CoTask *task);
 const char *cotask_get_name(CoTask *task) attr_nonnull(1);
 
+// Incremented every time any task is resumed. Useful to detect if arbitrary task code
+// could have run (and mutated game state) between two points.
+uint32_t cotask_get_resume_counter(void);
+
 BoxedTask cotask_box(CoTask *task);
 CoTask *cotask_unbox(BoxedTask box);
@@ -9,10 +9,24 @@
 #pragma once
 #include "taisei.h"
 
-#ifdef __EMSCRIPTEN__
-	#define CO_STACK_SIZE (64 * 1024)
+#if defined(__EMSCRIPTEN__)
+	#define CO_STACK_SIZE_SMALL  (16 * 1024)
+	#define CO_STACK_SIZE_MEDIUM (64 * 1024)
+	#define CO_STACK_SIZE_LARGE  (64 * 1024)
+#elif defined(ADDRESS_SANITIZER)
+	// Instrumented frames are a lot larger; don't risk the smaller classes
+	#define CO_STACK_SIZE_SMALL  (256 * 1024)
+	#define CO_STACK_SIZE_MEDIUM (256 * 1024)
+	#define CO_STACK_SIZE_LARGE  (256 * 1024)
 #else
-	#define CO_STACK_SIZE (256 * 1024)
+	#define CO_STACK_SIZE_SMALL  (16 * 1024)
+	#define CO_STACK_SIZE_MEDIUM (64 * 1024)
+	#define CO_STACK_SIZE_LARGE  (256 * 1024)
+#endif
+
+#if defined(TAISEI_BUILDCONF_HAVE_POSIX) && !defined(__EMSCRIPTEN__)
+	// guard pages and trimming of pooled stacks with mprotect/madvise
+	#define CO_STACK_VM
 #endif
 
 #ifdef CO_TASK_DEBUG
@@ -57,6 +71,23 @@ struct CoTask {
 	uint32_t unique_id;
 	const char *name;
 
+	CoStackClass stack_class;
+	bool stack_dirty;  // in the pool, and not trimmed since it was last used
+	uint32_t pooled_trim_epoch;  // trim_epoch at the time the task was returned to the pool
+
+	// What the task is waiting for, as far as the scheduler is concerned. Kept here rather than
+	// in CoTaskData, so that a waiting task's stack isn't touched until it can actually run.
+	struct {
+		uint32_t wake_frame;   // COTASK_WAIT_DELAY: the frame on which the wait ends
+		uint32_t start_frame;  // the last frame on which the task had been visited when it began waiting
+		uint8_t type;
+		bool subtasks_done;    // COTASK_WAIT_SUBTASKS: the last subtask has finished
+		bool event_reset;      // COTASK_WAIT_EVENT: the event has been re-initialized
+		bool queued;           // will be visited by the scheduler
+	} wait;
+
+	BoxedEntity bound_ent;
+
 	char _end[0];
 
 	#ifdef CO_TASK_DEBUG
@@ -77,8 +108,8 @@ extern CoTaskStats cotask_stats;
 #define STAT_VAL_SET(name, value) ((cotask_stats.name) = (value))
 
 // enable stack usage tracking (loose)
-#ifndef _WIN32
-// NOTE: disabled by default because of heavy performance overhead under ASan
+#ifdef CO_STACK_VM
+// NOTE: disabled by default; costs a couple of syscalls per finished task
 // #define CO_TASK_STATS_STACK
 #endif
 
@@ -105,7 +136,6 @@ struct CoTaskData {
 	CoTaskData *master;              // AKA supertask
 	LIST_ANCHOR(CoTaskData) slaves;  // AKA subtasks
 
-	BoxedEntity bound_ent;
 	CoTaskEvents events;
 
 	bool finalizing;
@@ -113,18 +143,10 @@ struct CoTaskData {
 	struct {
 		CoWaitResult result;
 
-		union {
-			struct {
-				int remaining;
-			} delay;
-
-			struct {
-				CoEvent *pevent;
-				CoEventSnapshot snapshot;
-			} event;
-		};
-
-		uint wait_type;
+		struct {
+			CoEvent *pevent;
+			CoEventSnapshot snapshot;
+		} event;
 	} wait;
 
 	struct {
@@ -152,9 +174,12 @@ typedef struct CoTaskInitData {
 void cotask_global_init(void);
 void cotask_global_shutdown(void);
 
-CoTask *cotask_new_internal(koishi_entrypoint_t entry_point);
+CoTask *cotask_new_internal(koishi_entrypoint_t entry_point, CoStackClass stack_class);
+void cotask_trim_stacks(void);
+void cotask_trim_idle_stacks(void);
 void *cotask_resume_internal(CoTask *task, void *arg);
 CoTask *cotask_unbox_notnull(BoxedTask box);
+void cotask_event_reinitialized(CoTask *task, CoEvent *evt);
 void cotask_force_finish(CoTask *task);
 void *cotask_entry(void *varg);
 
@@ -19,3 +19,4 @@
 
 #include "cotask_internal.h"
 #include "coevent_internal.h"
+#include "cosched_internal.h"
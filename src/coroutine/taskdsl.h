@@ -79,9 +79,11 @@
 	/* user-defined task body */ \
 	static void COTASK_##name(TASK_ARGS_TYPE(name) *_cotask_args) /* require semicolon */
 
-#define TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage) \
+#define TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage, stack_class) \
 	/* produce warning if the task is never used */ \
 	linkage char COTASK_UNUSED_CHECK_##name; \
+	/* stack size class the task is spawned with */ \
+	enum { COTASKSTACK_##name = (stack_class) }; \
 	/* type of indirect handle to a compatible task */ \
 	typedef handletype TASK_INDIRECT_TYPE_ALIAS(name); \
 	/* user-defined type of args struct */ \
@@ -152,8 +154,8 @@
 	linkage void COTASK_##name(TASK_ARGS_TYPE(name) *_cotask_args)
 
 
-#define DECLARE_TASK_EXPLICIT(name, argstype, handletype, linkage) \
-	TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage) /* require semicolon */
+#define DECLARE_TASK_EXPLICIT(name, argstype, handletype, linkage, stack_class) \
+	TASK_COMMON_DECLARATIONS(name, argstype, handletype, linkage, stack_class) /* require semicolon */
 
 #define DEFINE_TASK_EXPLICIT(name, linkage) \
 	TASK_COMMON_PRIVATE_DECLARATIONS(name); \
@@ -166,12 +168,19 @@
 #define DECLARE_TASK(name, ...) \
 	MACROHAX_OVERLOAD_HASARGS(DECLARE_TASK_, __VA_ARGS__)(name, ##__VA_ARGS__)
 #define DECLARE_TASK_1(name, ...) \
-	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(__VA_ARGS__), void, static) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(__VA_ARGS__), void, static, CO_STACK_DEFAULT) /* require semicolon */
 #define DECLARE_TASK_0(name) DECLARE_TASK_1(name, { })
 
+/* declare a task with static linkage and a non-default stack size class (needs to be defined later) */
+#define DECLARE_TASK_WITH_STACK(name, stack_class, ...) \
+	MACROHAX_OVERLOAD_HASARGS(DECLARE_TASK_WITH_STACK_, __VA_ARGS__)(name, stack_class, ##__VA_ARGS__)
+#define DECLARE_TASK_WITH_STACK_1(name, stack_class, ...) \
+	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(__VA_ARGS__), void, static, stack_class) /* require semicolon */
+#define DECLARE_TASK_WITH_STACK_0(name, stack_class) DECLARE_TASK_WITH_STACK_1(name, stack_class, { })
+
 /* declare a task with static linkage that conforms to a common interface (needs to be defined later) */
 #define DECLARE_TASK_WITH_INTERFACE(name, iface) \
-	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), static) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), static, CO_STACK_DEFAULT) /* require semicolon */
 
 /* define a task with static linkage (needs to be declared first) */
 #define DEFINE_TASK(name) \
@@ -182,6 +191,14 @@
 	DECLARE_TASK(name, ##__VA_ARGS__); \
 	DEFINE_TASK(name)
 
+/*
+ * declare and define a task with static linkage and a non-default stack size class, e.g.:
+ *     TASK_WITH_STACK(bullet_redirect, CO_STACK_MEDIUM, { BoxedProjectile proj; }) { ... }
+ */
+#define TASK_WITH_STACK(name, stack_class, ...) \
+	DECLARE_TASK_WITH_STACK(name, stack_class, ##__VA_ARGS__); \
+	DEFINE_TASK(name)
+
 /* declare and define a task with static linkage that conforms to a common interface */
 #define TASK_WITH_INTERFACE(name, iface) \
 	DECLARE_TASK_WITH_INTERFACE(name, iface); \
@@ -192,13 +209,13 @@
 #define DECLARE_EXTERN_TASK(name, ...)\
 	MACROHAX_OVERLOAD_HASARGS(DECLARE_EXTERN_TASK_, __VA_ARGS__)(name, ##__VA_ARGS__)
 #define DECLARE_EXTERN_TASK_1(name, ...) \
-	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(__VA_ARGS__), void, extern) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_ARGS_STRUCT(__VA_ARGS__), void, extern, CO_STACK_DEFAULT) /* require semicolon */
 #define DECLARE_EXTERN_TASK_0(name) \
 	DECLARE_EXTERN_TASK_1(name, { })
 
 /* declare a task with extern linkage that conforms to a common interface (needs to be defined later) */
 #define DECLARE_EXTERN_TASK_WITH_INTERFACE(name, iface) \
-	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), extern) /* require semicolon */
+	DECLARE_TASK_EXPLICIT(name, TASK_IFACE_ARGS_TYPE(iface), TASK_INDIRECT_TYPE(iface), extern, CO_STACK_DEFAULT) /* require semicolon */
 
 /* define a task with extern linkage (needs to be declared first) */
 #define DEFINE_EXTERN_TASK(name) \
@@ -238,6 +255,7 @@
 		COTASKTHUNK_##name, \
 		(&(TASK_ARGS_TYPE(name)) { __VA_ARGS__ }), \
 		sizeof(TASK_ARGS_TYPE(name)), \
+		COTASKSTACK_##name, \
 		#name \
 	) \
 )
@@ -272,6 +290,7 @@
 			.delay = (_delay) \
 		}), \
 		sizeof(TASK_ARGSDELAY(name)), \
+		COTASKSTACK_##name, \
 		#name \
 	) \
 )
@@ -315,6 +334,7 @@
 			.unconditional = is_unconditional \
 		}), \
 		sizeof(TASK_ARGSCOND(name)), \
+		COTASKSTACK_##name, \
 		#name \
 	) \
 )
@@ -353,6 +373,7 @@ DECLARE_EXTERN_TASK(_cancel_task_helper, { BoxedTask task; });
 		taskhandle._cotask_##iface##_thunk, \
 		(&(TASK_IFACE_ARGS_TYPE(iface)) { __VA_ARGS__ }), \
 		sizeof(TASK_IFACE_ARGS_TYPE(iface)), \
+		CO_STACK_DEFAULT, \
 		"<indirect:"#iface">" \
 	) \
 )
@@ -339,6 +339,12 @@ static void credits_init(void) {
 	credits_fill();
 	credits.end += 200 + CREDITS_ENTRY_FADEOUT;
 
+	dynarray_foreach_elem(&credits.entries, CreditsEntry *e, {
+		for(int i = 0; i < e->lines; ++i) {
+			font_prewarm_text(res_font(i ? "standard" : "big"), e->data[i]);
+		}
+	});
+
 	// Should be >1, because if we get here, that means we have achieved an
 	// ending just now, which this counter includes.
 	// That is unless we're in `taisei --credits`. But in that case, skipping is
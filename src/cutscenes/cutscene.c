@@ -444,6 +444,21 @@ static void cutscene_preload(const CutscenePhase phases[], ResourceGroup *rg) {
 	res_group_preload(rg, RES_BGM, RESF_DEFAULT, "ending", NULL);
 }
 
+static void cutscene_prewarm_text(const CutscenePhase phases[]) {
+	Font *standard = res_font("standard");
+	Font *big = res_font("big");
+
+	for(const CutscenePhase *p = phases; p->background; ++p) {
+		for(const CutscenePhaseTextEntry *e = p->text_entries; e->text; ++e) {
+			if(e->header) {
+				font_prewarm_text(e->type == CTT_CENTERED ? big : standard, e->header);
+			}
+
+			font_prewarm_text(standard, e->text);
+		}
+	}
+}
+
 static CutsceneState *cutscene_state_new(const CutscenePhase phases[]) {
 	auto st = ALLOC(CutsceneState, {
 		.phase = &phases[0],
@@ -452,6 +467,7 @@ static CutsceneState *cutscene_state_new(const CutscenePhase phases[]) {
 
 	res_group_init(&st->rg);
 	cutscene_preload(phases, &st->rg);
+	cutscene_prewarm_text(phases);
 
 	switch_bg(st, st->phase->background);
 	reset_timers(st);
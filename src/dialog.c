@@ -142,6 +142,9 @@ static void dialog_set_text(Dialog *d, const char *text, const Color *clr) {
 
 	d->text.current->color = *clr;
 	d->text.current->text = text;
+
+	// The text fades in, so there is time to render new glyphs off the main thread
+	font_prewarm_text(res_font("standard"), text);
 }
 
 void dialog_focus_actor(Dialog *d, DialogActor *actor) {
@@ -20,6 +20,7 @@
 #include "stageobjects.h"
 #include "util/glm.h"
 #include "entity.h"
+#include "enemygrid.h"
 
 #ifdef create_enemy_p
 #undef create_enemy_p
@@ -112,6 +113,7 @@ Enemy *create_enemy_p(EnemyList *enemies, cmplx pos, float hp, EnemyVisual visua
 	COEVENT_INIT_ARRAY(e->events);
 	fix_pos0_visual(e);
 	ent_register(&e->ent, ENT_TYPE_ID(Enemy));
+	enemygrid_invalidate();
 
 	return e;
 }
@@ -170,6 +172,7 @@ static void *_delete_enemy(ListAnchor *enemies, List* enemy, void *arg) {
 	COEVENT_CANCEL_ARRAY(e->events);
 	ent_unregister(&e->ent);
 	objpool_release(&stage_object_pools.enemies, alist_unlink(enemies, enemy));
+	enemygrid_invalidate();
 
 	return NULL;
 }
@@ -322,6 +325,7 @@ void process_enemies(EnemyList *enemies) {
 		}
 
 		enemy_update(enemy, global.frames - enemy->birthtime);
+		enemygrid_invalidate();
 
 		float hurt_radius = enemy_get_hurt_radius(enemy);
 
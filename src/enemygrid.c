@@ -0,0 +1,261 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "enemygrid.h"
+#include "global.h"
+#include "dynarray.h"
+#include "coroutine/cotask.h"
+
+#define CELL_SIZE 64
+#define GRID_W ((VIEWPORT_W + CELL_SIZE - 1) / CELL_SIZE)
+#define GRID_H ((VIEWPORT_H + CELL_SIZE - 1) / CELL_SIZE)
+#define GRID_CELLS (GRID_W * GRID_H)
+
+// Enemies covering more cells than this are not binned and get tested by every query instead.
+#define WIDE_THRESHOLD (GRID_CELLS / 4)
+
+// Extra padding around hit areas, to stay conservative in the face of rounding errors.
+#define HIT_MARGIN 2
+
+typedef struct GridEntry {
+	Enemy *enemy;
+	uint ordinal;
+} GridEntry;
+
+typedef struct CellSpan {
+	uint8_t x0, y0, x1, y1;
+	bool wide;
+} CellSpan;
+
+static struct {
+	DYNAMIC_ARRAY(GridEntry) binned;
+	DYNAMIC_ARRAY(GridEntry) wide;
+	DYNAMIC_ARRAY(GridEntry) candidates;
+	DYNAMIC_ARRAY(CellSpan) spans;
+	uint cell_ofs[GRID_CELLS + 1];
+	uint32_t enemy_epoch;
+	uint32_t built_enemy_epoch;
+	uint32_t built_resume_counter;
+	uint32_t query_serial;
+	bool built;
+} egrid;
+
+void enemygrid_invalidate(void) {
+	++egrid.enemy_epoch;
+}
+
+static bool enemygrid_is_valid(void) {
+	return
+		egrid.built &&
+		egrid.built_enemy_epoch == egrid.enemy_epoch &&
+		egrid.built_resume_counter == cotask_get_resume_counter();
+}
+
+static inline int cell_coord(double v, int num_cells) {
+	// NOTE: written so that NaN maps to 0; the mapping must be monotonic for the grid to work.
+	if(!(v >= 0)) {
+		return 0;
+	}
+
+	if(v >= num_cells * CELL_SIZE) {
+		return num_cells - 1;
+	}
+
+	return (int)(v / CELL_SIZE);
+}
+
+static CellSpan enemy_cell_span(Enemy *e) {
+	double r = max(e->hit_radius, 0) + HIT_MARGIN;
+	double x = re(e->pos);
+	double y = im(e->pos);
+
+	if(!isfinite(x) || !isfinite(y) || !isfinite(r)) {
+		return (CellSpan) { .wide = true };
+	}
+
+	CellSpan s = {
+		.x0 = cell_coord(x - r, GRID_W),
+		.y0 = cell_coord(y - r, GRID_H),
+		.x1 = cell_coord(x + r, GRID_W),
+		.y1 = cell_coord(y + r, GRID_H),
+	};
+
+	s.wide = (s.x1 - s.x0 + 1) * (s.y1 - s.y0 + 1) > WIDE_THRESHOLD;
+	return s;
+}
+
+void enemygrid_rebuild(void) {
+	uint num_enemies = 0;
+
+	for(Enemy *e = global.enemies.first; e; e = e->next) {
+		++num_enemies;
+	}
+
+	dynarray_ensure_capacity(&egrid.spans, num_enemies);
+	egrid.spans.num_elements = num_enemies;
+	egrid.wide.num_elements = 0;
+
+	uint cell_counts[GRID_CELLS] = { 0 };
+	uint ordinal = 0;
+	uint num_binned = 0;
+
+	for(Enemy *e = global.enemies.first; e; e = e->next, ++ordinal) {
+		CellSpan *s = dynarray_get_ptr(&egrid.spans, ordinal);
+		*s = enemy_cell_span(e);
+
+		if(s->wide) {
+			dynarray_append(&egrid.wide, { .enemy = e, .ordinal = ordinal });
+			continue;
+		}
+
+		for(int y = s->y0; y <= s->y1; ++y) {
+			for(int x = s->x0; x <= s->x1; ++x) {
+				++cell_counts[y * GRID_W + x];
+				++num_binned;
+			}
+		}
+	}
+
+	egrid.cell_ofs[0] = 0;
+
+	for(int i = 0; i < GRID_CELLS; ++i) {
+		egrid.cell_ofs[i + 1] = egrid.cell_ofs[i] + cell_counts[i];
+		cell_counts[i] = egrid.cell_ofs[i];
+	}
+
+	assert(egrid.cell_ofs[GRID_CELLS] == num_binned);
+	dynarray_ensure_capacity(&egrid.binned, num_binned);
+	egrid.binned.num_elements = num_binned;
+
+	// Filling in list order keeps every cell sorted by ordinal.
+	ordinal = 0;
+
+	for(Enemy *e = global.enemies.first; e; e = e->next, ++ordinal) {
+		CellSpan *s = dynarray_get_ptr(&egrid.spans, ordinal);
+
+		if(s->wide) {
+			continue;
+		}
+
+		for(int y = s->y0; y <= s->y1; ++y) {
+			for(int x = s->x0; x <= s->x1; ++x) {
+				egrid.binned.data[cell_counts[y * GRID_W + x]++] = (GridEntry) {
+					.enemy = e,
+					.ordinal = ordinal,
+				};
+			}
+		}
+	}
+
+	egrid.built = true;
+	egrid.built_enemy_epoch = egrid.enemy_epoch;
+	egrid.built_resume_counter = cotask_get_resume_counter();
+}
+
+void enemygrid_free(void) {
+	dynarray_free_data(&egrid.binned);
+	dynarray_free_data(&egrid.wide);
+	dynarray_free_data(&egrid.candidates);
+	dynarray_free_data(&egrid.spans);
+	egrid.built = false;
+}
+
+static int entry_cmp(const void *ptr1, const void *ptr2) {
+	const GridEntry *e1 = ptr1;
+	const GridEntry *e2 = ptr2;
+	return (e1->ordinal > e2->ordinal) - (e1->ordinal < e2->ordinal);
+}
+
+static void collect_candidates(cmplx tl, cmplx br) {
+	int x0 = cell_coord(re(tl), GRID_W);
+	int y0 = cell_coord(im(tl), GRID_H);
+	int x1 = cell_coord(re(br), GRID_W);
+	int y1 = cell_coord(im(br), GRID_H);
+
+	egrid.candidates.num_elements = 0;
+
+	for(int y = y0; y <= y1; ++y) {
+		for(int x = x0; x <= x1; ++x) {
+			uint cell = y * GRID_W + x;
+
+			for(uint i = egrid.cell_ofs[cell]; i < egrid.cell_ofs[cell + 1]; ++i) {
+				*dynarray_append(&egrid.candidates) = egrid.binned.data[i];
+			}
+		}
+	}
+
+	dynarray_foreach_elem(&egrid.wide, GridEntry *w, {
+		*dynarray_append(&egrid.candidates) = *w;
+	});
+
+	bool single_cell = (x0 == x1 && y0 == y1);
+
+	if(single_cell && egrid.wide.num_elements == 0) {
+		// Already sorted and unique
+		return;
+	}
+
+	dynarray_qsort(&egrid.candidates, entry_cmp);
+
+	if(single_cell) {
+		// Sorted, and wide entries are never binned, so no duplicates
+		return;
+	}
+
+	uint out = 0;
+
+	dynarray_foreach_elem(&egrid.candidates, GridEntry *c, {
+		if(out == 0 || egrid.candidates.data[out - 1].ordinal != c->ordinal) {
+			egrid.candidates.data[out++] = *c;
+		}
+	});
+
+	egrid.candidates.num_elements = out;
+}
+
+Enemy *enemygrid_query_begin(EnemyGridQuery *q, cmplx tl, cmplx br) {
+	if(cotask_active()) {
+		// The task may have moved enemies since the grid was last built, even within the same
+		// activation, and we have no way of knowing.
+		*q = (EnemyGridQuery) { .linear = true };
+		return enemygrid_query_next(q);
+	}
+
+	if(!enemygrid_is_valid()) {
+		enemygrid_rebuild();
+	}
+
+	collect_candidates(tl, br);
+
+	*q = (EnemyGridQuery) {
+		.num_candidates = egrid.candidates.num_elements,
+		.serial = ++egrid.query_serial,
+	};
+
+	return enemygrid_query_next(q);
+}
+
+Enemy *enemygrid_query_next(EnemyGridQuery *q) {
+	if(!q->linear && (q->serial != egrid.query_serial || !enemygrid_is_valid())) {
+		// Something may have moved, spawned, or clobbered our candidate list while the caller
+		// was processing the previous result. Continue the way a naive loop would.
+		q->linear = true;
+	}
+
+	if(q->linear) {
+		return q->last = (q->last ? q->last->next : global.enemies.first);
+	}
+
+	if(q->next_candidate < q->num_candidates) {
+		return q->last = egrid.candidates.data[q->next_candidate++].enemy;
+	}
+
+	return NULL;
+}
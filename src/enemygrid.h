@@ -0,0 +1,63 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#pragma once
+#include "taisei.h"
+
+#include "enemy.h"
+
+/*
+ * A uniform grid over the viewport that indexes `global.enemies` by their hit areas, so that
+ * player shots and area attacks don't have to test every enemy on the screen.
+ *
+ * The grid is only a broad-phase filter. Queries yield a superset of the enemies that may
+ * intersect the requested box, always in `global.enemies` list order, so callers must still
+ * perform the exact test. Results are identical to walking the whole list, which is important
+ * for replay determinism.
+ *
+ * Any change to the enemy list, any enemy movement in `process_enemies`, and any coroutine resume
+ * invalidates the grid. A stale grid is rebuilt lazily by the next query. If the grid gets
+ * invalidated in the middle of a query, the query continues as a plain linear walk from the last
+ * enemy it returned, exactly like the naive loop would.
+ *
+ * Task code may write to `Enemy.pos` at any time without telling the grid, so queries made from
+ * inside a task never use it and always walk the whole list.
+ */
+
+typedef struct EnemyGridQuery {
+	Enemy *last;
+	uint num_candidates;
+	uint next_candidate;
+	uint32_t serial;
+	bool linear;
+} EnemyGridQuery;
+
+// Marks the grid as stale. Must be called whenever non-task code spawns, removes, or moves enemies.
+void enemygrid_invalidate(void);
+
+// Rebuilds the grid from `global.enemies`. Normally called right after `process_enemies`.
+void enemygrid_rebuild(void);
+
+// Frees the grid's memory. The grid is still usable afterwards and will reallocate as needed.
+void enemygrid_free(void);
+
+// Starts a query for enemies whose hit areas may intersect the box [tl, br].
+// Returns the first candidate, or NULL.
+Enemy *enemygrid_query_begin(EnemyGridQuery *q, cmplx tl, cmplx br) attr_nonnull(1);
+
+// Returns the next candidate in list order, or NULL.
+Enemy *enemygrid_query_next(EnemyGridQuery *q) attr_nonnull(1);
+
+#define ENEMYGRID_FOREACH_IN_BOX(_q, _tl, _br, _e) \
+	for(Enemy *_e = enemygrid_query_begin((_q), (_tl), (_br)); _e; _e = enemygrid_query_next((_q)))
+
+#define ENEMYGRID_FOREACH_IN_RADIUS(_q, _origin, _radius, _e) \
+	ENEMYGRID_FOREACH_IN_BOX(_q, \
+		(_origin) - CMPLX((_radius), (_radius)), \
+		(_origin) + CMPLX((_radius), (_radius)), \
+	_e)
@@ -13,6 +13,7 @@
 #include "renderer/api.h"
 #include "global.h"
 #include "dynarray.h"
+#include "enemygrid.h"
 
 typedef struct EntityDrawHook EntityDrawHook;
 typedef LIST_ANCHOR(EntityDrawHook) EntityDrawHookList;
@@ -23,10 +24,26 @@ struct EntityDrawHook {
 	void *arg;
 };
 
+typedef struct EntitySortKey {
+	uint64_t key;
+	EntityInterface *ent;
+} EntitySortKey;
+
 static struct {
 	DYNAMIC_ARRAY(EntityInterface*) registered;
 	uint32_t total_spawns;
 
+	struct {
+		DYNAMIC_ARRAY(EntitySortKey) keys;
+		DYNAMIC_ARRAY(EntitySortKey) scratch;
+		EntitySortStats stats;
+	} sort;
+
+	struct {
+		drawlayer_t first;
+		drawlayer_t last;
+	} sprite_sort;
+
 	struct {
 		EntityDrawHookList pre_draw;
 		EntityDrawHookList post_draw;
@@ -62,6 +79,12 @@ static void call_hooks(EntityDrawHookList *list, EntityInterface *ent) {
 void ent_init(void) {
 	memset(&entities, 0, sizeof(entities));
 	dynarray_ensure_capacity(&entities.registered, 1024);
+
+	if(env_get("TAISEI_SPRITE_SORT", false)) {
+		ent_set_sprite_sort_layers(LAYER_PLAYER_SHOT, LAYER_PARTICLE_HIGH | LAYER_LOW_MASK);
+	} else {
+		ent_set_sprite_sort_layers(1, 0);
+	}
 }
 
 void ent_shutdown(void) {
@@ -70,6 +93,8 @@ void ent_shutdown(void) {
 	}
 
 	dynarray_free_data(&entities.registered);
+	dynarray_free_data(&entities.sort.keys);
+	dynarray_free_data(&entities.sort.scratch);
 
 	assert(entities.hooks.post_draw.first == NULL);
 	assert(entities.hooks.pre_draw.first == NULL);
@@ -95,27 +120,109 @@ void ent_unregister(EntityInterface *ent) {
 	entities.registered.data[sub->index = ent->index] = sub;
 }
 
-static int ent_cmp(const void *ptr1, const void *ptr2) {
-	const EntityInterface *ent1 = *(const EntityInterface**)ptr1;
-	const EntityInterface *ent2 = *(const EntityInterface**)ptr2;
+static void ent_sort_registered(void) {
+	dynarray_size_t num = entities.registered.num_elements;
+
+	if(num < 2) {
+		return;
+	}
 
-	int r = (ent1->draw_layer > ent2->draw_layer) - (ent1->draw_layer < ent2->draw_layer);
+	dynarray_ensure_capacity(&entities.sort.keys, num);
+	dynarray_ensure_capacity(&entities.sort.scratch, num);
+	EntitySortKey *keys = entities.sort.keys.data;
+	EntitySortKey *scratch = entities.sort.scratch.data;
+	EntityInterface **ents = entities.registered.data;
+	bool sorted = true;
+
+	// Sort by layer, then by spawn order. Whatever spawned later goes on top.
+	// spawn_id is unique, so ties are impossible.
+	for(dynarray_size_t i = 0; i < num; ++i) {
+		keys[i].key = ((uint64_t)ents[i]->draw_layer << 32) | ents[i]->spawn_id;
+		keys[i].ent = ents[i];
+		sorted = sorted && (i == 0 || keys[i - 1].key < keys[i].key);
+	}
 
-	if(r == 0) {
-		// Same layer? Put whatever spawned later on top, then.
-		r = (ent1->spawn_id > ent2->spawn_id) - (ent1->spawn_id < ent2->spawn_id);
+	if(sorted) {
+		return;
 	}
 
-	return r;
+	// Stable LSD radix sort, 8 bits per pass. Passes where every key has the same digit
+	// (typically the high bytes of both halves) are skipped.
+	uint32_t hist[sizeof(uint64_t)][256] = { 0 };
+
+	for(dynarray_size_t i = 0; i < num; ++i) {
+		uint64_t key = keys[i].key;
+
+		for(uint b = 0; b < sizeof(uint64_t); ++b) {
+			++hist[b][(key >> (b * 8)) & 0xff];
+		}
+	}
+
+	for(uint b = 0; b < sizeof(uint64_t); ++b) {
+		uint shift = b * 8;
+
+		if(hist[b][(keys[0].key >> shift) & 0xff] == num) {
+			continue;
+		}
+
+		uint32_t ofs = 0;
+
+		for(uint d = 0; d < 256; ++d) {
+			uint32_t count = hist[b][d];
+			hist[b][d] = ofs;
+			ofs += count;
+		}
+
+		for(dynarray_size_t i = 0; i < num; ++i) {
+			scratch[hist[b][(keys[i].key >> shift) & 0xff]++] = keys[i];
+		}
+
+		SWAP(keys, scratch);
+	}
+
+	for(dynarray_size_t i = 0; i < num; ++i) {
+		ents[i] = keys[i].ent;
+	}
 }
 
 static inline bool ent_is_drawable(EntityInterface *ent) {
 	return (ent->draw_layer & ~LAYER_LOW_MASK) > LAYER_NODRAW && ent->draw_func;
 }
 
+void ent_set_sprite_sort_layers(drawlayer_t first, drawlayer_t last) {
+	entities.sprite_sort.first = first;
+	entities.sprite_sort.last = last;
+}
+
+static inline void ent_update_sprite_sort(EntityInterface *ent, bool *deferred) {
+	bool in_range = ent->draw_layer >= entities.sprite_sort.first && ent->draw_layer <= entities.sprite_sort.last;
+
+	if(in_range != *deferred) {
+		if(in_range) {
+			r_sprite_batch_begin_deferred();
+		} else {
+			r_sprite_batch_end_deferred();
+		}
+
+		*deferred = in_range;
+	}
+
+	if(in_range) {
+		// Only sprites on the exact same layer (including the sublayer) may be reordered
+		r_sprite_batch_set_sort_group(ent->draw_layer);
+	}
+}
+
 void ent_draw(EntityPredicate predicate) {
+	bool deferred = false;
+
 	call_hooks(&entities.hooks.pre_draw, NULL);
-	dynarray_qsort(&entities.registered, ent_cmp);
+
+	hrtime_t sort_start = time_get();
+	ent_sort_registered();
+	entities.sort.stats.time += time_get() - sort_start;
+	entities.sort.stats.num_entities += entities.registered.num_elements;
+	entities.sort.stats.num_sorts++;
 
 	if(predicate) {
 		dynarray_foreach(&entities.registered, int i, EntityInterface **pent, {
@@ -123,6 +230,7 @@ void ent_draw(EntityPredicate predicate) {
 			ent->index = i;
 
 			if(ent_is_drawable(ent) && predicate(ent)) {
+				ent_update_sprite_sort(ent, &deferred);
 				call_hooks(&entities.hooks.pre_draw, ent);
 				r_state_push();
 				ent->draw_func(ent);
@@ -136,6 +244,7 @@ void ent_draw(EntityPredicate predicate) {
 			ent->index = i;
 
 			if(ent_is_drawable(ent)) {
+				ent_update_sprite_sort(ent, &deferred);
 				call_hooks(&entities.hooks.pre_draw, ent);
 				r_state_push();
 				ent->draw_func(ent);
@@ -145,9 +254,18 @@ void ent_draw(EntityPredicate predicate) {
 		});
 	}
 
+	if(deferred) {
+		r_sprite_batch_end_deferred();
+	}
+
 	call_hooks(&entities.hooks.post_draw, NULL);
 }
 
+void ent_pop_sort_stats(EntitySortStats *stats) {
+	*stats = entities.sort.stats;
+	memset(&entities.sort.stats, 0, sizeof(entities.sort.stats));
+}
+
 DamageResult ent_damage(EntityInterface *ent, const DamageInfo *damage) {
 	if(ent->damage_func == NULL) {
 		return DMG_RESULT_INAPPLICABLE;
@@ -171,7 +289,9 @@ DamageResult ent_damage(EntityInterface *ent, const DamageInfo *damage) {
 }
 
 void ent_area_damage(cmplx origin, float radius, const DamageInfo *damage, EntityAreaDamageCallback callback, void *callback_arg) {
-	for(Enemy *e = global.enemies.first; e; e = e->next) {
+	EnemyGridQuery q;
+
+	ENEMYGRID_FOREACH_IN_RADIUS(&q, origin, radius, e) {
 		if(
 			cabs(origin - e->pos) < radius &&
 			ent_damage(&e->ent, damage) == DMG_RESULT_OK &&
@@ -192,7 +312,10 @@ void ent_area_damage(cmplx origin, float radius, const DamageInfo *damage, Entit
 }
 
 void ent_area_damage_ellipse(Ellipse ellipse, const DamageInfo *damage, EntityAreaDamageCallback callback, void *callback_arg) {
-	for(Enemy *e = global.enemies.first; e; e = e->next) {
+	EnemyGridQuery q;
+	Rect bbox = ellipse_bbox(ellipse);
+
+	ENEMYGRID_FOREACH_IN_BOX(&q, bbox.top_left, bbox.bottom_right, e) {
 		if(
 			point_in_ellipse(e->pos, ellipse) &&
 			ent_damage(&e->ent, damage) == DMG_RESULT_OK &&
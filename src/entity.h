@@ -13,6 +13,7 @@
 #include "util/geometry.h"
 #include "util/macrohax.h"
 #include "known_entities.h"
+#include "hirestime.h"
 
 #define LAYER_LOW_BITS 16
 #define LAYER_LOW_MASK ((1 << LAYER_LOW_BITS) - 1)
@@ -129,11 +130,19 @@ INLINE const char *ent_type_name(EntityType type) {
 	UNION_CAST(EntityInterface*, typename*, _ent); \
 })
 
+typedef struct EntitySortStats {
+	hrtime_t time;      // time spent sorting entities for drawing
+	uint num_entities;  // total number of entities sorted
+	uint num_sorts;     // number of ent_draw() calls
+} EntitySortStats;
+
 void ent_init(void);
 void ent_shutdown(void);
 void ent_register(EntityInterface *ent, EntityType type) attr_nonnull(1);
 void ent_unregister(EntityInterface *ent) attr_nonnull(1);
 void ent_draw(EntityPredicate predicate);
+void ent_pop_sort_stats(EntitySortStats *stats) attr_nonnull_all;  // returns stats accumulated since the last call and resets them
+void ent_set_sprite_sort_layers(drawlayer_t first, drawlayer_t last);  // defer and sort sprites of entities in this range; disabled if first > last
 DamageResult ent_damage(EntityInterface *ent, const DamageInfo *damage) attr_nonnull(1, 2);
 void ent_area_damage(cmplx origin, float radius, const DamageInfo *damage, EntityAreaDamageCallback callback, void *callback_arg) attr_nonnull(3);
 void ent_area_damage_ellipse(Ellipse ellipse, const DamageInfo *damage, EntityAreaDamageCallback callback, void *callback_arg) attr_nonnull(2);
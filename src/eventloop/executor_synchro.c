@@ -13,6 +13,7 @@
 #include "framerate.h"
 #include "thread.h"
 #include "global.h"
+#include "coroutine/coroutine.h"
 
 void eventloop_run(void) {
 	assert(thread_current_is_main());
@@ -122,6 +123,9 @@ void eventloop_run(void) {
 			}
 		}
 
+		// We're ahead of schedule; spend some of the slack on housekeeping
+		coroutines_trim_idle_stacks();
+
 		if(sleep > 0) {
 			// CAUTION: All of these casts are important!
 			while((shrtime_t)evloop.frame_times.next - (shrtime_t)time_get() > (shrtime_t)evloop.frame_times.target / sleep) {
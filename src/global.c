@@ -21,7 +21,7 @@ void init_global(CLIAction *cli) {
 
 	global.frameskip = cli->frameskip;
 
-	if(cli->type == CLI_VerifyReplay) {
+	if(cli->type == CLI_VerifyReplay || cli->type == CLI_BenchmarkReplay) {
 		global.is_headless = true;
 		global.is_replay_verification = true;
 		global.frameskip = 1;
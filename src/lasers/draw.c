@@ -197,7 +197,7 @@ static void create_pass1_resources(void) {
 	#undef VERTEX_OFS
 	#undef INSTANCE_OFS
 
-	VertexBuffer *vb = r_vertex_buffer_create(sz_attr * EXPECTED_MAX_SEGMENTS, NULL);
+	VertexBuffer *vb = r_vertex_buffer_create_streaming(sz_attr * EXPECTED_MAX_SEGMENTS);
 	r_vertex_buffer_set_debug_label(vb, "Lasers VB pass 1");
 
 	VertexArray *va = r_vertex_array_create();
@@ -235,7 +235,7 @@ static void create_pass2_resources(void) {
 	#undef VERTEX_OFS
 	#undef INSTANCE_OFS
 
-	VertexBuffer *vb = r_vertex_buffer_create(sz_attr * EXPECTED_MAX_LASERS, NULL);
+	VertexBuffer *vb = r_vertex_buffer_create_streaming(sz_attr * EXPECTED_MAX_LASERS);
 	r_vertex_buffer_set_debug_label(vb, "Lasers VB pass 2");
 
 	VertexArray *va = r_vertex_array_create();
@@ -14,9 +14,12 @@ LaserInternalData lintern;
 
 void laserintern_init(void) {
 	assert(lintern.segments.num_elements == 0);
+	assert(lintern.chunks.num_elements == 0);
 	dynarray_ensure_capacity(&lintern.segments, 2048);
+	dynarray_ensure_capacity(&lintern.chunks, 2048 / LASER_CHUNK_SIZE);
 }
 
 void laserintern_shutdown(void) {
 	dynarray_free_data(&lintern.segments);
+	dynarray_free_data(&lintern.chunks);
 }
@@ -13,8 +13,23 @@
 #include "util.h"
 #include "dynarray.h"
 
+// Consecutive segments of a laser are grouped into chunks of this size, each with its own bounding
+// box, so that intersection queries can skip over most of a long laser without testing every
+// segment.
+#define LASER_CHUNK_SIZE 8
+
+typedef struct LaserSegmentChunk {
+	// Bounding box of the segments' endpoints; does not include the width
+	FloatOffset top_left, bottom_right;
+	// Half of the largest segment width in this chunk
+	float max_radius;
+} LaserSegmentChunk;
+
+typedef DYNAMIC_ARRAY(LaserSegment) LaserSegmentArray;
+
 typedef struct LaserInternalData {
-	DYNAMIC_ARRAY(LaserSegment) segments;
+	LaserSegmentArray segments;
+	DYNAMIC_ARRAY(LaserSegmentChunk) chunks;
 } LaserInternalData;
 
 extern LaserInternalData lintern;
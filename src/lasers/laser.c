@@ -16,6 +16,7 @@
 #include "list.h"
 #include "stageobjects.h"
 #include "stagedraw.h"
+#include "taskmanager.h"
 #include "renderer/api.h"
 #include "resource/model.h"
 #include "util/fbmgr.h"
@@ -43,18 +44,42 @@ typedef struct LaserSample {
 
 typedef DYNAMIC_ARRAY(LaserSample) LaserSampleArray;
 
+// Number of consecutive lasers quantized together by one parallel job
+#define QUANTIZE_BATCH_SIZE 4
+
+// Don't bother with threads if there are fewer lasers than this
+#define QUANTIZE_PARALLEL_MIN_LASERS (QUANTIZE_BATCH_SIZE * 2)
+
+typedef struct LaserQuantizeBatch {
+	LaserSampleArray samples;
+	// Output of the batch's lasers; their segments_ofs are relative to this until merged
+	LaserSegmentArray segments;
+} LaserQuantizeBatch;
+
 static struct {
 	LaserSampleArray samples;
+	DYNAMIC_ARRAY(Laser*) queue;
+	DYNAMIC_ARRAY(LaserQuantizeBatch) batches;
+	bool parallel;
 } lasers;
 
 void lasers_init(void) {
 	lasers.samples = (LaserSampleArray) {};
+	lasers.parallel = !env_get("TAISEI_LASER_SERIAL_QUANTIZE", false);
 	laserintern_init();
 	laserdraw_init();
 }
 
 void lasers_shutdown(void) {
 	dynarray_free_data(&lasers.samples);
+	dynarray_free_data(&lasers.queue);
+
+	dynarray_foreach_elem(&lasers.batches, LaserQuantizeBatch *b, {
+		dynarray_free_data(&b->samples);
+		dynarray_free_data(&b->segments);
+	});
+
+	dynarray_free_data(&lasers.batches);
 	laserdraw_shutdown();
 	laserintern_shutdown();
 }
@@ -250,12 +275,65 @@ static bool segment_is_visible(cmplxf a, cmplxf b, const FloatRect *bounds) {
 	return max(y0, y1) >= top && min(y0, y1) <= bottom;
 }
 
+static void build_segment_chunks(Laser *l) {
+	// NOTE: this only summarizes the segments for culling; it must never modify them.
+
+	l->_internal.chunks_ofs = lintern.chunks.num_elements;
+
+	int num_segs = l->_internal.num_segments;
+	LaserSegment *segs = dynarray_get_ptr(&lintern.segments, l->_internal.segments_ofs);
+
+	for(int i = 0; i < num_segs; i += LASER_CHUNK_SIZE) {
+		LaserSegment *first = segs + i;
+		LaserSegment *last = segs + min(i + LASER_CHUNK_SIZE, num_segs) - 1;
+
+		LaserSegmentChunk chunk;
+		chunk.top_left.as_cmplx = first->pos.a;
+		chunk.bottom_right.as_cmplx = first->pos.a;
+		chunk.max_radius = 0;
+
+		for(LaserSegment *seg = first; seg <= last; ++seg) {
+			float xa = re(seg->pos.a);
+			float ya = im(seg->pos.a);
+			float xb = re(seg->pos.b);
+			float yb = im(seg->pos.b);
+
+			chunk.top_left.x     = min(    chunk.top_left.x, min(xa, xb));
+			chunk.top_left.y     = min(    chunk.top_left.y, min(ya, yb));
+			chunk.bottom_right.x = max(chunk.bottom_right.x, max(xa, xb));
+			chunk.bottom_right.y = max(chunk.bottom_right.y, max(ya, yb));
+
+			// width.b is the larger one, see quantize_laser
+			chunk.max_radius = max(chunk.max_radius, seg->width.b * 0.5f);
+		}
+
+		dynarray_append(&lintern.chunks, chunk);
+	}
+}
+
+INLINE int laser_num_chunks(Laser *l) {
+	return (l->_internal.num_segments + LASER_CHUNK_SIZE - 1) / LASER_CHUNK_SIZE;
+}
+
+// Tests whether the chunk's bounding box, expanded by margin on all sides, overlaps the given box.
+INLINE bool chunk_overlaps_box(
+	const LaserSegmentChunk *c, double margin, double left, double top, double right, double bottom
+) {
+	return
+		right  >= c->top_left.x     - margin &&
+		left   <= c->bottom_right.x + margin &&
+		bottom >= c->top_left.y     - margin &&
+		top    <= c->bottom_right.y + margin;
+}
+
 attr_hot
-static int quantize_laser(Laser *l) {
+static int quantize_laser(Laser *l, LaserSampleArray *samples, LaserSegmentArray *segments) {
 	// Break the laser curve into small line segments, simplify and cull them,
 	// compute the bounding box.
+	// NOTE: may run on a worker thread; must not touch anything but the laser and the arrays
+	// passed in. The segments are appended to the given array, and segments_ofs is relative to it.
 
-	l->_internal.segments_ofs = lintern.segments.num_elements;
+	l->_internal.segments_ofs = segments->num_elements;
 	l->_internal.num_segments = 0;
 
 	LaserSamplingParams sp;
@@ -267,7 +345,7 @@ static int quantize_laser(Laser *l) {
 	}
 
 	// Sample all points now
-	fill_samples(&lasers.samples, &sp, l);
+	fill_samples(samples, &sp, l);
 
 	// Precomputed magic parameters for width calculation
 	LaserWidthParams wp;
@@ -280,13 +358,13 @@ static int quantize_laser(Laser *l) {
 	// These values should be kept as high as possible without introducing artifacts.
 
 	// Time value of last included sample
-	float t0 = dynarray_get(&lasers.samples, 0).t;
+	float t0 = dynarray_get(samples, 0).t;
 
 	// Points of the current line segment
 	// Begin constructing at t0
 	// WARNING: these must be double precision to prevent cross-platform replay desync
 	cmplx a, b;
-	a = dynarray_get(&lasers.samples, 0).p;
+	a = dynarray_get(samples, 0).p;
 
 	// Width value of the last included sample
 	// Initialized to the width at t0
@@ -307,9 +385,9 @@ static int quantize_laser(Laser *l) {
 	top_left.as_cmplx = a;
 	bottom_right.as_cmplx = a;
 
-	auto last_sample = lasers.samples.data + (lasers.samples.num_elements - 1);
+	auto last_sample = samples->data + (samples->num_elements - 1);
 
-	for(auto sample = lasers.samples.data + 1; sample <= last_sample; ++sample) {
+	for(auto sample = samples->data + 1; sample <= last_sample; ++sample) {
 		b = sample->p;
 
 		if(sample != last_sample && (sample->t - t0) < thres_temporal) {
@@ -357,7 +435,7 @@ static int quantize_laser(Laser *l) {
 		bool visible = segment_is_visible(a, b, &viewbounds);
 
 		if(visible) {
-			LaserSegment *seg = dynarray_append(&lintern.segments, {
+			LaserSegment *seg = dynarray_append(segments, {
 				.pos   = {   a,  b },
 				.width = {  w0,  w },
 				.time  = { sp.time_shift - t0, sp.time_shift - sample->t },
@@ -396,10 +474,83 @@ static int quantize_laser(Laser *l) {
 	l->_internal.bbox.top_left = top_left;
 	l->_internal.bbox.bottom_right = bottom_right;
 
-	l->_internal.num_segments = lintern.segments.num_elements - l->_internal.segments_ofs;
+	l->_internal.num_segments = segments->num_elements - l->_internal.segments_ofs;
 	return l->_internal.num_segments;
 }
 
+static void quantize_lasers_batch_range(uint begin, uint end, void *userdata) {
+	// The ranges given by taskmgr_parallel_for are aligned to QUANTIZE_BATCH_SIZE, but may span
+	// several batches if it decides to run everything on this thread.
+	for(uint b = begin / QUANTIZE_BATCH_SIZE; b * QUANTIZE_BATCH_SIZE < end; ++b) {
+		LaserQuantizeBatch *batch = dynarray_get_ptr(&lasers.batches, b);
+		uint last = min(end, (b + 1) * QUANTIZE_BATCH_SIZE);
+
+		batch->segments.num_elements = 0;
+
+		for(uint i = b * QUANTIZE_BATCH_SIZE; i < last; ++i) {
+			quantize_laser(dynarray_get(&lasers.queue, i), &batch->samples, &batch->segments);
+		}
+	}
+}
+
+static void quantize_lasers_parallel(void) {
+	uint num_lasers = lasers.queue.num_elements;
+	uint num_batches = (num_lasers + QUANTIZE_BATCH_SIZE - 1) / QUANTIZE_BATCH_SIZE;
+
+	if(lasers.batches.num_elements < num_batches) {
+		dynarray_ensure_capacity(&lasers.batches, num_batches);
+
+		while(lasers.batches.num_elements < num_batches) {
+			dynarray_append(&lasers.batches, {});
+		}
+	}
+
+	taskmgr_parallel_for(NULL, num_lasers, QUANTIZE_BATCH_SIZE, quantize_lasers_batch_range, NULL);
+
+	// Concatenate the batches in list order. The result is identical to the serial path.
+	uint total = lintern.segments.num_elements;
+
+	for(uint b = 0; b < num_batches; ++b) {
+		total += dynarray_get_ptr(&lasers.batches, b)->segments.num_elements;
+	}
+
+	dynarray_ensure_capacity(&lintern.segments, total);
+
+	for(uint b = 0; b < num_batches; ++b) {
+		LaserQuantizeBatch *batch = dynarray_get_ptr(&lasers.batches, b);
+		uint base = lintern.segments.num_elements;
+		uint last = min(num_lasers, (b + 1) * QUANTIZE_BATCH_SIZE);
+
+		memcpy(
+			lintern.segments.data + base,
+			batch->segments.data,
+			batch->segments.num_elements * sizeof(*batch->segments.data)
+		);
+
+		lintern.segments.num_elements += batch->segments.num_elements;
+
+		for(uint i = b * QUANTIZE_BATCH_SIZE; i < last; ++i) {
+			dynarray_get(&lasers.queue, i)->_internal.segments_ofs += base;
+		}
+	}
+}
+
+static void quantize_lasers(void) {
+	uint num_lasers = lasers.queue.num_elements;
+
+	if(lasers.parallel && num_lasers >= QUANTIZE_PARALLEL_MIN_LASERS) {
+		quantize_lasers_parallel();
+	} else {
+		dynarray_foreach_elem(&lasers.queue, Laser **l, {
+			quantize_laser(*l, &lasers.samples, &lintern.segments);
+		});
+	}
+
+	dynarray_foreach_elem(&lasers.queue, Laser **l, {
+		build_segment_chunks(*l);
+	});
+}
+
 static bool laser_collision(Laser *l, Player *plr);
 
 typedef struct LaserTraceState {
@@ -579,6 +730,7 @@ void process_lasers(void) {
 	Player *plr = &global.plr;
 
 	lintern.segments.num_elements = 0;
+	lintern.chunks.num_elements = 0;
 
 	/*
 	 * NOTE: it's important to have two loops here, because something triggered from ent_damage()
@@ -587,6 +739,8 @@ void process_lasers(void) {
 	 * discharge and try to cancel all lasers in a circle.
 	 */
 
+	lasers.queue.num_elements = 0;
+
 	for(Laser *laser = global.lasers.first, *next; laser; laser = next) {
 		next = laser->next;
 
@@ -595,13 +749,17 @@ void process_lasers(void) {
 			continue;
 		}
 
-		quantize_laser(laser);
+		dynarray_append(&lasers.queue, laser);
 
 		if(stage_cleared) {
 			clear_laser(laser, CLEAR_HAZARDS_LASERS | CLEAR_HAZARDS_FORCE);
 		}
 	}
 
+	// Quantization is independent for every laser, so it may be spread over worker threads.
+	// clear_laser above doesn't depend on its results.
+	quantize_lasers();
+
 	for(Laser *laser = global.lasers.first, *next; laser; laser = next) {
 		next = laser->next;
 
@@ -651,6 +809,8 @@ static bool laser_collision(Laser *l, Player *plr) {
 	}
 
 	LaserSegment *segs = dynarray_get_ptr(&lintern.segments, l->_internal.segments_ofs);
+	LaserSegmentChunk *chunks = dynarray_get_ptr(&lintern.chunks, l->_internal.chunks_ofs);
+	int num_chunks = laser_num_chunks(l);
 
 	LineSegment plrmotion;
 	cmplx plrpos = plr->pos;
@@ -660,9 +820,34 @@ static bool laser_collision(Laser *l, Player *plr) {
 		player_moved = true;
 		plrmotion.a = plrpos - plr->velocity;
 		plrmotion.b = plrpos;
+	} else {
+		plrmotion.a = plrmotion.b = plrpos;
 	}
 
+	// Area that must be near a segment for any of the tests below to pass:
+	// the player's motion segment, or just the position if not moving.
+	double qleft   = min(re(plrmotion.a), re(plrmotion.b));
+	double qright  = max(re(plrmotion.a), re(plrmotion.b));
+	double qtop    = min(im(plrmotion.a), im(plrmotion.b));
+	double qbottom = max(im(plrmotion.a), im(plrmotion.b));
+
 	for(int i = 0; i < num_segs; ++i) {
+		if(i % LASER_CHUNK_SIZE == 0) {
+			LaserSegmentChunk *chunk = chunks + i / LASER_CHUNK_SIZE;
+			assert(chunk - chunks < num_chunks);
+
+			// Capsule radii are at most max(width * 0.5, 2), so the distance from any segment in
+			// this chunk is bounded by this. Segments farther away than the current graze distance
+			// would not update it, so they can be skipped without changing the result.
+			// The +1 absorbs float vs. double rounding.
+			double margin = max(chunk->max_radius, 2) + (graze ? graze_dist : 0) + 1;
+
+			if(!chunk_overlaps_box(chunk, margin, qleft, qtop, qright, qbottom)) {
+				i += LASER_CHUNK_SIZE - 1;
+				continue;
+			}
+		}
+
 		LaserSegment *lseg = segs + i;
 		LineSegment s = { lseg->pos.a, lseg->pos.b };
 
@@ -721,8 +906,21 @@ bool laser_intersects_ellipse(Laser *l, Ellipse ellipse) {
 	}
 
 	LaserSegment *segs = dynarray_get_ptr(&lintern.segments, l->_internal.segments_ofs);
+	LaserSegmentChunk *chunks = dynarray_get_ptr(&lintern.chunks, l->_internal.chunks_ofs);
 
 	for(int i = 0; i < num_segs; ++i) {
+		if(i % LASER_CHUNK_SIZE == 0) {
+			// A segment can only intersect the ellipse if its bbox does
+			LaserSegmentChunk *chunk = chunks + i / LASER_CHUNK_SIZE;
+
+			if(!chunk_overlaps_box(chunk, 1,
+				re(e_bbox.top_left), im(e_bbox.top_left), re(e_bbox.bottom_right), im(e_bbox.bottom_right)
+			)) {
+				i += LASER_CHUNK_SIZE - 1;
+				continue;
+			}
+		}
+
 		LaserSegment *lseg = segs + i;
 		LineSegment s = { lseg->pos.a, lseg->pos.b };
 
@@ -16,6 +16,8 @@
 #include "resource/shader_program.h"
 #include "entity.h"
 
+// NOTE: rules may be evaluated on worker threads, concurrently with each other.
+// They must only read game state, never modify it (no RNG, no spawning).
 typedef cmplx LaserRuleFunc(Laser *p, real t, void *ruledata);
 
 typedef struct LaserRule {
@@ -32,6 +34,7 @@ DEFINE_ENTITY_TYPE(Laser, {
 	struct {
 		int segments_ofs;
 		int num_segments;
+		int chunks_ofs;
 		struct {
 			FloatOffset top_left, bottom_right;
 		} bbox;
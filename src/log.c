@@ -24,15 +24,25 @@ typedef struct Logger {
 
 	FormatterObj formatter;
 	SDL_RWops *out;
+	StringBuffer batch;
 	uint levels;
 } Logger;
 
+// Must be a power of two
+#define LOG_QUEUE_SIZE 1024
+#define LOG_QUEUE_MESSAGE_SIZE 256
+
 typedef struct QueuedLogEntry {
-	LIST_INTERFACE(struct QueuedLogEntry);
 	LogEntry e;
-	char message[];
+	char *spilled_message;  // heap copy of messages too long for the inline buffer
+	char message[LOG_QUEUE_MESSAGE_SIZE];
 } QueuedLogEntry;
 
+typedef enum LogQueueOverflowPolicy {
+	LOG_QUEUE_OVERFLOW_BLOCK,
+	LOG_QUEUE_OVERFLOW_DROP,
+} LogQueueOverflowPolicy;
+
 typedef struct LogFilterEntry {
 	struct {
 		char *module;
@@ -54,10 +64,27 @@ static struct {
 
 	struct {
 		Thread *thread;
-		SDL_mutex *mutex;
-		SDL_cond *cond;
-		LIST_ANCHOR(QueuedLogEntry) queue;
-		int shutdown;
+		QueuedLogEntry *ring;
+
+		// Producers are serialized by logging.mutex, so only the logger thread races with them.
+		SDL_atomic_t head;      // next slot to fill; advanced by producers
+		SDL_atomic_t tail;      // next slot to consume; advanced by the logger thread
+		SDL_atomic_t written;   // everything before this has been written to the outputs
+
+		// Each side only posts to the other's semaphore if it announced that it's about to sleep.
+		SDL_sem *wake_sem;
+		SDL_sem *space_sem;
+		SDL_atomic_t consumer_waiting;
+		SDL_atomic_t producer_waiting;
+
+		// Only for log_sync(), which is rare enough to not bother avoiding locks.
+		SDL_mutex *sync_mutex;
+		SDL_cond *sync_cond;
+		SDL_atomic_t sync_waiters;
+
+		SDL_atomic_t dropped;
+		SDL_atomic_t shutdown;
+		LogQueueOverflowPolicy overflow_policy;
 	} queue;
 
 	DYNAMIC_ARRAY(LogFilterEntry) filters;
@@ -228,7 +255,7 @@ static LogLevel filter_entry(LogEntry *entry) {
 	return log_apply_level_diff(LOG_ALL, d);
 }
 
-static void log_dispatch(LogEntry *entry) {
+static void log_dispatch_internal(LogEntry *entry, bool batch) {
 	StringBuffer *fmt_buf = &logging.buffers.format;
 
 	bool init = false;
@@ -256,6 +283,12 @@ static void log_dispatch(LogEntry *entry) {
 				continue;
 			}
 
+			if(batch) {
+				// Written out by log_flush_batch()
+				l->formatter.format(&l->formatter, &l->batch, entry);
+				continue;
+			}
+
 			strbuf_clear(fmt_buf);
 			size_t slen = l->formatter.format(&l->formatter, fmt_buf, entry);
 			assert_nolog(fmt_buf->buf_size >= slen);
@@ -268,21 +301,83 @@ static void log_dispatch(LogEntry *entry) {
 	}
 }
 
+static void log_dispatch(LogEntry *entry) {
+	log_dispatch_internal(entry, false);
+}
+
+static void log_flush_batch(void) {
+	for(Logger *l = logging.outputs; l; l = l->next) {
+		size_t len = l->batch.pos - l->batch.start;
+
+		if(len) {
+			SDL_RWwrite(l->out, l->batch.start, 1, len);
+			strbuf_clear(&l->batch);
+		}
+	}
+}
+
+static void log_queue_entry_free(QueuedLogEntry *qle) {
+	mem_free(qle->spilled_message);
+	qle->spilled_message = NULL;
+}
+
+static void log_queue_push(LogEntry *entry) {
+	uint head = SDL_AtomicGet(&logging.queue.head);
+
+	while(head - (uint)SDL_AtomicGet(&logging.queue.tail) >= LOG_QUEUE_SIZE) {
+		if(
+			logging.queue.overflow_policy == LOG_QUEUE_OVERFLOW_DROP ||
+			// The logger thread can't wait for itself
+			thread_get_current() == logging.queue.thread
+		) {
+			SDL_AtomicIncRef(&logging.queue.dropped);
+
+			if(entry->thread) {
+				thread_decref(entry->thread);
+			}
+
+			return;
+		}
+
+		// A failed CAS means the flag is already set, which is just as good.
+		// Re-check after announcing, so that the logger thread making room in between can't be missed.
+		SDL_AtomicCAS(&logging.queue.producer_waiting, 0, 1);
+
+		if(head - (uint)SDL_AtomicGet(&logging.queue.tail) >= LOG_QUEUE_SIZE) {
+			SDL_SemWaitTimeout(logging.queue.space_sem, 10);
+		}
+	}
+
+	QueuedLogEntry *qle = logging.queue.ring + (head & (LOG_QUEUE_SIZE - 1));
+	qle->e = *entry;
+
+	size_t msg_len = strlen(entry->message);
+
+	if(LIKELY(msg_len < sizeof(qle->message))) {
+		memcpy(qle->message, entry->message, msg_len + 1);
+		qle->e.message = qle->message;
+	} else {
+		qle->e.message = qle->spilled_message = memdup(entry->message, msg_len + 1);
+	}
+
+	SDL_AtomicAdd(&logging.queue.head, 1);
+
+	if(SDL_AtomicCAS(&logging.queue.consumer_waiting, 1, 0)) {
+		SDL_SemPost(logging.queue.wake_sem);
+	}
+}
+
 static void log_dispatch_async(LogEntry *entry) {
 	for(Logger *l = logging.outputs; l; l = l->next) {
 		if(l->levels & entry->level) {
-			size_t msg_len = strlen(entry->message);
-			auto qle = ALLOC_FLEX(QueuedLogEntry, msg_len + 1);
-			memcpy(&qle->e, entry, sizeof(*entry));
-			memcpy(qle->message, entry->message, msg_len);
-			qle->e.message = qle->message;
-			SDL_LockMutex(logging.queue.mutex);
-			alist_append(&logging.queue.queue, qle);
-			SDL_CondBroadcast(logging.queue.cond);
-			SDL_UnlockMutex(logging.queue.mutex);
-			break;
+			log_queue_push(entry);
+			return;
 		}
 	}
+
+	if(entry->thread) {
+		thread_decref(entry->thread);
+	}
 }
 
 static void *sync_logger(List **loggers, List *logger, void *arg) {
@@ -383,58 +478,177 @@ static void *delete_logger(List **loggers, List *logger, void *arg) {
 
 	SDL_RWsync(l->out);
 	SDL_RWclose(l->out);
+	strbuf_free(&l->batch);
 	mem_free(list_unlink(loggers, logger));
 
 	return NULL;
 }
 
-static void *log_queue_thread(void *a) {
-	SDL_mutex *mtx = logging.queue.mutex;
-	SDL_cond *cond = logging.queue.cond;
+static void log_report_dropped(void) {
+	int dropped = SDL_AtomicSet(&logging.queue.dropped, 0);
 
-	SDL_LockMutex(mtx);
+	if(!dropped) {
+		return;
+	}
 
+	char msg[64];
+	snprintf(msg, sizeof(msg), "%i messages dropped because the log queue was full", dropped);
+
+	LogEntry entry = {
+		.message = msg,
+		.file = _TAISEI_SRC_FILE,
+		.func = __func__,
+		.line = __LINE__,
+		.level = LOG_WARN,
+		.time = SDL_GetTicks(),
+		.thread = thread_get_current(),
+		.thread_id = thread_get_current_id(),
+	};
+
+	if(entry.thread) {
+		thread_incref(entry.thread);
+	}
+
+	log_dispatch_internal(&entry, true);
+}
+
+static void *log_queue_thread(void *a) {
 	for(;;) {
-		SDL_CondWait(cond, mtx);
-		QueuedLogEntry *qle;
-
-		while((qle = alist_pop(&logging.queue.queue)) && logging.queue.shutdown < 2) {
-			SDL_UnlockMutex(mtx);
-			log_dispatch(&qle->e);
-			mem_free(qle);
-			SDL_LockMutex(mtx);
+		if(SDL_AtomicGet(&logging.queue.shutdown) > 1) {
+			break;
 		}
 
-		SDL_CondBroadcast(cond);
+		uint tail = SDL_AtomicGet(&logging.queue.tail);
+		uint head = SDL_AtomicGet(&logging.queue.head);
 
-		if(logging.queue.shutdown) {
-			break;
+		if(head == tail) {
+			if(SDL_AtomicGet(&logging.queue.shutdown)) {
+				break;
+			}
+
+			// Same as in log_queue_push(), but the other way around
+			SDL_AtomicCAS(&logging.queue.consumer_waiting, 0, 1);
+
+			if(
+				SDL_AtomicGet(&logging.queue.head) == tail &&
+				!SDL_AtomicGet(&logging.queue.shutdown)
+			) {
+				SDL_SemWait(logging.queue.wake_sem);
+			}
+
+			continue;
+		}
+
+		// Format everything that's queued up, then release the slots before doing any I/O
+		for(uint i = tail; i != head; ++i) {
+			QueuedLogEntry *qle = logging.queue.ring + (i & (LOG_QUEUE_SIZE - 1));
+			log_dispatch_internal(&qle->e, true);
+			log_queue_entry_free(qle);
+		}
+
+		SDL_AtomicAdd(&logging.queue.tail, head - tail);
+
+		if(SDL_AtomicCAS(&logging.queue.producer_waiting, 1, 0)) {
+			SDL_SemPost(logging.queue.space_sem);
+		}
+
+		log_report_dropped();
+		log_flush_batch();
+		SDL_AtomicSet(&logging.queue.written, head);
+
+		if(SDL_AtomicGet(&logging.queue.sync_waiters)) {
+			SDL_LockMutex(logging.queue.sync_mutex);
+			SDL_CondBroadcast(logging.queue.sync_cond);
+			SDL_UnlockMutex(logging.queue.sync_mutex);
 		}
 	}
 
-	SDL_UnlockMutex(mtx);
+	if(SDL_AtomicGet(&logging.queue.sync_waiters)) {
+		SDL_LockMutex(logging.queue.sync_mutex);
+		SDL_CondBroadcast(logging.queue.sync_cond);
+		SDL_UnlockMutex(logging.queue.sync_mutex);
+	}
+
 	return NULL;
 }
 
+static void log_queue_free(void) {
+	if(logging.queue.ring) {
+		// Leftovers from a fast shutdown
+		uint head = SDL_AtomicGet(&logging.queue.head);
+
+		for(uint i = SDL_AtomicGet(&logging.queue.tail); i != head; ++i) {
+			QueuedLogEntry *qle = logging.queue.ring + (i & (LOG_QUEUE_SIZE - 1));
+
+			if(qle->e.thread) {
+				thread_decref(qle->e.thread);
+			}
+
+			log_queue_entry_free(qle);
+		}
+
+		mem_free(logging.queue.ring);
+	}
+
+	if(logging.queue.wake_sem) {
+		SDL_DestroySemaphore(logging.queue.wake_sem);
+	}
+
+	if(logging.queue.space_sem) {
+		SDL_DestroySemaphore(logging.queue.space_sem);
+	}
+
+	if(logging.queue.sync_mutex) {
+		SDL_DestroyMutex(logging.queue.sync_mutex);
+	}
+
+	if(logging.queue.sync_cond) {
+		SDL_DestroyCond(logging.queue.sync_cond);
+	}
+
+	memset(&logging.queue, 0, sizeof(logging.queue));
+}
+
 static void log_queue_init(void) {
 	if(!env_get("TAISEI_LOG_ASYNC", true)) {
 		return;
 	}
 
-	if(!(logging.queue.cond = SDL_CreateCond())) {
+	const char *policy = env_get("TAISEI_LOG_ASYNC_OVERFLOW", "block");
+
+	if(!strcmp(policy, "drop")) {
+		logging.queue.overflow_policy = LOG_QUEUE_OVERFLOW_DROP;
+	} else {
+		logging.queue.overflow_policy = LOG_QUEUE_OVERFLOW_BLOCK;
+	}
+
+	if(
+		!(logging.queue.wake_sem = SDL_CreateSemaphore(0)) ||
+		!(logging.queue.space_sem = SDL_CreateSemaphore(0))
+	) {
+		log_sdl_error(LOG_ERROR, "SDL_CreateSemaphore");
+		log_queue_free();
+		return;
+	}
+
+	if(!(logging.queue.sync_cond = SDL_CreateCond())) {
 		log_sdl_error(LOG_ERROR, "SDL_CreateCond");
+		log_queue_free();
 		return;
 	}
 
-	if(!(logging.queue.mutex = SDL_CreateMutex())) {
+	if(!(logging.queue.sync_mutex = SDL_CreateMutex())) {
 		log_sdl_error(LOG_ERROR, "SDL_CreateMutex");
+		log_queue_free();
 		return;
 	}
 
+	logging.queue.ring = ALLOC_ARRAY(LOG_QUEUE_SIZE, QueuedLogEntry);
 	logging.queue.thread = thread_create("Log queue", log_queue_thread, NULL, THREAD_PRIO_LOW);
 
 	if(!logging.queue.thread) {
 		log_error("Failed to create log queue thread");
+		log_queue_free();
 		return;
 	}
 }
@@ -444,16 +658,11 @@ static void log_queue_shutdown_internal(bool force_sync) {
 		return;
 	}
 
-	SDL_LockMutex(logging.queue.mutex);
-	logging.queue.shutdown = env_get("TAISEI_LOG_ASYNC_FAST_SHUTDOWN", false) && !force_sync ? 2 : 1;
-	SDL_CondBroadcast(logging.queue.cond);
-	SDL_UnlockMutex(logging.queue.mutex);
+	SDL_AtomicSet(&logging.queue.shutdown,
+		env_get("TAISEI_LOG_ASYNC_FAST_SHUTDOWN", false) && !force_sync ? 2 : 1);
+	SDL_SemPost(logging.queue.wake_sem);
 	thread_wait(logging.queue.thread);
-	logging.queue.thread = NULL;
-	SDL_DestroyMutex(logging.queue.mutex);
-	logging.queue.mutex = NULL;
-	SDL_DestroyCond(logging.queue.cond);
-	logging.queue.cond = NULL;
+	log_queue_free();
 }
 
 void log_queue_shutdown(void) {
@@ -486,17 +695,26 @@ void log_shutdown(void) {
 }
 
 void log_sync(bool flush) {
-	SDL_LockMutex(logging.queue.mutex);
+	if(logging.queue.thread) {
+		uint target = SDL_AtomicGet(&logging.queue.head);
+
+		SDL_LockMutex(logging.queue.sync_mutex);
+		SDL_AtomicIncRef(&logging.queue.sync_waiters);
 
-	while(logging.queue.queue.first) {
-		SDL_CondWait(logging.queue.cond, logging.queue.mutex);
+		while(
+			(int)(target - (uint)SDL_AtomicGet(&logging.queue.written)) > 0 &&
+			SDL_AtomicGet(&logging.queue.shutdown) < 2
+		) {
+			SDL_CondWait(logging.queue.sync_cond, logging.queue.sync_mutex);
+		}
+
+		SDL_AtomicAdd(&logging.queue.sync_waiters, -1);
+		SDL_UnlockMutex(logging.queue.sync_mutex);
 	}
 
 	if(flush) {
 		list_foreach(&logging.outputs, sync_logger, NULL);
 	}
-
-	SDL_UnlockMutex(logging.queue.mutex);
 }
 
 bool log_initialized(void) {
@@ -36,6 +36,7 @@
 #include "replay/demoplayer.h"
 #include "replay/tsrtool.h"
 #include "watchdog.h"
+#include "benchmark.h"
 
 static bool watchdog_handler(SDL_Event *evt, void *arg) {
 	assert(evt->type == MAKE_TAISEI_EVENT(TE_WATCHDOG));
@@ -61,6 +62,7 @@ static void taisei_shutdown(void) {
 
 	watchdog_shutdown();
 	demoplayer_shutdown();
+	benchmark_shutdown();
 	progress_unload();
 	stage_objpools_shutdown();
 	gamemode_shutdown();
@@ -229,6 +231,12 @@ static void log_version(void) {
 	log_info("%s %s", TAISEI_VERSION_FULL, TAISEI_VERSION_BUILD_TYPE);
 }
 
+typedef struct BenchmarkReplay {
+	Replay *replay;
+	char *filename;
+	int stage_idx;
+} BenchmarkReplay;
+
 typedef struct MainContext {
 	CLIAction cli;
 	Replay *replay_in;
@@ -236,6 +244,11 @@ typedef struct MainContext {
 	SDL_RWops *replay_out_stream;
 	ResourceGroup rg;
 	int replay_idx;
+	struct {
+		DYNAMIC_ARRAY(BenchmarkReplay) replays;
+		char *out_path;
+		int next;
+	} bench;
 	uchar headless : 1;
 } MainContext;
 
@@ -243,6 +256,7 @@ static void main_post_vfsinit(CallChainResult ccr);
 static void main_mainmenu(CallChainResult ccr);
 static void main_singlestg(MainContext *mctx) attr_unused;
 static void main_replay(MainContext *mctx);
+static void main_benchmark_next(CallChainResult ccr);
 static noreturn void main_vfstree(CallChainResult ccr);
 
 static void cleanup_replay(Replay **rpy) {
@@ -280,6 +294,14 @@ static noreturn void main_quit(MainContext *ctx, int status) {
 
 	cleanup_replay(&ctx->replay_out);
 
+	dynarray_foreach_elem(&ctx->bench.replays, BenchmarkReplay *br, {
+		cleanup_replay(&br->replay);
+		mem_free(br->filename);
+	});
+
+	dynarray_free_data(&ctx->bench.replays);
+	mem_free(ctx->bench.out_path);
+
 	mem_free(ctx);
 	exit(status);
 }
@@ -354,6 +376,26 @@ int main(int argc, char **argv) {
 
 			ctx->replay_out = alloc_replay();
 		}
+	} else if(ctx->cli.type == CLI_BenchmarkReplay) {
+		dynarray_foreach_elem(&ctx->cli.benchmark_replays, char **filename, {
+			auto br = dynarray_append(&ctx->bench.replays, {
+				.replay = alloc_replay(),
+				.filename = strdup(*filename),
+			});
+
+			if(!replay_load_syspath(br->replay, br->filename, REPLAY_READ_ALL)) {
+				main_quit(ctx, 1);
+			}
+
+			br->stage_idx = ctx->cli.stageid ? replay_find_stage_idx(br->replay, ctx->cli.stageid) : 0;
+
+			if(br->stage_idx < 0) {
+				main_quit(ctx, 1);
+			}
+		});
+
+		ctx->bench.out_path = strdup(ctx->cli.benchmark_out);
+		ctx->headless = true;
 	} else if(ctx->cli.type == CLI_DumpVFSTree) {
 		vfs_setup(CALLCHAIN(main_vfstree, ctx));
 		return 0; // NO main_quit here! vfs_setup may be asynchronous.
@@ -449,6 +491,12 @@ static void main_post_vfsinit(CallChainResult ccr) {
 		return;
 	}
 
+	if(ctx->cli.type == CLI_BenchmarkReplay) {
+		main_benchmark_next(CALLCHAIN_RESULT(ctx, NULL));
+		eventloop_run();
+		return;
+	}
+
 	if(ctx->cli.type == CLI_Credits) {
 		credits_enter(cc_cleanup);
 		eventloop_run();
@@ -573,6 +621,24 @@ static void main_replay(MainContext *mctx) {
 	eventloop_run();
 }
 
+static void main_benchmark_next(CallChainResult ccr) {
+	MainContext *mctx = ccr.ctx;
+
+	if(mctx->bench.next > 0) {
+		benchmark_end_run();
+	}
+
+	if(mctx->bench.next < mctx->bench.replays.num_elements) {
+		BenchmarkReplay *br = dynarray_get_ptr(&mctx->bench.replays, mctx->bench.next++);
+		log_info("Benchmarking replay %s", br->filename);
+		benchmark_begin_run(br->filename);
+		replay_play(br->replay, br->stage_idx, false, CALLCHAIN(main_benchmark_next, mctx));
+		return;
+	}
+
+	main_quit(mctx, benchmark_write_report(mctx->bench.out_path) ? 0 : 1);
+}
+
 static void main_vfstree(CallChainResult ccr) {
 	MainContext *mctx = ccr.ctx;
 	SDL_RWops *rwops = SDL_RWFromFP(stdout, false);
@@ -16,6 +16,7 @@
 #include "plrmodes.h"
 #include "video.h"
 #include "common.h"
+#include "replay/index.h"
 #include "replay/state.h"
 #include "replay/struct.h"
 
@@ -23,11 +24,14 @@
 typedef struct ReplayviewContext {
 	MenuData *submenu;
 	MenuData *next_submenu;
+	ReplayIndexRefresh *refresh;
 	double sub_fade;
+	int num_replays;
 } ReplayviewContext;
 
 // Type of MenuEntry.arg (which should be renamed to context, probably...)
 typedef struct ReplayviewItemContext {
+	// Only the summary from the replay index, until the replay is started
 	Replay *replay;
 	char *replayname;
 } ReplayviewItemContext;
@@ -81,9 +85,19 @@ static void start_replay(MenuData *menu, void *arg) {
 	}
 
 	Replay *rpy = ictx->replay;
+	Replay loaded;
 
-	if(!replay_load(rpy, ictx->replayname, REPLAY_READ_EVENTS)) {
-		replayview_set_submenu(menu, replayview_sub_messagebox(menu, "Failed to load replay events"));
+	if(!replay_load(&loaded, ictx->replayname, REPLAY_READ_ALL)) {
+		replayview_set_submenu(menu, replayview_sub_messagebox(menu, "Failed to load replay"));
+		return;
+	}
+
+	replay_reset(rpy);
+	*rpy = loaded;
+
+	if(stagenum >= rpy->stages.num_elements) {
+		replay_destroy_events(rpy);
+		replayview_set_submenu(menu, replayview_sub_messagebox(menu, "The replay file has changed"));
 		return;
 	}
 
@@ -322,6 +336,17 @@ static void replayview_drawitem(MenuEntry *e, int item, int cnt, void *ctx) {
 static void replayview_logic(MenuData *m) {
 	ReplayviewContext *ctx = m->context;
 
+	// Nothing may hold on to the current entries while they're being replaced
+	if(
+		ctx->refresh &&
+		!ctx->submenu &&
+		m->state == MS_Normal &&
+		transition.state == TRANS_IDLE &&
+		replay_index_refresh_done(ctx->refresh)
+	) {
+		replayview_finish_refresh(m);
+	}
+
 	if(ctx->submenu) {
 		MenuData *sm = ctx->submenu;
 
@@ -375,43 +400,90 @@ static int replayview_cmp(const void *a, const void *b) {
 	return dynarray_get(&brpy->stages, 0).start_time - dynarray_get(&arpy->stages, 0).start_time;
 }
 
-static int fill_replayview_menu(MenuData *m) {
-	VFSDir *dir = vfs_dir_open("storage/replays");
-	const char *filename;
-	int rpys = 0;
+static void replayview_clear(MenuData *m) {
+	dynarray_foreach_elem(&m->entries, MenuEntry *e, {
+		if(e->action == replayview_run) {
+			replayview_freearg(e->arg);
+		}
 
-	if(!dir) {
-		log_warn("VFS error: %s", vfs_get_error());
-		return -1;
-	}
+		mem_free(e->name);
+	});
 
-	char ext[5];
-	snprintf(ext, 5, ".%s", REPLAY_EXTENSION);
+	m->entries.num_elements = 0;
+}
 
-	while((filename = vfs_dir_read(dir))) {
-		if(!strendswith(filename, ext))
-			continue;
+static void replayview_populate(MenuData *m, ReplayIndex *idx, bool failed) {
+	ReplayviewContext *ctx = m->context;
+	char *selected = NULL;
+
+	if(m->cursor >= 0 && m->cursor < m->entries.num_elements) {
+		MenuEntry *e = dynarray_get_ptr(&m->entries, m->cursor);
+
+		if(e->action == replayview_run) {
+			selected = strdup(((ReplayviewItemContext*)e->arg)->replayname);
+		}
+	}
+
+	replayview_clear(m);
+	ctx->num_replays = 0;
 
-		auto rpy = ALLOC(Replay);
-		if(!replay_load(rpy, filename, REPLAY_READ_META)) {
-			mem_free(rpy);
+	dynarray_foreach_elem(&idx->entries, ReplayIndexEntry *ie, {
+		if(!ie->replay) {
 			continue;
 		}
 
+		// Take over the entry's data; replay_index_free() skips what's been taken
 		auto ictx = ALLOC(ReplayviewItemContext, {
-			.replay = rpy,
-			.replayname = strdup(filename),
+			.replay = ie->replay,
+			.replayname = ie->name,
 		});
 
+		ie->replay = NULL;
+		ie->name = NULL;
+
 		add_menu_entry(m, " ", replayview_run, ictx)->transition = /*rpy->numstages < 2 ? TransFadeBlack :*/ NULL;
-		++rpys;
+		++ctx->num_replays;
+	});
+
+	dynarray_qsort(&m->entries, replayview_cmp);
+	m->cursor = 0;
+
+	if(selected) {
+		dynarray_foreach(&m->entries, int i, MenuEntry *e, {
+			if(!strcmp(((ReplayviewItemContext*)e->arg)->replayname, selected)) {
+				m->cursor = i;
+				break;
+			}
+		});
+
+		mem_free(selected);
 	}
 
-	vfs_dir_close(dir);
+	if(ctx->num_replays) {
+		add_menu_separator(m);
+		add_menu_entry(m, "Back", menu_action_close, NULL);
+	} else if(failed) {
+		add_menu_entry(m, "There was a problem getting the replay list :(", menu_action_close, NULL);
+	} else if(ctx->refresh) {
+		add_menu_entry(m, "Looking for replays...", menu_action_close, NULL);
+	} else {
+		add_menu_entry(m, "No replays available. Play the game and record some!", menu_action_close, NULL);
+	}
+}
 
-	dynarray_qsort(&m->entries, replayview_cmp);
+static void replayview_finish_refresh(MenuData *m) {
+	ReplayviewContext *ctx = m->context;
+	ReplayIndex idx;
+	bool changed;
+	bool ok = replay_index_refresh_finish(ctx->refresh, &idx, &changed);
+	ctx->refresh = NULL;
+
+	// Keep showing the saved index if the directory can't be read for some reason
+	if(!ctx->num_replays || (ok && changed)) {
+		replayview_populate(m, &idx, !ok);
+	}
 
-	return rpys;
+	replay_index_free(&idx);
 }
 
 static void replayview_menu_input(MenuData *m) {
@@ -433,6 +505,10 @@ static void replayview_free(MenuData *m) {
 	if(m->context) {
 		ReplayviewContext *ctx = m->context;
 
+		if(ctx->refresh) {
+			replay_index_refresh_cancel(ctx->refresh);
+		}
+
 		free_menu(ctx->next_submenu);
 		free_menu(ctx->submenu);
 		mem_free(m->context);
@@ -459,16 +535,14 @@ MenuData *create_replayview_menu(void) {
 	});
 	m->flags = MF_Abortable;
 
-	int r = fill_replayview_menu(m);
+	// Show what we knew last time right away, and pick up any changes in the background
+	ReplayviewContext *ctx = m->context;
+	ctx->refresh = replay_index_refresh_async();
 
-	if(!r) {
-		add_menu_entry(m, "No replays available. Play the game and record some!", menu_action_close, NULL);
-	} else if(r < 0) {
-		add_menu_entry(m, "There was a problem getting the replay list :(", menu_action_close, NULL);
-	} else {
-		add_menu_separator(m);
-		add_menu_entry(m, "Back", menu_action_close, NULL);
-	}
+	ReplayIndex idx;
+	replay_index_load(&idx);
+	replayview_populate(m, &idx, false);
+	replay_index_free(&idx);
 
 	return m;
 }
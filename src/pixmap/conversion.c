@@ -9,9 +9,11 @@
 #include "taisei.h"
 
 #include "pixmap.h"
+#include "conversion_kernels.h"
 #include "util.h"
 
-// NOTE: this is pretty stupid and not at all optimized, patches welcome
+// NOTE: this is pretty stupid and not at all optimized; the common cases are handled by the
+// specialized kernels in conversion_kernels.c
 
 #define _CONV_FUNCNAME	convert_u8_to_u8
 #define _CONV_IN_MAX	UINT8_MAX
@@ -217,6 +219,10 @@ void pixmap_convert(const Pixmap *src, Pixmap *dst, PixmapFormat format) {
 
 	dst->format = format;
 
+	if(pixmap_convert_fast(src->format, format, num_pixels, src->data.untyped, dst->data.untyped)) {
+		return;
+	}
+
 	struct conversion_def *cv = find_conversion(
 		PIXMAP_FORMAT_DEPTH(src->format) | (PIXMAP_FORMAT_IS_FLOAT(src->format) * DEPTH_FLOAT_BIT),
 		PIXMAP_FORMAT_DEPTH(dst->format) | (PIXMAP_FORMAT_IS_FLOAT(dst->format) * DEPTH_FLOAT_BIT)
@@ -252,21 +258,29 @@ void pixmap_swizzle_inplace(Pixmap *px, SwizzleMask swizzle) {
 		return;
 	}
 
+	int swizzle_map[] = {
+		swizzle_idx(swizzle.r),
+		swizzle_idx(swizzle.g),
+		swizzle_idx(swizzle.b),
+		swizzle_idx(swizzle.a),
+	};
+
+	size_t num_pixels = px->width * px->height;
+
+	if(pixmap_swizzle_fast(px->format, num_pixels, px->data.untyped, swizzle_map)) {
+		return;
+	}
+
 	uint cvt_id = pixmap_format_depth(px->format) | (pixmap_format_is_float(px->format) * DEPTH_FLOAT_BIT);
 	struct conversion_def *cv = find_conversion(cvt_id, cvt_id);
 
 	cv->func(
 		channels,
 		channels,
-		px->width * px->height,
+		num_pixels,
 		px->data.untyped,
 		px->data.untyped,
-		(int[]) {
-			swizzle_idx(swizzle.r),
-			swizzle_idx(swizzle.g),
-			swizzle_idx(swizzle.b),
-			swizzle_idx(swizzle.a),
-		}
+		swizzle_map
 	);
 }
 
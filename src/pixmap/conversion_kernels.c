@@ -0,0 +1,795 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#include "taisei.h"
+
+#include "conversion_kernels.h"
+#include "util.h"
+
+// SSE2 is only used where it's part of the baseline (always the case on x86_64). AVX2 kernels are
+// compiled for it regardless of the build flags, and are only used if the CPU supports them.
+#if defined(__SSE2__)
+	#define KERNELS_SSE2
+	#include <emmintrin.h>
+
+	#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+		#define KERNELS_AVX2
+		#define TARGET_AVX2 __attribute__((target("avx2")))
+		#include <immintrin.h>
+	#endif
+#endif
+
+#if defined(__ARM_NEON)
+	#define KERNELS_NEON
+	#include <arm_neon.h>
+#endif
+
+typedef void (*ConvKernel)(size_t count, const void *in, void *out);
+typedef void (*SwizzleKernel)(size_t num_pixels, uint8_t *data, const int swizzle[4]);
+
+enum {
+	// count is in pixels
+	CONV_RGBA8_TO_RGB8,
+	CONV_RGB8_TO_RGBA8,
+	CONV_R8_TO_RGBA8,
+
+	// count is in elements; any layout, as long as it's the same on both sides
+	CONV_U8_TO_F32,
+	CONV_F32_TO_U8,
+	CONV_U16_TO_U8,
+
+	NUM_CONV_KERNELS,
+};
+
+typedef struct KernelTable {
+	ConvKernel conv[NUM_CONV_KERNELS];
+	SwizzleKernel swizzle_rgba8;
+} KernelTable;
+
+/*
+ * Scalar kernels. Also used to handle the tails of the vector kernels.
+ */
+
+// Same as roundf(clamp(v, 0, 1) * 255), NaN included, but without the libm call
+INLINE uint8_t unorm8_from_float(float v) {
+	float y = (v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f) * 255.0f;
+	int t = (int)y;
+	return t + (y - (float)t >= 0.5f);
+}
+
+static void scalar_rgba8_to_rgb8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+
+	for(size_t i = 0; i < num_pixels; ++i, in += 4, out += 3) {
+		out[0] = in[0];
+		out[1] = in[1];
+		out[2] = in[2];
+	}
+}
+
+static void scalar_rgb8_to_rgba8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+
+	for(size_t i = 0; i < num_pixels; ++i, in += 3, out += 4) {
+		out[0] = in[0];
+		out[1] = in[1];
+		out[2] = in[2];
+		out[3] = UINT8_MAX;
+	}
+}
+
+static void scalar_r8_to_rgba8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+
+	for(size_t i = 0; i < num_pixels; ++i, out += 4) {
+		out[0] = in[i];
+		out[1] = 0;
+		out[2] = 0;
+		out[3] = UINT8_MAX;
+	}
+}
+
+static void scalar_u8_to_f32(size_t count, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	float *out = vout;
+
+	for(size_t i = 0; i < count; ++i) {
+		out[i] = in[i] * (1.0f / (float)UINT8_MAX);
+	}
+}
+
+static void scalar_f32_to_u8(size_t count, const void *vin, void *vout) {
+	const float *in = vin;
+	uint8_t *out = vout;
+
+	for(size_t i = 0; i < count; ++i) {
+		out[i] = unorm8_from_float(in[i]);
+	}
+}
+
+static void scalar_u16_to_u8(size_t count, const void *vin, void *vout) {
+	const uint16_t *in = vin;
+	uint8_t *out = vout;
+
+	for(size_t i = 0; i < count; ++i) {
+		// round(v * 255 / 65535) == round(v / 257); exact over the whole range
+		out[i] = (in[i] + 128) / 257;
+	}
+}
+
+static void scalar_swizzle_rgba8(size_t num_pixels, uint8_t *data, const int swizzle[4]) {
+	for(size_t i = 0; i < num_pixels; ++i, data += 4) {
+		uint8_t src[] = { data[0], data[1], data[2], data[3], 0, UINT8_MAX };
+		data[0] = src[swizzle[0]];
+		data[1] = src[swizzle[1]];
+		data[2] = src[swizzle[2]];
+		data[3] = src[swizzle[3]];
+	}
+}
+
+static const KernelTable scalar_kernels = {
+	.conv = {
+		[CONV_RGBA8_TO_RGB8] = scalar_rgba8_to_rgb8,
+		[CONV_RGB8_TO_RGBA8] = scalar_rgb8_to_rgba8,
+		[CONV_R8_TO_RGBA8]   = scalar_r8_to_rgba8,
+		[CONV_U8_TO_F32]     = scalar_u8_to_f32,
+		[CONV_F32_TO_U8]     = scalar_f32_to_u8,
+		[CONV_U16_TO_U8]     = scalar_u16_to_u8,
+	},
+	.swizzle_rgba8 = scalar_swizzle_rgba8,
+};
+
+/*
+ * SSE2 kernels. There's no byte shuffle, so the channel reordering ones are left to the scalar
+ * kernels (which compilers vectorize reasonably well anyway).
+ */
+
+#ifdef KERNELS_SSE2
+
+INLINE __m128i sse2_unorm8_from_float(__m128 v) {
+	// max returns the second operand if either is NaN, which is what the generic clamp does too
+	v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	__m128 y = _mm_mul_ps(v, _mm_set1_ps(255.0f));
+	__m128i t = _mm_cvttps_epi32(y);
+	__m128 frac = _mm_sub_ps(y, _mm_cvtepi32_ps(t));
+	// the mask is -1 where the value has to be rounded up
+	return _mm_sub_epi32(t, _mm_castps_si128(_mm_cmpge_ps(frac, _mm_set1_ps(0.5f))));
+}
+
+INLINE __m128i sse2_unorm8_from_unorm16(__m128i v) {
+	// (((v * 65281) >> 16) + 128) >> 8 == round(v / 257), without overflowing 16 bits
+	v = _mm_mulhi_epu16(v, _mm_set1_epi16((short)65281));
+	return _mm_srli_epi16(_mm_add_epi16(v, _mm_set1_epi16(128)), 8);
+}
+
+static void sse2_r8_to_rgba8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi16((short)0xff00);
+	size_t i = 0;
+
+	for(; i + 16 <= num_pixels; i += 16) {
+		__m128i r = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i lo = _mm_unpacklo_epi8(r, zero);
+		__m128i hi = _mm_unpackhi_epi8(r, zero);
+		__m128i *o = (__m128i*)(out + i * 4);
+		_mm_storeu_si128(o + 0, _mm_unpacklo_epi16(lo, alpha));
+		_mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo, alpha));
+		_mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi, alpha));
+		_mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi, alpha));
+	}
+
+	scalar_r8_to_rgba8(num_pixels - i, in + i, out + i * 4);
+}
+
+static void sse2_u8_to_f32(size_t count, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	float *out = vout;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(1.0f / (float)UINT8_MAX);
+	size_t i = 0;
+
+	for(; i + 16 <= count; i += 16) {
+		__m128i b = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i lo = _mm_unpacklo_epi8(b, zero);
+		__m128i hi = _mm_unpackhi_epi8(b, zero);
+		_mm_storeu_ps(out + i +  0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+		_mm_storeu_ps(out + i +  4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+		_mm_storeu_ps(out + i +  8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+		_mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+	}
+
+	scalar_u8_to_f32(count - i, in + i, out + i);
+}
+
+static void sse2_f32_to_u8(size_t count, const void *vin, void *vout) {
+	const float *in = vin;
+	uint8_t *out = vout;
+	size_t i = 0;
+
+	for(; i + 16 <= count; i += 16) {
+		__m128i a = sse2_unorm8_from_float(_mm_loadu_ps(in + i +  0));
+		__m128i b = sse2_unorm8_from_float(_mm_loadu_ps(in + i +  4));
+		__m128i c = sse2_unorm8_from_float(_mm_loadu_ps(in + i +  8));
+		__m128i d = sse2_unorm8_from_float(_mm_loadu_ps(in + i + 12));
+		__m128i p = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+		_mm_storeu_si128((__m128i*)(out + i), p);
+	}
+
+	scalar_f32_to_u8(count - i, in + i, out + i);
+}
+
+static void sse2_u16_to_u8(size_t count, const void *vin, void *vout) {
+	const uint16_t *in = vin;
+	uint8_t *out = vout;
+	size_t i = 0;
+
+	for(; i + 16 <= count; i += 16) {
+		__m128i a = sse2_unorm8_from_unorm16(_mm_loadu_si128((const __m128i*)(in + i)));
+		__m128i b = sse2_unorm8_from_unorm16(_mm_loadu_si128((const __m128i*)(in + i + 8)));
+		_mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(a, b));
+	}
+
+	scalar_u16_to_u8(count - i, in + i, out + i);
+}
+
+static const KernelTable sse2_kernels = {
+	.conv = {
+		[CONV_R8_TO_RGBA8]   = sse2_r8_to_rgba8,
+		[CONV_U8_TO_F32]     = sse2_u8_to_f32,
+		[CONV_F32_TO_U8]     = sse2_f32_to_u8,
+		[CONV_U16_TO_U8]     = sse2_u16_to_u8,
+	},
+};
+
+#endif  // KERNELS_SSE2
+
+/*
+ * AVX2 kernels.
+ */
+
+#ifdef KERNELS_AVX2
+
+INLINE TARGET_AVX2 __m256i avx2_unorm8_from_float(__m256 v) {
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+	__m256 y = _mm256_mul_ps(v, _mm256_set1_ps(255.0f));
+	__m256i t = _mm256_cvttps_epi32(y);
+	__m256 frac = _mm256_sub_ps(y, _mm256_cvtepi32_ps(t));
+	return _mm256_sub_epi32(t, _mm256_castps_si256(_mm256_cmp_ps(frac, _mm256_set1_ps(0.5f), _CMP_GE_OQ)));
+}
+
+INLINE TARGET_AVX2 __m256i avx2_unorm8_from_unorm16(__m256i v) {
+	v = _mm256_mulhi_epu16(v, _mm256_set1_epi16((short)65281));
+	return _mm256_srli_epi16(_mm256_add_epi16(v, _mm256_set1_epi16(128)), 8);
+}
+
+// Builds the byte shuffle and the OR mask for 8 pixels. Constant 0 selects a zero byte, constant
+// 1 selects a zero byte as well, which is then OR'd with 0xff.
+static TARGET_AVX2 void avx2_swizzle_masks(const int swizzle[4], __m256i *shuf, __m256i *fill) {
+	alignas(32) int8_t shuf_bytes[32];
+	alignas(32) int8_t fill_bytes[32];
+
+	for(int i = 0; i < 32; ++i) {
+		int s = swizzle[i & 3];
+		// within a 128-bit lane
+		int pixel_ofs = (i & 15) & ~3;
+		shuf_bytes[i] = s < 4 ? pixel_ofs + s : -128;
+		fill_bytes[i] = s == 5 ? -1 : 0;
+	}
+
+	*shuf = _mm256_load_si256((const __m256i*)shuf_bytes);
+	*fill = _mm256_load_si256((const __m256i*)fill_bytes);
+}
+
+static TARGET_AVX2 void avx2_rgba8_to_rgb8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+	// Pack the 12 useful bytes at the start of each lane, then move the lanes together
+	const __m256i shuf = _mm256_setr_epi8(
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+	);
+	const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+	size_t i = 0;
+
+	for(; i + 8 <= num_pixels; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(in + i * 4));
+		v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuf), perm);
+		_mm_storeu_si128((__m128i*)(out + i * 3), _mm256_castsi256_si128(v));
+		_mm_storel_epi64((__m128i*)(out + i * 3 + 16), _mm256_extracti128_si256(v, 1));
+	}
+
+	scalar_rgba8_to_rgb8(num_pixels - i, in + i * 4, out + i * 3);
+}
+
+static TARGET_AVX2 void avx2_rgb8_to_rgba8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+	// Put pixels 0-3 into the low lane and 4-7 into the high lane, then spread them out
+	const __m256i perm = _mm256_setr_epi32(0, 1, 2, 2, 3, 4, 5, 5);
+	const __m256i shuf = _mm256_setr_epi8(
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+	);
+	const __m256i alpha = _mm256_set1_epi32((int)0xff000000u);
+	size_t i = 0;
+
+	for(; i + 8 <= num_pixels; i += 8) {
+		// exactly 24 bytes, so that we never read past the end of the buffer
+		__m128i lo = _mm_loadu_si128((const __m128i*)(in + i * 3));
+		__m128i hi = _mm_loadl_epi64((const __m128i*)(in + i * 3 + 16));
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+		v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, perm), shuf);
+		_mm256_storeu_si256((__m256i*)(out + i * 4), _mm256_or_si256(v, alpha));
+	}
+
+	scalar_rgb8_to_rgba8(num_pixels - i, in + i * 3, out + i * 4);
+}
+
+static TARGET_AVX2 void avx2_r8_to_rgba8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+	const __m256i alpha = _mm256_set1_epi32((int)0xff000000u);
+	size_t i = 0;
+
+	for(; i + 8 <= num_pixels; i += 8) {
+		__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+		_mm256_storeu_si256((__m256i*)(out + i * 4), _mm256_or_si256(v, alpha));
+	}
+
+	scalar_r8_to_rgba8(num_pixels - i, in + i, out + i * 4);
+}
+
+static TARGET_AVX2 void avx2_u8_to_f32(size_t count, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	float *out = vout;
+	const __m256 scale = _mm256_set1_ps(1.0f / (float)UINT8_MAX);
+	size_t i = 0;
+
+	for(; i + 8 <= count; i += 8) {
+		__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+	}
+
+	scalar_u8_to_f32(count - i, in + i, out + i);
+}
+
+static TARGET_AVX2 void avx2_f32_to_u8(size_t count, const void *vin, void *vout) {
+	const float *in = vin;
+	uint8_t *out = vout;
+	// packs/packus work within lanes; this puts the dwords back in order
+	const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	size_t i = 0;
+
+	for(; i + 32 <= count; i += 32) {
+		__m256i a = avx2_unorm8_from_float(_mm256_loadu_ps(in + i +  0));
+		__m256i b = avx2_unorm8_from_float(_mm256_loadu_ps(in + i +  8));
+		__m256i c = avx2_unorm8_from_float(_mm256_loadu_ps(in + i + 16));
+		__m256i d = avx2_unorm8_from_float(_mm256_loadu_ps(in + i + 24));
+		__m256i p = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+		_mm256_storeu_si256((__m256i*)(out + i), _mm256_permutevar8x32_epi32(p, perm));
+	}
+
+	scalar_f32_to_u8(count - i, in + i, out + i);
+}
+
+static TARGET_AVX2 void avx2_u16_to_u8(size_t count, const void *vin, void *vout) {
+	const uint16_t *in = vin;
+	uint8_t *out = vout;
+	size_t i = 0;
+
+	for(; i + 32 <= count; i += 32) {
+		__m256i a = avx2_unorm8_from_unorm16(_mm256_loadu_si256((const __m256i*)(in + i)));
+		__m256i b = avx2_unorm8_from_unorm16(_mm256_loadu_si256((const __m256i*)(in + i + 16)));
+		// packus works within lanes; swap the middle quadwords to restore the order
+		__m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+		_mm256_storeu_si256((__m256i*)(out + i), p);
+	}
+
+	scalar_u16_to_u8(count - i, in + i, out + i);
+}
+
+static TARGET_AVX2 void avx2_swizzle_rgba8(size_t num_pixels, uint8_t *data, const int swizzle[4]) {
+	__m256i shuf, fill;
+	avx2_swizzle_masks(swizzle, &shuf, &fill);
+	size_t i = 0;
+
+	for(; i + 8 <= num_pixels; i += 8) {
+		__m256i *p = (__m256i*)(data + i * 4);
+		__m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(p), shuf);
+		_mm256_storeu_si256(p, _mm256_or_si256(v, fill));
+	}
+
+	scalar_swizzle_rgba8(num_pixels - i, data + i * 4, swizzle);
+}
+
+static const KernelTable avx2_kernels = {
+	.conv = {
+		[CONV_RGBA8_TO_RGB8] = avx2_rgba8_to_rgb8,
+		[CONV_RGB8_TO_RGBA8] = avx2_rgb8_to_rgba8,
+		[CONV_R8_TO_RGBA8]   = avx2_r8_to_rgba8,
+		[CONV_U8_TO_F32]     = avx2_u8_to_f32,
+		[CONV_F32_TO_U8]     = avx2_f32_to_u8,
+		[CONV_U16_TO_U8]     = avx2_u16_to_u8,
+	},
+	.swizzle_rgba8 = avx2_swizzle_rgba8,
+};
+
+#endif  // KERNELS_AVX2
+
+/*
+ * NEON kernels.
+ */
+
+#ifdef KERNELS_NEON
+
+INLINE uint32x4_t neon_unorm8_from_float(float32x4_t v) {
+	// NaN survives the clamp here, but converts to 0 like in the generic path
+	v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+	float32x4_t y = vmulq_n_f32(v, 255.0f);
+	uint32x4_t t = vcvtq_u32_f32(y);
+	float32x4_t frac = vsubq_f32(y, vcvtq_f32_u32(t));
+	return vsubq_u32(t, vcgeq_f32(frac, vdupq_n_f32(0.5f)));
+}
+
+INLINE uint8x8_t neon_unorm8_from_unorm16(uint16x8_t v) {
+	uint16x4_t lo = vshrn_n_u32(vmull_n_u16(vget_low_u16(v), 65281), 16);
+	uint16x4_t hi = vshrn_n_u32(vmull_n_u16(vget_high_u16(v), 65281), 16);
+	return vshrn_n_u16(vaddq_u16(vcombine_u16(lo, hi), vdupq_n_u16(128)), 8);
+}
+
+static void neon_rgba8_to_rgb8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+	size_t i = 0;
+
+	for(; i + 16 <= num_pixels; i += 16) {
+		uint8x16x4_t v = vld4q_u8(in + i * 4);
+		vst3q_u8(out + i * 3, (uint8x16x3_t) {{ v.val[0], v.val[1], v.val[2] }});
+	}
+
+	scalar_rgba8_to_rgb8(num_pixels - i, in + i * 4, out + i * 3);
+}
+
+static void neon_rgb8_to_rgba8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+	const uint8x16_t alpha = vdupq_n_u8(UINT8_MAX);
+	size_t i = 0;
+
+	for(; i + 16 <= num_pixels; i += 16) {
+		uint8x16x3_t v = vld3q_u8(in + i * 3);
+		vst4q_u8(out + i * 4, (uint8x16x4_t) {{ v.val[0], v.val[1], v.val[2], alpha }});
+	}
+
+	scalar_rgb8_to_rgba8(num_pixels - i, in + i * 3, out + i * 4);
+}
+
+static void neon_r8_to_rgba8(size_t num_pixels, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	uint8_t *out = vout;
+	const uint8x16_t zero = vdupq_n_u8(0);
+	const uint8x16_t alpha = vdupq_n_u8(UINT8_MAX);
+	size_t i = 0;
+
+	for(; i + 16 <= num_pixels; i += 16) {
+		vst4q_u8(out + i * 4, (uint8x16x4_t) {{ vld1q_u8(in + i), zero, zero, alpha }});
+	}
+
+	scalar_r8_to_rgba8(num_pixels - i, in + i, out + i * 4);
+}
+
+static void neon_u8_to_f32(size_t count, const void *vin, void *vout) {
+	const uint8_t *in = vin;
+	float *out = vout;
+	const float32x4_t scale = vdupq_n_f32(1.0f / (float)UINT8_MAX);
+	size_t i = 0;
+
+	for(; i + 16 <= count; i += 16) {
+		uint8x16_t b = vld1q_u8(in + i);
+		uint16x8_t lo = vmovl_u8(vget_low_u8(b));
+		uint16x8_t hi = vmovl_u8(vget_high_u8(b));
+		vst1q_f32(out + i +  0, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), scale));
+		vst1q_f32(out + i +  4, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+		vst1q_f32(out + i +  8, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), scale));
+		vst1q_f32(out + i + 12, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+	}
+
+	scalar_u8_to_f32(count - i, in + i, out + i);
+}
+
+static void neon_f32_to_u8(size_t count, const void *vin, void *vout) {
+	const float *in = vin;
+	uint8_t *out = vout;
+	size_t i = 0;
+
+	for(; i + 16 <= count; i += 16) {
+		uint16x8_t lo = vcombine_u16(
+			vmovn_u32(neon_unorm8_from_float(vld1q_f32(in + i +  0))),
+			vmovn_u32(neon_unorm8_from_float(vld1q_f32(in + i +  4)))
+		);
+		uint16x8_t hi = vcombine_u16(
+			vmovn_u32(neon_unorm8_from_float(vld1q_f32(in + i +  8))),
+			vmovn_u32(neon_unorm8_from_float(vld1q_f32(in + i + 12)))
+		);
+		vst1q_u8(out + i, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+	}
+
+	scalar_f32_to_u8(count - i, in + i, out + i);
+}
+
+static void neon_u16_to_u8(size_t count, const void *vin, void *vout) {
+	const uint16_t *in = vin;
+	uint8_t *out = vout;
+	size_t i = 0;
+
+	for(; i + 16 <= count; i += 16) {
+		uint8x8_t lo = neon_unorm8_from_unorm16(vld1q_u16(in + i));
+		uint8x8_t hi = neon_unorm8_from_unorm16(vld1q_u16(in + i + 8));
+		vst1q_u8(out + i, vcombine_u8(lo, hi));
+	}
+
+	scalar_u16_to_u8(count - i, in + i, out + i);
+}
+
+#ifdef __aarch64__
+
+static void neon_swizzle_rgba8(size_t num_pixels, uint8_t *data, const int swizzle[4]) {
+	uint8_t shuf_bytes[16], fill_bytes[16];
+
+	for(int i = 0; i < 16; ++i) {
+		int s = swizzle[i & 3];
+		// out of range indices select 0
+		shuf_bytes[i] = s < 4 ? (i & ~3) + s : 0xff;
+		fill_bytes[i] = s == 5 ? 0xff : 0;
+	}
+
+	const uint8x16_t shuf = vld1q_u8(shuf_bytes);
+	const uint8x16_t fill = vld1q_u8(fill_bytes);
+	size_t i = 0;
+
+	for(; i + 4 <= num_pixels; i += 4) {
+		uint8_t *p = data + i * 4;
+		vst1q_u8(p, vorrq_u8(vqtbl1q_u8(vld1q_u8(p), shuf), fill));
+	}
+
+	scalar_swizzle_rgba8(num_pixels - i, data + i * 4, swizzle);
+}
+
+#endif  // __aarch64__
+
+static const KernelTable neon_kernels = {
+	.conv = {
+		[CONV_RGBA8_TO_RGB8] = neon_rgba8_to_rgb8,
+		[CONV_RGB8_TO_RGBA8] = neon_rgb8_to_rgba8,
+		[CONV_R8_TO_RGBA8]   = neon_r8_to_rgba8,
+		[CONV_U8_TO_F32]     = neon_u8_to_f32,
+		[CONV_F32_TO_U8]     = neon_f32_to_u8,
+		[CONV_U16_TO_U8]     = neon_u16_to_u8,
+	},
+#ifdef __aarch64__
+	.swizzle_rgba8 = neon_swizzle_rgba8,
+#endif
+};
+
+#endif  // KERNELS_NEON
+
+/*
+ * Selection
+ */
+
+static const struct {
+	const char *name;
+	const KernelTable *table;  // NULL if not compiled in
+	PixmapKernelSet fallback;  // for kernels missing from table
+} kernel_sets[] = {
+	[PIXMAP_KERNELS_GENERIC] = { "generic" },
+	[PIXMAP_KERNELS_SCALAR] = { "scalar", &scalar_kernels, PIXMAP_KERNELS_GENERIC },
+#ifdef KERNELS_SSE2
+	[PIXMAP_KERNELS_SSE2] = { "sse2", &sse2_kernels, PIXMAP_KERNELS_SCALAR },
+#else
+	[PIXMAP_KERNELS_SSE2] = { "sse2" },
+#endif
+#ifdef KERNELS_AVX2
+	[PIXMAP_KERNELS_AVX2] = { "avx2", &avx2_kernels, PIXMAP_KERNELS_SSE2 },
+#else
+	[PIXMAP_KERNELS_AVX2] = { "avx2" },
+#endif
+#ifdef KERNELS_NEON
+	[PIXMAP_KERNELS_NEON] = { "neon", &neon_kernels, PIXMAP_KERNELS_SCALAR },
+#else
+	[PIXMAP_KERNELS_NEON] = { "neon" },
+#endif
+};
+
+static_assert(ARRAY_SIZE(kernel_sets) == PIXMAP_KERNELS_NUM_SETS, "");
+
+// In order of preference
+static const PixmapKernelSet preferred_sets[] = {
+	PIXMAP_KERNELS_AVX2,
+	PIXMAP_KERNELS_SSE2,
+	PIXMAP_KERNELS_NEON,
+	PIXMAP_KERNELS_SCALAR,
+};
+
+static SDL_atomic_t active_set = { -1 };
+
+const char *pixmap_kernel_set_name(PixmapKernelSet ks) {
+	assert((uint)ks < ARRAY_SIZE(kernel_sets));
+	return kernel_sets[ks].name;
+}
+
+bool pixmap_kernel_set_supported(PixmapKernelSet ks) {
+	assert((uint)ks < ARRAY_SIZE(kernel_sets));
+
+	if(ks == PIXMAP_KERNELS_GENERIC) {
+		return true;
+	}
+
+	if(!kernel_sets[ks].table) {
+		return false;
+	}
+
+	if(ks == PIXMAP_KERNELS_AVX2) {
+		return SDL_HasAVX2();
+	}
+
+	// Everything else is only compiled in if the target guarantees it
+	return true;
+}
+
+static PixmapKernelSet pixmap_kernels_select(void) {
+	const char *want = env_get("TAISEI_PIXMAP_KERNELS", "");
+
+	if(*want) {
+		for(uint i = 0; i < ARRAY_SIZE(kernel_sets); ++i) {
+			if(strcmp(want, kernel_sets[i].name)) {
+				continue;
+			}
+
+			if(pixmap_kernel_set_supported(i)) {
+				return i;
+			}
+
+			log_warn("Pixmap kernel set '%s' is not supported on this system", want);
+			goto pick_best;
+		}
+
+		log_warn("Unknown pixmap kernel set '%s'", want);
+	}
+
+pick_best:
+	for(uint i = 0; i < ARRAY_SIZE(preferred_sets); ++i) {
+		if(pixmap_kernel_set_supported(preferred_sets[i])) {
+			return preferred_sets[i];
+		}
+	}
+
+	UNREACHABLE;
+}
+
+PixmapKernelSet pixmap_kernels_get(void) {
+	int ks = SDL_AtomicGet(&active_set);
+
+	if(UNLIKELY(ks < 0)) {
+		ks = pixmap_kernels_select();
+
+		// Loader threads may race us here; they all arrive at the same answer anyway
+		if(SDL_AtomicCAS(&active_set, -1, ks)) {
+			log_info("Using %s pixmap conversion kernels", pixmap_kernel_set_name(ks));
+		}
+
+		ks = SDL_AtomicGet(&active_set);
+	}
+
+	return ks;
+}
+
+void pixmap_kernels_set(PixmapKernelSet ks) {
+	assert(pixmap_kernel_set_supported(ks));
+	SDL_AtomicSet(&active_set, ks);
+}
+
+static ConvKernel find_conv_kernel(PixmapKernelSet ks, uint id) {
+	for(; ks != PIXMAP_KERNELS_GENERIC; ks = kernel_sets[ks].fallback) {
+		ConvKernel k = kernel_sets[ks].table->conv[id];
+
+		if(k) {
+			return k;
+		}
+	}
+
+	return NULL;
+}
+
+static SwizzleKernel find_swizzle_kernel(PixmapKernelSet ks) {
+	for(; ks != PIXMAP_KERNELS_GENERIC; ks = kernel_sets[ks].fallback) {
+		SwizzleKernel k = kernel_sets[ks].table->swizzle_rgba8;
+
+		if(k) {
+			return k;
+		}
+	}
+
+	return NULL;
+}
+
+INLINE bool format_is_unorm(PixmapFormat fmt, uint depth) {
+	return pixmap_format_depth(fmt) == depth && !pixmap_format_is_float(fmt);
+}
+
+INLINE bool format_is_float(PixmapFormat fmt, uint depth) {
+	return pixmap_format_depth(fmt) == depth && pixmap_format_is_float(fmt);
+}
+
+bool pixmap_convert_fast(
+	PixmapFormat src_format, PixmapFormat dst_format, size_t num_pixels, const void *in, void *out
+) {
+	PixmapKernelSet ks = pixmap_kernels_get();
+
+	if(ks == PIXMAP_KERNELS_GENERIC || num_pixels == 0) {
+		return false;
+	}
+
+	uint src_layout = pixmap_format_layout(src_format);
+	uint dst_layout = pixmap_format_layout(dst_format);
+	size_t count = num_pixels;
+	uint id;
+
+	if(src_format == PIXMAP_FORMAT_RGBA8 && dst_format == PIXMAP_FORMAT_RGB8) {
+		id = CONV_RGBA8_TO_RGB8;
+	} else if(src_format == PIXMAP_FORMAT_RGB8 && dst_format == PIXMAP_FORMAT_RGBA8) {
+		id = CONV_RGB8_TO_RGBA8;
+	} else if(src_format == PIXMAP_FORMAT_R8 && dst_format == PIXMAP_FORMAT_RGBA8) {
+		id = CONV_R8_TO_RGBA8;
+	} else if(src_layout == dst_layout) {
+		count *= src_layout;
+
+		if(format_is_unorm(src_format, 8) && format_is_float(dst_format, 32)) {
+			id = CONV_U8_TO_F32;
+		} else if(format_is_float(src_format, 32) && format_is_unorm(dst_format, 8)) {
+			id = CONV_F32_TO_U8;
+		} else if(format_is_unorm(src_format, 16) && format_is_unorm(dst_format, 8)) {
+			id = CONV_U16_TO_U8;
+		} else {
+			return false;
+		}
+	} else {
+		return false;
+	}
+
+	ConvKernel kernel = find_conv_kernel(ks, id);
+
+	if(!kernel) {
+		return false;
+	}
+
+	kernel(count, in, out);
+	return true;
+}
+
+bool pixmap_swizzle_fast(PixmapFormat format, size_t num_pixels, void *data, const int swizzle[4]) {
+	PixmapKernelSet ks = pixmap_kernels_get();
+
+	if(ks == PIXMAP_KERNELS_GENERIC || format != PIXMAP_FORMAT_RGBA8 || num_pixels == 0) {
+		return false;
+	}
+
+	SwizzleKernel kernel = find_swizzle_kernel(ks);
+
+	if(!kernel) {
+		return false;
+	}
+
+	kernel(num_pixels, data, swizzle);
+	return true;
+}
@@ -0,0 +1,49 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#pragma once
+#include "taisei.h"
+
+#include "pixmap.h"
+
+/*
+ * Specialized kernels for the few conversions that show up in hot paths (texture loading,
+ * screenshots, font rasterization). Everything else goes through the generic converter.
+ *
+ * The kernels produce exactly the same output as the generic path, including rounding and the
+ * handling of out-of-range and NaN floats, so the choice of kernel set never affects the result.
+ */
+
+typedef enum PixmapKernelSet {
+	PIXMAP_KERNELS_GENERIC,  // no specialized kernels at all
+	PIXMAP_KERNELS_SCALAR,   // portable C
+	PIXMAP_KERNELS_SSE2,
+	PIXMAP_KERNELS_AVX2,
+	PIXMAP_KERNELS_NEON,
+
+	PIXMAP_KERNELS_NUM_SETS,
+} PixmapKernelSet;
+
+const char *pixmap_kernel_set_name(PixmapKernelSet ks);
+bool pixmap_kernel_set_supported(PixmapKernelSet ks);
+
+// The best supported set, unless overridden with TAISEI_PIXMAP_KERNELS.
+PixmapKernelSet pixmap_kernels_get(void);
+
+// For benchmarking; the set must be supported.
+void pixmap_kernels_set(PixmapKernelSet ks);
+
+// These return false if there is no specialized kernel for the operation.
+bool pixmap_convert_fast(
+	PixmapFormat src_format, PixmapFormat dst_format, size_t num_pixels, const void *in, void *out
+) attr_nonnull_all;
+
+// swizzle has the same meaning as in the generic converter: 0-3 are the source channels,
+// 4 is constant 0, 5 is constant 1.
+bool pixmap_swizzle_fast(PixmapFormat format, size_t num_pixels, void *data, const int swizzle[4])
+	attr_nonnull_all;
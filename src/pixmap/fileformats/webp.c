@@ -10,6 +10,7 @@
 
 #include "util.h"
 #include "fileformats.h"
+#include "vfs/public.h"
 
 #include <webp/decode.h>
 
@@ -51,16 +52,21 @@ static inline const char* webp_error_str(VP8StatusCode code)  {
 
 static bool px_webp_load(SDL_RWops *stream, Pixmap *pixmap, PixmapFormat preferred_format) {
 	size_t webp_bufsize;
-	// 64MB ought to be enough for anybody
-	uint8_t *webp_buffer = SDL_RWreadAll(stream, &webp_bufsize, 1024 * 1024 * 64);
+	uint8_t *webp_buffer = NULL;
+	const uint8_t *webp_data = vfs_stream_mapped_data(stream, &webp_bufsize);
 
-	if(UNLIKELY(!webp_buffer)) {
-		log_sdl_error(LOG_ERROR, "SDL_RWreadAll");
-		return false;
+	if(!webp_data) {
+		// 64MB ought to be enough for anybody
+		webp_data = webp_buffer = SDL_RWreadAll(stream, &webp_bufsize, 1024 * 1024 * 64);
+
+		if(UNLIKELY(!webp_buffer)) {
+			log_sdl_error(LOG_ERROR, "SDL_RWreadAll");
+			return false;
+		}
 	}
 
 	WebPBitstreamFeatures features;
-	VP8StatusCode status = WebPGetFeatures(webp_buffer, webp_bufsize, &features);
+	VP8StatusCode status = WebPGetFeatures(webp_data, webp_bufsize, &features);
 
 	if(UNLIKELY(status != VP8_STATUS_OK)) {
 		mem_free(webp_buffer);
@@ -105,13 +111,13 @@ static bool px_webp_load(SDL_RWops *stream, Pixmap *pixmap, PixmapFormat preferr
 
 	if(pixmap->format == PIXMAP_FORMAT_RGBA8) {
 		if(UNLIKELY(!(ok = WebPDecodeRGBAInto(
-			webp_buffer, webp_bufsize, begin, pixmap->data_size, stride))
+			webp_data, webp_bufsize, begin, pixmap->data_size, stride))
 		)) {
 			log_error("WebPDecodeRGBAInto() failed");
 		}
 	} else {
 		if(UNLIKELY(!(ok = WebPDecodeRGBInto(
-			webp_buffer, webp_bufsize, begin, pixmap->data_size, stride))
+			webp_data, webp_bufsize, begin, pixmap->data_size, stride))
 		)) {
 			log_error("WebPDecodeRGBInto() failed");
 		}
@@ -118,7 +118,7 @@ bool pixmap_load_stream(SDL_RWops *stream, PixmapFileFormat filefmt, Pixmap *dst
 
 bool pixmap_load_file(const char *path, Pixmap *dst, PixmapFormat preferred_format) {
 	log_debug("%s   %x", path, preferred_format);
-	SDL_RWops *stream = vfs_open(path, VFS_MODE_READ | VFS_MODE_SEEKABLE);
+	SDL_RWops *stream = vfs_open(path, VFS_MODE_READ | VFS_MODE_SEEKABLE | VFS_MODE_MAPPED);
 
 	if(!stream) {
 		log_error("VFS error: %s", vfs_get_error());
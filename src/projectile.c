@@ -13,6 +13,8 @@
 #include "global.h"
 #include "list.h"
 #include "stageobjects.h"
+#include "enemygrid.h"
+#include "projectile_batch.h"
 #include "util/glm.h"
 #include "stage.h"
 
@@ -114,7 +116,7 @@ static void process_projectile_args(ProjArgs *args, ProjArgs *defaults) {
 	assert(args->type <= PROJ_PLAYER);
 }
 
-static cmplx projectile_size(Projectile *p) {
+cmplx projectile_size(Projectile *p) {
 	cmplx r;
 
 	if(p->type == PROJ_PARTICLE && LIKELY(p->sprite != NULL)) {
@@ -132,20 +134,39 @@ static cmplx projectile_size(Projectile *p) {
 static Projectile *spawn_bullet_spawning_effect(Projectile *p);
 
 // Returns true if projectile should be destroyed
-static inline bool proj_update(Projectile *p, int t) {
+static inline bool proj_update(Projectile *p, int t, const ProjBatchResult *batched) {
 	bool destroy = false;
 
 	if(p->timeout > 0 && t >= p->timeout) {
 		destroy = true;
 	} else if(t >= 0) {
 		if(!(p->flags & PFLAG_NOMOVE)) {
-			move_update(&p->pos, &p->move);
+			if(batched) {
+				assert(batched->moved);
+#ifdef PROJ_DEBUG
+				cmplx check_pos = p->pos;
+				MoveParams check_move = p->move;
+				move_update(&check_pos, &check_move);
+
+				if(
+					memcmp(&check_pos, &batched->pos, sizeof(cmplx)) ||
+					memcmp(&check_move.velocity, &batched->velocity, sizeof(cmplx))
+				) {
+					set_debug_info(&p->debug);
+					log_fatal("Batched movement result differs from move_update()");
+				}
+#endif
+				p->pos = batched->pos;
+				p->move.velocity = batched->velocity;
+			} else {
+				move_update(&p->pos, &p->move);
+			}
 		}
 
 		if(p->flags & PFLAG_MANUALANGLE) {
 			p->angle += p->angle_delta;
 		} else {
-			cmplx delta_pos = p->pos - p->prevpos;
+			cmplx delta_pos = batched ? batched->delta_pos : p->pos - p->prevpos;
 
 			if(delta_pos) {
 				real angle;
@@ -340,7 +361,7 @@ void delete_projectiles(ProjectileList *projlist) {
 	alist_foreach(projlist, foreach_delete_projectile, NULL);
 }
 
-void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
+static void calc_projectile_collision_internal(Projectile *p, ProjCollisionResult *out_col, const ProjBatchResult *batched) {
 	out_col->type = PCOL_NONE;
 	out_col->entity = NULL;
 	out_col->fatal = false;
@@ -396,7 +417,9 @@ void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
 			}
 		}
 	} else if(p->type == PROJ_PLAYER) {
-		for(Enemy *e = global.enemies.first; e; e = e->next) {
+		EnemyGridQuery q;
+
+		ENEMYGRID_FOREACH_IN_BOX(&q, p->pos, p->pos, e) {
 			if(
 				!(e->flags & EFLAG_NO_HIT) &&
 				cabs2(e->pos - p->pos) < e->hit_radius * e->hit_radius
@@ -425,13 +448,17 @@ void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
 	if(
 		out_col->type == PCOL_NONE &&
 		!(p->flags & PFLAG_NOAUTOREMOVE) &&
-		!projectile_in_viewport(p)
+		!(batched ? batched->in_viewport : projectile_in_viewport(p))
 	) {
 		out_col->type = PCOL_VOID;
 		out_col->fatal = true;
 	}
 }
 
+void calc_projectile_collision(Projectile *p, ProjCollisionResult *out_col) {
+	calc_projectile_collision_internal(p, out_col, NULL);
+}
+
 void apply_projectile_collision(ProjectileList *projlist, Projectile *p, ProjCollisionResult *col) {
 	signal_event_with_collision_result(p, &p->events.collision, col);
 
@@ -571,9 +598,11 @@ void kill_projectile(Projectile *proj) {
 void process_projectiles(ProjectileList *projlist, bool collision) {
 	ProjCollisionResult col = { 0 };
 	bool stage_cleared = stage_is_cleared();
+	ProjBatch *batch = projbatch_begin(projlist);
 
 	for(Projectile *proj = projlist->first, *next; proj; proj = next) {
 		next = proj->next;
+		int batch_slot = batch ? projbatch_advance(batch, proj) : -1;
 
 		if(proj->flags & PFLAG_INTERNAL_DEAD) {
 			delete_projectile(projlist, proj, NULL);
@@ -584,7 +613,9 @@ void process_projectiles(ProjectileList *projlist, bool collision) {
 			clear_projectile(proj, CLEAR_HAZARDS_BULLETS | CLEAR_HAZARDS_FORCE);
 		}
 
-		bool destroy = proj_update(proj, global.frames - proj->birthtime);
+		// NOTE: fetched after anything that may run task code for this projectile
+		const ProjBatchResult *batched = batch ? projbatch_get(batch, batch_slot, proj) : NULL;
+		bool destroy = proj_update(proj, global.frames - proj->birthtime, batched && batched->moved ? batched : NULL);
 
 		if(proj->graze_counter && proj->graze_counter_reset_timer - global.frames <= -90) {
 			proj->graze_counter--;
@@ -599,7 +630,7 @@ void process_projectiles(ProjectileList *projlist, bool collision) {
 			memset(&col, 0, sizeof(col));
 			col.fatal = true;
 		} else if(collision) {
-			calc_projectile_collision(proj, &col);
+			calc_projectile_collision_internal(proj, &col, batched);
 
 			if(col.fatal && col.type != PCOL_VOID) {
 				spawn_projectile_collision_effect(proj);
@@ -607,7 +638,10 @@ void process_projectiles(ProjectileList *projlist, bool collision) {
 		} else {
 			memset(&col, 0, sizeof(col));
 
-			if(!(proj->flags & PFLAG_NOAUTOREMOVE) && !projectile_in_viewport(proj)) {
+			if(
+				!(proj->flags & PFLAG_NOAUTOREMOVE) &&
+				!(batched ? batched->in_viewport : projectile_in_viewport(proj))
+			) {
 				col.fatal = true;
 			}
 		}
@@ -616,6 +650,10 @@ void process_projectiles(ProjectileList *projlist, bool collision) {
 		apply_projectile_collision(projlist, proj, &col);
 	}
 
+	if(batch) {
+		projbatch_end(batch);
+	}
+
 	for(Projectile *proj = projlist->first, *next; proj; proj = next) {
 		next = proj->next;
 
@@ -629,7 +667,7 @@ int trace_projectile(Projectile *p, ProjCollisionResult *out_col, ProjCollisionT
 	int t;
 
 	for(t = timeofs;; ++t) {
-		bool destroy = proj_update(p, t);
+		bool destroy = proj_update(p, t, NULL);
 		calc_projectile_collision(p, out_col);
 
 		if(out_col->type & stopflags || destroy) {
@@ -1112,6 +1150,7 @@ void projectiles_preload(ResourceGroup *rg) {
 
 void projectiles_free(void) {
 	ht_destroy(&shader_sublayer_map);
+	projbatch_free();
 	#define PP(name) (_pp_##name).reset(&_pp_##name);
 	#include "projectile_prototypes/all.inc.h"
 }
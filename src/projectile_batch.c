@@ -0,0 +1,394 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "projectile_batch.h"
+#include "global.h"
+#include "util/env.h"
+
+/*
+ * The SSE2 kernel is only bit-identical to move_update() as long as the compiler doesn't contract
+ * the scalar code into FMA instructions, which it may do if they're available.
+ */
+#if defined(__SSE2__) && !defined(__FMA__)
+	#define PROJBATCH_SSE2
+	#include <emmintrin.h>
+#endif
+
+enum {
+	// Input
+	SOA_POS_X,
+	SOA_POS_Y,
+	SOA_PREVPOS_X,
+	SOA_PREVPOS_Y,
+	SOA_VEL_X,
+	SOA_VEL_Y,
+	SOA_ACCEL_X,
+	SOA_ACCEL_Y,
+	SOA_RETENTION_X,
+	SOA_RETENTION_Y,
+	SOA_ATTRACTION_X,
+	SOA_ATTRACTION_Y,
+	SOA_ATTRACTION_POINT_X,
+	SOA_ATTRACTION_POINT_Y,
+	SOA_VIEWPORT_BUF_X,
+	SOA_VIEWPORT_BUF_Y,
+
+	// Output
+	SOA_OUT_POS_X,
+	SOA_OUT_POS_Y,
+	SOA_OUT_VEL_X,
+	SOA_OUT_VEL_Y,
+
+	SOA_NUM_FIELDS,
+};
+
+enum {
+	ENTRY_SCALAR,   // must go through the scalar path
+	ENTRY_STATIC,   // doesn't move this frame
+	ENTRY_MOVING,
+};
+
+struct ProjBatch {
+	double *soa;
+	Projectile **projs;
+	ProjFlags *flags;
+	ProjType *types;
+	uint8_t *entry_types;
+	uint8_t *in_viewport;
+	uint num;
+	uint capacity;
+	uint cursor;
+	uint32_t resume_counter;
+	ProjBatchResult result;
+	bool busy;
+};
+
+static ProjBatch batch;
+static int batch_enabled = -1;
+
+INLINE double *soa_field(ProjBatch *b, uint field) {
+	return b->soa + field * b->capacity;
+}
+
+static void projbatch_reserve(ProjBatch *b, uint num) {
+	if(num <= b->capacity) {
+		return;
+	}
+
+	// Keep the capacity even, so that the SIMD kernel never needs a scalar tail
+	uint capacity = topow2_u32(num | 1);
+
+	mem_free(b->soa);
+	mem_free(b->projs);
+	mem_free(b->flags);
+	mem_free(b->types);
+	mem_free(b->entry_types);
+	mem_free(b->in_viewport);
+
+	b->soa = mem_alloc_array_aligned(SOA_NUM_FIELDS * capacity, sizeof(double), 16);
+	b->projs = ALLOC_ARRAY(capacity, typeof(*b->projs));
+	b->flags = ALLOC_ARRAY(capacity, typeof(*b->flags));
+	b->types = ALLOC_ARRAY(capacity, typeof(*b->types));
+	b->entry_types = ALLOC_ARRAY(capacity, typeof(*b->entry_types));
+	b->in_viewport = ALLOC_ARRAY(capacity, typeof(*b->in_viewport));
+	b->capacity = capacity;
+}
+
+static uint8_t classify(Projectile *p) {
+	int t = global.frames - p->birthtime;
+
+	// Must match the conditions in proj_update()
+	if((p->timeout > 0 && t >= p->timeout) || t < 0 || (p->flags & PFLAG_NOMOVE)) {
+		return ENTRY_STATIC;
+	}
+
+	if(p->move.attraction && p->move.attraction_exponent != 1) {
+		// Needs pow(); not worth vectorizing
+		return ENTRY_SCALAR;
+	}
+
+	return ENTRY_MOVING;
+}
+
+static void projbatch_gather(ProjBatch *b, ProjectileList *projlist) {
+	double *f[SOA_NUM_FIELDS];
+
+	for(uint i = 0; i < SOA_NUM_FIELDS; ++i) {
+		f[i] = soa_field(b, i);
+	}
+
+	uint i = 0;
+
+	for(Projectile *p = projlist->first; p; p = p->next, ++i) {
+		b->projs[i] = p;
+		b->flags[i] = p->flags;
+		b->types[i] = p->type;
+		b->entry_types[i] = classify(p);
+
+		f[SOA_POS_X][i] = re(p->pos);
+		f[SOA_POS_Y][i] = im(p->pos);
+		f[SOA_PREVPOS_X][i] = re(p->prevpos);
+		f[SOA_PREVPOS_Y][i] = im(p->prevpos);
+		f[SOA_VEL_X][i] = re(p->move.velocity);
+		f[SOA_VEL_Y][i] = im(p->move.velocity);
+		f[SOA_ACCEL_X][i] = re(p->move.acceleration);
+		f[SOA_ACCEL_Y][i] = im(p->move.acceleration);
+		f[SOA_RETENTION_X][i] = re(p->move.retention);
+		f[SOA_RETENTION_Y][i] = im(p->move.retention);
+		f[SOA_ATTRACTION_X][i] = re(p->move.attraction);
+		f[SOA_ATTRACTION_Y][i] = im(p->move.attraction);
+		f[SOA_ATTRACTION_POINT_X][i] = re(p->move.attraction_point);
+		f[SOA_ATTRACTION_POINT_Y][i] = im(p->move.attraction_point);
+
+		if(p->flags & PFLAG_NOAUTOREMOVE) {
+			f[SOA_VIEWPORT_BUF_X][i] = 0;
+			f[SOA_VIEWPORT_BUF_Y][i] = 0;
+		} else {
+			// Same as in projectile_in_viewport()
+			real e = p->max_viewport_dist;
+			cmplx buffer = 0.5 * projectile_size(p) + CMPLX(e, e);
+			f[SOA_VIEWPORT_BUF_X][i] = re(buffer);
+			f[SOA_VIEWPORT_BUF_Y][i] = im(buffer);
+		}
+	}
+
+	assert(i == b->num);
+
+	// Pad to an even count with inert entries
+	if(i & 1) {
+		for(uint j = 0; j < SOA_NUM_FIELDS; ++j) {
+			f[j][i] = 0;
+		}
+
+		b->entry_types[i] = ENTRY_STATIC;
+	}
+}
+
+/*
+ * The kernels below must perform exactly the same operations as move_update() and
+ * projectile_in_viewport(), in the same order. Don't "simplify" the arithmetic.
+ */
+
+#ifdef PROJBATCH_SSE2
+
+INLINE __m128d blendv(__m128d mask, __m128d a, __m128d b) {
+	// mask ? a : b
+	return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+static void projbatch_kernel(ProjBatch *b) {
+	double *f[SOA_NUM_FIELDS];
+
+	for(uint i = 0; i < SOA_NUM_FIELDS; ++i) {
+		f[i] = soa_field(b, i);
+	}
+
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d vp_w = _mm_set1_pd(VIEWPORT_W);
+	const __m128d vp_h = _mm_set1_pd(VIEWPORT_H);
+
+	for(uint i = 0; i < b->num; i += 2) {
+		__m128d px  = _mm_load_pd(f[SOA_POS_X] + i);
+		__m128d py  = _mm_load_pd(f[SOA_POS_Y] + i);
+		__m128d vx  = _mm_load_pd(f[SOA_VEL_X] + i);
+		__m128d vy  = _mm_load_pd(f[SOA_VEL_Y] + i);
+		__m128d ax  = _mm_load_pd(f[SOA_ACCEL_X] + i);
+		__m128d ay  = _mm_load_pd(f[SOA_ACCEL_Y] + i);
+		__m128d rx  = _mm_load_pd(f[SOA_RETENTION_X] + i);
+		__m128d ry  = _mm_load_pd(f[SOA_RETENTION_Y] + i);
+		__m128d tx  = _mm_load_pd(f[SOA_ATTRACTION_X] + i);
+		__m128d ty  = _mm_load_pd(f[SOA_ATTRACTION_Y] + i);
+		__m128d apx = _mm_load_pd(f[SOA_ATTRACTION_POINT_X] + i);
+		__m128d apy = _mm_load_pd(f[SOA_ATTRACTION_POINT_Y] + i);
+
+		// *pos += velocity
+		__m128d nx = _mm_add_pd(px, vx);
+		__m128d ny = _mm_add_pd(py, vy);
+
+		// velocity = acceleration + cmul_finite(retention, velocity)
+		__m128d nvx = _mm_add_pd(ax, _mm_sub_pd(_mm_mul_pd(rx, vx), _mm_mul_pd(ry, vy)));
+		__m128d nvy = _mm_add_pd(ay, _mm_add_pd(_mm_mul_pd(rx, vy), _mm_mul_pd(ry, vx)));
+
+		// if(attraction) velocity += cmul_finite(attraction, attraction_point - *pos)
+		__m128d avx = _mm_sub_pd(apx, nx);
+		__m128d avy = _mm_sub_pd(apy, ny);
+		__m128d atvx = _mm_add_pd(nvx, _mm_sub_pd(_mm_mul_pd(tx, avx), _mm_mul_pd(ty, avy)));
+		__m128d atvy = _mm_add_pd(nvy, _mm_add_pd(_mm_mul_pd(tx, avy), _mm_mul_pd(ty, avx)));
+		__m128d has_attraction = _mm_or_pd(_mm_cmpneq_pd(tx, zero), _mm_cmpneq_pd(ty, zero));
+		nvx = blendv(has_attraction, atvx, nvx);
+		nvy = blendv(has_attraction, atvy, nvy);
+
+		__m128d moving = _mm_castsi128_pd(_mm_set_epi64x(
+			-(int64_t)(b->entry_types[i + 1] == ENTRY_MOVING),
+			-(int64_t)(b->entry_types[i] == ENTRY_MOVING)
+		));
+
+		nx = blendv(moving, nx, px);
+		ny = blendv(moving, ny, py);
+		nvx = blendv(moving, nvx, vx);
+		nvy = blendv(moving, nvy, vy);
+
+		_mm_store_pd(f[SOA_OUT_POS_X] + i, nx);
+		_mm_store_pd(f[SOA_OUT_POS_Y] + i, ny);
+		_mm_store_pd(f[SOA_OUT_VEL_X] + i, nvx);
+		_mm_store_pd(f[SOA_OUT_VEL_Y] + i, nvy);
+
+		// Viewport test
+		__m128d bx = _mm_load_pd(f[SOA_VIEWPORT_BUF_X] + i);
+		__m128d by = _mm_load_pd(f[SOA_VIEWPORT_BUF_Y] + i);
+		__m128d out = _mm_or_pd(
+			_mm_or_pd(
+				_mm_cmplt_pd(_mm_add_pd(nx, bx), zero),
+				_mm_cmplt_pd(_mm_add_pd(ny, by), zero)
+			),
+			_mm_or_pd(
+				_mm_cmpgt_pd(_mm_sub_pd(nx, bx), vp_w),
+				_mm_cmpgt_pd(_mm_sub_pd(ny, by), vp_h)
+			)
+		);
+
+		int outmask = _mm_movemask_pd(out);
+		b->in_viewport[i] = !(outmask & 1);
+		b->in_viewport[i + 1] = !(outmask & 2);
+	}
+}
+
+#else
+
+static void projbatch_kernel(ProjBatch *b) {
+	double *f[SOA_NUM_FIELDS];
+
+	for(uint i = 0; i < SOA_NUM_FIELDS; ++i) {
+		f[i] = soa_field(b, i);
+	}
+
+	for(uint i = 0; i < b->num; ++i) {
+		cmplx pos = CMPLX(f[SOA_POS_X][i], f[SOA_POS_Y][i]);
+		MoveParams move = {
+			.velocity = CMPLX(f[SOA_VEL_X][i], f[SOA_VEL_Y][i]),
+			.acceleration = CMPLX(f[SOA_ACCEL_X][i], f[SOA_ACCEL_Y][i]),
+			.retention = CMPLX(f[SOA_RETENTION_X][i], f[SOA_RETENTION_Y][i]),
+			.attraction = CMPLX(f[SOA_ATTRACTION_X][i], f[SOA_ATTRACTION_Y][i]),
+			.attraction_point = CMPLX(f[SOA_ATTRACTION_POINT_X][i], f[SOA_ATTRACTION_POINT_Y][i]),
+			.attraction_exponent = 1,
+		};
+
+		if(b->entry_types[i] == ENTRY_MOVING) {
+			move_update(&pos, &move);
+		}
+
+		f[SOA_OUT_POS_X][i] = re(pos);
+		f[SOA_OUT_POS_Y][i] = im(pos);
+		f[SOA_OUT_VEL_X][i] = re(move.velocity);
+		f[SOA_OUT_VEL_Y][i] = im(move.velocity);
+
+		cmplx buffer = CMPLX(f[SOA_VIEWPORT_BUF_X][i], f[SOA_VIEWPORT_BUF_Y][i]);
+		cmplx br = pos + buffer;
+		cmplx tl = pos - buffer;
+
+		b->in_viewport[i] = !(
+			re(br) < 0 || im(br) < 0 ||
+			re(tl) > VIEWPORT_W || im(tl) > VIEWPORT_H
+		);
+	}
+}
+
+#endif
+
+ProjBatch *projbatch_begin(ProjectileList *projlist) {
+	if(UNLIKELY(batch_enabled < 0)) {
+		batch_enabled = env_get("TAISEI_PROJ_BATCH", true);
+	}
+
+	if(!batch_enabled || batch.busy) {
+		return NULL;
+	}
+
+	uint num = 0;
+
+	for(Projectile *p = projlist->first; p; p = p->next) {
+		++num;
+	}
+
+	if(num == 0) {
+		return NULL;
+	}
+
+	ProjBatch *b = &batch;
+	projbatch_reserve(b, num + 1);
+	b->num = num;
+	b->cursor = 0;
+	b->busy = true;
+
+	projbatch_gather(b, projlist);
+	projbatch_kernel(b);
+
+	b->resume_counter = cotask_get_resume_counter();
+
+	return b;
+}
+
+int projbatch_advance(ProjBatch *b, Projectile *p) {
+	if(b->cursor >= b->num || b->projs[b->cursor] != p) {
+		// Spawned after the batch was gathered
+		return -1;
+	}
+
+	return b->cursor++;
+}
+
+const ProjBatchResult *projbatch_get(ProjBatch *b, int slot, Projectile *p) {
+	if(slot < 0) {
+		return NULL;
+	}
+
+	uint i = slot;
+	assert(i < b->num);
+	assert(b->projs[i] == p);
+
+	if(
+		b->entry_types[i] == ENTRY_SCALAR ||
+		b->resume_counter != cotask_get_resume_counter() ||
+		b->flags[i] != p->flags ||
+		b->types[i] != p->type
+	) {
+		return NULL;
+	}
+
+	b->result = (ProjBatchResult) {
+		.pos = CMPLX(soa_field(b, SOA_OUT_POS_X)[i], soa_field(b, SOA_OUT_POS_Y)[i]),
+		.velocity = CMPLX(soa_field(b, SOA_OUT_VEL_X)[i], soa_field(b, SOA_OUT_VEL_Y)[i]),
+		.moved = b->entry_types[i] == ENTRY_MOVING,
+		.in_viewport = b->in_viewport[i],
+	};
+
+	b->result.delta_pos = b->result.pos - CMPLX(
+		soa_field(b, SOA_PREVPOS_X)[i],
+		soa_field(b, SOA_PREVPOS_Y)[i]
+	);
+
+	return &b->result;
+}
+
+void projbatch_end(ProjBatch *b) {
+	assert(b->busy);
+	b->busy = false;
+}
+
+void projbatch_free(void) {
+	assert(!batch.busy);
+	mem_free(batch.soa);
+	mem_free(batch.projs);
+	mem_free(batch.flags);
+	mem_free(batch.types);
+	mem_free(batch.entry_types);
+	mem_free(batch.in_viewport);
+	batch = (ProjBatch) { 0 };
+}
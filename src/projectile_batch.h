@@ -0,0 +1,51 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#pragma once
+#include "taisei.h"
+
+#include "projectile.h"
+
+/*
+ * Structure-of-arrays side table for the hot per-frame projectile data.
+ *
+ * Before process_projectiles() runs the per-projectile logic, the movement state of the whole
+ * list is gathered here, and move_update() plus the viewport test are computed for all of it in
+ * one (vectorized, where possible) pass. The results are not written back directly; instead the
+ * main loop fetches them one projectile at a time, in list order.
+ *
+ * The per-projectile logic may run arbitrary task code (through events), which may in turn modify
+ * projectiles that haven't been processed yet. To stay exactly equivalent to the scalar path, the
+ * batch is discarded as soon as any task is resumed, and remaining projectiles fall back to
+ * move_update(). The vectorized kernel performs the same IEEE operations in the same order as
+ * move_update(), so results are bit-identical either way.
+ */
+
+typedef struct ProjBatchResult {
+	cmplx pos;
+	cmplx velocity;
+	cmplx delta_pos;
+	bool moved;
+	bool in_viewport;
+} ProjBatchResult;
+
+typedef struct ProjBatch ProjBatch;
+
+// Gathers and processes projlist. Returns NULL if batching is disabled or unavailable.
+ProjBatch *projbatch_begin(ProjectileList *projlist) attr_nonnull_all;
+
+// Must be called for every projectile in the list, in order, before it's processed.
+// Returns a slot for projbatch_get(), or -1 if p is not part of the batch.
+int projbatch_advance(ProjBatch *batch, Projectile *p) attr_nonnull_all;
+
+// Returns the precomputed result for p, or NULL if the scalar path must be used.
+// Validity is checked at the time of the call, so call this right before using the result.
+const ProjBatchResult *projbatch_get(ProjBatch *batch, int slot, Projectile *p) attr_nonnull_all;
+
+void projbatch_end(ProjBatch *batch) attr_nonnull_all;
+void projbatch_free(void);
@@ -676,6 +676,10 @@ VertexBuffer* r_vertex_buffer_create(size_t capacity, void *data) {
 	return B.vertex_buffer_create(capacity, data);
 }
 
+VertexBuffer* r_vertex_buffer_create_streaming(size_t capacity) {
+	return B.vertex_buffer_create_streaming(capacity);
+}
+
 const char* r_vertex_buffer_get_debug_label(VertexBuffer *vbuf) {
 	return B.vertex_buffer_get_debug_label(vbuf);
 }
@@ -696,6 +700,14 @@ SDL_RWops* r_vertex_buffer_get_stream(VertexBuffer *vbuf) {
 	return B.vertex_buffer_get_stream(vbuf);
 }
 
+void* r_vertex_buffer_map_range(VertexBuffer *vbuf, size_t min_size, size_t *out_size) {
+	return B.vertex_buffer_map_range(vbuf, min_size, out_size);
+}
+
+void r_vertex_buffer_commit(VertexBuffer *vbuf, size_t size) {
+	B.vertex_buffer_commit(vbuf, size);
+}
+
 IndexBuffer* r_index_buffer_create(uint index_size, size_t max_elements) {
 	return B.index_buffer_create(index_size, max_elements);
 }
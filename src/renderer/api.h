@@ -782,12 +782,23 @@ void r_framebuffer(Framebuffer *fb);
 Framebuffer* r_framebuffer_current(void);
 
 VertexBuffer* r_vertex_buffer_create(size_t capacity, void *data);
+
+// For per-draw data that is written from scratch after every r_vertex_buffer_invalidate().
+// The backend may keep several batches worth of storage around to avoid stalls.
+VertexBuffer* r_vertex_buffer_create_streaming(size_t capacity);
+
 const char* r_vertex_buffer_get_debug_label(VertexBuffer *vbuf) attr_nonnull(1);
 void r_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char* label) attr_nonnull(1);
 void r_vertex_buffer_destroy(VertexBuffer *vbuf) attr_nonnull(1);
 void r_vertex_buffer_invalidate(VertexBuffer *vbuf) attr_nonnull(1);
 SDL_RWops* r_vertex_buffer_get_stream(VertexBuffer *vbuf) attr_nonnull(1);
 
+// Returns a pointer to at least [min_size] writable bytes at the buffer's current write position;
+// the actual amount is stored in [out_size]. Data written there is not used until committed with
+// r_vertex_buffer_commit(). The pointer is invalidated by any other write to the buffer.
+void* r_vertex_buffer_map_range(VertexBuffer *vbuf, size_t min_size, size_t *out_size) attr_nonnull(1, 3);
+void r_vertex_buffer_commit(VertexBuffer *vbuf, size_t size) attr_nonnull(1);
+
 IndexBuffer* r_index_buffer_create(uint index_size, size_t max_elements);
 size_t r_index_buffer_get_capacity(IndexBuffer *ibuf) attr_nonnull(1);
 uint r_index_buffer_get_index_size(IndexBuffer *ibuf) attr_nonnull(1);
@@ -881,6 +892,13 @@ void r_draw_sprite(const SpriteParams *params) attr_nonnull(1);
 void r_sprite_batch_prepare_state(const SpriteStateParams *stp);
 void r_sprite_batch_add_instance(const SpriteInstanceAttribs *attribs);
 
+// Between these calls, r_draw_sprite() only records sprites. They are submitted on the next flush,
+// and sprites with a commutative blend mode (e.g. additive) may be reordered by state within the
+// same sort group. The caller must not change uniforms of the sprite shaders while deferring.
+void r_sprite_batch_begin_deferred(void);
+void r_sprite_batch_end_deferred(void);
+void r_sprite_batch_set_sort_group(uint32_t group);
+
 void r_flush_sprites(void);
 
 BlendMode r_blend_compose(
@@ -98,11 +98,14 @@ typedef struct RendererFuncs {
 	Framebuffer* (*framebuffer_current)(void);
 
 	VertexBuffer* (*vertex_buffer_create)(size_t capacity, void *data);
+	VertexBuffer* (*vertex_buffer_create_streaming)(size_t capacity);
 	const char* (*vertex_buffer_get_debug_label)(VertexBuffer *vbuf);
 	void (*vertex_buffer_set_debug_label)(VertexBuffer *vbuf, const char *label);
 	void (*vertex_buffer_destroy)(VertexBuffer *vbuf);
 	void (*vertex_buffer_invalidate)(VertexBuffer *vbuf);
 	SDL_RWops* (*vertex_buffer_get_stream)(VertexBuffer *vbuf);
+	void* (*vertex_buffer_map_range)(VertexBuffer *vbuf, size_t min_size, size_t *out_size);
+	void (*vertex_buffer_commit)(VertexBuffer *vbuf, size_t size);
 
 	IndexBuffer* (*index_buffer_create)(uint index_size, size_t max_elements);
 	size_t (*index_buffer_get_capacity)(IndexBuffer *ibuf);
@@ -13,6 +13,7 @@
 #include "util/glm.h"
 #include "resource/sprite.h"
 #include "resource/model.h"
+#include "hirestime.h"
 
 #define SPRITE_BATCH_STATS 0
 
@@ -26,6 +27,31 @@
 
 #define SIZEOF_SPRITE_ATTRIBS (offsetof(SpriteInstanceAttribs, end_of_fields))
 
+// Everything that forces a flush when it changes between two sprites.
+// Zero-initialized before filling, so that keys can be compared with memcmp.
+typedef struct SpriteStateKey {
+	ShaderProgram *shader;
+	Texture *primary_texture;
+	Texture *aux_textures[R_NUM_SPRITE_AUX_TEXTURES];
+	Framebuffer *framebuffer;
+	BlendMode blend;
+	DepthTestFunc depth_func;  // 0 unless depth test is enabled
+	CullFaceMode cull_mode;    // 0 unless face culling is enabled
+	uint projection;           // index into deferred.projections; unused in immediate mode
+	r_capability_bits_t capbits;
+} SpriteStateKey;
+
+typedef struct DeferredSprite {
+	SpriteStateKey key;
+	uint32_t group;
+	bool commutative;
+	SpriteInstanceAttribs attribs;
+} DeferredSprite;
+
+typedef struct DeferredProjection {
+	mat4 matrix;
+} DeferredProjection;
+
 static struct SpriteBatchState {
 	// constants (set once on init and not expected to change)
 	VertexArray *varr;
@@ -46,12 +72,32 @@ static struct SpriteBatchState {
 	uint num_pending;
 	r_capability_bits_t capbits;
 
+	// Window of the vertex buffer that instances are written into directly
+	struct {
+		char *ptr;
+		size_t size;
+		size_t used;
+	} mapping;
+
+	// Sprites recorded between r_sprite_batch_begin_deferred and r_sprite_batch_end_deferred
+	struct {
+		DYNAMIC_ARRAY(DeferredSprite) sprites;
+		DYNAMIC_ARRAY(DeferredProjection) projections;
+		DYNAMIC_ARRAY(uint32_t) order;
+		uint32_t group;
+		bool active;
+		bool submitting;
+	} deferred;
+
 #if SPRITE_BATCH_STATS
 	struct {
 		uint flushes;
+		uint deferred_sprites;
+		uint flushes_saved;
 		uint sprites;
 		uint best_batch;
 		uint worst_batch;
+		hrtime_t submit_time;
 	} frame_stats;
 #endif
 } _r_sprite_batch;
@@ -94,9 +140,8 @@ void _r_sprite_batch_init(void) {
 
 	uint capacity = 1 << 11;
 
-	_r_sprite_batch.vbuf = r_vertex_buffer_create(sz_attr * capacity, NULL);
+	_r_sprite_batch.vbuf = r_vertex_buffer_create_streaming(sz_attr * capacity);
 	r_vertex_buffer_set_debug_label(_r_sprite_batch.vbuf, "Sprite batch vertex buffer");
-	r_vertex_buffer_invalidate(_r_sprite_batch.vbuf);
 
 	_r_sprite_batch.varr = r_vertex_array_create();
 	r_vertex_array_set_debug_label(_r_sprite_batch.varr, "Sprite batch vertex array");
@@ -116,9 +161,16 @@ void _r_sprite_batch_init(void) {
 void _r_sprite_batch_shutdown(void) {
 	r_vertex_array_destroy(_r_sprite_batch.varr);
 	r_vertex_buffer_destroy(_r_sprite_batch.vbuf);
+	dynarray_free_data(&_r_sprite_batch.deferred.sprites);
+	dynarray_free_data(&_r_sprite_batch.deferred.projections);
+	dynarray_free_data(&_r_sprite_batch.deferred.order);
 }
 
+static void _r_sprite_batch_submit_deferred(void);
+
 void r_flush_sprites(void) {
+	_r_sprite_batch_submit_deferred();
+
 	if(_r_sprite_batch.num_pending == 0) {
 		return;
 	}
@@ -162,44 +214,79 @@ void r_flush_sprites(void) {
 		r_cull(_r_sprite_batch.cull_mode);
 	}
 
+	r_vertex_buffer_commit(_r_sprite_batch.vbuf, _r_sprite_batch.mapping.used);
 	r_draw_model_ptr(&_r_sprite_batch.quad, pending, 0);
 	r_vertex_buffer_invalidate(_r_sprite_batch.vbuf);
+	memset(&_r_sprite_batch.mapping, 0, sizeof(_r_sprite_batch.mapping));
 
 	r_mat_proj_pop();
 	r_state_pop();
 }
 
-static void _r_sprite_batch_compute_attribs(
-	const Sprite *restrict spr,
-	const SpriteParams *restrict params,
-	SpriteInstanceAttribs *out_attribs
+static inline bool _r_sprite_batch_is_2d_rotation(const SpriteRotationParams *rot) {
+	if(!rot->angle) {
+		return true;
+	}
+
+	const float *rvec = rot->vector;
+	return rvec[0] == 0 && rvec[1] == 0 && rvec[2] == 0;
+}
+
+/*
+ * Specialized version of _r_sprite_batch_transform_generic for the most common case: optional
+ * rotation around the Z axis, and no flipping. Updates the affected columns directly instead of
+ * building and multiplying full matrices.
+ */
+static void _r_sprite_batch_transform_2d(
+	mat4 m, FloatOffset pos, float angle, FloatExtent size, FloatOffset ofs, FloatExtent imgdims
 ) {
-	SpriteInstanceAttribs attribs;
-	r_mat_mv_current(attribs.mv_transform);
-	r_mat_tex_current(attribs.tex_transform);
+	if(pos.x || pos.y) {
+		glm_vec4_muladds(m[0], pos.x, m[3]);
+		glm_vec4_muladds(m[1], pos.y, m[3]);
+	}
 
-	float scale_x = params->scale.x ? params->scale.x : 1;
-	float scale_y = params->scale.y ? params->scale.y : scale_x;
+	if(angle) {
+		float s = sinf(angle);
+		float c = cosf(angle);
+		vec4 x, y;
 
-	FloatOffset ofs = spr->padding.offset;
-	FloatExtent imgdims = spr->extent;
-	imgdims.as_cmplx -= spr->padding.extent.as_cmplx;
+		glm_vec4_scale(m[0], c, x);
+		glm_vec4_muladds(m[1], s, x);
+		glm_vec4_scale(m[1], c, y);
+		glm_vec4_muladds(m[0], -s, y);
+
+		glm_vec4_copy(x, m[0]);
+		glm_vec4_copy(y, m[1]);
+	}
+
+	glm_vec4_scale(m[0], size.w, m[0]);
+	glm_vec4_scale(m[1], size.h, m[1]);
+
+	if(ofs.x || ofs.y) {
+		glm_vec4_muladds(m[0], ofs.x / imgdims.w, m[3]);
+		glm_vec4_muladds(m[1], ofs.y / imgdims.h, m[3]);
+	}
+}
 
+static void _r_sprite_batch_transform_generic(
+	mat4 m, const SpriteParams *restrict params,
+	float scale_x, float scale_y, FloatExtent imgdims, FloatOffset ofs
+) {
 	if(params->pos.x || params->pos.y) {
-		glm_translate(attribs.mv_transform, (vec3) { params->pos.x, params->pos.y });
+		glm_translate(m, (vec3) { params->pos.x, params->pos.y });
 	}
 
 	if(params->rotation.angle) {
 		float *rvec = (float*)params->rotation.vector;
 
 		if(rvec[0] == 0 && rvec[1] == 0 && rvec[2] == 0) {
-			glm_rotate(attribs.mv_transform, params->rotation.angle, (vec3) { 0, 0, 1 });
+			glm_rotate(m, params->rotation.angle, (vec3) { 0, 0, 1 });
 		} else {
-			glm_rotate(attribs.mv_transform, params->rotation.angle, rvec);
+			glm_rotate(m, params->rotation.angle, rvec);
 		}
 	}
 
-	glm_scale(attribs.mv_transform, (vec3) { scale_x * imgdims.w, scale_y * imgdims.h, 1 });
+	glm_scale(m, (vec3) { scale_x * imgdims.w, scale_y * imgdims.h, 1 });
 
 	if(ofs.x || ofs.y) {
 		if(params->flip.x) {
@@ -210,7 +297,41 @@ static void _r_sprite_batch_compute_attribs(
 			ofs.y *= -1;
 		}
 
-		glm_translate(attribs.mv_transform, (vec3) { ofs.x / imgdims.w, ofs.y / imgdims.h });
+		glm_translate(m, (vec3) { ofs.x / imgdims.w, ofs.y / imgdims.h });
+	}
+}
+
+static void _r_sprite_batch_compute_attribs(
+	const Sprite *restrict spr,
+	const SpriteParams *restrict params,
+	SpriteInstanceAttribs *out_attribs
+) {
+	SpriteInstanceAttribs attribs;
+	r_mat_mv_current(attribs.mv_transform);
+	r_mat_tex_current(attribs.tex_transform);
+
+	float scale_x = params->scale.x ? params->scale.x : 1;
+	float scale_y = params->scale.y ? params->scale.y : scale_x;
+
+	FloatOffset ofs = spr->padding.offset;
+	FloatExtent imgdims = spr->extent;
+	imgdims.as_cmplx -= spr->padding.extent.as_cmplx;
+
+	if(LIKELY(
+		!params->flip.x &&
+		!params->flip.y &&
+		_r_sprite_batch_is_2d_rotation(&params->rotation)
+	)) {
+		_r_sprite_batch_transform_2d(
+			attribs.mv_transform,
+			params->pos,
+			params->rotation.angle,
+			(FloatExtent) { .w = scale_x * imgdims.w, .h = scale_y * imgdims.h },
+			ofs,
+			imgdims
+		);
+	} else {
+		_r_sprite_batch_transform_generic(attribs.mv_transform, params, scale_x, scale_y, imgdims, ofs);
 	}
 
 	if(params->color == NULL) {
@@ -272,14 +393,32 @@ INLINE void _r_sprite_batch_process_params(
 	}
 }
 
-void r_sprite_batch_prepare_state(const SpriteStateParams *stp) {
-	if(stp->primary_texture != _r_sprite_batch.primary_texture) {
+static inline void _r_sprite_batch_capture_state(const SpriteStateParams *stp, SpriteStateKey *key) {
+	memset(key, 0, sizeof(*key));
+	key->shader = stp->shader;
+	key->primary_texture = stp->primary_texture;
+	memcpy(key->aux_textures, stp->aux_textures, sizeof(key->aux_textures));
+	key->blend = stp->blend;
+	key->framebuffer = r_framebuffer_current();
+	key->capbits = r_capabilities_current();
+
+	if(key->capbits & r_capability_bit(RCAP_DEPTH_TEST)) {
+		key->depth_func = r_depth_func_current();
+	}
+
+	if(key->capbits & r_capability_bit(RCAP_CULL_FACE)) {
+		key->cull_mode = r_cull_current();
+	}
+}
+
+static inline void _r_sprite_batch_apply_state(const SpriteStateKey *key, mat4 projection) {
+	if(key->primary_texture != _r_sprite_batch.primary_texture) {
 		r_flush_sprites();
-		_r_sprite_batch.primary_texture = stp->primary_texture;
+		_r_sprite_batch.primary_texture = key->primary_texture;
 	}
 
 	for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
-		Texture *aux_tex = stp->aux_textures[i];
+		Texture *aux_tex = key->aux_textures[i];
 
 		if(aux_tex != NULL && aux_tex != _r_sprite_batch.aux_textures[i]) {
 			r_flush_sprites();
@@ -287,57 +426,69 @@ void r_sprite_batch_prepare_state(const SpriteStateParams *stp) {
 		}
 	}
 
-	assume(stp->shader != NULL);
+	assume(key->shader != NULL);
 
-	if(stp->shader != _r_sprite_batch.shader) {
+	if(key->shader != _r_sprite_batch.shader) {
 		r_flush_sprites();
-		_r_sprite_batch.shader = stp->shader;
+		_r_sprite_batch.shader = key->shader;
 	}
 
-	BlendMode blend = stp->blend;
-
-	if(blend != _r_sprite_batch.blend) {
+	if(key->blend != _r_sprite_batch.blend) {
 		r_flush_sprites();
-		_r_sprite_batch.blend = blend;
+		_r_sprite_batch.blend = key->blend;
 	}
 
-	Framebuffer *fb = r_framebuffer_current();
-
-	if(fb != _r_sprite_batch.framebuffer) {
+	if(key->framebuffer != _r_sprite_batch.framebuffer) {
 		r_flush_sprites();
-		_r_sprite_batch.framebuffer = fb;
+		_r_sprite_batch.framebuffer = key->framebuffer;
 	}
 
-	r_capability_bits_t caps = r_capabilities_current();
-	DepthTestFunc depth_func = r_depth_func_current();
-	CullFaceMode cull_mode = r_cull_current();
+	r_capability_bits_t caps = key->capbits;
 
 	if(_r_sprite_batch.capbits != caps) {
 		r_flush_sprites();
 		_r_sprite_batch.capbits = caps;
 	}
 
-	if((caps & r_capability_bit(RCAP_DEPTH_TEST)) && _r_sprite_batch.depth_func != depth_func) {
+	if((caps & r_capability_bit(RCAP_DEPTH_TEST)) && _r_sprite_batch.depth_func != key->depth_func) {
 		r_flush_sprites();
-		_r_sprite_batch.depth_func = depth_func;
+		_r_sprite_batch.depth_func = key->depth_func;
 	}
 
-	if((caps & r_capability_bit(RCAP_CULL_FACE)) && _r_sprite_batch.cull_mode != cull_mode) {
+	if((caps & r_capability_bit(RCAP_CULL_FACE)) && _r_sprite_batch.cull_mode != key->cull_mode) {
 		r_flush_sprites();
-		_r_sprite_batch.cull_mode = cull_mode;
+		_r_sprite_batch.cull_mode = key->cull_mode;
 	}
 
-	mat4 *current_projection = r_mat_proj_current_ptr();
-
-	if(memcmp(*current_projection, _r_sprite_batch.projection, sizeof(mat4))) {
+	if(memcmp(projection, _r_sprite_batch.projection, sizeof(mat4))) {
 		r_flush_sprites();
-		glm_mat4_copy(*current_projection, _r_sprite_batch.projection);
+		glm_mat4_copy(projection, _r_sprite_batch.projection);
 	}
 }
 
+void r_sprite_batch_prepare_state(const SpriteStateParams *stp) {
+	// Sprites added directly (e.g. by the text renderer) must go after anything deferred so far
+	_r_sprite_batch_submit_deferred();
+
+	SpriteStateKey key;
+	_r_sprite_batch_capture_state(stp, &key);
+	_r_sprite_batch_apply_state(&key, *r_mat_proj_current_ptr());
+}
+
+static void _r_sprite_batch_remap(void) {
+	r_vertex_buffer_commit(_r_sprite_batch.vbuf, _r_sprite_batch.mapping.used);
+	_r_sprite_batch.mapping.used = 0;
+	_r_sprite_batch.mapping.ptr = r_vertex_buffer_map_range(
+		_r_sprite_batch.vbuf, SIZEOF_SPRITE_ATTRIBS, &_r_sprite_batch.mapping.size);
+}
+
 void r_sprite_batch_add_instance(const SpriteInstanceAttribs *attribs) {
-	SDL_RWops *stream = r_vertex_buffer_get_stream(_r_sprite_batch.vbuf);
-	SDL_RWwrite(stream, attribs, SIZEOF_SPRITE_ATTRIBS, 1);
+	if(UNLIKELY(_r_sprite_batch.mapping.size - _r_sprite_batch.mapping.used < SIZEOF_SPRITE_ATTRIBS)) {
+		_r_sprite_batch_remap();
+	}
+
+	memcpy(_r_sprite_batch.mapping.ptr + _r_sprite_batch.mapping.used, attribs, SIZEOF_SPRITE_ATTRIBS);
+	_r_sprite_batch.mapping.used += SIZEOF_SPRITE_ATTRIBS;
 
 	_r_sprite_batch.num_pending++;
 
@@ -346,15 +497,219 @@ void r_sprite_batch_add_instance(const SpriteInstanceAttribs *attribs) {
 #endif
 }
 
+/*
+ * Deferred mode.
+ *
+ * Sprites are recorded along with their full state key, and submitted in one go when the batch
+ * is flushed (explicitly, by any other draw call, or when deferred mode ends). Before submission,
+ * each run of consecutive sprites in the same sort group that share a commutative blend mode is
+ * sorted by state, so that e.g. additive bullets of different types interleaved by spawn order
+ * end up in a few large batches instead of many tiny ones.
+ *
+ * Sprites outside of such runs act as barriers and keep their position, so the result is the
+ * same as in immediate mode, up to floating point rounding of the blend equation.
+ */
+
+static bool _r_sprite_batch_blend_factor_reads_dst(BlendFactor f) {
+	switch(f) {
+		case BLENDFACTOR_DST_COLOR:
+		case BLENDFACTOR_INV_DST_COLOR:
+		case BLENDFACTOR_DST_ALPHA:
+		case BLENDFACTOR_INV_DST_ALPHA:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+static bool _r_sprite_batch_blend_part_is_commutative(const UnpackedBlendModePart *part) {
+	switch(part->op) {
+		case BLENDOP_ADD:
+			// dst + f(src); saturation doesn't break this, since all terms are non-negative
+			return part->dst == BLENDFACTOR_ONE && !_r_sprite_batch_blend_factor_reads_dst(part->src);
+
+		case BLENDOP_MIN:
+		case BLENDOP_MAX:
+			// blend factors are ignored by these ops
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+static bool _r_sprite_batch_is_commutative(const SpriteStateKey *key) {
+	if(key->capbits & r_capability_bit(RCAP_DEPTH_TEST)) {
+		// with depth writes, the first sprite to touch a pixel wins
+		return false;
+	}
+
+	UnpackedBlendMode ub;
+	r_blend_unpack(key->blend, &ub);
+
+	return
+		_r_sprite_batch_blend_part_is_commutative(&ub.color) &&
+		_r_sprite_batch_blend_part_is_commutative(&ub.alpha);
+}
+
+static void _r_sprite_batch_defer(
+	const Sprite *restrict spr,
+	const SpriteParams *restrict params,
+	const SpriteStateParams *restrict state_params
+) {
+	auto d = &_r_sprite_batch.deferred;
+	DeferredSprite *ds = dynarray_append(&d->sprites);
+
+	_r_sprite_batch_capture_state(state_params, &ds->key);
+
+	mat4 *projection = r_mat_proj_current_ptr();
+
+	if(
+		d->projections.num_elements == 0 ||
+		memcmp(*projection, dynarray_get_ptr(&d->projections, d->projections.num_elements - 1)->matrix, sizeof(mat4))
+	) {
+		glm_mat4_copy(*projection, dynarray_append(&d->projections)->matrix);
+	}
+
+	ds->key.projection = d->projections.num_elements - 1;
+	ds->group = d->group;
+	ds->commutative = _r_sprite_batch_is_commutative(&ds->key);
+	_r_sprite_batch_compute_attribs(spr, params, &ds->attribs);
+}
+
+static int _r_sprite_batch_deferred_cmp(const void *pa, const void *pb) {
+	uint32_t a = *(const uint32_t*)pa;
+	uint32_t b = *(const uint32_t*)pb;
+	DeferredSprite *sprites = _r_sprite_batch.deferred.sprites.data;
+
+	int c = memcmp(&sprites[a].key, &sprites[b].key, sizeof(SpriteStateKey));
+
+	if(c) {
+		return c;
+	}
+
+	// qsort isn't stable; preserve submission order within a state
+	return (a > b) - (a < b);
+}
+
+static inline bool _r_sprite_batch_deferred_can_swap(const DeferredSprite *a, const DeferredSprite *b) {
+	return
+		a->commutative &&
+		b->commutative &&
+		a->group == b->group &&
+		a->key.blend == b->key.blend &&
+		a->key.framebuffer == b->key.framebuffer;
+}
+
+#if SPRITE_BATCH_STATS
+static uint _r_sprite_batch_count_state_changes(DeferredSprite *sprites, uint32_t *order, uint num) {
+	uint changes = 0;
+
+	for(uint i = 1; i < num; ++i) {
+		SpriteStateKey *k0 = &sprites[order ? order[i - 1] : i - 1].key;
+		SpriteStateKey *k1 = &sprites[order ? order[i] : i].key;
+		changes += memcmp(k0, k1, sizeof(*k0)) != 0;
+	}
+
+	return changes;
+}
+#endif
+
+static void _r_sprite_batch_submit_deferred(void) {
+	auto d = &_r_sprite_batch.deferred;
+	uint num = d->sprites.num_elements;
+
+	if(num == 0 || d->submitting) {
+		return;
+	}
+
+	// needs to be set early to thwart recursive calls from the flushes below
+	d->submitting = true;
+
+	dynarray_ensure_capacity(&d->order, num);
+	d->order.num_elements = num;
+	DeferredSprite *sprites = d->sprites.data;
+	uint32_t *order = d->order.data;
+
+	for(uint i = 0; i < num; ++i) {
+		order[i] = i;
+	}
+
+	for(uint begin = 0; begin < num;) {
+		uint end = begin + 1;
+
+		while(end < num && _r_sprite_batch_deferred_can_swap(sprites + begin, sprites + end)) {
+			++end;
+		}
+
+		if(end - begin > 1) {
+			qsort(order + begin, end - begin, sizeof(*order), _r_sprite_batch_deferred_cmp);
+		}
+
+		begin = end;
+	}
+
+#if SPRITE_BATCH_STATS
+	uint changes_before = _r_sprite_batch_count_state_changes(sprites, NULL, num);
+	uint changes_after = _r_sprite_batch_count_state_changes(sprites, order, num);
+	_r_sprite_batch.frame_stats.deferred_sprites += num;
+
+	if(changes_after < changes_before) {
+		_r_sprite_batch.frame_stats.flushes_saved += changes_before - changes_after;
+	}
+#endif
+
+	for(uint i = 0; i < num; ++i) {
+		DeferredSprite *ds = sprites + order[i];
+		_r_sprite_batch_apply_state(&ds->key, dynarray_get_ptr(&d->projections, ds->key.projection)->matrix);
+		r_sprite_batch_add_instance(&ds->attribs);
+	}
+
+	d->sprites.num_elements = 0;
+	d->projections.num_elements = 0;
+	d->submitting = false;
+}
+
+void r_sprite_batch_begin_deferred(void) {
+	assert(!_r_sprite_batch.deferred.active);
+	_r_sprite_batch.deferred.active = true;
+	_r_sprite_batch.deferred.group = 0;
+}
+
+void r_sprite_batch_end_deferred(void) {
+	assert(_r_sprite_batch.deferred.active);
+	_r_sprite_batch.deferred.active = false;
+	_r_sprite_batch_submit_deferred();
+}
+
+void r_sprite_batch_set_sort_group(uint32_t group) {
+	_r_sprite_batch.deferred.group = group;
+}
+
 void r_draw_sprite(const SpriteParams *params) {
 	SpriteStateParams state_params;
 	SpriteInstanceAttribs attribs;
 	Sprite *spr;
 
+#if SPRITE_BATCH_STATS
+	hrtime_t t_begin = time_get();
+#endif
+
 	_r_sprite_batch_process_params(params, &state_params, &spr);
-	r_sprite_batch_prepare_state(&state_params);
-	_r_sprite_batch_compute_attribs(spr, params, &attribs);
-	r_sprite_batch_add_instance(&attribs);
+
+	if(_r_sprite_batch.deferred.active) {
+		_r_sprite_batch_defer(spr, params, &state_params);
+	} else {
+		r_sprite_batch_prepare_state(&state_params);
+		_r_sprite_batch_compute_attribs(spr, params, &attribs);
+		r_sprite_batch_add_instance(&attribs);
+	}
+
+#if SPRITE_BATCH_STATS
+	// NOTE: includes the time spent in any flushes triggered by state changes
+	_r_sprite_batch.frame_stats.submit_time += time_get() - t_begin;
+#endif
 }
 
 #if SPRITE_BATCH_STATS
@@ -371,12 +726,16 @@ void _r_sprite_batch_end_frame(void) {
 	}
 
 	static char buf[512];
-	snprintf(buf, sizeof(buf), "%6i sprites %6i flushes %9.02f spr/flush %6i best %6i worst %12.02f fps",
+	double submit_ms = _r_sprite_batch.frame_stats.submit_time / (double)(HRTIME_RESOLUTION / 1000);
+	snprintf(buf, sizeof(buf), "%6i sprites %6i flushes %9.02f spr/flush %6i best %6i worst %9.02f spr/ms %6i deferred %6i saved %12.02f fps",
 		_r_sprite_batch.frame_stats.sprites,
 		_r_sprite_batch.frame_stats.flushes,
 		_r_sprite_batch.frame_stats.sprites / (double)_r_sprite_batch.frame_stats.flushes,
 		_r_sprite_batch.frame_stats.best_batch,
 		_r_sprite_batch.frame_stats.worst_batch,
+		submit_ms > 0 ? _r_sprite_batch.frame_stats.sprites / submit_ms : 0,
+		_r_sprite_batch.frame_stats.deferred_sprites,
+		_r_sprite_batch.frame_stats.flushes_saved,
 		global.fps.render.fps
 	);
 
@@ -402,4 +761,16 @@ void _r_sprite_batch_texture_deleted(Texture *tex) {
 			_r_sprite_batch.aux_textures[i] = NULL;
 		}
 	}
+
+	dynarray_foreach_elem(&_r_sprite_batch.deferred.sprites, DeferredSprite *ds, {
+		if(ds->key.primary_texture == tex) {
+			ds->key.primary_texture = NULL;
+		}
+
+		for(uint i = 0; i < R_NUM_SPRITE_AUX_TEXTURES; ++i) {
+			if(ds->key.aux_textures[i] == tex) {
+				ds->key.aux_textures[i] = NULL;
+			}
+		}
+	});
 }
@@ -10,6 +10,7 @@
 
 #include "common_buffer.h"
 #include "gl33.h"
+#include "util/env.h"
 
 #define STREAM_CBUF(rw) ((CommonBuffer*)rw)
 
@@ -44,8 +45,172 @@ static int64_t gl33_buffer_stream_size(SDL_RWops *rw) {
 static size_t gl33_buffer_stream_write(SDL_RWops *rw, const void *data, size_t size, size_t num) {
 	CommonBuffer *cbuf = STREAM_CBUF(rw);
 	size_t total_size = size * num;
+
+	if(LIKELY(total_size > 0)) {
+		size_t avail;
+		memcpy(gl33_buffer_map_range(cbuf, total_size, &avail), data, total_size);
+		gl33_buffer_commit(cbuf, total_size);
+	}
+
+	return num;
+}
+
+static inline size_t gl33_buffer_ring_segment_size(CommonBuffer *cbuf) {
+	return cbuf->size * 2;
+}
+
+static inline size_t gl33_buffer_ring_capacity(CommonBuffer *cbuf) {
+	return gl33_buffer_ring_segment_size(cbuf) * GL33_BUFFER_RING_SEGMENTS;
+}
+
+static void gl33_buffer_ring_map(CommonBuffer *cbuf) {
+	assert(cbuf->ring.mapping == NULL);
+	assert(cbuf->offset < cbuf->size);
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		cbuf->ring.mapping = glMapBufferRange(
+			gl33_bindidx_to_glenum(cbuf->bindidx),
+			cbuf->ring.base + cbuf->offset,
+			cbuf->size - cbuf->offset,
+			GL_MAP_WRITE_BIT |
+			GL_MAP_INVALIDATE_RANGE_BIT |
+			GL_MAP_FLUSH_EXPLICIT_BIT |
+			GL_MAP_UNSYNCHRONIZED_BIT
+		);
+	});
+
+	if(UNLIKELY(cbuf->ring.mapping == NULL)) {
+		log_fatal("glMapBufferRange() failed for buffer %u (%s)", cbuf->gl_handle, cbuf->debug_label);
+	}
+
+	cbuf->ring.map_offset = cbuf->offset;
+}
+
+static void gl33_buffer_ring_unmap(CommonBuffer *cbuf, bool flush) {
+	if(cbuf->ring.mapping == NULL) {
+		return;
+	}
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		GLenum target = gl33_bindidx_to_glenum(cbuf->bindidx);
+
+		if(flush && cbuf->cache.update_begin < cbuf->cache.update_end) {
+			assert(cbuf->cache.update_begin >= cbuf->ring.map_offset);
+			glFlushMappedBufferRange(
+				target,
+				cbuf->cache.update_begin - cbuf->ring.map_offset,
+				cbuf->cache.update_end - cbuf->cache.update_begin
+			);
+		}
+
+		if(!glUnmapBuffer(target) && flush) {
+			log_warn("Contents of buffer %u (%s) were lost while mapped",
+				cbuf->gl_handle, cbuf->debug_label
+			);
+		}
+	});
+
+	cbuf->ring.mapping = NULL;
+	cbuf->cache.update_begin = cbuf->size;
+	cbuf->cache.update_end = 0;
+}
+
+static void gl33_buffer_ring_wait(CommonBuffer *cbuf, uint segment) {
+	GLsync fence = cbuf->ring.fences[segment];
+
+	if(fence == NULL) {
+		return;
+	}
+
+	GLenum status;
+
+	do {
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	} while(status == GL_TIMEOUT_EXPIRED);
+
+	if(UNLIKELY(status == GL_WAIT_FAILED)) {
+		log_error("glClientWaitSync() failed for buffer %u (%s)", cbuf->gl_handle, cbuf->debug_label);
+	}
+
+	glDeleteSync(fence);
+	cbuf->ring.fences[segment] = NULL;
+}
+
+static void gl33_buffer_ring_delete_fences(CommonBuffer *cbuf) {
+	for(uint i = 0; i < ARRAY_SIZE(cbuf->ring.fences); ++i) {
+		if(cbuf->ring.fences[i]) {
+			glDeleteSync(cbuf->ring.fences[i]);
+			cbuf->ring.fences[i] = NULL;
+		}
+	}
+}
+
+static void gl33_buffer_ring_advance(CommonBuffer *cbuf) {
+	gl33_buffer_ring_unmap(cbuf, false);
+	cbuf->offset = 0;
+
+	if(cbuf->ring.used == 0) {
+		return;
+	}
+
+	size_t seg_size = gl33_buffer_ring_segment_size(cbuf);
+	size_t seg_end = (cbuf->ring.segment + 1) * seg_size;
+	size_t next_base = cbuf->ring.base + cbuf->ring.used;
+	next_base = (next_base + GL33_BUFFER_RING_ALIGNMENT - 1) & ~(size_t)(GL33_BUFFER_RING_ALIGNMENT - 1);
+
+	if(next_base + cbuf->size > seg_end) {
+		// Everything drawn from the segment we're leaving has been submitted by now. Fence it off,
+		// and make sure the GPU is done with the next one before writing over it.
+		assert(cbuf->ring.fences[cbuf->ring.segment] == NULL);
+		cbuf->ring.fences[cbuf->ring.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		cbuf->ring.segment = (cbuf->ring.segment + 1) % GL33_BUFFER_RING_SEGMENTS;
+		gl33_buffer_ring_wait(cbuf, cbuf->ring.segment);
+		next_base = cbuf->ring.segment * seg_size;
+	}
+
+	cbuf->ring.base = next_base;
+	cbuf->ring.used = 0;
+}
+
+static void gl33_buffer_ring_resize(CommonBuffer *cbuf, size_t new_size) {
+	// The window is mapped write-only, so the data written so far can't be read back.
+	// Move it out of the way on the GPU instead, then reallocate the ring and put it back.
+	size_t keep = cbuf->ring.used;
+	gl33_buffer_ring_unmap(cbuf, true);
+	gl33_buffer_ring_delete_fences(cbuf);
+	cbuf->size = new_size;
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		GLenum target = gl33_bindidx_to_glenum(cbuf->bindidx);
+		GLuint tmp = 0;
+		GLuint copy_saved = gl33_buffer_current(GL33_BUFFER_BINDING_COPY_WRITE);
+
+		if(keep > 0) {
+			glGenBuffers(1, &tmp);
+			gl33_bind_buffer(GL33_BUFFER_BINDING_COPY_WRITE, tmp);
+			gl33_sync_buffer(GL33_BUFFER_BINDING_COPY_WRITE);
+			glBufferData(GL_COPY_WRITE_BUFFER, keep, NULL, GL_STREAM_COPY);
+			glCopyBufferSubData(target, GL_COPY_WRITE_BUFFER, cbuf->ring.base, 0, keep);
+		}
+
+		glBufferData(target, gl33_buffer_ring_capacity(cbuf), NULL, cbuf->gl_usage_hint);
+
+		if(tmp) {
+			glCopyBufferSubData(GL_COPY_WRITE_BUFFER, target, 0, 0, keep);
+			gl33_bind_buffer(GL33_BUFFER_BINDING_COPY_WRITE, copy_saved);
+			gl33_sync_buffer(GL33_BUFFER_BINDING_COPY_WRITE);
+			glDeleteBuffers(1, &tmp);
+		}
+	});
+
+	cbuf->commited_size = gl33_buffer_ring_capacity(cbuf);
+	cbuf->ring.base = 0;
+	cbuf->ring.segment = 0;
+}
+
+void *gl33_buffer_map_range(CommonBuffer *cbuf, size_t min_size, size_t *out_size) {
 	size_t offset = cbuf->offset;
-	size_t req_bufsize = offset + total_size;
+	size_t req_bufsize = offset + min_size;
 
 	if(UNLIKELY(req_bufsize > cbuf->size)) {
 		gl33_buffer_resize(cbuf, req_bufsize);
@@ -53,14 +218,30 @@ static size_t gl33_buffer_stream_write(SDL_RWops *rw, const void *data, size_t s
 		assert(offset == cbuf->offset);
 	}
 
-	if(LIKELY(total_size > 0)) {
-		memcpy(cbuf->cache.buffer + cbuf->offset, data, total_size);
-		cbuf->cache.update_begin = min(cbuf->offset, cbuf->cache.update_begin);
-		cbuf->cache.update_end = max(cbuf->offset + total_size, cbuf->cache.update_end);
-		cbuf->offset += total_size;
+	*out_size = cbuf->size - offset;
+
+	if(cbuf->streaming) {
+		if(cbuf->ring.mapping == NULL || offset < cbuf->ring.map_offset) {
+			gl33_buffer_ring_unmap(cbuf, true);
+			gl33_buffer_ring_map(cbuf);
+		}
+
+		return cbuf->ring.mapping + (offset - cbuf->ring.map_offset);
 	}
 
-	return num;
+	return cbuf->cache.buffer + offset;
+}
+
+void gl33_buffer_commit(CommonBuffer *cbuf, size_t size) {
+	if(UNLIKELY(size == 0)) {
+		return;
+	}
+
+	assert(cbuf->offset + size <= cbuf->size);
+	cbuf->cache.update_begin = min(cbuf->offset, cbuf->cache.update_begin);
+	cbuf->cache.update_end = max(cbuf->offset + size, cbuf->cache.update_end);
+	cbuf->offset += size;
+	cbuf->ring.used = max(cbuf->offset, cbuf->ring.used);
 }
 
 static size_t gl33_buffer_stream_read(SDL_RWops *rw, void *data, size_t size, size_t num) {
@@ -118,7 +299,30 @@ void gl33_buffer_init(CommonBuffer *cbuf, size_t capacity, void *data, GLenum us
 	});
 }
 
+void gl33_buffer_init_streaming(CommonBuffer *cbuf, size_t capacity) {
+	if(!glext.map_buffer_range || !env_get("TAISEI_GL_BUFFER_STREAMING", true)) {
+		gl33_buffer_init(cbuf, capacity, NULL, GL_DYNAMIC_DRAW);
+		return;
+	}
+
+	cbuf->streaming = true;
+	cbuf->size = topow2(capacity);
+	cbuf->commited_size = gl33_buffer_ring_capacity(cbuf);
+	cbuf->cache.update_begin = cbuf->size;
+	cbuf->gl_usage_hint = GL_DYNAMIC_DRAW;
+
+	GL33_BUFFER_TEMP_BIND(cbuf, {
+		assert(glIsBuffer(cbuf->gl_handle));
+		glBufferData(gl33_bindidx_to_glenum(cbuf->bindidx), cbuf->commited_size, NULL, cbuf->gl_usage_hint);
+	});
+}
+
 void gl33_buffer_destroy(CommonBuffer *cbuf) {
+	if(cbuf->streaming) {
+		gl33_buffer_ring_unmap(cbuf, false);
+		gl33_buffer_ring_delete_fences(cbuf);
+	}
+
 	mem_free(cbuf->cache.buffer);
 	gl33_buffer_deleted(cbuf);
 	glDeleteBuffers(1, &cbuf->gl_handle);
@@ -126,6 +330,11 @@ void gl33_buffer_destroy(CommonBuffer *cbuf) {
 }
 
 void gl33_buffer_invalidate(CommonBuffer *cbuf) {
+	if(cbuf->streaming) {
+		gl33_buffer_ring_advance(cbuf);
+		return;
+	}
+
 	// TODO: a better way to set this properly in advance
 	cbuf->gl_usage_hint = GL_DYNAMIC_DRAW;
 	GL33_BUFFER_TEMP_BIND(cbuf, {
@@ -135,8 +344,6 @@ void gl33_buffer_invalidate(CommonBuffer *cbuf) {
 }
 
 void gl33_buffer_resize(CommonBuffer *cbuf, size_t new_size) {
-	assert(cbuf->cache.buffer != NULL);
-
 	size_t old_size = cbuf->size;
 	new_size = topow2(new_size);
 
@@ -148,6 +355,14 @@ void gl33_buffer_resize(CommonBuffer *cbuf, size_t new_size) {
 		cbuf->gl_handle, cbuf->debug_label, old_size, new_size
 	);
 
+	if(cbuf->streaming) {
+		assert(new_size > old_size);
+		gl33_buffer_ring_resize(cbuf, new_size);
+		return;
+	}
+
+	assert(cbuf->cache.buffer != NULL);
+
 	cbuf->size = new_size;
 	cbuf->cache.buffer = mem_realloc(cbuf->cache.buffer, new_size);
 	cbuf->cache.update_begin = 0;
@@ -159,6 +374,11 @@ void gl33_buffer_resize(CommonBuffer *cbuf, size_t new_size) {
 }
 
 void gl33_buffer_flush(CommonBuffer *cbuf) {
+	if(cbuf->streaming) {
+		gl33_buffer_ring_unmap(cbuf, true);
+		return;
+	}
+
 	if(cbuf->cache.update_begin >= cbuf->cache.update_end) {
 		return;
 	}
@@ -14,6 +14,10 @@
 
 typedef struct CommonBuffer CommonBuffer;
 
+// Streaming buffers are backed by a ring of this many segments, each twice the buffer's size.
+#define GL33_BUFFER_RING_SEGMENTS 4
+#define GL33_BUFFER_RING_ALIGNMENT 256
+
 struct CommonBuffer {
 	union {
 		SDL_RWops stream;
@@ -26,12 +30,23 @@ struct CommonBuffer {
 				size_t update_end;
 			} cache;
 
+			// Streaming buffers only; see gl33_buffer_init_streaming()
+			struct {
+				char *mapping;
+				GLsync fences[GL33_BUFFER_RING_SEGMENTS];
+				size_t base;
+				size_t map_offset;
+				size_t used;
+				uint segment;
+			} ring;
+
 			size_t offset;
 			size_t size;
 			size_t commited_size;
 			GLuint gl_handle;
 			GLuint gl_usage_hint;
 			uint bindidx;
+			bool streaming;
 			char debug_label[R_DEBUG_LABEL_SIZE];
 
 			void (*pre_bind)(CommonBuffer *self);
@@ -48,12 +63,34 @@ static_assert(
 CommonBuffer *gl33_buffer_create(uint bindidx, size_t alloc_size);
 void gl33_buffer_init_cache(CommonBuffer *cbuf, size_t capacity);
 void gl33_buffer_init(CommonBuffer *cbuf, size_t capacity, void *data, GLenum usage_hint);
+
+// Sets up a buffer whose contents are rewritten from scratch after every invalidation.
+// If supported, the data is written straight into a mapped window of a GL buffer several times
+// larger than [capacity], and every invalidation moves that window forward instead of
+// reallocating the storage. Fences keep the window from wrapping around onto data the GPU may
+// still be reading. Otherwise, this is the same as gl33_buffer_init() with no initial data.
+void gl33_buffer_init_streaming(CommonBuffer *cbuf, size_t capacity);
+
+// Offset of the current contents within the GL buffer; always 0 unless streaming.
+static inline size_t gl33_buffer_base(CommonBuffer *cbuf) {
+	return cbuf->ring.base;
+}
+
 void gl33_buffer_destroy(CommonBuffer *cbuf);
 void gl33_buffer_invalidate(CommonBuffer *cbuf);
 void gl33_buffer_resize(CommonBuffer *cbuf, size_t new_size);
 SDL_RWops *gl33_buffer_get_stream(CommonBuffer *cbuf);
 void gl33_buffer_flush(CommonBuffer *cbuf);
 
+// Direct access to the cache, for writers that can't afford going through the stream.
+// Returns a pointer to the cache at the current offset, with at least [min_size] bytes available
+// (the buffer grows if necessary). The actual amount of available bytes is stored in [out_size].
+// The pointer is valid until the next write, resize, or destruction of the buffer.
+void *gl33_buffer_map_range(CommonBuffer *cbuf, size_t min_size, size_t *out_size);
+
+// Marks [size] bytes at the current offset as written, and advances the offset past them.
+void gl33_buffer_commit(CommonBuffer *cbuf, size_t size);
+
 #define GL33_BUFFER_TEMP_BIND(cbuf, code) do { \
 	CommonBuffer *_tempbind_cbuf = (cbuf); \
 	attr_unused BufferBindingIndex _tempbind_bindidx = 0; \
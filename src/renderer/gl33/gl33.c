@@ -16,6 +16,7 @@
 #include "texture.h"
 #include "shader_object.h"
 #include "shader_program.h"
+#include "program_cache.h"
 #include "framebuffer.h"
 #include "framebuffer_async_read.h"
 #include "common_buffer.h"
@@ -314,6 +315,7 @@ static void gl33_init_context(SDL_Window *window) {
 	}
 
 	gl33_init_texunits();
+	gl33_program_cache_init();
 	gl33_set_clear_depth(1);
 	gl33_set_clear_color(RGBA(0, 0, 0, 0));
 
@@ -1190,6 +1192,7 @@ static void gl33_post_init(void) {
 
 static void gl33_shutdown(void) {
 	gl33_framebuffer_finalize_read_requests();
+	gl33_program_cache_shutdown();
 	glcommon_unload_library();
 	SDL_GL_DeleteContext(R.gl_context);
 }
@@ -1501,11 +1504,14 @@ RendererBackend _r_backend_gl33 = {
 		.framebuffer_get_size = gl33_framebuffer_get_size,
 		.framebuffer_read_async = gl33_framebuffer_read_async,
 		.vertex_buffer_create = gl33_vertex_buffer_create,
+		.vertex_buffer_create_streaming = gl33_vertex_buffer_create_streaming,
 		.vertex_buffer_set_debug_label = gl33_vertex_buffer_set_debug_label,
 		.vertex_buffer_get_debug_label = gl33_vertex_buffer_get_debug_label,
 		.vertex_buffer_destroy = gl33_vertex_buffer_destroy,
 		.vertex_buffer_invalidate = gl33_vertex_buffer_invalidate,
 		.vertex_buffer_get_stream = gl33_vertex_buffer_get_stream,
+		.vertex_buffer_map_range = gl33_vertex_buffer_map_range,
+		.vertex_buffer_commit = gl33_vertex_buffer_commit,
 		.index_buffer_create = gl33_index_buffer_create,
 		.index_buffer_get_capacity = gl33_index_buffer_get_capacity,
 		.index_buffer_get_index_size = gl33_index_buffer_get_index_size,
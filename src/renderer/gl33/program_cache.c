@@ -0,0 +1,247 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "program_cache.h"
+#include "util.h"
+#include "rwops/rwops_autobuf.h"
+#include "rwops/rwops_zstd.h"
+
+#define CACHE_VERSION 1
+#define CACHE_MAGIC 0x50474c54  // "TLGP"
+#define CACHE_ROOT "cache/glprograms"
+
+// Sanity limit for the binary size stored in an entry header
+#define MAX_BINARY_SIZE (16 * 1024 * 1024)
+
+static struct {
+	char dir[sizeof(CACHE_ROOT) + SHA256_HEXDIGEST_SIZE + 1];
+	GLint *formats;
+	GLint num_formats;
+	bool enabled;
+} pcache;
+
+static const char *gl_string(GLenum name) {
+	const char *s = (const char*)glGetString(name);
+	return s ? s : "";
+}
+
+void gl33_program_cache_init(void) {
+	gl33_program_cache_shutdown();
+
+	if(!glext.get_program_binary) {
+		log_info("Program binaries are not supported, cache disabled");
+		return;
+	}
+
+	if(!env_get("TAISEI_GL_PROGRAM_CACHE", true)) {
+		log_info("Program binary cache disabled by the environment");
+		return;
+	}
+
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+	if(num_formats < 1) {
+		log_info("Driver exposes no program binary formats, cache disabled");
+		return;
+	}
+
+	pcache.formats = ALLOC_ARRAY(num_formats, typeof(*pcache.formats));
+	pcache.num_formats = num_formats;
+	glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, pcache.formats);
+
+	// Anything that may change the binary format must be part of this
+	char *driver_id = strfmt("%s\n%s\n%s\n%s",
+		gl_string(GL_VENDOR),
+		gl_string(GL_RENDERER),
+		gl_string(GL_VERSION),
+		gl_string(GL_SHADING_LANGUAGE_VERSION)
+	);
+
+	char driver_hash[SHA256_HEXDIGEST_SIZE];
+	sha256_hexdigest((uint8_t*)driver_id, strlen(driver_id), driver_hash, sizeof(driver_hash));
+	mem_free(driver_id);
+
+	snprintf(pcache.dir, sizeof(pcache.dir), CACHE_ROOT "/%s", driver_hash);
+	vfs_mkdir(CACHE_ROOT);
+	vfs_mkdir(pcache.dir);
+
+	pcache.enabled = true;
+	log_info("Program binary cache: %s", pcache.dir);
+}
+
+void gl33_program_cache_shutdown(void) {
+	mem_free(pcache.formats);
+	pcache.formats = NULL;
+	pcache.num_formats = 0;
+	pcache.enabled = false;
+}
+
+static bool is_supported_format(GLenum format) {
+	for(GLint i = 0; i < pcache.num_formats; ++i) {
+		if(pcache.formats[i] == format) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool gl33_program_cache_enabled(void) {
+	return pcache.enabled;
+}
+
+void gl33_program_cache_key(
+	uint num_objects, ShaderObject *shobjs[num_objects], char out_key[SHA256_HEXDIGEST_SIZE]
+) {
+	uint8_t *buf;
+	SDL_RWops *abuf = NOT_NULL(SDL_RWAutoBuffer((void**)&buf, 256));
+
+	SDL_WriteU8(abuf, CACHE_VERSION);
+	SDL_WriteU8(abuf, num_objects);
+
+	for(uint i = 0; i < num_objects; ++i) {
+		ShaderObject *shobj = shobjs[i];
+
+		SDL_WriteU8(abuf, shobj->stage);
+		SDL_RWwrite(abuf, shobj->source_hash, sizeof(shobj->source_hash), 1);
+		SDL_WriteU8(abuf, shobj->num_attribs);
+
+		// Attribute bindings are baked into the binary
+		for(uint a = 0; a < shobj->num_attribs; ++a) {
+			GLSLAttribute *attr = shobj->attribs + a;
+			SDL_WriteLE32(abuf, attr->location);
+			SDL_RWwrite(abuf, attr->name, strlen(attr->name) + 1, 1);
+		}
+	}
+
+	sha256_hexdigest(buf, SDL_RWtell(abuf), out_key, SHA256_HEXDIGEST_SIZE);
+	SDL_RWclose(abuf);
+}
+
+bool gl33_program_cache_load(GLuint prog, const char *key) {
+	if(!pcache.enabled) {
+		return false;
+	}
+
+	char path[sizeof(pcache.dir) + SHA256_HEXDIGEST_SIZE + 1];
+	snprintf(path, sizeof(path), "%s/%s", pcache.dir, key);
+
+	SDL_RWops *stream = vfs_open(path, VFS_MODE_READ);
+
+	if(stream == NULL) {
+		return false;
+	}
+
+	stream = NOT_NULL(SDL_RWWrapZstdReader(stream, true));
+
+	bool result = false;
+	bool evict = false;
+	void *binary = NULL;
+
+	if(SDL_ReadLE32(stream) != CACHE_MAGIC || SDL_ReadU8(stream) != CACHE_VERSION) {
+		log_warn("%s: bad header, evicting", path);
+		evict = true;
+		goto done;
+	}
+
+	GLenum format = SDL_ReadLE32(stream);
+	uint32_t size = SDL_ReadLE32(stream);
+
+	// Passing an unknown format to glProgramBinary is an error, not just a failed link
+	if(!is_supported_format(format)) {
+		log_info("%s: binary format 0x%04x is not supported by the driver, evicting", path, format);
+		evict = true;
+		goto done;
+	}
+
+	if(size == 0 || size > MAX_BINARY_SIZE) {
+		log_warn("%s: bad binary size %u, evicting", path, size);
+		evict = true;
+		goto done;
+	}
+
+	binary = mem_alloc(size);
+
+	if(SDL_RWread(stream, binary, size, 1) != 1) {
+		log_warn("%s: read error, ignoring", path);
+		goto done;
+	}
+
+	glProgramBinary(prog, format, binary, size);
+
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(prog, GL_LINK_STATUS, &link_status);
+
+	if(link_status) {
+		result = true;
+		log_debug("Loaded program binary %s", key);
+	} else {
+		// Usually means a driver update that didn't change the version string
+		log_info("%s: rejected by the driver, will relink", path);
+	}
+
+done:
+	mem_free(binary);
+	SDL_RWclose(stream);
+
+	if(evict && !vfs_unlink(path)) {
+		log_warn("VFS error: %s", vfs_get_error());
+	}
+
+	return result;
+}
+
+void gl33_program_cache_store(GLuint prog, const char *key) {
+	if(!pcache.enabled) {
+		return;
+	}
+
+	GLint size = 0;
+	glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &size);
+
+	if(size <= 0 || size > MAX_BINARY_SIZE) {
+		log_debug("Program %u has no retrievable binary (size %i)", prog, size);
+		return;
+	}
+
+	void *binary = mem_alloc(size);
+	GLenum format;
+	GLsizei written = 0;
+	glGetProgramBinary(prog, size, &written, &format, binary);
+
+	if(written <= 0) {
+		log_warn("glGetProgramBinary() failed for program %u", prog);
+		mem_free(binary);
+		return;
+	}
+
+	char path[sizeof(pcache.dir) + SHA256_HEXDIGEST_SIZE + 1];
+	snprintf(path, sizeof(path), "%s/%s", pcache.dir, key);
+
+	SDL_RWops *out = vfs_open(path, VFS_MODE_WRITE);
+
+	if(out == NULL) {
+		log_error("VFS error: %s", vfs_get_error());
+		mem_free(binary);
+		return;
+	}
+
+	out = NOT_NULL(SDL_RWWrapZstdWriter(out, RW_ZSTD_LEVEL_DEFAULT, true));
+	SDL_WriteLE32(out, CACHE_MAGIC);
+	SDL_WriteU8(out, CACHE_VERSION);
+	SDL_WriteLE32(out, format);
+	SDL_WriteLE32(out, written);
+	SDL_RWwrite(out, binary, written, 1);
+	SDL_RWclose(out);
+
+	mem_free(binary);
+	log_debug("Stored program binary %s (%i bytes)", key, written);
+}
@@ -0,0 +1,37 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#pragma once
+#include "taisei.h"
+
+#include "shader_object.h"
+#include "util/sha256.h"
+
+/*
+ * Persistent cache of linked program binaries (GL_ARB_get_program_binary).
+ *
+ * Entries live under cache/glprograms/<driver>/<key>, where <driver> is derived from the GL
+ * vendor, renderer and version strings, and <key> from the sources of the program's shader
+ * objects. A binary the driver refuses to load is simply treated as a miss. Entries that are
+ * corrupt or use a binary format the driver doesn't list are deleted.
+ */
+
+void gl33_program_cache_init(void);
+void gl33_program_cache_shutdown(void);
+bool gl33_program_cache_enabled(void);
+
+void gl33_program_cache_key(
+	uint num_objects, ShaderObject *shobjs[num_objects], char out_key[SHA256_HEXDIGEST_SIZE]
+) attr_nonnull_all;
+
+// On success, the program is linked and ready to use. On failure, the program object is in an
+// unspecified state and should be discarded.
+bool gl33_program_cache_load(GLuint prog, const char *key) attr_nonnull_all;
+
+// The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+void gl33_program_cache_store(GLuint prog, const char *key) attr_nonnull_all;
@@ -11,6 +11,7 @@
 #include "util.h"
 #include "gl33.h"
 #include "shader_object.h"
+#include "program_cache.h"
 #include "../glcommon/debug.h"
 #include "../glcommon/shaders.h"
 
@@ -58,25 +59,9 @@ static void print_info_log(GLuint shader) {
 	}
 }
 
-ShaderObject *gl33_shader_object_compile(ShaderSource *source) {
-	assert(r_shader_language_supported(&source->lang, NULL));
-
-	GLuint gl_handle = glCreateShader(
-		source->stage == SHADER_STAGE_VERTEX
-			? GL_VERTEX_SHADER
-			: GL_FRAGMENT_SHADER
-	);
-
+static bool compile_shader(GLuint gl_handle) {
 	GLint status;
 
-	// log_debug("Source code for %s:\n%s", path, source->content);
-
-	glShaderSource(
-		gl_handle, 1,
-		(const GLchar*[]) { source->content },
-		(GLint[])         { source->content_size - 1 }
-	);
-
 	glCompileShader(gl_handle);
 
 #if defined DEBUG && !defined STATIC_GLES3
@@ -95,34 +80,77 @@ ShaderObject *gl33_shader_object_compile(ShaderSource *source) {
 	glGetShaderiv(gl_handle, GL_COMPILE_STATUS, &status);
 	print_info_log(gl_handle);
 
-	ShaderObject *shobj = NULL;
+	return status;
+}
 
-	if(status) {
-		uint nattribs = source->meta.glsl.num_attributes;
+ShaderObject *gl33_shader_object_compile(ShaderSource *source) {
+	assert(r_shader_language_supported(&source->lang, NULL));
 
-		shobj = ALLOC(ShaderObject, {
-			.gl_handle = gl_handle,
-			.stage = source->stage,
-			.num_attribs = nattribs,
-		});
-		snprintf(shobj->debug_label, sizeof(shobj->debug_label), "Shader object #%i", gl_handle);
+	GLuint gl_handle = glCreateShader(
+		source->stage == SHADER_STAGE_VERTEX
+			? GL_VERTEX_SHADER
+			: GL_FRAGMENT_SHADER
+	);
 
-		if(nattribs > 0) {
-			shobj->attribs = ALLOC_ARRAY(nattribs, typeof(*shobj->attribs));
-		}
+	// log_debug("Source code for %s:\n%s", path, source->content);
 
-		for(uint i = 0; i < nattribs; ++i) {
-			GLSLAttribute *a = source->meta.glsl.attributes + i;
-			shobj->attribs[i].name = strdup(a->name);
-			shobj->attribs[i].location = a->location;
+	glShaderSource(
+		gl_handle, 1,
+		(const GLchar*[]) { source->content },
+		(GLint[])         { source->content_size - 1 }
+	);
+
+	// If programs using this object can be loaded from the binary cache, it may never need to be
+	// compiled at all. Otherwise, compile now to report errors as early as possible.
+	bool compiled = false;
+
+	if(!gl33_program_cache_enabled()) {
+		if(!compile_shader(gl_handle)) {
+			glDeleteShader(gl_handle);
+			return NULL;
 		}
-	} else {
-		glDeleteShader(gl_handle);
+
+		compiled = true;
+	}
+
+	uint nattribs = source->meta.glsl.num_attributes;
+
+	auto shobj = ALLOC(ShaderObject, {
+		.gl_handle = gl_handle,
+		.stage = source->stage,
+		.num_attribs = nattribs,
+		.compiled = compiled,
+	});
+	snprintf(shobj->debug_label, sizeof(shobj->debug_label), "Shader object #%i", gl_handle);
+	sha256_digest((uint8_t*)source->content, source->content_size, shobj->source_hash, sizeof(shobj->source_hash));
+
+	if(nattribs > 0) {
+		shobj->attribs = ALLOC_ARRAY(nattribs, typeof(*shobj->attribs));
+	}
+
+	for(uint i = 0; i < nattribs; ++i) {
+		GLSLAttribute *a = source->meta.glsl.attributes + i;
+		shobj->attribs[i].name = strdup(a->name);
+		shobj->attribs[i].location = a->location;
 	}
 
 	return shobj;
 }
 
+bool gl33_shader_object_ensure_compiled(ShaderObject *shobj) {
+	if(shobj->compiled) {
+		return true;
+	}
+
+	if(!compile_shader(shobj->gl_handle)) {
+		log_error("%s: compilation failed", shobj->debug_label);
+		return false;
+	}
+
+	shobj->compiled = true;
+	return true;
+}
+
 void gl33_shader_object_destroy(ShaderObject *shobj) {
 	glDeleteShader(shobj->gl_handle);
 
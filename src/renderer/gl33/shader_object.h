@@ -11,6 +11,7 @@
 
 #include "resource/shader_object.h"
 #include "opengl.h"
+#include "util/sha256.h"
 
 struct ShaderObject {
 	GLuint gl_handle;
@@ -18,11 +19,15 @@ struct ShaderObject {
 	char debug_label[R_DEBUG_LABEL_SIZE];
 	uint num_attribs;
 	GLSLAttribute *attribs;
+	uint8_t source_hash[SHA256_BLOCK_SIZE];
+	// With the program binary cache, compilation is deferred until a program actually needs it
+	bool compiled;
 };
 
 bool gl33_shader_language_supported(const ShaderLangInfo *lang, ShaderLangInfo *out_alternative);
 
 ShaderObject *gl33_shader_object_compile(ShaderSource *source);
+bool gl33_shader_object_ensure_compiled(ShaderObject *shobj);
 void gl33_shader_object_destroy(ShaderObject *shobj);
 void gl33_shader_object_set_debug_label(ShaderObject *shobj, const char *label);
 const char *gl33_shader_object_get_debug_label(ShaderObject *shobj);
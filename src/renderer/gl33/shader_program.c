@@ -11,6 +11,7 @@
 #include "gl33.h"
 #include "shader_program.h"
 #include "shader_object.h"
+#include "program_cache.h"
 #include "texture.h"
 #include "../glcommon/debug.h"
 #include "../api.h"
@@ -533,36 +534,71 @@ void gl33_shader_program_destroy(ShaderProgram *prog) {
 	mem_free(prog);
 }
 
-ShaderProgram *gl33_shader_program_link(uint num_objects, ShaderObject *shobjs[num_objects]) {
-	auto prog = ALLOC(ShaderProgram);
-
-	prog->gl_handle = glCreateProgram();
-	snprintf(prog->debug_label, sizeof(prog->debug_label), "Shader program #%i", prog->gl_handle);
-
+static bool link_program(GLuint gl_handle, uint num_objects, ShaderObject *shobjs[num_objects], bool retrievable) {
 	for(int i = 0; i < num_objects; ++i) {
 		ShaderObject *shobj = shobjs[i];
-		glAttachShader(prog->gl_handle, shobj->gl_handle);
+
+		if(!gl33_shader_object_ensure_compiled(shobj)) {
+			return false;
+		}
+
+		glAttachShader(gl_handle, shobj->gl_handle);
 
 		for(int a = 0; a < shobj->num_attribs; ++a) {
 			GLSLAttribute *attr = shobj->attribs + a;
 			log_debug("Binding attribute %s to location %i", attr->name, attr->location);
-			glBindAttribLocation(prog->gl_handle, attr->location, attr->name);
+			glBindAttribLocation(gl_handle, attr->location, attr->name);
 		}
 	}
 
-	glLinkProgram(prog->gl_handle);
-	print_info_log(prog->gl_handle);
+	if(retrievable) {
+		glProgramParameteri(gl_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	glLinkProgram(gl_handle);
+	print_info_log(gl_handle);
 
 	GLint link_status;
-	glGetProgramiv(prog->gl_handle, GL_LINK_STATUS, &link_status);
+	glGetProgramiv(gl_handle, GL_LINK_STATUS, &link_status);
 
-	if(!link_status) {
-		log_error("Failed to link the shader program");
-		glDeleteProgram(prog->gl_handle);
-		mem_free(prog);
-		return NULL;
+	return link_status;
+}
+
+ShaderProgram *gl33_shader_program_link(uint num_objects, ShaderObject *shobjs[num_objects]) {
+	auto prog = ALLOC(ShaderProgram);
+
+	prog->gl_handle = glCreateProgram();
+
+	bool use_cache = gl33_program_cache_enabled();
+	bool linked = false;
+	char cache_key[SHA256_HEXDIGEST_SIZE];
+
+	if(use_cache) {
+		gl33_program_cache_key(num_objects, shobjs, cache_key);
+		linked = gl33_program_cache_load(prog->gl_handle, cache_key);
+
+		if(!linked) {
+			// Don't reuse a program object that a rejected binary may have been loaded into
+			glDeleteProgram(prog->gl_handle);
+			prog->gl_handle = glCreateProgram();
+		}
 	}
 
+	if(!linked) {
+		if(!link_program(prog->gl_handle, num_objects, shobjs, use_cache)) {
+			log_error("Failed to link the shader program");
+			glDeleteProgram(prog->gl_handle);
+			mem_free(prog);
+			return NULL;
+		}
+
+		if(use_cache) {
+			gl33_program_cache_store(prog->gl_handle, cache_key);
+		}
+	}
+
+	snprintf(prog->debug_label, sizeof(prog->debug_label), "Shader program #%i", prog->gl_handle);
+
 	if(!cache_uniforms(prog)) {
 		gl33_shader_program_destroy(prog);
 		return NULL;
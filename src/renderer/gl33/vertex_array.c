@@ -41,6 +41,7 @@ void gl33_vertex_array_destroy(VertexArray *varr) {
 	gl33_vertex_array_deleted(varr);
 	glDeleteVertexArrays(1, &varr->gl_handle);
 	mem_free(varr->attachments);
+	mem_free(varr->attachment_bases);
 	mem_free(varr->attribute_layout);
 	mem_free(varr);
 }
@@ -83,6 +84,8 @@ static void gl33_vertex_array_update_layout(VertexArray *varr) {
 
 		glEnableVertexAttribArray(i);
 
+		uintptr_t offset = varr->attachment_bases[a->attachment] + a->offset;
+
 		switch(a->spec.coversion) {
 			case VA_CONVERT_FLOAT:
 			case VA_CONVERT_FLOAT_NORMALIZED:
@@ -92,7 +95,7 @@ static void gl33_vertex_array_update_layout(VertexArray *varr) {
 					va_type_to_gl_type[a->spec.type],
 					a->spec.coversion == VA_CONVERT_FLOAT_NORMALIZED,
 					a->stride,
-					(void*)a->offset
+					(void*)offset
 				);
 
 				break;
@@ -103,7 +106,7 @@ static void gl33_vertex_array_update_layout(VertexArray *varr) {
 					a->spec.elements,
 					va_type_to_gl_type[a->spec.type],
 					a->stride,
-					(void*)a->offset
+					(void*)offset
 				);
 
 				break;
@@ -141,10 +144,12 @@ void gl33_vertex_array_attach_vertex_buffer(VertexArray *varr, VertexBuffer *vbu
 	// TODO: more efficient way of handling this?
 	if(attachment >= varr->num_attachments) {
 		varr->attachments = mem_realloc(varr->attachments, (attachment + 1) * sizeof(VertexBuffer*));
+		varr->attachment_bases = mem_realloc(varr->attachment_bases, (attachment + 1) * sizeof(size_t));
 		varr->num_attachments = attachment + 1;
 	}
 
 	varr->attachments[attachment] = vbuf;
+	varr->attachment_bases[attachment] = gl33_buffer_base(&vbuf->cbuf);
 	varr->layout_dirty_bits |= (1u << attachment);
 }
 
@@ -183,17 +188,36 @@ void gl33_vertex_array_set_debug_label(VertexArray *varr, const char *label) {
 	glcommon_set_debug_label(varr->debug_label, "VAO", GL_VERTEX_ARRAY, varr->gl_handle, label);
 }
 
-void gl33_vertex_array_flush_buffers(VertexArray *varr) {
-	if(varr->layout_dirty_bits) {
-		gl33_vertex_array_update_layout(varr);
+static void gl33_vertex_array_rebase_attachment(VertexArray *varr, uint attachment, size_t base) {
+	varr->attachment_bases[attachment] = base;
+
+	for(uint i = 0; i < varr->num_attributes; ++i) {
+		if(varr->attribute_layout[i].attachment == attachment) {
+			varr->layout_dirty_bits |= (1u << i);
+		}
 	}
+}
 
+void gl33_vertex_array_flush_buffers(VertexArray *varr) {
 	for(uint i = 0; i < varr->num_attachments; ++i) {
-		if(varr->attachments[i] != NULL) {
-			gl33_vertex_buffer_flush(varr->attachments[i]);
+		VertexBuffer *vbuf = varr->attachments[i];
+
+		if(vbuf != NULL) {
+			gl33_vertex_buffer_flush(vbuf);
+
+			// Streaming buffers move their contents around the ring on every invalidation
+			size_t base = gl33_buffer_base(&vbuf->cbuf);
+
+			if(base != varr->attachment_bases[i]) {
+				gl33_vertex_array_rebase_attachment(varr, i, base);
+			}
 		}
 	}
 
+	if(varr->layout_dirty_bits) {
+		gl33_vertex_array_update_layout(varr);
+	}
+
 	if(varr->index_attachment != NULL) {
 		gl33_index_buffer_flush(varr->index_attachment);
 	}
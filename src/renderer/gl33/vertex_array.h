@@ -17,6 +17,7 @@
 
 struct VertexArray {
 	VertexBuffer **attachments;
+	size_t *attachment_bases;  // where the attribute pointers of each attachment were set up
 	VertexAttribFormat *attribute_layout;
 	IndexBuffer *index_attachment;
 	GLuint gl_handle;
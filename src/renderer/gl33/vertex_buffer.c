@@ -21,6 +21,18 @@ VertexBuffer* gl33_vertex_buffer_create(size_t capacity, void *data) {
 	return vbuf;
 }
 
+VertexBuffer* gl33_vertex_buffer_create_streaming(size_t capacity) {
+	VertexBuffer *vbuf = (VertexBuffer*)gl33_buffer_create(GL33_BUFFER_BINDING_ARRAY, sizeof(VertexBuffer));
+	gl33_buffer_init_streaming(&vbuf->cbuf, capacity);
+
+	snprintf(vbuf->cbuf.debug_label, sizeof(vbuf->cbuf.debug_label), "VBO #%i", vbuf->cbuf.gl_handle);
+	log_debug("Created %s VBO %u with %zukb of storage",
+		vbuf->cbuf.streaming ? "streaming" : "dynamic",
+		vbuf->cbuf.gl_handle, vbuf->cbuf.commited_size / 1024
+	);
+	return vbuf;
+}
+
 void gl33_vertex_buffer_destroy(VertexBuffer *vbuf) {
 	log_debug("Deleted VBO %u with %zukb of storage", vbuf->cbuf.gl_handle, vbuf->cbuf.size / 1024);
 	gl33_buffer_destroy(&vbuf->cbuf);
@@ -45,3 +57,11 @@ void gl33_vertex_buffer_flush(VertexBuffer *vbuf) {
 SDL_RWops* gl33_vertex_buffer_get_stream(VertexBuffer *vbuf) {
 	return gl33_buffer_get_stream(&vbuf->cbuf);
 }
+
+void *gl33_vertex_buffer_map_range(VertexBuffer *vbuf, size_t min_size, size_t *out_size) {
+	return gl33_buffer_map_range(&vbuf->cbuf, min_size, out_size);
+}
+
+void gl33_vertex_buffer_commit(VertexBuffer *vbuf, size_t size) {
+	gl33_buffer_commit(&vbuf->cbuf, size);
+}
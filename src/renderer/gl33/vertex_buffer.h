@@ -16,9 +16,12 @@ typedef struct VertexBuffer {
 } VertexBuffer;
 
 VertexBuffer* gl33_vertex_buffer_create(size_t capacity, void *data);
+VertexBuffer* gl33_vertex_buffer_create_streaming(size_t capacity);
 const char* gl33_vertex_buffer_get_debug_label(VertexBuffer *vbuf);
 void gl33_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char *label);
 void gl33_vertex_buffer_destroy(VertexBuffer *vbuf);
 void gl33_vertex_buffer_invalidate(VertexBuffer *vbuf);
 SDL_RWops* gl33_vertex_buffer_get_stream(VertexBuffer *vbuf);
+void *gl33_vertex_buffer_map_range(VertexBuffer *vbuf, size_t min_size, size_t *out_size);
+void gl33_vertex_buffer_commit(VertexBuffer *vbuf, size_t size);
 void gl33_vertex_buffer_flush(VertexBuffer *vbuf);
@@ -211,6 +211,27 @@ static void glcommon_ext_debug_output(void) {
 	EXT_MISSING();
 }
 
+static void glcommon_ext_map_buffer_range(void) {
+	EXT_FLAG(map_buffer_range);
+
+	// Only reported where fence syncs and buffer copies are also available, since the streaming
+	// buffers can't work without them. WebGL has no buffer mapping at all.
+	if(
+		!glext.version.is_webgl &&
+		HAVE_GL_FUNC(glMapBufferRange) &&
+		HAVE_GL_FUNC(glFlushMappedBufferRange) &&
+		HAVE_GL_FUNC(glUnmapBuffer) &&
+		HAVE_GL_FUNC(glCopyBufferSubData) &&
+		HAVE_GL_FUNC(glFenceSync) &&
+		HAVE_GL_FUNC(glClientWaitSync) &&
+		HAVE_GL_FUNC(glDeleteSync)
+	) {
+		CHECK_CORE(GL_ATLEAST(3, 2) || GLES_ATLEAST(3, 0));
+	}
+
+	EXT_MISSING();
+}
+
 static void glcommon_ext_pixel_buffer_object(void) {
 	EXT_FLAG(pixel_buffer_object);
 
@@ -288,6 +309,21 @@ static void glcommon_ext_internalformat_query2(void) {
 	EXT_MISSING();
 }
 
+static void glcommon_ext_get_program_binary(void) {
+	EXT_FLAG(get_program_binary);
+
+	if(
+		HAVE_GL_FUNC(glGetProgramBinary) &&
+		HAVE_GL_FUNC(glProgramBinary) &&
+		HAVE_GL_FUNC(glProgramParameteri)
+	) {
+		CHECK_CORE(GL_ATLEAST(4, 1) || GLES_ATLEAST(3, 0));
+		CHECK_EXT(GL_ARB_get_program_binary);
+	}
+
+	EXT_MISSING();
+}
+
 static void glcommon_ext_draw_buffers(void) {
 	EXT_FLAG(draw_buffers);
 
@@ -931,8 +967,10 @@ void glcommon_check_capabilities(void) {
 	glcommon_ext_depth_texture();
 	glcommon_ext_draw_buffers();
 	glcommon_ext_float_blend();
+	glcommon_ext_get_program_binary();
 	glcommon_ext_instanced_arrays();
 	glcommon_ext_internalformat_query2();
+	glcommon_ext_map_buffer_range();
 	glcommon_ext_pixel_buffer_object();
 	glcommon_ext_seamless_cubemap();
 	glcommon_ext_texture_filter_anisotropic();
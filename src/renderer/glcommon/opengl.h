@@ -168,8 +168,10 @@ struct glext_s {
 	ext_flag_t depth_texture;
 	ext_flag_t draw_buffers;
 	ext_flag_t float_blend;
+	ext_flag_t get_program_binary;
 	ext_flag_t instanced_arrays;
 	ext_flag_t internalformat_query2;
+	ext_flag_t map_buffer_range;
 	ext_flag_t pixel_buffer_object;
 	ext_flag_t seamless_cubemap;
 	ext_flag_t texture_filter_anisotropic;
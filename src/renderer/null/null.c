@@ -159,7 +159,17 @@ static SDL_RWops* null_vertex_buffer_get_stream(VertexBuffer *vbuf) {
 	return &dummy_stream;
 }
 
+static void* null_vertex_buffer_map_range(VertexBuffer *vbuf, size_t min_size, size_t *out_size) {
+	static char dummy_mapping[1 << 16];
+	assert(min_size <= sizeof(dummy_mapping));
+	*out_size = sizeof(dummy_mapping);
+	return dummy_mapping;
+}
+
+static void null_vertex_buffer_commit(VertexBuffer *vbuf, size_t size) { }
+
 static VertexBuffer* null_vertex_buffer_create(size_t capacity, void *data) { return (void*)&placeholder; }
+static VertexBuffer* null_vertex_buffer_create_streaming(size_t capacity) { return (void*)&placeholder; }
 static void null_vertex_buffer_set_debug_label(VertexBuffer *vbuf, const char *label) { }
 static const char* null_vertex_buffer_get_debug_label(VertexBuffer *vbuf) { return "null vertex buffer"; }
 static void null_vertex_buffer_destroy(VertexBuffer *vbuf) { }
@@ -261,11 +271,14 @@ RendererBackend _r_backend_null = {
 		.framebuffer_get_size = null_framebuffer_get_size,
 		.framebuffer_read_async = null_framebuffer_read_async,
 		.vertex_buffer_create = null_vertex_buffer_create,
+		.vertex_buffer_create_streaming = null_vertex_buffer_create_streaming,
 		.vertex_buffer_get_debug_label = null_vertex_buffer_get_debug_label,
 		.vertex_buffer_set_debug_label = null_vertex_buffer_set_debug_label,
 		.vertex_buffer_destroy = null_vertex_buffer_destroy,
 		.vertex_buffer_invalidate = null_vertex_buffer_invalidate,
 		.vertex_buffer_get_stream = null_vertex_buffer_get_stream,
+		.vertex_buffer_map_range = null_vertex_buffer_map_range,
+		.vertex_buffer_commit = null_vertex_buffer_commit,
 		.index_buffer_create = null_index_buffer_create,
 		.index_buffer_get_capacity = null_index_buffer_get_capacity,
 		.index_buffer_get_index_size = null_index_buffer_get_index_size,
@@ -0,0 +1,340 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#include "taisei.h"
+
+#include "index.h"
+#include "replay.h"
+
+#include "rwops/rwops_zstd.h"
+#include "taskmanager.h"
+#include "util.h"
+
+#define INDEX_VERSION 1
+#define INDEX_MAGIC 0x49525354  // "TSRI"
+#define INDEX_DIR "cache"
+#define INDEX_NAME "replays.index"
+#define INDEX_PATH INDEX_DIR "/" INDEX_NAME
+#define INDEX_TEMP_PATH INDEX_PATH ".tmp"
+#define REPLAYS_DIR "storage/replays"
+
+// Sanity limit for the entry count stored in the index header
+#define MAX_ENTRIES (1 << 20)
+
+struct ReplayIndexRefresh {
+	Task *task;
+	SDL_atomic_t cancelled;
+	ReplayIndex index;
+	bool changed;
+	bool ok;
+};
+
+void replay_index_free(ReplayIndex *idx) {
+	dynarray_foreach_elem(&idx->entries, ReplayIndexEntry *e, {
+		mem_free(e->name);
+
+		if(e->replay) {
+			replay_reset(e->replay);
+			mem_free(e->replay);
+		}
+	});
+
+	dynarray_free_data(&idx->entries);
+}
+
+static char *replay_index_read_string(SDL_RWops *rw) {
+	size_t len = SDL_ReadLE16(rw);
+	char *s = mem_alloc(len + 1);
+
+	if(SDL_RWread(rw, s, 1, len) != len) {
+		mem_free(s);
+		return NULL;
+	}
+
+	return s;
+}
+
+static void replay_index_write_string(SDL_RWops *rw, const char *s) {
+	size_t len = min(strlen(s), UINT16_MAX);
+	SDL_WriteLE16(rw, len);
+	SDL_RWwrite(rw, s, 1, len);
+}
+
+static bool replay_index_read_replay(SDL_RWops *rw, Replay *rpy) {
+	rpy->version = SDL_ReadLE16(rw);
+
+	if(taisei_version_read(rw, &rpy->game_version) != TAISEI_VERSION_SIZE) {
+		return false;
+	}
+
+	if(!(rpy->playername = replay_index_read_string(rw))) {
+		return false;
+	}
+
+	rpy->flags = SDL_ReadLE32(rw);
+
+	uint numstages = SDL_ReadLE16(rw);
+
+	if(!numstages) {
+		return false;
+	}
+
+	dynarray_ensure_capacity(&rpy->stages, numstages);
+
+	for(uint i = 0; i < numstages; ++i) {
+		ReplayStage *stg = dynarray_append(&rpy->stages, {});
+		stg->flags = SDL_ReadLE32(rw);
+		stg->stage = SDL_ReadLE16(rw);
+		stg->start_time = SDL_ReadLE64(rw);
+		stg->diff = SDL_ReadU8(rw);
+		stg->plr_char = SDL_ReadU8(rw);
+		stg->plr_shot = SDL_ReadU8(rw);
+		stg->plr_points_final = SDL_ReadLE64(rw);
+	}
+
+	return true;
+}
+
+static void replay_index_write_replay(SDL_RWops *rw, Replay *rpy) {
+	SDL_WriteLE16(rw, rpy->version);
+	taisei_version_write(rw, &rpy->game_version);
+	replay_index_write_string(rw, rpy->playername ? rpy->playername : "");
+	SDL_WriteLE32(rw, rpy->flags);
+	SDL_WriteLE16(rw, rpy->stages.num_elements);
+
+	dynarray_foreach_elem(&rpy->stages, ReplayStage *stg, {
+		SDL_WriteLE32(rw, stg->flags);
+		SDL_WriteLE16(rw, stg->stage);
+		SDL_WriteLE64(rw, stg->start_time);
+		SDL_WriteU8(rw, stg->diff);
+		SDL_WriteU8(rw, stg->plr_char);
+		SDL_WriteU8(rw, stg->plr_shot);
+		SDL_WriteLE64(rw, stg->plr_points_final);
+	});
+}
+
+static bool replay_index_read(SDL_RWops *rw, ReplayIndex *idx) {
+	if(SDL_ReadLE32(rw) != INDEX_MAGIC || SDL_ReadLE16(rw) != INDEX_VERSION) {
+		return false;
+	}
+
+	uint32_t num_entries = SDL_ReadLE32(rw);
+
+	if(num_entries > MAX_ENTRIES) {
+		return false;
+	}
+
+	dynarray_ensure_capacity(&idx->entries, num_entries);
+
+	for(uint32_t i = 0; i < num_entries; ++i) {
+		ReplayIndexEntry *e = dynarray_append(&idx->entries, {});
+
+		if(!(e->name = replay_index_read_string(rw))) {
+			return false;
+		}
+
+		e->size = SDL_ReadLE64(rw);
+		e->mtime = SDL_ReadLE64(rw);
+
+		if(SDL_ReadU8(rw)) {
+			e->replay = ALLOC(Replay);
+
+			if(!replay_index_read_replay(rw, e->replay)) {
+				return false;
+			}
+		}
+	}
+
+	// Catches truncated files, since the reads above can't tell EOF from zeroes
+	return SDL_ReadLE32(rw) == INDEX_MAGIC;
+}
+
+void replay_index_load(ReplayIndex *idx) {
+	*idx = (ReplayIndex) { };
+
+	SDL_RWops *rw = vfs_open(INDEX_PATH, VFS_MODE_READ);
+
+	if(!rw) {
+		return;
+	}
+
+	rw = SDL_RWWrapZstdReader(rw, true);
+
+	if(!replay_index_read(rw, idx)) {
+		log_warn("%s: Replay index is corrupt or outdated, ignoring", INDEX_PATH);
+		replay_index_free(idx);
+	}
+
+	SDL_RWclose(rw);
+}
+
+static void replay_index_save(ReplayIndex *idx) {
+	vfs_mkdir(INDEX_DIR);
+	SDL_RWops *rw = vfs_open(INDEX_TEMP_PATH, VFS_MODE_WRITE);
+
+	if(!rw) {
+		log_warn("VFS error: %s", vfs_get_error());
+		return;
+	}
+
+	rw = SDL_RWWrapZstdWriter(rw, RW_ZSTD_LEVEL_DEFAULT, true);
+
+	SDL_WriteLE32(rw, INDEX_MAGIC);
+	SDL_WriteLE16(rw, INDEX_VERSION);
+	SDL_WriteLE32(rw, idx->entries.num_elements);
+
+	dynarray_foreach_elem(&idx->entries, ReplayIndexEntry *e, {
+		replay_index_write_string(rw, e->name);
+		SDL_WriteLE64(rw, e->size);
+		SDL_WriteLE64(rw, e->mtime);
+		SDL_WriteU8(rw, e->replay != NULL);
+
+		if(e->replay) {
+			replay_index_write_replay(rw, e->replay);
+		}
+	});
+
+	SDL_WriteLE32(rw, INDEX_MAGIC);
+
+	// Closing flushes the compressor, so this can fail too
+	if(SDL_RWclose(rw) < 0) {
+		log_sdl_error(LOG_WARN, "SDL_RWclose");
+		vfs_unlink(INDEX_TEMP_PATH);
+		return;
+	}
+
+	if(!vfs_rename(INDEX_TEMP_PATH, INDEX_NAME)) {
+		log_warn("VFS error: %s", vfs_get_error());
+		vfs_unlink(INDEX_TEMP_PATH);
+	}
+}
+
+static int replay_index_entry_cmp_name(const void *a, const void *b) {
+	return strcmp(((const ReplayIndexEntry*)a)->name, ((const ReplayIndexEntry*)b)->name);
+}
+
+static void *replay_index_refresh_task(void *arg) {
+	ReplayIndexRefresh *r = arg;
+
+	if(SDL_AtomicGet(&r->cancelled)) {
+		return NULL;
+	}
+
+	ReplayIndex old;
+	replay_index_load(&old);
+	dynarray_qsort(&old.entries, replay_index_entry_cmp_name);
+
+	VFSDir *dir = vfs_dir_open(REPLAYS_DIR);
+
+	if(!dir) {
+		log_warn("VFS error: %s", vfs_get_error());
+		replay_index_free(&old);
+		return NULL;
+	}
+
+	const char *filename;
+	uint reused = 0;
+
+	while((filename = vfs_dir_read(dir))) {
+		if(SDL_AtomicGet(&r->cancelled)) {
+			break;
+		}
+
+		if(!strendswith(filename, "." REPLAY_EXTENSION)) {
+			continue;
+		}
+
+		char *path = strfmt(REPLAYS_DIR "/%s", filename);
+		VFSInfo info = vfs_query(path);
+		mem_free(path);
+
+		ReplayIndexEntry *e = dynarray_append(&r->index.entries, {
+			.size = info.size,
+			.mtime = info.mtime,
+		});
+
+		ReplayIndexEntry key = { .name = (char*)filename };
+		ReplayIndexEntry *old_e = old.entries.num_elements ? bsearch(
+			&key, old.entries.data, old.entries.num_elements, sizeof(key), replay_index_entry_cmp_name
+		) : NULL;
+
+		e->name = strdup(filename);
+
+		// Size and mtime are unknown outside of the real filesystem; always reread such files
+		if(
+			old_e != NULL &&
+			(e->size || e->mtime) &&
+			old_e->size == e->size &&
+			old_e->mtime == e->mtime
+		) {
+			e->replay = old_e->replay;
+			old_e->replay = NULL;
+			++reused;
+			continue;
+		}
+
+		e->replay = ALLOC(Replay);
+
+		if(!replay_load(e->replay, filename, REPLAY_READ_META)) {
+			mem_free(e->replay);
+			e->replay = NULL;
+		}
+	}
+
+	vfs_dir_close(dir);
+
+	r->changed = reused != old.entries.num_elements || reused != r->index.entries.num_elements;
+	replay_index_free(&old);
+
+	if(SDL_AtomicGet(&r->cancelled)) {
+		return NULL;
+	}
+
+	if(r->changed) {
+		replay_index_save(&r->index);
+	}
+
+	r->ok = true;
+	return NULL;
+}
+
+ReplayIndexRefresh *replay_index_refresh_async(void) {
+	auto r = ALLOC(ReplayIndexRefresh);
+	r->task = taskmgr_global_submit((TaskParams) {
+		.callback = replay_index_refresh_task,
+		.userdata = r,
+	});
+	return r;
+}
+
+bool replay_index_refresh_done(ReplayIndexRefresh *r) {
+	TaskStatus s = task_status(r->task);
+	return s != TASK_PENDING && s != TASK_RUNNING;
+}
+
+bool replay_index_refresh_finish(ReplayIndexRefresh *r, ReplayIndex *out, bool *changed) {
+	task_finish(r->task, NULL);
+
+	bool ok = r->ok;
+	*out = r->index;
+	*changed = r->changed;
+
+	if(!ok) {
+		replay_index_free(out);
+	}
+
+	mem_free(r);
+	return ok;
+}
+
+void replay_index_refresh_cancel(ReplayIndexRefresh *r) {
+	SDL_AtomicSet(&r->cancelled, true);
+	task_finish(r->task, NULL);
+	replay_index_free(&r->index);
+	mem_free(r);
+}
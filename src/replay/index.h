@@ -0,0 +1,55 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#pragma once
+#include "taisei.h"
+
+#include "struct.h"
+
+/*
+ * A persistent summary of the replays in storage/replays, so that the replay browser doesn't have
+ * to open and decompress every file whenever it's shown.
+ *
+ * The summaries only contain the header, the player name, and the stage id, start time,
+ * difficulty, player mode and final score of each stage. Load the replay with REPLAY_READ_ALL
+ * before playing it.
+ */
+
+typedef struct ReplayIndexEntry {
+	char *name;        // file name within storage/replays
+	uint64_t size;
+	int64_t mtime;
+	Replay *replay;    // NULL if the file could not be read
+} ReplayIndexEntry;
+
+typedef struct ReplayIndex {
+	DYNAMIC_ARRAY(ReplayIndexEntry) entries;
+} ReplayIndex;
+
+typedef struct ReplayIndexRefresh ReplayIndexRefresh;
+
+// Loads the saved index, which may be out of date. Never fails; the index is just empty then.
+void replay_index_load(ReplayIndex *idx) attr_nonnull_all;
+
+// Entries with their name or replay set to NULL (e.g. taken over by the caller) are fine here.
+void replay_index_free(ReplayIndex *idx) attr_nonnull_all;
+
+// Brings the saved index up to date on a worker thread. Only replays that were added or modified
+// since the last refresh are read.
+ReplayIndexRefresh *replay_index_refresh_async(void) attr_returns_nonnull attr_nodiscard;
+
+// Returns true once replay_index_refresh_finish() can be called without blocking.
+bool replay_index_refresh_done(ReplayIndexRefresh *r) attr_nonnull_all;
+
+// Waits for the refresh to complete, then frees it. On success, moves the up-to-date index into [out],
+// and sets [changed] to whether it differs from the one replay_index_load() returned before.
+// Returns false if the replay directory could not be read.
+bool replay_index_refresh_finish(ReplayIndexRefresh *r, ReplayIndex *out, bool *changed) attr_nonnull_all;
+
+// Stops the refresh early and frees it.
+void replay_index_refresh_cancel(ReplayIndexRefresh *r) attr_nonnull_all;
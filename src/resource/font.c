@@ -23,6 +23,8 @@
 #include "util/rectpack.h"
 #include "video.h"
 #include "dynarray.h"
+#include "eventloop/eventloop.h"
+#include "taskmanager.h"
 
 static void init_fonts(void);
 static void post_init_fonts(void);
@@ -87,6 +89,13 @@ static const char *ft_error_str(FT_Error err_code) {
 	return "Unknown error";
 }
 
+// TODO: Figure out sensible values for these; maybe make them depend on font size in some way.
+#define SS_WIDTH 2048
+#define SS_HEIGHT 2048
+
+#define SS_TEXTURE_TYPE TEX_TYPE_RGB_8
+#define SS_TEXTURE_FLAGS 0
+
 typedef struct SpriteSheet {
 	LIST_INTERFACE(struct SpriteSheet);
 	Texture *tex;
@@ -102,8 +111,17 @@ typedef struct Glyph {
 	RectPackSection *spritesheet_section;
 	GlyphMetrics metrics;
 	ulong ft_index;
+	bool pending;  // only the metrics are known yet; the bitmap is being rendered on a worker
 } Glyph;
 
+typedef struct RasterizedGlyph {
+	GlyphMetrics metrics;
+	Pixmap bitmap;  // data is NULL for invisible glyphs
+	FloatExtent padding;
+	FT_UInt ft_index;
+	bool ok;
+} RasterizedGlyph;
+
 struct Font {
 	char *source_path;
 	DYNAMIC_ARRAY(Glyph) glyphs;
@@ -118,6 +136,17 @@ struct Font {
 	FontMetrics metrics;
 	bool kerning;
 
+	// Glyph rendering on worker threads. See font_prewarm_text().
+	struct {
+		SDL_mutex *mutex;
+		DYNAMIC_ARRAY(FT_Face) spare_faces;  // FT_Face can't be shared between threads
+		DYNAMIC_ARRAY(RasterizedGlyph) results;
+
+		// Main thread only
+		DYNAMIC_ARRAY(Task*) tasks;
+		ht_int2int_t queued;  // ft_index -> 1 for glyphs owned by a task
+	} raster;
+
 #ifdef DEBUG
 	char debug_label[64];
 #endif
@@ -135,6 +164,15 @@ static struct {
 		SDL_mutex *done_face;
 	} mutex;
 
+	struct {
+		PixmapFormat pixmap_format;
+		PixmapOrigin pixmap_origin;
+		hrtime_t budget;
+		hrtime_t time_this_frame;
+		hrtime_t frame_threshold;
+		uint no_defer;
+	} raster;
+
 	ResourceGroup rg;
 } globals;
 
@@ -237,6 +275,16 @@ static void init_fonts(void) {
 	globals.render_buf = r_framebuffer_create();
 	r_framebuffer_attach(globals.render_buf, globals.render_tex, 0, FRAMEBUFFER_ATTACH_COLOR0);
 	r_framebuffer_viewport(globals.render_buf, 0, 0, 1024, 1024);
+
+	TextureTypeQueryResult qr = { 0 };
+
+	if(!r_texture_type_query(SS_TEXTURE_TYPE, SS_TEXTURE_FLAGS, PIXMAP_FORMAT_RGB8, PIXMAP_ORIGIN_BOTTOMLEFT, &qr)) {
+		log_fatal("Texture query failed!");
+	}
+
+	globals.raster.pixmap_format = qr.optimal_pixmap_format;
+	globals.raster.pixmap_origin = qr.optimal_pixmap_origin;
+	globals.raster.budget = max(0, env_get("TAISEI_GLYPH_RASTER_BUDGET", 0.0)) * (HRTIME_RESOLUTION / 1000);
 }
 
 static void post_init_fonts(void) {
@@ -341,17 +389,34 @@ static FT_Face load_font_face(char *vfspath, long index) {
 	return face;
 }
 
+static void free_font_face(FT_Face face) {
+	FT_Stream stream = face->stream;
+	FT_Done_Face_Thread_Safe(face);
+
+	if(stream) {
+		mem_free(stream->pathname.pointer);
+		mem_free(stream);
+	}
+}
+
+static FT_Error set_face_size(FT_Face face, int base_size, float scale) {
+	FT_Error err;
+	uint pxsize = float_to_f26dot6(base_size * scale);
+
+	if((err = FT_Set_Char_Size(face, 0, pxsize, 0, 0))) {
+		log_error("FT_Set_Char_Size(%u) failed: %s", pxsize, ft_error_str(err));
+	}
+
+	return err;
+}
+
 static FT_Error set_font_size(Font *fnt, float scale) {
 	FT_Error err = FT_Err_Ok;
-	uint pxsize = fnt->base_size;
 
 	assert(fnt != NULL);
 	assert(fnt->face != NULL);
 
-	pxsize = float_to_f26dot6(pxsize * scale);
-
-	if((err = FT_Set_Char_Size(fnt->face, 0, pxsize, 0, 0))) {
-		log_error("FT_Set_Char_Size(%u) failed: %s", pxsize, ft_error_str(err));
+	if((err = set_face_size(fnt->face, fnt->base_size, scale))) {
 		return err;
 	}
 
@@ -387,13 +452,6 @@ void font_set_kerning_enabled(Font *font, bool newval) {
 	font->kerning = (newval && FT_HAS_KERNING(font->face));
 }
 
-// TODO: Figure out sensible values for these; maybe make them depend on font size in some way.
-#define SS_WIDTH 2048
-#define SS_HEIGHT 2048
-
-#define SS_TEXTURE_TYPE TEX_TYPE_RGB_8
-#define SS_TEXTURE_FLAGS 0
-
 static SpriteSheet *add_spritesheet(SpriteSheetAnchor *spritesheets) {
 	auto ss = ALLOC(SpriteSheet, {
 		.tex = r_texture_create(&(TextureParams) {
@@ -502,69 +560,78 @@ static void delete_spritesheet(SpriteSheetAnchor *spritesheets, SpriteSheet *ss)
 	mem_free(ss);
 }
 
-static Glyph *load_glyph(Font *font, FT_UInt gindex, SpriteSheetAnchor *spritesheets) {
-	// log_debug("Loading glyph 0x%08x", gindex);
-
-	FT_Render_Mode render_mode = GLOBAL_RENDER_MODE;
-	FT_Error err = FT_Load_Glyph(font->face, gindex,
+static bool load_glyph_metrics(FT_Face face, FT_UInt gindex, GlyphMetrics *metrics) {
+	FT_Error err = FT_Load_Glyph(face, gindex,
 		FT_LOAD_NO_BITMAP |
-		FT_LOAD_TARGET_(render_mode) |
+		FT_LOAD_TARGET_(GLOBAL_RENDER_MODE) |
 	0);
 
 	if(err) {
 		log_warn("FT_Load_Glyph(%u) failed: %s", gindex, ft_error_str(err));
-		return NULL;
+		return false;
 	}
 
-	Glyph *glyph = dynarray_append(&font->glyphs, {
-		.metrics = {
-			.bearing_x = f26dot6_to_float(font->face->glyph->metrics.horiBearingX),
-			.bearing_y = f26dot6_to_float(font->face->glyph->metrics.horiBearingY),
-			.width = f26dot6_to_float(font->face->glyph->metrics.width),
-			.height = f26dot6_to_float(font->face->glyph->metrics.height),
-			.advance = f26dot6_to_float(font->face->glyph->metrics.horiAdvance),
-			.lsb_delta = f26dot6_to_float(font->face->glyph->lsb_delta),
-			.rsb_delta = f26dot6_to_float(font->face->glyph->rsb_delta),
-		}
-	});
+	*metrics = (GlyphMetrics) {
+		.bearing_x = f26dot6_to_float(face->glyph->metrics.horiBearingX),
+		.bearing_y = f26dot6_to_float(face->glyph->metrics.horiBearingY),
+		.width = f26dot6_to_float(face->glyph->metrics.width),
+		.height = f26dot6_to_float(face->glyph->metrics.height),
+		.advance = f26dot6_to_float(face->glyph->metrics.horiAdvance),
+		.lsb_delta = f26dot6_to_float(face->glyph->lsb_delta),
+		.rsb_delta = f26dot6_to_float(face->glyph->rsb_delta),
+	};
+
+	return true;
+}
+
+/*
+ * Renders the glyph into a pixmap that is ready to be uploaded to a spritesheet.
+ * Only touches the given face and stroker, so this may run on any thread that owns them.
+ */
+static bool rasterize_glyph(Font *font, FT_Face face, FT_Stroker stroker, FT_UInt gindex, RasterizedGlyph *out) {
+	// log_debug("Loading glyph 0x%08x", gindex);
+
+	*out = (RasterizedGlyph) { .ft_index = gindex };
+
+	if(!load_glyph_metrics(face, gindex, &out->metrics)) {
+		return false;
+	}
 
 	FT_Glyph g_src = NULL, g_fill = NULL, g_border = NULL, g_inner = NULL;
 	FT_BitmapGlyph g_bm_fill = NULL, g_bm_border = NULL, g_bm_inner = NULL;
-	FT_Get_Glyph(font->face->glyph, &g_src);
+	FT_Get_Glyph(face->glyph, &g_src);
 	FT_Glyph_Copy(g_src, &g_fill);
 	FT_Glyph_Copy(g_src, &g_border);
 	FT_Glyph_Copy(g_src, &g_inner);
 
 	assert(g_src->format == FT_GLYPH_FORMAT_OUTLINE);
 
-	bool have_bitmap = FT_Glyph_To_Bitmap(&g_fill, render_mode, NULL, true) == FT_Err_Ok;
+	bool have_bitmap = FT_Glyph_To_Bitmap(&g_fill, GLOBAL_RENDER_MODE, NULL, true) == FT_Err_Ok;
 
 	if(have_bitmap) {
 		have_bitmap = ((FT_BitmapGlyph)g_fill)->bitmap.width > 0;
 	}
 
-	if(!have_bitmap) {
-		// Some glyphs may be invisible, but we still need the metrics data for them (e.g. space)
-		memset(&glyph->sprite, 0, sizeof(Sprite));
-	} else {
-		FT_Stroker_Set(font->stroker,
+	// Some glyphs may be invisible, but we still need the metrics data for them (e.g. space)
+	if(have_bitmap) {
+		FT_Stroker_Set(stroker,
 			FT_MulFix(
 				float_to_f26dot6(font->base_border_outer),
-				font->face->size->metrics.y_scale),
+				face->size->metrics.y_scale),
 			FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_ROUND, 0
 		);
 
-		FT_Glyph_StrokeBorder(&g_border, font->stroker, false, true);
+		FT_Glyph_StrokeBorder(&g_border, stroker, false, true);
 		FT_Glyph_To_Bitmap(&g_border, GLOBAL_RENDER_MODE, NULL, true);
 
-		FT_Stroker_Set(font->stroker,
+		FT_Stroker_Set(stroker,
 			FT_MulFix(
 				float_to_f26dot6(font->base_border_inner),
-				font->face->size->metrics.y_scale),
+				face->size->metrics.y_scale),
 			FT_STROKER_LINECAP_ROUND, FT_STROKER_LINEJOIN_BEVEL, 0
 		);
 
-		FT_Glyph_StrokeBorder(&g_inner, font->stroker, true, true);
+		FT_Glyph_StrokeBorder(&g_inner, stroker, true, true);
 		FT_Glyph_To_Bitmap(&g_inner, GLOBAL_RENDER_MODE, NULL, true);
 
 		g_bm_fill = (FT_BitmapGlyph)g_fill;
@@ -587,8 +654,7 @@ static Glyph *load_glyph(Font *font, FT_UInt gindex, SpriteSheetAnchor *spritesh
 			FT_Done_Glyph(g_fill);
 			FT_Done_Glyph(g_border);
 			FT_Done_Glyph(g_inner);
-			font->glyphs.num_elements--;
-			return NULL;
+			return false;
 		}
 
 		Pixmap px;
@@ -652,54 +718,355 @@ static Glyph *load_glyph(Font *font, FT_UInt gindex, SpriteSheetAnchor *spritesh
 			}
 		}
 
-		TextureTypeQueryResult qr = { 0 };
+		out->padding.w = px.width - g_bm_fill->bitmap.width;
+		out->padding.h = px.height - g_bm_fill->bitmap.rows;
+
+		pixmap_convert_inplace_realloc(&px, globals.raster.pixmap_format);
+		pixmap_flip_to_origin_inplace(&px, globals.raster.pixmap_origin);
+		out->bitmap = px;
+	}
+
+	FT_Done_Glyph(g_src);
+	FT_Done_Glyph(g_fill);
+	FT_Done_Glyph(g_border);
+	FT_Done_Glyph(g_inner);
+
+	return true;
+}
+
+static bool add_rasterized_glyph(Glyph *glyph, RasterizedGlyph *rg) {
+	Pixmap *px = &rg->bitmap;
+
+	if(px->data.untyped == NULL) {
+		return true;
+	}
+
+	bool ok = add_glyph_to_spritesheets(glyph, px, &globals.spritesheets);
+
+	if(ok) {
+		glyph->sprite.padding.extent.w = rg->padding.w;
+		glyph->sprite.padding.extent.h = rg->padding.h;
+		glyph->sprite.padding.offset.x = -rg->padding.w;
+		glyph->sprite.padding.offset.y = -rg->padding.h;
+		glyph->sprite.extent.as_cmplx += glyph->sprite.padding.extent.as_cmplx;
+	} else {
+		log_error(
+			"Glyph %u fill can't fit into any spritesheets (padded bitmap size: %ux%u; max spritesheet size: %ux%u)",
+			rg->ft_index,
+			px->width + 2 * GLYPH_SPRITE_PADDING,
+			px->height + 2 * GLYPH_SPRITE_PADDING,
+			SS_WIDTH,
+			SS_HEIGHT
+		);
+	}
+
+	mem_free(px->data.untyped);
+	px->data.untyped = NULL;
+
+	return ok;
+}
+
+static Glyph *load_glyph(Font *font, FT_UInt gindex) {
+	RasterizedGlyph rg;
+
+	if(!rasterize_glyph(font, font->face, font->stroker, gindex, &rg)) {
+		return NULL;
+	}
 
-		// TODO: Only query this once on init.
-		if(r_texture_type_query(SS_TEXTURE_TYPE, SS_TEXTURE_FLAGS, px.format, px.origin, &qr)) {
-			pixmap_convert_inplace_realloc(&px, qr.optimal_pixmap_format);
-			pixmap_flip_to_origin_inplace(&px, qr.optimal_pixmap_origin);
+	Glyph *glyph = dynarray_append(&font->glyphs, {
+		.metrics = rg.metrics,
+		.ft_index = gindex,
+	});
+
+	if(!add_rasterized_glyph(glyph, &rg)) {
+		--font->glyphs.num_elements;
+		return NULL;
+	}
+
+	return glyph;
+}
+
+/*
+ * Asynchronous rasterization.
+ *
+ * Glyphs are rendered on worker threads, each with a face of its own, and the results are queued
+ * on the font. The main thread then only has to pack them into spritesheets, which it does within
+ * a per-frame time budget shared with any glyphs it still has to render synchronously. Glyphs that
+ * don't fit into the budget are laid out with their metrics right away, but drawn only once their
+ * bitmaps arrive, typically a frame or two later.
+ */
+
+#define GLYPH_RASTER_BATCH_SIZE 16
+
+typedef struct GlyphRasterTask {
+	Font *font;
+	float scale;
+	uint num_glyphs;
+	FT_UInt glyphs[];
+} GlyphRasterTask;
+
+static FT_Face acquire_worker_face(Font *font) {
+	FT_Face face = NULL;
+
+	SDL_LockMutex(font->raster.mutex);
+	if(font->raster.spare_faces.num_elements > 0) {
+		face = dynarray_get(&font->raster.spare_faces, font->raster.spare_faces.num_elements - 1);
+		--font->raster.spare_faces.num_elements;
+	}
+	SDL_UnlockMutex(font->raster.mutex);
+
+	if(face == NULL) {
+		face = load_font_face(font->source_path, font->base_face_idx);
+	}
+
+	return face;
+}
+
+static void release_worker_face(Font *font, FT_Face face) {
+	SDL_LockMutex(font->raster.mutex);
+	*dynarray_append(&font->raster.spare_faces) = face;
+	SDL_UnlockMutex(font->raster.mutex);
+}
+
+static void *glyph_raster_task(void *arg) {
+	GlyphRasterTask *task = arg;
+	Font *font = task->font;
+	FT_Face face = acquire_worker_face(font);
+	FT_Stroker stroker = NULL;
+	bool ready = false;
+
+	if(face && !set_face_size(face, font->base_size, task->scale)) {
+		FT_Error err = FT_Stroker_New(globals.lib, &stroker);
+
+		if(err) {
+			log_error("FT_Stroker_New() failed: %s", ft_error_str(err));
 		} else {
-			log_error("Texture query failed!");
-			assert(0);
+			ready = true;
 		}
+	}
 
-		if(!add_glyph_to_spritesheets(glyph, &px, spritesheets)) {
-			log_error(
-				"Glyph %u fill can't fit into any spritesheets (padded bitmap size: %ux%u; max spritesheet size: %ux%u)",
-				gindex,
-				px.width + 2 * GLYPH_SPRITE_PADDING,
-				px.height + 2 * GLYPH_SPRITE_PADDING,
-				SS_WIDTH,
-				SS_HEIGHT
-			);
+	// Failed glyphs are reported too; the main thread retries them with its own face.
+	for(uint i = 0; i < task->num_glyphs; ++i) {
+		RasterizedGlyph rg = { .ft_index = task->glyphs[i] };
+		rg.ok = ready && rasterize_glyph(font, face, stroker, task->glyphs[i], &rg);
 
-			mem_free(px.data.rg8);
-			FT_Done_Glyph(g_src);
-			FT_Done_Glyph(g_fill);
-			FT_Done_Glyph(g_border);
-			FT_Done_Glyph(g_inner);
-			--font->glyphs.num_elements;
-			return NULL;
+		SDL_LockMutex(font->raster.mutex);
+		*dynarray_append(&font->raster.results) = rg;
+		SDL_UnlockMutex(font->raster.mutex);
+	}
+
+	if(stroker) {
+		FT_Stroker_Done(stroker);
+	}
+
+	if(face) {
+		release_worker_face(font, face);
+	}
+
+	return NULL;
+}
+
+// The glyphs must be marked as queued by the caller.
+static void submit_glyph_raster_tasks(Font *font, uint num_glyphs, const FT_UInt glyphs[num_glyphs]) {
+	for(uint i = 0; i < num_glyphs; i += GLYPH_RASTER_BATCH_SIZE) {
+		uint n = min(GLYPH_RASTER_BATCH_SIZE, num_glyphs - i);
+		auto task = ALLOC_FLEX(GlyphRasterTask, n * sizeof(*glyphs));
+		task->font = font;
+		task->scale = font->metrics.scale;
+		task->num_glyphs = n;
+		memcpy(task->glyphs, glyphs + i, n * sizeof(*glyphs));
+
+		*dynarray_append(&font->raster.tasks) = taskmgr_global_submit((TaskParams) {
+			.callback = glyph_raster_task,
+			.userdata = task,
+			.userdata_free_callback = mem_free,
+		});
+	}
+}
+
+static bool glyph_raster_over_budget(void) {
+	if(globals.raster.no_defer) {
+		return false;
+	}
+
+	FrameTimes ft = eventloop_get_frame_times();
+
+	if(ft.target == 0) {
+		// Not in the main loop, there is no frame to stall.
+		return false;
+	}
+
+	if(ft.next != globals.raster.frame_threshold) {
+		globals.raster.frame_threshold = ft.next;
+		globals.raster.time_this_frame = 0;
+	}
+
+	hrtime_t budget = globals.raster.budget;
+
+	if(!budget) {
+		budget = ft.target / 4;
+	}
+
+	return globals.raster.time_this_frame >= budget;
+}
+
+static void commit_rasterized_glyph(Font *font, RasterizedGlyph *rg) {
+	FT_UInt gindex = rg->ft_index;
+	ht_unset(&font->raster.queued, gindex);
+
+	if(!rg->ok) {
+		rg->ok = rasterize_glyph(font, font->face, font->stroker, gindex, rg);
+	}
+
+	Glyph *glyph = NULL;
+	int64_t ofs;
+
+	if(ht_lookup(&font->ftindex_to_glyph_ofs, gindex, &ofs)) {
+		// Already laid out while the task was running
+		if(ofs >= 0) {
+			glyph = dynarray_get_ptr(&font->glyphs, ofs);
+			assert(glyph->pending);
+			glyph->pending = false;
 		}
+	} else if(rg->ok) {
+		glyph = dynarray_append(&font->glyphs, {
+			.metrics = rg->metrics,
+			.ft_index = gindex,
+		});
 
-		mem_free(px.data.rg8);
+		ht_set(&font->ftindex_to_glyph_ofs, gindex, dynarray_indexof(&font->glyphs, glyph));
+	} else {
+		ht_set(&font->ftindex_to_glyph_ofs, gindex, -1);
+	}
 
-		float xpad = px.width - g_bm_fill->bitmap.width;
-		float ypad = px.height - g_bm_fill->bitmap.rows;
-		glyph->sprite.padding.extent.w = xpad;
-		glyph->sprite.padding.extent.h = ypad;
-		glyph->sprite.padding.offset.x = -xpad;
-		glyph->sprite.padding.offset.y = -ypad;
-		glyph->sprite.extent.as_cmplx += glyph->sprite.padding.extent.as_cmplx;
+	if(glyph && rg->ok) {
+		add_rasterized_glyph(glyph, rg);
+	} else {
+		mem_free(rg->bitmap.data.untyped);
 	}
+}
 
-	FT_Done_Glyph(g_src);
-	FT_Done_Glyph(g_fill);
-	FT_Done_Glyph(g_border);
-	FT_Done_Glyph(g_inner);
+static bool filter_unfinished_tasks(const void *pelem, void *userdata) {
+	Task *task = *(Task *const*)pelem;
 
-	glyph->ft_index = gindex;
-	return glyph;
+	if(task_status(task) == TASK_FINISHED) {
+		task_detach(task);
+		return false;
+	}
+
+	return true;
+}
+
+static void commit_rasterized_glyphs(Font *font, bool budgeted) {
+	if(font->raster.tasks.num_elements > 0) {
+		dynarray_filter(&font->raster.tasks, filter_unfinished_tasks, NULL);
+	}
+
+	while(!budgeted || !glyph_raster_over_budget()) {
+		RasterizedGlyph rg;
+
+		SDL_LockMutex(font->raster.mutex);
+
+		if(font->raster.results.num_elements == 0) {
+			SDL_UnlockMutex(font->raster.mutex);
+			break;
+		}
+
+		rg = dynarray_get(&font->raster.results, font->raster.results.num_elements - 1);
+		--font->raster.results.num_elements;
+		SDL_UnlockMutex(font->raster.mutex);
+
+		hrtime_t t = time_get();
+		commit_rasterized_glyph(font, &rg);
+		globals.raster.time_this_frame += time_get() - t;
+	}
+}
+
+static void finish_glyph_raster_tasks(Font *font) {
+	dynarray_foreach_elem(&font->raster.tasks, Task **task, {
+		task_finish(*task, NULL);
+	});
+
+	font->raster.tasks.num_elements = 0;
+	commit_rasterized_glyphs(font, false);
+}
+
+static void cancel_glyph_raster_tasks(Font *font) {
+	dynarray_foreach_elem(&font->raster.tasks, Task **task, {
+		task_cancel(*task);
+		task_finish(*task, NULL);
+	});
+
+	font->raster.tasks.num_elements = 0;
+
+	dynarray_foreach_elem(&font->raster.results, RasterizedGlyph *rg, {
+		mem_free(rg->bitmap.data.untyped);
+	});
+
+	font->raster.results.num_elements = 0;
+	ht_unset_all(&font->raster.queued);
+}
+
+static Glyph *acquire_glyph(Font *font, FT_UInt gindex) {
+	bool queued = ht_get(&font->raster.queued, gindex, 0);
+
+	if(!queued && !glyph_raster_over_budget()) {
+		hrtime_t t = time_get();
+		Glyph *glyph = load_glyph(font, gindex);
+		globals.raster.time_this_frame += time_get() - t;
+		return glyph;
+	}
+
+	GlyphMetrics metrics;
+
+	if(!load_glyph_metrics(font->face, gindex, &metrics)) {
+		return NULL;
+	}
+
+	if(!queued) {
+		ht_set(&font->raster.queued, gindex, 1);
+		submit_glyph_raster_tasks(font, 1, &gindex);
+	}
+
+	return dynarray_append(&font->glyphs, {
+		.metrics = metrics,
+		.ft_index = gindex,
+		.pending = true,
+	});
+}
+
+void font_prewarm_text(Font *font, const char *text) {
+	DYNAMIC_ARRAY(FT_UInt) glyphs = { 0 };
+
+	while(*text) {
+		charcode_t cp = utf8_getch(&text);
+
+		if(cp == '\n') {
+			continue;
+		}
+
+		FT_UInt gindex = FT_Get_Char_Index(font->face, cp);
+
+		if(gindex == 0) {
+			gindex = FT_Get_Char_Index(font->face, UNICODE_UNKNOWN);
+		}
+
+		if(
+			ht_lookup(&font->ftindex_to_glyph_ofs, gindex, NULL) ||
+			ht_get(&font->raster.queued, gindex, 0)
+		) {
+			continue;
+		}
+
+		ht_set(&font->raster.queued, gindex, 1);
+		*dynarray_append(&glyphs) = gindex;
+	}
+
+	if(glyphs.num_elements > 0) {
+		submit_glyph_raster_tasks(font, glyphs.num_elements, glyphs.data);
+	}
+
+	dynarray_free_data(&glyphs);
 }
 
 static Glyph *get_glyph(Font *fnt, charcode_t cp) {
@@ -715,7 +1082,7 @@ static Glyph *get_glyph(Font *fnt, charcode_t cp) {
 			glyph = get_glyph(fnt, UNICODE_UNKNOWN);
 			ofs = glyph ? dynarray_indexof(&fnt->glyphs, glyph) : -1;
 		} else if(!ht_lookup(&fnt->ftindex_to_glyph_ofs, ft_index, &ofs)) {
-			glyph = load_glyph(fnt, ft_index, &globals.spritesheets);
+			glyph = acquire_glyph(fnt, ft_index);
 			ofs = glyph ? dynarray_indexof(&fnt->glyphs, glyph) : -1;
 			ht_set(&fnt->ftindex_to_glyph_ofs, ft_index, ofs);
 		}
@@ -728,6 +1095,8 @@ static Glyph *get_glyph(Font *fnt, charcode_t cp) {
 
 attr_nonnull(1)
 static void wipe_glyph_cache(Font *font) {
+	cancel_glyph_raster_tasks(font);
+
 	dynarray_foreach_elem(&font->glyphs, Glyph *g, {
 		SpriteSheet *ss = g->spritesheet;
 
@@ -753,27 +1122,30 @@ static void wipe_glyph_cache(Font *font) {
 }
 
 static void free_font_resources(Font *font) {
-	if(font->face) {
-		FT_Stream stream = font->face->stream;
-		FT_Done_Face_Thread_Safe(font->face);
+	wipe_glyph_cache(font);
 
-		if(stream) {
-			mem_free(stream->pathname.pointer);
-			mem_free(stream);
-		}
+	if(font->face) {
+		free_font_face(font->face);
 	}
 
+	dynarray_foreach_elem(&font->raster.spare_faces, FT_Face *face, {
+		free_font_face(*face);
+	});
+
 	if(font->stroker) {
 		FT_Stroker_Done(font->stroker);
 	}
 
-	wipe_glyph_cache(font);
-
 	ht_destroy(&font->charcodes_to_glyph_ofs);
 	ht_destroy(&font->ftindex_to_glyph_ofs);
+	ht_destroy(&font->raster.queued);
+	SDL_DestroyMutex(font->raster.mutex);
 
 	mem_free(font->source_path);
 	dynarray_free_data(&font->glyphs);
+	dynarray_free_data(&font->raster.spare_faces);
+	dynarray_free_data(&font->raster.results);
+	dynarray_free_data(&font->raster.tasks);
 }
 
 static void finish_reload(ResourceLoadState *st);
@@ -818,6 +1190,8 @@ void load_font(ResourceLoadState *st) {
 
 	ht_create(&font.charcodes_to_glyph_ofs);
 	ht_create(&font.ftindex_to_glyph_ofs);
+	ht_create(&font.raster.queued);
+	try_create_mutex(&font.raster.mutex);
 
 	if(!(font.face = load_font_face(font.source_path, font.base_face_idx))) {
 		free_font_resources(&font);
@@ -1146,6 +1520,8 @@ static float _text_ucs4_draw(Font *font, const uint32_t *ucs4text, const TextPar
 
 	batch_state_params.primary_texture = NULL;
 
+	commit_rasterized_glyphs(font, true);
+
 	TextBBox bbox;
 	float y = params->pos.y;
 	float scale = font->metrics.scale;
@@ -1321,6 +1697,10 @@ float text_draw_wrapped(const char *text, float max_width, const TextParams *par
 }
 
 void text_render(const char *text, Font *font, Sprite *out_sprite, TextBBox *out_bbox) {
+	// The result is persistent, so no glyph may be left for a later frame.
+	finish_glyph_raster_tasks(font);
+	++globals.raster.no_defer;
+
 	text_bbox(font, text, 0, out_bbox);
 
 	float bbox_width = out_bbox->x.max - out_bbox->x.min;
@@ -1385,6 +1765,7 @@ void text_render(const char *text, Font *font, Sprite *out_sprite, TextBBox *out
 	});
 
 	font->metrics.scale = fontscale;
+	--globals.raster.no_defer;
 	r_flush_sprites();
 
 	r_mat_tex_pop();
@@ -1504,6 +1885,7 @@ const GlyphMetrics *font_get_char_metrics(Font *font, charcode_t c) {
 static bool transfer_font(void *dst, void *src) {
 	auto dfont = CASTPTR_ASSUME_ALIGNED(dst, Font);
 	auto sfont = CASTPTR_ASSUME_ALIGNED(src, Font);
+	assert(sfont->raster.tasks.num_elements == 0);
 	free_font_resources(dfont);
 	*dfont = *sfont;
 	mem_free(sfont);
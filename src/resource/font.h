@@ -92,6 +92,9 @@ float font_get_lineskip(Font *font) attr_nonnull(1);
 
 const GlyphMetrics *font_get_char_metrics(Font *font, charcode_t c) attr_nonnull(1);
 
+// Starts rendering the glyphs of [text] on worker threads, so that drawing it later won't stall.
+void font_prewarm_text(Font *font, const char *text) attr_nonnull(1, 2);
+
 float text_draw(const char *text, const TextParams *params) attr_nonnull(1, 2);
 float text_ucs4_draw(const uint32_t *text, const TextParams *params) attr_nonnull(1, 2);
 
@@ -141,6 +141,10 @@ struct InternalResource {
 	// For simplicity of implementation, this is a counted set (a multiset)
 	ht_ires_counted_set_t dependents;
 
+	// Async loads that are waiting for this resource to finish loading before they can continue.
+	// See schedule_after_dependencies.
+	DYNAMIC_ARRAY(InternalResLoadState*) load_waiters;
+
 #if DEBUG_LOCKS
 	SDL_atomic_t num_locks;
 #endif
@@ -153,6 +157,16 @@ struct InternalResLoadState {
 	ResourceLoadProc continuation;
 	LoadStatus status;
 	bool ready_to_finalize;
+
+	// Number of dependencies this load is waiting for, plus one while they are being registered
+	SDL_atomic_t pending_deps;
+
+	// In SDL performance counter ticks
+	struct {
+		uint64_t start;
+		uint64_t worker;  // time spent in load procs off the main thread
+		uint64_t main;    // time spent in load procs on the main thread
+	} timing;
 };
 
 typedef struct FileWatchHandlerData {
@@ -161,12 +175,14 @@ typedef struct FileWatchHandlerData {
 
 static struct {
 	hrtime_t frame_threshold;
+	hrtime_t finalize_time_this_frame;
 	uchar loaded_this_frame : 1;
 	struct {
 		uchar no_async_load : 1;
 		uchar no_preload : 1;
 		uchar no_unload : 1;
 		uchar preload_required : 1;
+		hrtime_t finalize_budget;
 	} env;
 	InternalResource *ires_freelist;
 	SDL_SpinLock ires_freelist_lock;
@@ -365,9 +381,11 @@ static void ires_free_meta(InternalResource *ires) {
 	assert(ires->load == NULL);
 	assert(ires->watched_paths.num_elements == 0);
 	assert(ires->dependents.num_elements_occupied == 0);
+	assert(ires->load_waiters.num_elements == 0);
 
 	dynarray_free_data(&ires->watched_paths);
 	dynarray_free_data(&ires->dependencies);
+	dynarray_free_data(&ires->load_waiters);
 	ht_ires_counted_set_destroy(&ires->dependents);
 }
 
@@ -444,6 +462,28 @@ static inline const char *loadstatus_name(LoadStatus status) {
 	LOAD_DBG("%p now ready to finalize", _a_st->ires); \
 })
 
+#define PROTECT_FLAGS(ist, ...) do { \
+	attr_unused InternalResLoadState *_ist = (ist); \
+	attr_unused ResourceFlags _orig_flags = _ist->st.flags; \
+	{ __VA_ARGS__; } \
+	assert(_ist->st.flags == _orig_flags); \
+} while(0)
+
+// Calls a load or continuation proc, which must set a new status.
+static void lstate_run_proc(InternalResLoadState *st, ResourceLoadProc proc) {
+	lstate_set_status(st, LOAD_NONE);
+
+	uint64_t t = SDL_GetPerformanceCounter();
+	PROTECT_FLAGS(st, proc(&st->st));
+	t = SDL_GetPerformanceCounter() - t;
+
+	if(thread_current_is_main()) {
+		st->timing.main += t;
+	} else {
+		st->timing.worker += t;
+	}
+}
+
 void res_load_failed(ResourceLoadState *st) {
 	InternalResLoadState *ist = loadstate_internal(st);
 	lstate_set_status(ist, LOAD_FAILED);
@@ -834,6 +874,8 @@ static bool try_begin_load_resource(ResourceType type, const char *name, hash_t
 static void load_resource_finish(InternalResLoadState *st);
 
 static ResourceStatus pump_or_wait_for_dependencies(InternalResLoadState *st, bool pump_only);
+static bool lstate_try_unpark(InternalResLoadState *st);
+static void load_resource_continue_unparked(InternalResLoadState *st);
 
 static ResourceStatus pump_dependencies(InternalResLoadState *st) {
 	return pump_or_wait_for_dependencies(st, true);
@@ -890,24 +932,29 @@ static ResourceStatus pump_or_wait_for_resource_load_nolock(
 		}
 
 		if(load_state) {
-			ResourceStatus dep_status = pump_dependencies(load_state);
+			pump_dependencies(load_state);
 
 			if(!pump_only && thread_current_is_main()) {
 				InternalResource *persistent = ires_get_persistent(ires);
 
-				if(dep_status == RES_STATUS_LOADING) {
-					wait_for_dependencies(load_state);
+				// The async task may have returned while the load is parked waiting for its
+				// dependencies (see schedule_after_dependencies), or a worker may be resuming it.
+				// ires->load must be re-read after every wait: the worker frees it if it finishes
+				// the load by itself.
+				while((load_state = ires->load) && !load_state->ready_to_finalize) {
+					if(lstate_try_unpark(load_state)) {
+						// Nothing else will resume it now; finishes and frees the load
+						load_resource_continue_unparked(load_state);
+					} else {
+						ires_cond_wait(ires);
+					}
 				}
 
-				while(!load_state->ready_to_finalize) {
-					ires_cond_wait(ires);
-				}
-
-				// May have been finalized while we were sleeping
-				// Can happen if load fails
-				load_state = ires->load;
-
 				if(load_state) {
+					if(pump_dependencies(load_state) == RES_STATUS_LOADING) {
+						wait_for_dependencies(load_state);
+					}
+
 					load_resource_finish(load_state);
 				}
 
@@ -1005,24 +1052,115 @@ static ResourceStatus pump_or_wait_for_dependencies(InternalResLoadState *st, bo
 	return dep_status;
 }
 
-#define PROTECT_FLAGS(ist, ...) do { \
-	attr_unused InternalResLoadState *_ist = (ist); \
-	attr_unused ResourceFlags _orig_flags = _ist->st.flags; \
-	{ __VA_ARGS__; } \
-	assert(_ist->st.flags == _orig_flags); \
-} while(0)
+static void *load_resource_resume_task(void *vdata);
 
-static void *load_resource_async_task(void *vdata) {
-	InternalResLoadState *st = vdata;
+// Registers st with every dependency that's still loading, so that the last one to finish can
+// resume this load in a new task, instead of having a worker block on them.
+// Returns true if there is nothing to wait for, in which case the caller should continue the
+// load itself.
+//
+// While parked, st->pending_deps is positive. It's only set up and torn down with ires locked,
+// so that lstate_try_unpark() can tell a parked load from one that's running.
+static bool schedule_after_dependencies(InternalResLoadState *st) {
 	InternalResource *ires = st->ires;
-	assume(st == ires->load);
 
-	LOAD_DBG("BEGIN:\t\tires = %p\t\tst = %p", ires, st);
+	ires_lock(ires);
+	SDL_AtomicSet(&st->pending_deps, 1);
 
-	ResourceHandler *h = get_ires_handler(ires);
+	dynarray_foreach_elem(&ires->dependencies, InternalResource **pdep, {
+		InternalResource *dep = *pdep;
+		ires_lock(dep);
 
-	lstate_set_status(st, LOAD_NONE);
-	PROTECT_FLAGS(st, h->procs.load(&st->st));
+		if(dep->status == RES_STATUS_LOADING) {
+			dynarray_append(&dep->load_waiters, st);
+			SDL_AtomicIncRef(&st->pending_deps);
+		}
+
+		ires_unlock(dep);
+	});
+
+	bool ready = SDL_AtomicDecRef(&st->pending_deps);
+
+	if(!ready) {
+		// Someone on the main thread may be waiting to take over a parked load
+		ires_cond_broadcast(ires);
+	}
+
+	ires_unlock(ires);
+	return ready;
+}
+
+// Takes over a load parked in schedule_after_dependencies, so that its dependencies won't resume
+// it anymore. Must be called with st->ires locked. Returns false if the load isn't parked; it's
+// either running on a worker then, or about to be.
+static bool lstate_try_unpark(InternalResLoadState *st) {
+	for(;;) {
+		int pending = SDL_AtomicGet(&st->pending_deps);
+
+		if(pending < 1) {
+			return false;
+		}
+
+		// Holding an extra count keeps the last dependency from submitting the resume task
+		if(SDL_AtomicCAS(&st->pending_deps, pending, pending + 1)) {
+			return true;
+		}
+	}
+}
+
+// Finishes a load taken over with lstate_try_unpark() on the current thread, the same way
+// load_resource() does for synchronous loads. Must be called with st->ires locked.
+static void load_resource_continue_unparked(InternalResLoadState *st) {
+	// Wait for each one even if some fail, so that they've all notified us afterwards
+	dynarray_foreach_elem(&st->ires->dependencies, InternalResource **dep, {
+		wait_for_resource_load(*dep, st->st.flags);
+	});
+
+	attr_unused bool last = SDL_AtomicDecRef(&st->pending_deps);
+	assert(last);
+
+	retry: switch(st->status) {
+		case LOAD_OK:
+		case LOAD_FAILED:
+			lstate_set_ready_to_finalize(st);
+			load_resource_finish(st);
+			break;
+		case LOAD_CONT:
+		case LOAD_CONT_ON_MAIN:
+			lstate_run_proc(st, st->continuation);
+
+			if(st->status == LOAD_CONT || st->status == LOAD_CONT_ON_MAIN) {
+				wait_for_dependencies(st);
+			}
+
+			goto retry;
+		default: UNREACHABLE;
+	}
+}
+
+// Called with ires locked, once it's no longer loading.
+// The waiters must not be locked here: their owners may be holding them while waiting for ires.
+static void ires_notify_load_waiters(InternalResource *ires) {
+	dynarray_foreach_elem(&ires->load_waiters, InternalResLoadState **pst, {
+		InternalResLoadState *st = *pst;
+
+		if(SDL_AtomicDecRef(&st->pending_deps)) {
+			LOAD_DBG("%p resuming %p", ires, st->ires);
+			task_detach(taskmgr_global_submit((TaskParams) { load_resource_resume_task, st }));
+		}
+	});
+
+	ires->load_waiters.num_elements = 0;
+}
+
+// Reloads still go through the old blocking path, because they may have to wait for new versions
+// of the dependencies rather than just the loaded ones.
+INLINE bool can_schedule_after_dependencies(InternalResLoadState *st) {
+	return !(st->st.flags & RESF_RELOAD) && !thread_current_is_main();
+}
+
+static void load_resource_async_step(InternalResLoadState *st) {
+	InternalResource *ires = st->ires;
 
 retry:
 	LOAD_DBG("st->status == %s", loadstatus_name(st->status));
@@ -1030,28 +1168,36 @@ static void *load_resource_async_task(void *vdata) {
 		case LOAD_CONT: {
 			ResourceStatus dep_status;
 
-			if(thread_current_is_main()) {
+			if(can_schedule_after_dependencies(st)) {
+				if(!schedule_after_dependencies(st)) {
+					// resumed by the last dependency to finish
+					break;
+				}
+
+				lstate_run_proc(st, st->continuation);
+				goto retry;
+			} else if(thread_current_is_main()) {
 				dep_status = pump_dependencies(st);
 
 				if(dep_status == RES_STATUS_LOADING) {
 					dep_status = wait_for_dependencies(st);
 				}
 
-				lstate_set_status(st, LOAD_NONE);
-				PROTECT_FLAGS(st, st->continuation(&st->st));
+				lstate_run_proc(st, st->continuation);
 				goto retry;
 			} else {
 				dep_status = pump_dependencies(st);
 
 				if(dep_status == RES_STATUS_LOADING) {
 					lstate_set_status(st, LOAD_CONT_ON_MAIN);
+					ires_lock(ires);
 					lstate_set_ready_to_finalize(st);
 					ires_cond_broadcast(ires);
+					ires_unlock(ires);
 					events_emit(TE_RESOURCE_ASYNC_LOADED, 0, ires, (void*)(uintptr_t)ires->generation_id);
 					break;
 				} else {
-					lstate_set_status(st, LOAD_NONE);
-					PROTECT_FLAGS(st, st->continuation(&st->st));
+					lstate_run_proc(st, st->continuation);
 					goto retry;
 				}
 			}
@@ -1060,9 +1206,16 @@ static void *load_resource_async_task(void *vdata) {
 		}
 
 		case LOAD_CONT_ON_MAIN:
+			if(can_schedule_after_dependencies(st) && !schedule_after_dependencies(st)) {
+				// Don't bother the main thread until all dependencies are there
+				break;
+			}
+
 			if(pump_dependencies(st) == RES_STATUS_LOADING || !thread_current_is_main()) {
+				ires_lock(ires);
 				lstate_set_ready_to_finalize(st);
 				ires_cond_broadcast(ires);
+				ires_unlock(ires);
 				events_emit(TE_RESOURCE_ASYNC_LOADED, 0, ires, (void*)(uintptr_t)ires->generation_id);
 				// fun fact: in some rare cases, the main thread manages to finalize the load
 				// before this function even returns.
@@ -1080,8 +1233,27 @@ static void *load_resource_async_task(void *vdata) {
 		default:
 			UNREACHABLE;
 	}
+}
+
+static void *load_resource_async_task(void *vdata) {
+	InternalResLoadState *st = vdata;
+	InternalResource *ires = st->ires;
+	assume(st == ires->load);
 
-	LOAD_DBG("  END:\t\tires = %p\t\tst = %p", ires, st);
+	LOAD_DBG("BEGIN:\t\tires = %p\t\tst = %p", ires, st);
+
+	lstate_run_proc(st, get_ires_handler(ires)->procs.load);
+	load_resource_async_step(st);
+
+	// NOTE: st may be gone at this point
+	LOAD_DBG("  END:\t\tires = %p", ires);
+	return NULL;
+}
+
+static void *load_resource_resume_task(void *vdata) {
+	InternalResLoadState *st = vdata;
+	LOAD_DBG("RESUME:\t\tires = %p\t\tst = %p", st->ires, st);
+	load_resource_async_step(st);
 	return NULL;
 }
 
@@ -1147,25 +1319,25 @@ static bool should_defer_load(InternalResLoadState *st) {
 	}
 
 	FrameTimes ft = eventloop_get_frame_times();
-	shrtime_t tnext = ft.start + ft.target;
-	shrtime_t tmin = ft.target / 2;
 
 	if(ft.next != res_gstate.frame_threshold) {
 		res_gstate.frame_threshold = ft.next;
+		res_gstate.finalize_time_this_frame = 0;
 		res_gstate.loaded_this_frame = false;
 	}
 
+	// Always finalize at least one resource per frame, so that we never stall completely
 	if(!res_gstate.loaded_this_frame) {
 		return false;
 	}
 
-	shrtime_t t = time_get();
+	hrtime_t budget = res_gstate.env.finalize_budget;
 
-	if(tnext - t < tmin) {
-		return true;
+	if(!budget) {
+		budget = ft.target / 2;
 	}
 
-	return false;
+	return res_gstate.finalize_time_this_frame >= budget;
 }
 
 static bool resource_asyncload_handler(SDL_Event *evt, void *arg) {
@@ -1215,7 +1387,9 @@ static bool resource_asyncload_handler(SDL_Event *evt, void *arg) {
 	}
 
 	if(st) {
+		hrtime_t t = time_get();
 		load_resource_finish(ires->load);
+		res_gstate.finalize_time_this_frame += time_get() - t;
 		res_gstate.loaded_this_frame = true;
 	}
 
@@ -1283,6 +1457,7 @@ static void load_resource(
 			.path = path,
 			.flags = flags,
 		},
+		.timing.start = SDL_GetPerformanceCounter(),
 	};
 
 	if(ires->status == RES_STATUS_FAILED) {
@@ -1295,8 +1470,7 @@ static void load_resource(
 		if(async) {
 			load_resource_async(&st);
 		} else {
-			lstate_set_status(&st, LOAD_NONE);
-			PROTECT_FLAGS(&st, handler->procs.load(&st.st));
+			lstate_run_proc(&st, handler->procs.load);
 
 			retry: switch(st.status) {
 				case LOAD_OK:
@@ -1307,8 +1481,7 @@ static void load_resource(
 				case LOAD_CONT:
 				case LOAD_CONT_ON_MAIN:
 					wait_for_dependencies(&st);
-					lstate_set_status(&st, LOAD_NONE);
-					PROTECT_FLAGS(&st, st.continuation(&st.st));
+					lstate_run_proc(&st, st.continuation);
 					goto retry;
 				default: UNREACHABLE;
 			}
@@ -1385,8 +1558,7 @@ static void load_resource_finish(InternalResLoadState *st) {
 		retry: switch(st->status) {
 			case LOAD_CONT:
 			case LOAD_CONT_ON_MAIN:
-				lstate_set_status(st, LOAD_NONE);
-				st->continuation(&st->st);
+				lstate_run_proc(st, st->continuation);
 				goto retry;
 
 			case LOAD_OK:
@@ -1419,7 +1591,14 @@ static void load_resource_finish(InternalResLoadState *st) {
 
 	if(success) {
 		ires->status = RES_STATUS_LOADED;
-		log_info("Loaded %s '%s' from '%s'", typename, name, source);
+
+		double ticks_per_ms = SDL_GetPerformanceFrequency() / 1000.0;
+		log_info("Loaded %s '%s' from '%s' in %.2f ms (%.2f ms on workers, %.2f ms on main)",
+			typename, name, source,
+			(SDL_GetPerformanceCounter() - st->timing.start) / ticks_per_ms,
+			st->timing.worker / ticks_per_ms,
+			st->timing.main / ticks_per_ms
+		);
 	} else {
 		ires->status = RES_STATUS_FAILED;
 
@@ -1448,6 +1627,7 @@ static void load_resource_finish(InternalResLoadState *st) {
 
 	ires_cond_broadcast(ires);
 	assert(ires->status != RES_STATUS_LOADING);
+	ires_notify_load_waiters(ires);
 
 	// If we are reloading, ires points to a transient resource that will be copied into the
 	// persistent version at the end of this function.
@@ -1621,6 +1801,9 @@ static bool resource_filewatch_handler(SDL_Event *e, void *a) {
 	FileWatch *watch = NOT_NULL(e->user.data1);
 	FileWatchEvent fevent = e->user.code;
 
+	// Files may have appeared or disappeared; don't trust cached VFS lookups
+	vfs_invalidate_caches();
+
 	get_ires_list_for_watch(watch, &hdata->temp_ires_array);
 	dynarray_foreach_elem(&hdata->temp_ires_array, InternalResource **pires, {
 		InternalResource *ires = *pires;
@@ -1660,15 +1843,34 @@ static bool resource_filewatch_handler(SDL_Event *e, void *a) {
 	return false;
 }
 
+static void *prewarm_vfs_task(void *arg) {
+	int num_paths = vfs_union_prewarm("res");
+
+	if(num_paths < 0) {
+		log_debug("Not prewarming the VFS: %s", vfs_get_error());
+	} else {
+		log_debug("Cached lookups of %i resource paths", num_paths);
+	}
+
+	return NULL;
+}
+
 void res_init(void) {
 	res_gstate.env.no_async_load = env_get("TAISEI_NOASYNC", false);
 	res_gstate.env.no_preload = env_get("TAISEI_NOPRELOAD", false);
 	res_gstate.env.no_unload = env_get("TAISEI_NOUNLOAD", false);
 	res_gstate.env.preload_required = env_get("TAISEI_PRELOAD_REQUIRED", false);
+	res_gstate.env.finalize_budget = max(0, env_get("TAISEI_RES_FINALIZE_BUDGET", 0.0)) * (HRTIME_RESOLUTION / 1000);
 
 	ht_watch2iresset_create(&res_gstate.watch_to_iresset);
 	res_group_init(&res_gstate.default_group);
 
+	if(!res_gstate.env.no_async_load && env_get("TAISEI_RES_PREWARM_VFS", true)) {
+		task_detach(taskmgr_global_submit((TaskParams) {
+			.callback = prewarm_vfs_task,
+		}));
+	}
+
 	for(int i = 0; i < RES_NUMTYPES; ++i) {
 		ResourceHandler *h = get_handler(i);
 		alloc_handler(h);
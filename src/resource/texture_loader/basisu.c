@@ -371,6 +371,7 @@ static PixmapFormat texture_loader_basisu_pick_and_apply_compressed_format(
 
 struct basisu_load_data {
 	char *filebuf;
+	SDL_RWops *mapped_file;
 	basist_transcoder *tc;
 	uint mip_bias;
 	PixmapFormat px_decode_format;
@@ -392,6 +393,11 @@ static void texture_loader_basisu_cleanup(struct basisu_load_data *bld) {
 
 	mem_free(bld->filebuf);
 	bld->filebuf = NULL;
+
+	if(bld->mapped_file) {
+		SDL_RWclose(bld->mapped_file);
+		bld->mapped_file = NULL;
+	}
 }
 
 static void texture_loader_basisu_failed(TextureLoadData *ld, struct basisu_load_data *bld) {
@@ -399,9 +405,19 @@ static void texture_loader_basisu_failed(TextureLoadData *ld, struct basisu_load
 	texture_loader_failed(ld);
 }
 
-static char *read_basis_file(SDL_RWops *rw, size_t *file_size, size_t hash_size, char hash[hash_size]) {
+static void finish_basis_hash(SHA256State *sha256, size_t file_size, size_t hash_size, char hash[hash_size]) {
 	assert(hash_size >= BASISU_HASH_SIZE);
 
+	uint8_t raw_hash[SHA256_BLOCK_SIZE];
+	sha256_final(sha256, raw_hash, sizeof(raw_hash));
+	sha256_free(sha256);
+	hexdigest(raw_hash, sizeof(raw_hash), hash, hash_size);
+
+	assert(hash[SHA256_HEXDIGEST_SIZE - 1] == 0);
+	snprintf(&hash[SHA256_HEXDIGEST_SIZE - 1], BASISU_HASH_SIZE - SHA256_HEXDIGEST_SIZE, "-%zx", file_size);
+}
+
+static char *read_basis_file(SDL_RWops *rw, size_t *file_size, size_t hash_size, char hash[hash_size]) {
 	SHA256State *sha256 = sha256_new();
 	rw = SDL_RWWrapSHA256(rw, sha256, false);
 	char *buf = NULL;
@@ -417,17 +433,16 @@ static char *read_basis_file(SDL_RWops *rw, size_t *file_size, size_t hash_size,
 		return NULL;
 	}
 
-	uint8_t raw_hash[SHA256_BLOCK_SIZE];
-	sha256_final(sha256, raw_hash, sizeof(raw_hash));
-	sha256_free(sha256);
-	hexdigest(raw_hash, sizeof(raw_hash), hash, hash_size);
-
-	assert(hash[SHA256_HEXDIGEST_SIZE - 1] == 0);
-	snprintf(&hash[SHA256_HEXDIGEST_SIZE - 1], BASISU_HASH_SIZE - SHA256_HEXDIGEST_SIZE, "-%zx", *file_size);
-
+	finish_basis_hash(sha256, *file_size, hash_size, hash);
 	return buf;
 }
 
+static void hash_mapped_basis_file(const void *data, size_t size, size_t hash_size, char hash[hash_size]) {
+	SHA256State *sha256 = sha256_new();
+	sha256_update(sha256, data, size);
+	finish_basis_hash(sha256, size, hash_size, hash);
+}
+
 static void texture_loader_basisu_set_swizzle(TextureLoadData *ld, PixmapFormat fmt, uint32_t taisei_meta) {
 	PixmapLayout channels = pixmap_format_layout(fmt);
 
@@ -656,6 +671,35 @@ static bool texture_loader_basisu_init_mipmaps(
 	return true;
 }
 
+static bool texture_loader_basisu_transcode_level(
+	const char *ctx,
+	struct basisu_load_data *bld,
+	basist_transcode_level_params *parm,
+	const basist_image_level_desc *level_desc,
+	uint32_t num_blocks,
+	uint32_t data_size,
+	Pixmap *out_pixmap
+) {
+	if(!bld->transcoding_started) {
+		TRY_BOOL(basist_transcoder_start_transcoding, bld->tc);
+		bld->transcoding_started = true;
+	}
+
+	out_pixmap->data_size = data_size;
+	out_pixmap->data.untyped = mem_alloc(out_pixmap->data_size);
+	parm->output_blocks = out_pixmap->data.untyped;
+	parm->output_blocks_size = num_blocks;
+
+	TRY_BOOL(basist_transcoder_transcode_image_level, bld->tc, parm);
+
+	out_pixmap->format = bld->px_decode_format;
+	out_pixmap->width = level_desc->orig_width;
+	out_pixmap->height = level_desc->orig_height;
+	out_pixmap->origin = bld->px_origin;
+
+	return true;
+}
+
 static bool texture_loader_basisu_load_pixmap(
 	const char *ctx,
 	struct basisu_load_data *bld,
@@ -695,23 +739,14 @@ static bool texture_loader_basisu_load_pixmap(
 		data_size,
 		out_pixmap
 	)) {
-		if(!bld->transcoding_started) {
-			TRY_BOOL(basist_transcoder_start_transcoding, bld->tc);
-			bld->transcoding_started = true;
+		if(!texture_loader_basisu_transcode_level(
+			ctx, bld, parm, &level_desc, size_info.num_blocks, data_size, out_pixmap
+		)) {
+			// Let anyone waiting for this entry transcode it themselves
+			texture_loader_basisu_cache_abandon(bld->basis_hash, parm);
+			return false;
 		}
 
-		out_pixmap->data_size = data_size;
-		out_pixmap->data.untyped = mem_alloc(out_pixmap->data_size);
-		parm->output_blocks = out_pixmap->data.untyped;
-		parm->output_blocks_size = size_info.num_blocks;
-
-		TRY_BOOL(basist_transcoder_transcode_image_level, bld->tc, parm);
-
-		out_pixmap->format = bld->px_decode_format;
-		out_pixmap->width = level_desc.orig_width;
-		out_pixmap->height = level_desc.orig_height;
-		out_pixmap->origin = bld->px_origin;
-
 		texture_loader_basisu_cache(bld->basis_hash, parm, &level_desc, out_pixmap);
 	}
 
@@ -745,7 +780,7 @@ void texture_loader_basisu(TextureLoadData *ld) {
 	const char *ctx = ld->st->name;
 	const char *basis_file = ld->src_paths.main;
 
-	SDL_RWops *rw_in = res_open_file(ld->st, basis_file, VFS_MODE_READ);
+	SDL_RWops *rw_in = res_open_file(ld->st, basis_file, VFS_MODE_READ | VFS_MODE_MAPPED);
 
 	if(!UNLIKELY(rw_in)) {
 		log_error("%s: VFS error: %s", ctx, vfs_get_error());
@@ -754,18 +789,26 @@ void texture_loader_basisu(TextureLoadData *ld) {
 	}
 
 	size_t filesize;
-	bld.filebuf = read_basis_file(rw_in, &filesize, sizeof(bld.basis_hash), bld.basis_hash);
-	SDL_RWclose(rw_in);
+	char *filedata = (char*)vfs_stream_mapped_data(rw_in, &filesize);
 
-	if(UNLIKELY(!bld.filebuf)) {
-		log_error("%s: Read error: %s", basis_file, SDL_GetError());
-		texture_loader_basisu_failed(ld, &bld);
-		return;
+	if(filedata) {
+		// The transcoder reads straight from the mapping; keep it around until cleanup
+		bld.mapped_file = rw_in;
+		hash_mapped_basis_file(filedata, filesize, sizeof(bld.basis_hash), bld.basis_hash);
+	} else {
+		filedata = bld.filebuf = read_basis_file(rw_in, &filesize, sizeof(bld.basis_hash), bld.basis_hash);
+		SDL_RWclose(rw_in);
+
+		if(UNLIKELY(!bld.filebuf)) {
+			log_error("%s: Read error: %s", basis_file, SDL_GetError());
+			texture_loader_basisu_failed(ld, &bld);
+			return;
+		}
 	}
 
 	assert(!basist_transcoder_get_ready_to_transcode(bld.tc));
 
-	basist_transcoder_set_data(bld.tc, (basist_data) { .data = bld.filebuf, .size = filesize });
+	basist_transcoder_set_data(bld.tc, (basist_data) { .data = filedata, .size = filesize });
 	log_info("%s: Loaded Basis Universal data from %s", ctx, basis_file);
 
 	basist_file_info file_info = { 0 };
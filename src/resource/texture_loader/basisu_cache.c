@@ -11,17 +11,303 @@
 #include "basisu_cache.h"
 #include "pixmap/pixmap.h"
 #include "rwops/rwops_zstd.h"
+#include "taskmanager.h"
+#include "util.h"
 
 #include <basisu_transcoder_c_api.h>
+#include <time.h>
 
-// FIXME: The cache is not atomic.
-// This may be a problem if multiple threads are loading identical .basis files,
-// or if multiple Taisei instances are running for some reason.
+/*
+ * Entries are written to a temporary file next to their final path and then renamed into place,
+ * so that readers never see a partial entry, not even from another process. The contents are
+ * covered by the CRC32 of the internal pixmap format; entries that fail to load are deleted.
+ *
+ * Within one process, only one thread transcodes any given entry at a time. Other threads that
+ * look it up in the meantime wait for it to be written, instead of duplicating the work.
+ *
+ * Modification times double as last use times, and are refreshed on cache hits. Once the total
+ * size exceeds TAISEI_BASISU_CACHE_MAX_SIZE, a background task deletes the least recently used
+ * entries.
+ */
 
 enum {
 	ENTRY_PATH_SIZE = 256,
+	TEMP_PATH_SIZE = ENTRY_PATH_SIZE + 32,
+
+	// In seconds
+	TOUCH_INTERVAL = 60 * 60,
+	STALE_TEMP_FILE_AGE = 60 * 60,
 };
 
+#define CACHE_ROOT "cache/textures"
+#define CACHE_DIR_PREFIX "basisu-"
+#define TEMP_FILE_INFIX ".tmp-"
+
+// Check the total size again after writing this fraction of the limit
+#define EVICTION_CHECK_FRACTION 8
+
+// Evict a bit more than necessary, so that this doesn't have to run again right away
+#define EVICTION_TARGET(limit) ((limit) / 8 * 7)
+
+typedef struct PendingEntry {
+	SDL_cond *cond;
+	uint waiters;
+	bool done;
+} PendingEntry;
+
+static struct {
+	SDL_mutex *mutex;
+	ht_str2ptr_t pending;  // entry path -> PendingEntry; entries being transcoded right now
+	uint64_t size_limit;
+	uint64_t instance_token;
+	SDL_atomic_t temp_counter;
+	SDL_atomic_t kib_since_eviction;
+	SDL_atomic_t eviction_running;
+	bool initialized;
+} cache;
+
+typedef struct CacheFile {
+	char *path;
+	uint64_t size;
+	int64_t mtime;
+	uint dir_index;
+} CacheFile;
+
+typedef struct CacheDir {
+	char *path;
+	uint num_files;
+} CacheDir;
+
+static int cache_file_compare_mtime(const void *pa, const void *pb) {
+	const CacheFile *a = pa, *b = pb;
+	return (a->mtime > b->mtime) - (a->mtime < b->mtime);
+}
+
+static void texture_loader_basisu_scan_cache_dir(
+	CacheDir *dir,
+	uint dir_index,
+	int64_t now,
+	void *files_darr,
+	uint64_t *total_size
+) {
+	DYNAMIC_ARRAY(CacheFile) *files = files_darr;
+	VFSDir *vdir = vfs_dir_open(dir->path);
+
+	if(!vdir) {
+		return;
+	}
+
+	for(const char *name; (name = vfs_dir_read(vdir));) {
+		char *path = strfmt("%s/%s", dir->path, name);
+		VFSInfo i = vfs_query(path);
+
+		if(!i.exists || i.is_dir) {
+			mem_free(path);
+			continue;
+		}
+
+		if(strstr(name, TEMP_FILE_INFIX)) {
+			// Probably left behind by a crashed instance; a recent one may still be in use
+			if(now - i.mtime > STALE_TEMP_FILE_AGE) {
+				vfs_unlink(path);
+			}
+
+			mem_free(path);
+			continue;
+		}
+
+		*dynarray_append(files) = (CacheFile) {
+			.path = path,
+			.size = i.size,
+			.mtime = i.mtime,
+			.dir_index = dir_index,
+		};
+
+		*total_size += i.size;
+		++dir->num_files;
+	}
+
+	vfs_dir_close(vdir);
+}
+
+static void *texture_loader_basisu_evict_task(void *arg) {
+	DYNAMIC_ARRAY(CacheDir) dirs = { 0 };
+	DYNAMIC_ARRAY(CacheFile) files = { 0 };
+	uint64_t total_size = 0;
+	int64_t now = time(NULL);
+
+	VFSDir *root = vfs_dir_open(CACHE_ROOT);
+
+	if(root) {
+		for(const char *name; (name = vfs_dir_read(root));) {
+			if(strstartswith(name, CACHE_DIR_PREFIX)) {
+				*dynarray_append(&dirs) = (CacheDir) { .path = strfmt(CACHE_ROOT "/%s", name) };
+			}
+		}
+
+		vfs_dir_close(root);
+	}
+
+	dynarray_foreach(&dirs, uint i, CacheDir *dir, {
+		texture_loader_basisu_scan_cache_dir(dir, i, now, &files, &total_size);
+	});
+
+	if(total_size > cache.size_limit) {
+		uint64_t target_size = EVICTION_TARGET(cache.size_limit);
+		uint64_t initial_size = total_size;
+		uint num_evicted = 0;
+
+		dynarray_qsort(&files, cache_file_compare_mtime);
+
+		dynarray_foreach_elem(&files, CacheFile *f, {
+			if(total_size <= target_size) {
+				break;
+			}
+
+			if(vfs_unlink(f->path)) {
+				total_size -= f->size;
+				++num_evicted;
+
+				CacheDir *dir = dynarray_get_ptr(&dirs, f->dir_index);
+
+				if(--dir->num_files == 0) {
+					vfs_unlink(dir->path);
+				}
+			}
+		});
+
+		log_info("Evicted %u Basis Universal cache entries (%"PRIu64" KiB -> %"PRIu64" KiB)",
+			num_evicted, initial_size / 1024, total_size / 1024
+		);
+	} else {
+		BASISU_DEBUG("Cache size: %"PRIu64" KiB", total_size / 1024);
+	}
+
+	dynarray_foreach_elem(&files, CacheFile *f, {
+		mem_free(f->path);
+	});
+
+	dynarray_foreach_elem(&dirs, CacheDir *dir, {
+		mem_free(dir->path);
+	});
+
+	dynarray_free_data(&files);
+	dynarray_free_data(&dirs);
+
+	SDL_AtomicSet(&cache.eviction_running, 0);
+	return NULL;
+}
+
+static void texture_loader_basisu_schedule_eviction(void) {
+	if(!SDL_AtomicCAS(&cache.eviction_running, 0, 1)) {
+		return;
+	}
+
+	SDL_AtomicSet(&cache.kib_since_eviction, 0);
+	task_detach(taskmgr_global_submit((TaskParams) {
+		.callback = texture_loader_basisu_evict_task,
+	}));
+}
+
+static void texture_loader_basisu_cache_written(uint64_t size) {
+	if(!cache.size_limit) {
+		return;
+	}
+
+	int kib = (size + 1023) / 1024;
+	int total_kib = SDL_AtomicAdd(&cache.kib_since_eviction, kib) + kib;
+
+	if(total_kib * UINT64_C(1024) >= cache.size_limit / EVICTION_CHECK_FRACTION) {
+		texture_loader_basisu_schedule_eviction();
+	}
+}
+
+static bool texture_loader_basisu_cache_init(void) {
+	static SDL_SpinLock lock;
+
+	SDL_AtomicLock(&lock);
+
+	if(!cache.initialized) {
+		// Lives until the process exits, like the transcoders.
+		cache.mutex = SDL_CreateMutex();
+
+		if(UNLIKELY(!cache.mutex)) {
+			log_sdl_error(LOG_WARN, "SDL_CreateMutex");
+		}
+
+		ht_create(&cache.pending);
+		cache.size_limit = max(0, env_get("TAISEI_BASISU_CACHE_MAX_SIZE", 512)) * UINT64_C(1048576);
+		cache.instance_token = SDL_GetPerformanceCounter() ^ ((uint64_t)time(NULL) << 32) ^ (uintptr_t)&cache;
+		cache.initialized = true;
+
+		if(cache.size_limit) {
+			texture_loader_basisu_schedule_eviction();
+		}
+	}
+
+	SDL_AtomicUnlock(&lock);
+	return cache.mutex != NULL;
+}
+
+/*
+ * Returns true if the calling thread now owns the entry and is expected to produce it.
+ * Otherwise, another thread has just finished with it, and the cache should be checked again.
+ */
+static bool texture_loader_basisu_claim_entry(const char *path) {
+	if(!cache.mutex) {
+		return true;
+	}
+
+	SDL_LockMutex(cache.mutex);
+	PendingEntry *pe = ht_get(&cache.pending, path, NULL);
+
+	if(!pe) {
+		pe = ALLOC(PendingEntry, { .cond = SDL_CreateCond() });
+		ht_set(&cache.pending, path, pe);
+		SDL_UnlockMutex(cache.mutex);
+		return true;
+	}
+
+	BASISU_DEBUG("%s is being transcoded by another thread, waiting", path);
+
+	++pe->waiters;
+
+	while(!pe->done) {
+		SDL_CondWait(pe->cond, cache.mutex);
+	}
+
+	if(--pe->waiters == 0) {
+		SDL_DestroyCond(pe->cond);
+		mem_free(pe);
+	}
+
+	SDL_UnlockMutex(cache.mutex);
+	return false;
+}
+
+static void texture_loader_basisu_release_entry(const char *path) {
+	if(!cache.mutex) {
+		return;
+	}
+
+	SDL_LockMutex(cache.mutex);
+	PendingEntry *pe = ht_get(&cache.pending, path, NULL);
+
+	if(pe) {
+		ht_unset(&cache.pending, path);
+
+		if(pe->waiters > 0) {
+			pe->done = true;
+			SDL_CondBroadcast(pe->cond);
+		} else {
+			SDL_DestroyCond(pe->cond);
+			mem_free(pe);
+		}
+	}
+
+	SDL_UnlockMutex(cache.mutex);
+}
+
 static bool texture_loader_basisu_make_cache_path(
 	const char *basisu_hash,
 	const basist_transcode_level_params *tc_params,
@@ -46,31 +332,33 @@ static bool texture_loader_basisu_make_cache_path(
 	return true;
 }
 
-bool texture_loader_basisu_load_cached(
-	const char *basisu_hash,
-	const basist_transcode_level_params *tc_params,
+typedef enum CacheEntryStatus {
+	ENTRY_MISSING,
+	ENTRY_LOADED,
+	ENTRY_BAD,
+} CacheEntryStatus;
+
+static CacheEntryStatus texture_loader_basisu_load_entry(
+	const char *path,
 	const basist_image_level_desc *level_desc,
 	PixmapFormat expected_px_format,
 	PixmapOrigin expected_px_origin,
 	uint32_t expected_size,
 	Pixmap *out_pixmap
 ) {
-	char path[ENTRY_PATH_SIZE];
-
-	if(!texture_loader_basisu_make_cache_path(basisu_hash, tc_params, sizeof(path), path)) {
-		return false;
-	}
+	VFSInfo i = vfs_query(path);
 
-	if(!vfs_query(path).exists) {
+	if(!i.exists) {
 		BASISU_DEBUG("%s not found", path);
-		return false;
+		return ENTRY_MISSING;
 	}
 
 	SDL_RWops *rw = vfs_open(path, VFS_MODE_READ);
 
 	if(!rw) {
-		log_error("VFS error: %s", vfs_get_error());
-		return false;
+		// Could have been evicted in the meantime
+		log_warn("VFS error: %s", vfs_get_error());
+		return ENTRY_MISSING;
 	}
 
 	rw = SDL_RWWrapZstdReader(rw, true);
@@ -80,7 +368,7 @@ bool texture_loader_basisu_load_cached(
 
 	if(!deserialize_ok) {
 		log_error("%s: Failed to deserialize cached pixmap", path);
-		return false;
+		return ENTRY_BAD;
 	}
 
 	if(out_pixmap->format != expected_px_format) {
@@ -144,19 +432,28 @@ bool texture_loader_basisu_load_cached(
 	}
 
 	BASISU_DEBUG("Loaded cache entry from %s", path);
-	return true;
+
+	if(time(NULL) - i.mtime > TOUCH_INTERVAL) {
+		// Mark as recently used for eviction purposes
+		vfs_touch(path);
+	}
+
+	return ENTRY_LOADED;
 
 bad_entry:
 	mem_free(out_pixmap->data.untyped);
 	out_pixmap->data.untyped = NULL;
-	return false;
+	return ENTRY_BAD;
 }
 
-bool texture_loader_basisu_cache(
+bool texture_loader_basisu_load_cached(
 	const char *basisu_hash,
 	const basist_transcode_level_params *tc_params,
 	const basist_image_level_desc *level_desc,
-	const Pixmap *pixmap
+	PixmapFormat expected_px_format,
+	PixmapOrigin expected_px_origin,
+	uint32_t expected_size,
+	Pixmap *out_pixmap
 ) {
 	char path[ENTRY_PATH_SIZE];
 
@@ -164,12 +461,47 @@ bool texture_loader_basisu_cache(
 		return false;
 	}
 
+	texture_loader_basisu_cache_init();
+
+	for(;;) {
+		CacheEntryStatus status = texture_loader_basisu_load_entry(
+			path, level_desc, expected_px_format, expected_px_origin, expected_size, out_pixmap
+		);
+
+		if(status == ENTRY_LOADED) {
+			return true;
+		}
+
+		if(status == ENTRY_BAD) {
+			log_warn("%s: Removing bad cache entry", path);
+			vfs_unlink(path);
+		}
+
+		if(texture_loader_basisu_claim_entry(path)) {
+			return false;
+		}
+	}
+}
+
+
+static void texture_loader_basisu_remove_temp_file(const char *path) {
+	if(!vfs_unlink(path)) {
+		log_warn("%s: Failed to remove temporary file: %s", path, vfs_get_error());
+	}
+}
+
+static bool texture_loader_basisu_write_entry(const char *path, const Pixmap *pixmap) {
+	char tmp_path[TEMP_PATH_SIZE];
+	snprintf(tmp_path, sizeof(tmp_path), "%s" TEMP_FILE_INFIX "%016"PRIx64"-%x",
+		path, cache.instance_token, SDL_AtomicAdd(&cache.temp_counter, 1)
+	);
+
 	if(!vfs_mkparents(path)) {
 		log_error("VFS error: %s", vfs_get_error());
 		return false;
 	}
 
-	SDL_RWops *rw = vfs_open(path, VFS_MODE_WRITE);
+	SDL_RWops *rw = vfs_open(tmp_path, VFS_MODE_WRITE);
 
 	if(!rw) {
 		log_error("VFS error: %s", vfs_get_error());
@@ -181,14 +513,58 @@ bool texture_loader_basisu_cache(
 	PixmapSaveOptions opts = PIXMAP_DEFAULT_SAVE_OPTIONS;
 	opts.file_format = PIXMAP_FILEFORMAT_INTERNAL;
 	bool serialize_ok = pixmap_save_stream(rw, pixmap, &opts);
-	SDL_RWclose(rw);
+
+	// Closing flushes the compressor, so this can fail too
+	if(SDL_RWclose(rw) < 0) {
+		log_sdl_error(LOG_ERROR, "SDL_RWclose");
+		serialize_ok = false;
+	}
 
 	if(!serialize_ok) {
-		log_error("%s: Failed to serialize pixmap", path);
+		log_error("%s: Failed to serialize pixmap", tmp_path);
+		texture_loader_basisu_remove_temp_file(tmp_path);
+		return false;
+	}
+
+	VFSInfo i = vfs_query(tmp_path);
+
+	// Atomically replaces any existing entry, which may have been written by another process
+	if(!vfs_rename(tmp_path, strrchr(path, '/') + 1)) {
+		log_error("VFS error: %s", vfs_get_error());
+		texture_loader_basisu_remove_temp_file(tmp_path);
 		return false;
 	}
 
 	BASISU_DEBUG("Cached pixmap at %s", path);
+	texture_loader_basisu_cache_written(i.size);
 
 	return true;
 }
+
+bool texture_loader_basisu_cache(
+	const char *basisu_hash,
+	const basist_transcode_level_params *tc_params,
+	const basist_image_level_desc *level_desc,
+	const Pixmap *pixmap
+) {
+	char path[ENTRY_PATH_SIZE];
+
+	if(!texture_loader_basisu_make_cache_path(basisu_hash, tc_params, sizeof(path), path)) {
+		return false;
+	}
+
+	bool ok = texture_loader_basisu_write_entry(path, pixmap);
+	texture_loader_basisu_release_entry(path);
+	return ok;
+}
+
+void texture_loader_basisu_cache_abandon(
+	const char *basisu_hash,
+	const basist_transcode_level_params *tc_params
+) {
+	char path[ENTRY_PATH_SIZE];
+
+	if(texture_loader_basisu_make_cache_path(basisu_hash, tc_params, sizeof(path), path)) {
+		texture_loader_basisu_release_entry(path);
+	}
+}
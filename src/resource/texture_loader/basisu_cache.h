@@ -13,6 +13,11 @@
 
 #include <basisu_transcoder_c_api.h>
 
+/*
+ * If this returns false, the calling thread becomes responsible for the entry: other threads
+ * looking it up will wait until either texture_loader_basisu_cache or
+ * texture_loader_basisu_cache_abandon is called with the same parameters.
+ */
 bool texture_loader_basisu_load_cached(
 	const char *basisu_hash,
 	const basist_transcode_level_params *tc_params,
@@ -29,3 +34,8 @@ bool texture_loader_basisu_cache(
 	const basist_image_level_desc *level_desc,
 	const Pixmap *pixmap
 ) attr_nonnull_all;
+
+void texture_loader_basisu_cache_abandon(
+	const char *basisu_hash,
+	const basist_transcode_level_params *tc_params
+) attr_nonnull_all;
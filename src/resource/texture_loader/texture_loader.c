@@ -464,7 +464,7 @@ static bool texture_loader_infer_sources_cubemap(TextureLoadData *ld) {
 static bool load_pixmap(
 	TextureLoadData *ld, const char *path, Pixmap *dst, PixmapFormat preferred_format
 ) {
-	SDL_RWops *stream = res_open_file(ld->st, path, VFS_MODE_READ | VFS_MODE_SEEKABLE);
+	SDL_RWops *stream = res_open_file(ld->st, path, VFS_MODE_READ | VFS_MODE_SEEKABLE | VFS_MODE_MAPPED);
 
 	if(UNLIKELY(!stream)) {
 		log_error("VFS error: %s", vfs_get_error());
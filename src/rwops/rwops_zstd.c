@@ -32,6 +32,13 @@ typedef struct ZstdData {
 			size_t in_buffer_alloc_size;
 			size_t next_read_size;
 			int64_t uncompressed_size;
+
+			// Frame boundaries from a seek table, if the stream has one; num_frames + 1 entries each
+			struct {
+				int64_t *compressed_offsets;
+				int64_t *uncompressed_offsets;
+				uint num_frames;
+			} seek_table;
 		} reader;
 	};
 
@@ -186,6 +193,8 @@ static int rwzstd_reader_close(SDL_RWops *rw) {
 	ZstdData *z = ZDATA(rw);
 	ZSTD_freeDStream(z->reader.stream);
 	mem_free((void*)z->reader.in_buffer.src);
+	mem_free(z->reader.seek_table.compressed_offsets);
+	mem_free(z->reader.seek_table.uncompressed_offsets);
 	return rwzstd_close(rw);
 }
 
@@ -214,18 +223,18 @@ SDL_RWops *SDL_RWWrapZstdReader(SDL_RWops *src, bool autoclose) {
 	return rw;
 }
 
-static int rwzstd_reopen(SDL_RWops *rw) {
+static int rwzstd_restart_at(SDL_RWops *rw, int64_t src_offset, int64_t uncompressed_pos) {
 	ZstdData *z = ZDATA(rw);
 
-	int64_t srcpos = SDL_RWseek(z->wrapped, 0, RW_SEEK_SET);
+	int64_t srcpos = SDL_RWseek(z->wrapped, src_offset, RW_SEEK_SET);
 
 	if(srcpos < 0) {
 		return srcpos;
 	}
 
-	assert(srcpos == 0);
+	assert(srcpos == src_offset);
 
-	z->pos = 0;
+	z->pos = uncompressed_pos;
 	z->reader.in_buffer.pos = 0;
 	z->reader.in_buffer.size = 0;
 	z->reader.next_read_size = ZSTD_initDStream(z->reader.stream);
@@ -233,6 +242,10 @@ static int rwzstd_reopen(SDL_RWops *rw) {
 	return 0;
 }
 
+static int rwzstd_reopen(SDL_RWops *rw) {
+	return rwzstd_restart_at(rw, 0, 0);
+}
+
 static int64_t rwzstd_seek_emulated(SDL_RWops *rw, int64_t offset, int whence) {
 	ZstdData *z = ZDATA(rw);
 	char buf[1024];
@@ -243,6 +256,157 @@ static int64_t rwzstd_seek_emulated(SDL_RWops *rw, int64_t offset, int whence) {
 	);
 }
 
+/*
+ * Seekable format support; see the zstd repository, contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * The content is split into independently compressed frames, and a skippable frame at the end of
+ * the stream lists the compressed and decompressed size of each. A seek then only has to decompress
+ * the part of a single frame that precedes the target position.
+ */
+
+#define SEEKABLE_MAGIC 0x8F92EAB1
+#define SEEKABLE_SKIPPABLE_MAGIC 0x184D2A5E
+#define SEEKABLE_FOOTER_SIZE 9
+#define SEEKABLE_SKIPPABLE_HEADER_SIZE 8
+#define SEEKABLE_DESCRIPTOR_CHECKSUM 0x80
+#define SEEKABLE_DESCRIPTOR_RESERVED 0x7c
+
+static uint rwzstd_seek_table_find_frame(ZstdData *z, int64_t pos) {
+	const int64_t *ofs = z->reader.seek_table.uncompressed_offsets;
+	uint lo = 0, hi = z->reader.seek_table.num_frames - 1;
+
+	// Last frame that starts at or before pos; seeking to the very end lands in the last frame.
+	while(lo < hi) {
+		uint mid = lo + (hi - lo + 1) / 2;
+
+		if(ofs[mid] <= pos) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return lo;
+}
+
+static int64_t rwzstd_seek_table(SDL_RWops *rw, int64_t offset, int whence) {
+	ZstdData *z = ZDATA(rw);
+	int64_t new_pos = rwutil_compute_seek_pos(offset, whence, z->pos, z->reader.uncompressed_size);
+
+	if(new_pos == z->pos) {
+		return z->pos;
+	}
+
+	uint frame = rwzstd_seek_table_find_frame(z, new_pos);
+
+	// Keep decoding if the target is further ahead in the current frame; restart at the frame
+	// boundary otherwise.
+	if(new_pos < z->pos || frame != rwzstd_seek_table_find_frame(z, z->pos)) {
+		int status = rwzstd_restart_at(
+			rw,
+			z->reader.seek_table.compressed_offsets[frame],
+			z->reader.seek_table.uncompressed_offsets[frame]
+		);
+
+		if(status < 0) {
+			return status;
+		}
+	}
+
+	char buf[1024];
+	return rwutil_seek_emulated_abs(rw, new_pos, &z->pos, rwzstd_reopen, sizeof(buf), buf);
+}
+
+static bool rwzstd_read_exact(SDL_RWops *src, int64_t offset, void *buf, size_t size) {
+	return
+		SDL_RWseek(src, offset, RW_SEEK_SET) == offset &&
+		SDL_RWread(src, buf, 1, size) == size;
+}
+
+static uint32_t rwzstd_load_le32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return SDL_SwapLE32(v);
+}
+
+static bool rwzstd_load_seek_table(ZstdData *z) {
+	SDL_RWops *src = z->wrapped;
+	int64_t src_size = SDL_RWsize(src);
+
+	if(src_size < SEEKABLE_SKIPPABLE_HEADER_SIZE + SEEKABLE_FOOTER_SIZE) {
+		return false;
+	}
+
+	uint8_t footer[SEEKABLE_FOOTER_SIZE];
+
+	if(!rwzstd_read_exact(src, src_size - sizeof(footer), footer, sizeof(footer))) {
+		return false;
+	}
+
+	if(rwzstd_load_le32(footer + 5) != SEEKABLE_MAGIC) {
+		return false;
+	}
+
+	uint32_t num_frames = rwzstd_load_le32(footer);
+	uint8_t descriptor = footer[4];
+
+	if(descriptor & SEEKABLE_DESCRIPTOR_RESERVED) {
+		log_warn("Seek table has reserved bits set; ignoring");
+		return false;
+	}
+
+	size_t entry_size = (descriptor & SEEKABLE_DESCRIPTOR_CHECKSUM) ? 12 : 8;
+	int64_t table_size = (int64_t)num_frames * entry_size + SEEKABLE_FOOTER_SIZE;
+	int64_t table_start = src_size - table_size - SEEKABLE_SKIPPABLE_HEADER_SIZE;
+
+	if(num_frames == 0 || table_start < 0) {
+		log_warn("Seek table is malformed; ignoring");
+		return false;
+	}
+
+	uint8_t header[SEEKABLE_SKIPPABLE_HEADER_SIZE];
+
+	if(
+		!rwzstd_read_exact(src, table_start, header, sizeof(header)) ||
+		rwzstd_load_le32(header) != SEEKABLE_SKIPPABLE_MAGIC ||
+		rwzstd_load_le32(header + 4) != table_size
+	) {
+		log_warn("Seek table is malformed; ignoring");
+		return false;
+	}
+
+	size_t entries_size = num_frames * entry_size;
+	uint8_t *entries = mem_alloc(entries_size);
+
+	if(SDL_RWread(src, entries, 1, entries_size) != entries_size) {
+		mem_free(entries);
+		return false;
+	}
+
+	int64_t *c_ofs = ALLOC_ARRAY(num_frames + 1, int64_t);
+	int64_t *d_ofs = ALLOC_ARRAY(num_frames + 1, int64_t);
+
+	for(uint32_t i = 0; i < num_frames; ++i) {
+		const uint8_t *e = entries + i * entry_size;
+		c_ofs[i + 1] = c_ofs[i] + rwzstd_load_le32(e);
+		d_ofs[i + 1] = d_ofs[i] + rwzstd_load_le32(e + 4);
+	}
+
+	mem_free(entries);
+
+	if(c_ofs[num_frames] != table_start) {
+		log_warn("Seek table doesn't match the stream size; ignoring");
+		mem_free(c_ofs);
+		mem_free(d_ofs);
+		return false;
+	}
+
+	z->reader.seek_table.compressed_offsets = c_ofs;
+	z->reader.seek_table.uncompressed_offsets = d_ofs;
+	z->reader.seek_table.num_frames = num_frames;
+	return true;
+}
+
 SDL_RWops *SDL_RWWrapZstdReaderSeekable(SDL_RWops *src, int64_t uncompressed_size, bool autoclose) {
 	SDL_RWops *rw = SDL_RWWrapZstdReader(src, autoclose);
 
@@ -253,6 +417,26 @@ SDL_RWops *SDL_RWWrapZstdReaderSeekable(SDL_RWops *src, int64_t uncompressed_siz
 	rw->seek = rwzstd_seek_emulated;
 	ZstdData *z = ZDATA(rw);
 
+	bool have_seek_table = rwzstd_load_seek_table(z);
+
+	if(SDL_RWseek(src, 0, RW_SEEK_SET) != 0) {
+		SDL_RWclose(rw);
+		return NULL;
+	}
+
+	if(have_seek_table) {
+		int64_t table_size = z->reader.seek_table.uncompressed_offsets[z->reader.seek_table.num_frames];
+
+		if(uncompressed_size >= 0 && uncompressed_size != table_size) {
+			log_warn("Seek table claims %"PRIi64" bytes of content, expected %"PRIi64"; ignoring it",
+				table_size, uncompressed_size
+			);
+		} else {
+			rw->seek = rwzstd_seek_table;
+			uncompressed_size = table_size;
+		}
+	}
+
 	if(uncompressed_size < 0) {
 		// Try to get it from the zstd frame header.
 		// This won't work correctly for multi-frame content.
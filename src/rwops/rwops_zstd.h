@@ -16,5 +16,7 @@
 SDL_RWops *SDL_RWWrapZstdReader(SDL_RWops *src, bool autoclose);
 SDL_RWops *SDL_RWWrapZstdWriter(SDL_RWops *src, int clevel, bool autoclose);
 
-// NOTE: uses inefficient emulation to implement seeking. Source must be seekable as well.
+// Source must be seekable as well. If the stream is in the zstd seekable format (independent frames
+// followed by a seek table), only the frame containing the target position is decompressed on seek.
+// Otherwise, seeking is emulated by decompressing from the start of the stream.
 SDL_RWops *SDL_RWWrapZstdReaderSeekable(SDL_RWops *src, int64_t uncompressed_size, bool autoclose);
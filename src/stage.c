@@ -26,6 +26,8 @@
 #include "stagetext.h"
 #include "stagedraw.h"
 #include "stageobjects.h"
+#include "enemygrid.h"
+#include "benchmark.h"
 #include "eventloop/eventloop.h"
 #include "common_tasks.h"
 #include "stageinfo.h"
@@ -782,6 +784,7 @@ static void stage_free(void) {
 	lasers_shutdown();
 	projectiles_free();
 	stagetext_free();
+	enemygrid_free();
 }
 
 static void stage_finalize(CallChainResult ccr) {
@@ -948,7 +951,7 @@ static void stage_replay_sync(StageFrameState *fstate) {
 	}
 }
 
-static LogicFrameAction stage_logic_frame(void *arg) {
+static LogicFrameAction stage_logic_frame_internal(void *arg) {
 	StageFrameState *fstate = arg;
 	StageInfo *stage = fstate->stage;
 
@@ -978,7 +981,9 @@ static LogicFrameAction stage_logic_frame(void *arg) {
 		// Usually stage_comain will do this
 		events_poll(NULL, 0);
 	} else {
+		benchmark_section_begin(BENCH_TASKS);
 		cosched_run_tasks(&fstate->sched);
+		benchmark_section_end(BENCH_TASKS);
 		update_all_sfx();
 		stage_replay_sync(fstate);
 
@@ -1060,6 +1065,13 @@ static LogicFrameAction stage_logic_frame(void *arg) {
 	return LFRAME_WAIT;
 }
 
+static LogicFrameAction stage_logic_frame(void *arg) {
+	benchmark_section_begin(BENCH_FRAME);
+	LogicFrameAction action = stage_logic_frame_internal(arg);
+	benchmark_frame_end();
+	return action;
+}
+
 static RenderFrameAction stage_render_frame(void *arg) {
 	StageFrameState *fstate = arg;
 	StageInfo *stage = fstate->stage;
@@ -1109,11 +1121,27 @@ TASK(stage_comain, { StageFrameState *fstate; }) {
 	for(;;YIELD) {
 		process_input(fstate);
 		process_boss(&global.boss);
+
+		benchmark_section_begin(BENCH_ENEMIES);
 		process_enemies(&global.enemies);
+		enemygrid_rebuild();
+		benchmark_section_end(BENCH_ENEMIES);
+
+		benchmark_section_begin(BENCH_PROJECTILES);
 		process_projectiles(&global.projs, true);
+		benchmark_section_end(BENCH_PROJECTILES);
+
+		benchmark_section_begin(BENCH_ITEMS);
 		process_items();
+		benchmark_section_end(BENCH_ITEMS);
+
+		benchmark_section_begin(BENCH_LASERS);
 		process_lasers();
+		benchmark_section_end(BENCH_LASERS);
+
+		benchmark_section_begin(BENCH_PROJECTILES);
 		process_projectiles(&global.particles, false);
+		benchmark_section_end(BENCH_PROJECTILES);
 
 		if(global.dialog) {
 			dialog_update(global.dialog);
@@ -1300,6 +1328,8 @@ void stage_end_loop(void *ctx) {
 	s->stage->procs->end();
 	stage_draw_shutdown();
 	cosched_finish(&s->sched);
+	// all of the stage's tasks are back in the pool now; this is a good time to shrink their stacks
+	coroutines_trim_stacks();
 	stage_free();
 	player_free(&global.plr);
 	ent_shutdown();
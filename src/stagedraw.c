@@ -1214,6 +1214,28 @@ static void stage_draw_hud_objpool_stats(float x, float y, float width) {
 		y += lineskip;
 	}
 
+	EntitySortStats sort_stats;
+	ent_pop_sort_stats(&sort_stats);
+
+	y += lineskip * 0.5;
+
+	text_draw("Entity sort:", &(TextParams) {
+		.pos = { x, y },
+		.font_ptr = font,
+		.align = ALIGN_LEFT,
+	});
+
+	snprintf(buf, sizeof(buf), "%u | %7.3fms",
+		sort_stats.num_entities,
+		sort_stats.time / (double)(HRTIME_RESOLUTION / 1000)
+	);
+
+	text_draw(buf, &(TextParams) {
+		.pos = { x + width, y },
+		.font_ptr = font,
+		.align = ALIGN_RIGHT,
+	});
+
 	r_shader_ptr(sh_prev);
 }
 
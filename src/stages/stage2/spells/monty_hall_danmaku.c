@@ -141,7 +141,7 @@ TASK(cards, { BoxedBoss boss; }) {
 DEFINE_EXTERN_TASK(stage2_spell_monty_hall_danmaku) {
 	Boss *boss = INIT_BOSS_ATTACK(&ARGS);
 
-	COEVENTS_ARRAY(goat_trigger) events;
+	COEVENTS_ARRAY(goat_trigger) events = { 0 };
 	TASK_HOST_EVENTS(events);
 
 	boss->move = move_from_towards(boss->pos, VIEWPORT_W/2.0 + VIEWPORT_H/2.0 * I, 0.06);
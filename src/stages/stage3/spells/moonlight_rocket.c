@@ -94,7 +94,7 @@ TASK(rocket, { BoxedBoss boss; cmplx pos; cmplx dir; Color color; real phase; re
 		.flags = PFLAG_NOMOVE,
 	);
 
-	COEVENTS_ARRAY(phase2, explosion) events;
+	COEVENTS_ARRAY(phase2, explosion) events = { 0 };
 	TASK_HOST_EVENTS(events);
 
 	INVOKE_TASK(laser_bullet, ENT_BOX(p), ENT_BOX(l), &events.phase2, dt);
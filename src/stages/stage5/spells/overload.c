@@ -378,7 +378,7 @@ DEFINE_EXTERN_TASK(stage5_spell_overload) {
 	boss->move = move_from_towards(boss->pos, VIEWPORT_W/2 + 120i, 0.2);
 	BEGIN_BOSS_ATTACK(&ARGS);
 
-	COEVENTS_ARRAY(trigger) events;
+	COEVENTS_ARRAY(trigger) events = { 0 };
 	TASK_HOST_EVENTS(events);
 
 	NodesGrid *grid;
@@ -28,7 +28,7 @@ TASK(eigenstate_baryons, { BoxedBoss boss; BoxedEllyBaryons baryons; }) {
 	}
 }	
 
-TASK(eigenstate_bullet, { cmplx pos; cmplx v0; cmplx v1; Color color; }) {
+TASK_WITH_STACK(eigenstate_bullet, CO_STACK_MEDIUM, { cmplx pos; cmplx v0; cmplx v1; Color color; }) {
 	Projectile *p = TASK_BIND(PROJECTILE(
 		.proto = pp_plainball,
 		.pos = ARGS.pos,
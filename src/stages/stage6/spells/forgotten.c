@@ -54,7 +54,7 @@ TASK(forgotten_baryons_spawner, { BoxedEllyBaryons baryons;}) {
 	}
 }
 
-TASK(forgotten_bullet, { cmplx pos; cmplx *diff; }) {
+TASK_WITH_STACK(forgotten_bullet, CO_STACK_MEDIUM, { cmplx pos; cmplx *diff; }) {
 	real speed = difficulty_value(0.25, 0.25, 0.5, 0.5);
 
 	Projectile *p = TASK_BIND(PROJECTILE(
@@ -78,7 +78,7 @@ TASK(forgotten_bullet, { cmplx pos; cmplx *diff; }) {
 	}
 }
 
-TASK(forgotten_orbiter, { BoxedProjectile parent; cmplx offset; }) {
+TASK_WITH_STACK(forgotten_orbiter, CO_STACK_MEDIUM, { BoxedProjectile parent; cmplx offset; }) {
 	real angular_velocity = 0.03;
 	Projectile *p = PROJECTILE(
 		.proto = pp_plainball,
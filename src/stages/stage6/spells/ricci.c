@@ -212,7 +212,7 @@ TASK(ricci_baryons, { BoxedEllyBaryons baryons; BoxedBoss boss; }) {
 	}
 }
 
-TASK(ricci_proj, { cmplx pos; cmplx velocity; BoxedEllyBaryons baryons; }) {
+TASK_WITH_STACK(ricci_proj, CO_STACK_MEDIUM, { cmplx pos; cmplx velocity; BoxedEllyBaryons baryons; }) {
 	Projectile *p = TASK_BIND(PROJECTILE(
 		.proto = pp_ball,
 		.pos = ARGS.pos,
@@ -119,7 +119,7 @@ static cmplx wrap_around(cmplx *pos) {
 }
 
 // XXX: should this not be a draw rule?
-TASK(toe_boson_effect_spin, { BoxedProjectile p; }) {
+TASK_WITH_STACK(toe_boson_effect_spin, CO_STACK_SMALL, { BoxedProjectile p; }) {
 	Projectile *p = TASK_BIND(ARGS.p);
 	float target_angle = rng_angle();
 	for(int t = 0; t < p->timeout; t++) {
@@ -99,7 +99,7 @@ TASK(flowermine_fairy_move, { BoxedEnemy enemy; MoveParams move1; MoveParams mov
 	e->move = ARGS.move2;
 }
 
-TASK(projectile_redirect, { BoxedProjectile proj; MoveParams move; }) {
+TASK_WITH_STACK(projectile_redirect, CO_STACK_MEDIUM, { BoxedProjectile proj; MoveParams move; }) {
 	Projectile *p = TASK_BIND(ARGS.proj);
 	play_sfx_ex("redirect", 1, false);
 	spawn_projectile_highlight_effect(p);
@@ -130,7 +130,7 @@ TASK(flowermine_fairy, { cmplx pos; MoveParams move1; MoveParams move2; }) {
 	}
 }
 
-TASK(sniper_fairy_shot_cleanup, { BoxedLaser l; }) {
+TASK_WITH_STACK(sniper_fairy_shot_cleanup, CO_STACK_SMALL, { BoxedLaser l; }) {
 	auto l = ENT_UNBOX(ARGS.l);
 	if(l) {
 		l->deathtime = min(l->deathtime, global.frames - l->birthtime + 10);
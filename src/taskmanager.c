@@ -12,20 +12,33 @@
 #include "list.h"
 #include "util.h"
 
+// Tasks don't own any kernel objects. Instead, blocking waits on tasks and task groups are done
+// on one of these mutex/condvar pairs, selected by hashing the address of the waited-on object.
+#define TASK_WAIT_BUCKETS 64
+
+// Maximum amount of recycled Task structs kept around for reuse.
+#define TASK_POOL_MAX 256
+
 typedef enum TaskManagerState {
 	TMGR_STATE_SHUTDOWN,
 	TMGR_STATE_RUNNING,
 	TMGR_STATE_ABORTED,
 } TaskManagerState;
 
-struct TaskManager {
+typedef struct TaskWorker {
 	LIST_ANCHOR(Task) queue;
-	SDL_sem *queue_sem;
 	SDL_SpinLock queue_lock;
+	TaskManager *mgr;
+	Thread *thread;
+} TaskWorker;
+
+struct TaskManager {
+	SDL_sem *queue_sem;
 	uint numthreads;
 	TaskManagerState state;
 	SDL_atomic_t numtasks;
-	Thread *threads[];
+	SDL_atomic_t next_worker;
+	TaskWorker workers[];
 };
 
 struct Task {
@@ -33,17 +46,136 @@ struct Task {
 	task_func_t callback;
 	task_free_func_t userdata_free_callback;
 	void *userdata;
+	TaskManager *mgr;
+	TaskGroup *group;
 	int prio;
-	SDL_mutex *mutex;
-	SDL_cond *cond;
 	TaskStatus status;
 	void *result;
 	uint disowned : 1;
 	uint in_queue : 1;
 };
 
+typedef struct TaskWaitBucket {
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+} TaskWaitBucket;
+
+static struct {
+	TaskWaitBucket wait_buckets[TASK_WAIT_BUCKETS];
+	SDL_TLSID current_worker;
+	SDL_SpinLock init_lock;
+	bool initialized;
+
+	struct {
+		LIST_ANCHOR(Task) free;
+		SDL_SpinLock lock;
+		uint num_free;
+	} pool;
+} tsys;
+
 static TaskManager *g_taskmgr;
 
+static bool tsys_init(void) {
+	bool ok = true;
+	SDL_AtomicLock(&tsys.init_lock);
+
+	if(!tsys.initialized) {
+		for(int i = 0; i < TASK_WAIT_BUCKETS; ++i) {
+			TaskWaitBucket *b = tsys.wait_buckets + i;
+
+			if(!(b->mutex = SDL_CreateMutex())) {
+				log_sdl_error(LOG_ERROR, "SDL_CreateMutex");
+				ok = false;
+				break;
+			}
+
+			if(!(b->cond = SDL_CreateCond())) {
+				log_sdl_error(LOG_ERROR, "SDL_CreateCond");
+				ok = false;
+				break;
+			}
+		}
+
+		if(ok && !(tsys.current_worker = SDL_TLSCreate())) {
+			log_sdl_error(LOG_ERROR, "SDL_TLSCreate");
+			ok = false;
+		}
+
+		tsys.initialized = ok;
+	}
+
+	SDL_AtomicUnlock(&tsys.init_lock);
+	return ok;
+}
+
+static void tsys_shutdown(void) {
+	SDL_AtomicLock(&tsys.init_lock);
+
+	for(int i = 0; i < TASK_WAIT_BUCKETS; ++i) {
+		TaskWaitBucket *b = tsys.wait_buckets + i;
+
+		if(b->mutex) {
+			SDL_DestroyMutex(b->mutex);
+		}
+
+		if(b->cond) {
+			SDL_DestroyCond(b->cond);
+		}
+	}
+
+	memset(&tsys.wait_buckets, 0, sizeof(tsys.wait_buckets));
+	tsys.initialized = false;
+
+	SDL_AtomicLock(&tsys.pool.lock);
+	for(Task *t; (t = alist_pop(&tsys.pool.free));) {
+		mem_free(t);
+	}
+	tsys.pool.num_free = 0;
+	SDL_AtomicUnlock(&tsys.pool.lock);
+
+	SDL_AtomicUnlock(&tsys.init_lock);
+}
+
+static TaskWaitBucket *wait_bucket(const void *obj) {
+	uint32_t h = (uint32_t)((uintptr_t)obj >> 4) * UINT32_C(2654435761);
+	return tsys.wait_buckets + (h >> 26) % TASK_WAIT_BUCKETS;
+}
+
+static_assert(TASK_WAIT_BUCKETS <= 64, "wait_bucket() only yields 6 bits of hash");
+
+static TaskWorker *taskmgr_current_worker(TaskManager *mgr) {
+	TaskWorker *w = SDL_TLSGet(tsys.current_worker);
+	return (w && w->mgr == mgr) ? w : NULL;
+}
+
+static Task *task_alloc(void) {
+	SDL_AtomicLock(&tsys.pool.lock);
+	Task *task = alist_pop(&tsys.pool.free);
+	if(task) {
+		--tsys.pool.num_free;
+	}
+	SDL_AtomicUnlock(&tsys.pool.lock);
+
+	if(task) {
+		memset(task, 0, sizeof(*task));
+		return task;
+	}
+
+	return ALLOC(Task);
+}
+
+static void task_recycle(Task *task) {
+	SDL_AtomicLock(&tsys.pool.lock);
+	if(tsys.pool.num_free < TASK_POOL_MAX) {
+		alist_push(&tsys.pool.free, task);
+		++tsys.pool.num_free;
+		task = NULL;
+	}
+	SDL_AtomicUnlock(&tsys.pool.lock);
+
+	mem_free(task);
+}
+
 static void taskmgr_free(TaskManager *mgr) {
 	SDL_DestroySemaphore(mgr->queue_sem);
 	mem_free(mgr);
@@ -57,42 +189,164 @@ static void task_free(Task *task) {
 		task->userdata_free_callback(task->userdata);
 	}
 
-	if(task->mutex != NULL) {
-		SDL_DestroyMutex(task->mutex);
-	}
+	task_recycle(task);
+}
+
+static void task_lock(Task *task) {
+	SDL_LockMutex(wait_bucket(task)->mutex);
+}
 
-	if(task->cond != NULL) {
-		SDL_DestroyCond(task->cond);
+static void task_unlock(Task *task) {
+	SDL_UnlockMutex(wait_bucket(task)->mutex);
+}
+
+static void task_wait_locked(Task *task) {
+	TaskWaitBucket *b = wait_bucket(task);
+	// The condvar is shared with other tasks, so wakeups may be spurious.
+	while(task->status == TASK_RUNNING) {
+		SDL_CondWait(b->cond, b->mutex);
 	}
+}
 
-	mem_free(task);
+static void task_notify_locked(Task *task) {
+	SDL_CondBroadcast(wait_bucket(task)->cond);
 }
 
-static Task *taskmgr_pop_queue(TaskManager *mgr) {
-	if(mgr->queue.first == NULL) {
+static void taskgroup_release(TaskGroup *group) {
+	if(SDL_AtomicDecRef(&group->pending)) {
+		TaskWaitBucket *b = wait_bucket(group);
+		SDL_LockMutex(b->mutex);
+		SDL_CondBroadcast(b->cond);
+		SDL_UnlockMutex(b->mutex);
+	}
+}
+
+static Task *worker_pop(TaskWorker *w, TaskGroup *group) {
+	if(w->queue.first == NULL) {
 		return NULL;
 	}
 
-	SDL_AtomicLock(&mgr->queue_lock);
-	auto t = alist_pop(&mgr->queue);
-	SDL_AtomicUnlock(&mgr->queue_lock);
-	return t;
+	Task *task = NULL;
+
+	SDL_AtomicLock(&w->queue_lock);
+	if(group == NULL) {
+		task = alist_pop(&w->queue);
+	} else {
+		for(Task *t = w->queue.first; t; t = t->next) {
+			if(t->group == group) {
+				task = alist_unlink(&w->queue, t);
+				break;
+			}
+		}
+	}
+	SDL_AtomicUnlock(&w->queue_lock);
+
+	return task;
+}
+
+// Takes a task from [self]'s queue, or steals one from another worker if it's empty.
+// If [group] is not NULL, only tasks from that group are considered.
+static Task *taskmgr_pop_task(TaskManager *mgr, TaskWorker *self, TaskGroup *group) {
+	uint n = mgr->numthreads;
+	uint start;
+
+	if(self) {
+		Task *task = worker_pop(self, group);
+
+		if(task) {
+			return task;
+		}
+
+		start = self - mgr->workers;
+	} else {
+		start = (uint)SDL_AtomicGet(&mgr->next_worker) % n;
+	}
+
+	for(uint i = 0; i < n; ++i) {
+		TaskWorker *w = mgr->workers + (start + i) % n;
+
+		if(w == self) {
+			continue;
+		}
+
+		Task *task = worker_pop(w, group);
+
+		if(task) {
+			return task;
+		}
+	}
+
+	return NULL;
+}
+
+// Called once a task has been taken off a queue, after it has been executed or skipped.
+static void task_retire_locked(Task *task, bool *out_free) {
+	assert(task->in_queue);
+	task->in_queue = false;
+	(void)SDL_AtomicDecRef(&task->mgr->numtasks);
+	*out_free = task->disowned;
+}
+
+static void task_process(Task *task, bool aborted) {
+	TaskGroup *group = task->group;
+	bool need_free;
+
+	task_lock(task);
+
+	if(aborted && task->status == TASK_PENDING) {
+		task->status = TASK_CANCELLED;
+	}
+
+	if(task->status == TASK_PENDING) {
+		task->status = TASK_RUNNING;
+
+		task_unlock(task);
+		void *result = task->callback(task->userdata);
+		task_lock(task);
+
+		task->result = result;
+		task->status = TASK_FINISHED;
+		task_retire_locked(task, &need_free);
+		task_notify_locked(task);
+	} else if(
+		task->status == TASK_CANCELLED ||
+		task->status == TASK_RUNNING ||
+		task->status == TASK_FINISHED
+	) {
+		task_retire_locked(task, &need_free);
+	} else {
+		UNREACHABLE;
+	}
+
+	task_unlock(task);
+
+	if(need_free) {
+		task_free(task);
+	}
+
+	if(group) {
+		taskgroup_release(group);
+	}
 }
 
 static void *taskmgr_thread(void *arg) {
-	TaskManager *mgr = arg;
+	TaskWorker *self = arg;
+	TaskManager *mgr = self->mgr;
 	attr_unused SDL_threadID tid = SDL_ThreadID();
 
+	SDL_TLSSet(tsys.current_worker, self, NULL);
+
 	TaskManagerState state = mgr->state;
 	SDL_sem *qsem = mgr->queue_sem;
 
 	while(state != TMGR_STATE_ABORTED) {
 		SDL_SemWait(qsem);
 
-		Task *task = taskmgr_pop_queue(mgr);
+		Task *task = taskmgr_pop_task(mgr, self, NULL);
 		state = mgr->state;
 
 		if(UNLIKELY(task == NULL)) {
+			// Also happens when a task we've been woken up for got picked up by a waiting thread.
 			if(state == TMGR_STATE_SHUTDOWN) {
 				break;
 			}
@@ -100,54 +354,17 @@ static void *taskmgr_thread(void *arg) {
 			continue;
 		}
 
-		SDL_LockMutex(task->mutex);
-
-		if(state == TMGR_STATE_ABORTED && task->status == TASK_PENDING) {
-			task->status = TASK_CANCELLED;
-		}
-
-		if(task->status == TASK_PENDING) {
-			task->status = TASK_RUNNING;
-
-			SDL_UnlockMutex(task->mutex);
-			task->result = task->callback(task->userdata);
-			SDL_LockMutex(task->mutex);
-
-			assert(task->in_queue);
-			task->in_queue = false;
-			(void)SDL_AtomicDecRef(&mgr->numtasks);
-
-			if(task->disowned) {
-				SDL_UnlockMutex(task->mutex);
-				task_free(task);
-			} else {
-				task->status = TASK_FINISHED;
-				SDL_CondBroadcast(task->cond);
-				SDL_UnlockMutex(task->mutex);
-			}
-		} else if(
-			task->status == TASK_CANCELLED ||
-			task->status == TASK_RUNNING ||
-			task->status == TASK_FINISHED
-		) {
-			assert(task->in_queue);
-			task->in_queue = false;
-			(void)SDL_AtomicDecRef(&mgr->numtasks);
-			bool task_disowned = task->disowned;
-			SDL_UnlockMutex(task->mutex);
-
-			if(task_disowned) {
-				task_free(task);
-			}
-		} else {
-			UNREACHABLE;
-		}
+		task_process(task, state == TMGR_STATE_ABORTED);
 	}
 
 	return NULL;
 }
 
 TaskManager *taskmgr_create(uint numthreads, ThreadPriority prio, const char *name) {
+	if(!tsys_init()) {
+		return NULL;
+	}
+
 	int numcores = SDL_GetCPUCount();
 
 	if(numcores < 1) {
@@ -164,7 +381,7 @@ TaskManager *taskmgr_create(uint numthreads, ThreadPriority prio, const char *na
 		numthreads = maxthreads;
 	}
 
-	auto mgr = ALLOC_FLEX(TaskManager, numthreads * sizeof(SDL_Thread*));
+	auto mgr = ALLOC_FLEX(TaskManager, numthreads * sizeof(TaskWorker));
 
 	if(!(mgr->queue_sem = SDL_CreateSemaphore(0))) {
 		log_sdl_error(LOG_ERROR, "SDL_CreateSemaphore");
@@ -174,19 +391,23 @@ TaskManager *taskmgr_create(uint numthreads, ThreadPriority prio, const char *na
 	mgr->numthreads = numthreads;
 	mgr->state = TMGR_STATE_RUNNING;
 
+	for(uint i = 0; i < numthreads; ++i) {
+		mgr->workers[i].mgr = mgr;
+	}
+
 	for(uint i = 0; i < numthreads; ++i) {
 		int digits = i ? log10(i) + 1 : 1;
 		static const char *const prefix = "taskmgr";
 		char threadname[sizeof(prefix) + strlen(name) + digits + 2];
 		snprintf(threadname, sizeof(threadname), "%s:%s/%i", prefix, name, i);
 
-		if(!(mgr->threads[i] = thread_create(threadname, taskmgr_thread, mgr, prio))) {
+		if(!(mgr->workers[i].thread = thread_create(threadname, taskmgr_thread, mgr->workers + i, prio))) {
 			mgr->state = TMGR_STATE_ABORTED;
 
 			for(uint j = 0; j < i; ++j) {
 				SDL_SemPost(mgr->queue_sem);
-				thread_decref(mgr->threads[j]);
-				mgr->threads[j] = NULL;
+				thread_decref(mgr->workers[j].thread);
+				mgr->workers[j].thread = NULL;
 			}
 
 			goto fail;
@@ -212,45 +433,49 @@ static int task_prio_func(List *ltask) {
 	return ((Task*)ltask)->prio;
 }
 
-Task *taskmgr_submit(TaskManager *mgr, TaskParams params) {
-	assert(params.callback != NULL);
+static Task *taskmgr_submit_internal(TaskManager *mgr, TaskParams *params, TaskGroup *group) {
+	assert(params->callback != NULL);
 	assert(mgr->state == TMGR_STATE_RUNNING);
 
-	auto task = ALLOC(Task, {
-		.callback = params.callback,
-		.userdata_free_callback = params.userdata_free_callback,
-		.userdata = params.userdata,
-		.prio = params.prio,
-		.status = TASK_PENDING,
-	});
+	Task *task = task_alloc();
+	task->callback = params->callback;
+	task->userdata_free_callback = params->userdata_free_callback;
+	task->userdata = params->userdata;
+	task->mgr = mgr;
+	task->group = group;
+	task->prio = params->prio;
+	task->status = TASK_PENDING;
+	task->disowned = (group != NULL);
+	task->in_queue = true;
 
-	if(!(task->mutex = SDL_CreateMutex())) {
-		log_sdl_error(LOG_WARN, "SDL_CreateMutex");
-		goto fail;
+	if(group) {
+		SDL_AtomicIncRef(&group->pending);
 	}
 
-	if(!(task->cond = SDL_CreateCond())) {
-		log_sdl_error(LOG_WARN, "SDL_CreateCond");
-		goto fail;
+	// Tasks spawned by other tasks go to the local queue; the others are spread across all workers.
+	TaskWorker *w = taskmgr_current_worker(mgr);
+
+	if(!w) {
+		w = mgr->workers + (uint)SDL_AtomicAdd(&mgr->next_worker, 1) % mgr->numthreads;
 	}
 
-	SDL_AtomicLock(&mgr->queue_lock);
-	if(params.topmost) {
-		alist_insert_at_priority_head(&mgr->queue, task, task->prio, task_prio_func);
+	SDL_AtomicIncRef(&mgr->numtasks);
+
+	SDL_AtomicLock(&w->queue_lock);
+	if(params->topmost) {
+		alist_insert_at_priority_head(&w->queue, task, task->prio, task_prio_func);
 	} else {
-		alist_insert_at_priority_tail(&mgr->queue, task, task->prio, task_prio_func);
+		alist_insert_at_priority_tail(&w->queue, task, task->prio, task_prio_func);
 	}
-	SDL_AtomicUnlock(&mgr->queue_lock);
+	SDL_AtomicUnlock(&w->queue_lock);
 
-	task->in_queue = true;
-	SDL_AtomicIncRef(&mgr->numtasks);
 	SDL_SemPost(mgr->queue_sem);
 
 	return task;
+}
 
-fail:
-	task_free(task);
-	return NULL;
+Task *taskmgr_submit(TaskManager *mgr, TaskParams params) {
+	return taskmgr_submit_internal(mgr, &params, NULL);
 }
 
 uint taskmgr_remaining(TaskManager *mgr) {
@@ -274,7 +499,7 @@ static void taskmgr_finalize_and_wait(TaskManager *mgr, bool do_abort) {
 	}
 
 	for(uint i = 0; i < mgr->numthreads; ++i) {
-		thread_wait(mgr->threads[i]);
+		thread_wait(mgr->workers[i].thread);
 	}
 
 	taskmgr_free(mgr);
@@ -292,9 +517,9 @@ TaskStatus task_status(Task *task) {
 	TaskStatus result = TASK_INVALID;
 
 	if(task != NULL) {
-		SDL_LockMutex(task->mutex);
+		task_lock(task);
 		result = task->status;
-		SDL_UnlockMutex(task->mutex);
+		task_unlock(task);
 	}
 
 	return result;
@@ -303,13 +528,13 @@ TaskStatus task_status(Task *task) {
 static void *task_offload(Task *task) {
 	assert(task->status == TASK_PENDING);
 	task->status = TASK_RUNNING;
-	SDL_UnlockMutex(task->mutex);
+	task_unlock(task);
 	void *result = task->callback(task->userdata);
-	SDL_LockMutex(task->mutex);
+	task_lock(task);
 	assert(!task->disowned);
 	task->status = TASK_FINISHED;
 	task->result = result;
-	SDL_CondBroadcast(task->cond);
+	task_notify_locked(task);
 	return result;
 }
 
@@ -322,7 +547,7 @@ bool task_wait(Task *task, void **result) {
 
 	void *_result = NULL;
 
-	SDL_LockMutex(task->mutex);
+	task_lock(task);
 
 	if(task->status == TASK_CANCELLED) {
 		success = false;
@@ -330,7 +555,7 @@ bool task_wait(Task *task, void **result) {
 		success = true;
 		_result = task->result;
 	} else if(task->status == TASK_RUNNING) {
-		SDL_CondWait(task->cond, task->mutex);
+		task_wait_locked(task);
 		_result = task->result;
 		success = (task->status == TASK_FINISHED);
 	} else if(task->status == TASK_PENDING) {
@@ -341,7 +566,7 @@ bool task_wait(Task *task, void **result) {
 		UNREACHABLE;
 	}
 
-	SDL_UnlockMutex(task->mutex);
+	task_unlock(task);
 
 	if(success && result != NULL) {
 		*result = _result;
@@ -357,14 +582,14 @@ bool task_cancel(Task *task) {
 		return success;
 	}
 
-	SDL_LockMutex(task->mutex);
+	task_lock(task);
 
 	if(task->status == TASK_PENDING) {
 		task->status = TASK_CANCELLED;
 		success = true;
 	}
 
-	SDL_UnlockMutex(task->mutex);
+	task_unlock(task);
 
 	return success;
 }
@@ -377,12 +602,12 @@ bool task_detach(Task *task) {
 		return success;
 	}
 
-	SDL_LockMutex(task->mutex);
+	task_lock(task);
 	assert(!task->disowned);
 	task->disowned = true;
 	task_in_queue = task->in_queue;
 	success = true;
-	SDL_UnlockMutex(task->mutex);
+	task_unlock(task);
 
 	if(!task_in_queue) {
 		task_free(task);
@@ -403,6 +628,111 @@ bool task_abort(Task *task) {
 	return success;
 }
 
+void taskgroup_init(TaskGroup *group, TaskManager *mgr) {
+	*group = (TaskGroup) { .mgr = mgr };
+}
+
+void taskgroup_submit(TaskGroup *group, TaskParams params) {
+	TaskManager *mgr = group->mgr ? group->mgr : g_taskmgr;
+
+	if(mgr == NULL) {
+		params.callback(params.userdata);
+
+		if(params.userdata_free_callback) {
+			params.userdata_free_callback(params.userdata);
+		}
+
+		return;
+	}
+
+	group->mgr = mgr;
+	taskmgr_submit_internal(mgr, &params, group);
+}
+
+void taskgroup_wait(TaskGroup *group) {
+	TaskManager *mgr = group->mgr;
+
+	if(mgr == NULL) {
+		assert(SDL_AtomicGet(&group->pending) == 0);
+		return;
+	}
+
+	TaskWorker *self = taskmgr_current_worker(mgr);
+
+	// Help with the group's own queued tasks first. This is also what prevents deadlocks when
+	// waiting from within a worker thread.
+	for(Task *task; SDL_AtomicGet(&group->pending) > 0 && (task = taskmgr_pop_task(mgr, self, group));) {
+		task_process(task, false);
+	}
+
+	// Whatever remains is already being executed by other threads.
+	TaskWaitBucket *b = wait_bucket(group);
+	SDL_LockMutex(b->mutex);
+	while(SDL_AtomicGet(&group->pending) > 0) {
+		SDL_CondWait(b->cond, b->mutex);
+	}
+	SDL_UnlockMutex(b->mutex);
+}
+
+typedef struct ParallelForChunk {
+	task_parallel_func_t func;
+	void *userdata;
+	uint begin, end;
+} ParallelForChunk;
+
+static void *parallel_for_task(void *arg) {
+	ParallelForChunk *c = arg;
+	c->func(c->begin, c->end, c->userdata);
+	return NULL;
+}
+
+void taskmgr_parallel_for(
+	TaskManager *mgr, uint num_items, uint batch_size, task_parallel_func_t func, void *userdata
+) {
+	if(mgr == NULL) {
+		mgr = g_taskmgr;
+	}
+
+	if(num_items == 0) {
+		return;
+	}
+
+	if(batch_size == 0) {
+		uint nchunks = mgr ? mgr->numthreads * 4 : 1;
+		batch_size = max(1, (num_items + nchunks - 1) / nchunks);
+	}
+
+	uint nchunks = (num_items + batch_size - 1) / batch_size;
+
+	if(mgr == NULL || nchunks < 2) {
+		func(0, num_items, userdata);
+		return;
+	}
+
+	ParallelForChunk *chunks = ALLOC_ARRAY(nchunks, typeof(*chunks));
+	TaskGroup group;
+	taskgroup_init(&group, mgr);
+
+	for(uint i = 0; i < nchunks; ++i) {
+		chunks[i] = (ParallelForChunk) {
+			.func = func,
+			.userdata = userdata,
+			.begin = i * batch_size,
+			.end = min(num_items, (i + 1) * batch_size),
+		};
+	}
+
+	// The last chunk runs on the calling thread, the rest are picked up by the workers
+	// (or by taskgroup_wait below, if they're all busy).
+	for(uint i = 0; i < nchunks - 1; ++i) {
+		taskgroup_submit(&group, (TaskParams) { .callback = parallel_for_task, .userdata = chunks + i });
+	}
+
+	parallel_for_task(chunks + nchunks - 1);
+	taskgroup_wait(&group);
+	mem_free(chunks);
+}
+
 void taskmgr_global_init(void) {
 	assert(g_taskmgr == NULL);
 	int nthreads = env_get("TAISEI_TASKMGR_NUM_THREADS", 0);
@@ -414,6 +744,12 @@ void taskmgr_global_shutdown(void) {
 		taskmgr_finish(g_taskmgr);
 		g_taskmgr = NULL;
 	}
+
+	tsys_shutdown();
+}
+
+TaskManager *taskmgr_global(void) {
+	return g_taskmgr;
 }
 
 Task *taskmgr_global_submit(TaskParams params) {
@@ -422,6 +758,7 @@ Task *taskmgr_global_submit(TaskParams params) {
 			.callback = params.callback,
 			.userdata = params.userdata,
 			.userdata_free_callback = params.userdata_free_callback,
+			.status = TASK_FINISHED,
 			.result = params.callback(params.userdata),
 		});
 	}
@@ -24,6 +24,16 @@ typedef enum TaskStatus {
 
 typedef void *(*task_func_t)(void *userdata);
 typedef void (*task_free_func_t)(void *userdata);
+typedef void (*task_parallel_func_t)(uint begin, uint end, void *userdata);
+
+/**
+ * A set of detached tasks that can be waited on together. See `taskgroup_submit`.
+ * Treat the contents as opaque.
+ */
+typedef struct TaskGroup {
+	TaskManager *mgr;
+	SDL_atomic_t pending;
+} TaskGroup;
 
 /**
  * Parameters for `taskmgr_submit`. See its documentation below.
@@ -54,6 +64,9 @@ typedef struct TaskParams {
 	 * to the queue ahead of the lower priority ones, and thus will start executing sooner. Note
 	 * that this affects only the pending tasks. A task that already began executing cannot be
 	 * interrupted, regardless of its priority.
+	 *
+	 * Every worker thread has its own queue, and idle workers steal tasks from the others, so
+	 * the ordering is only strict among tasks that ended up in the same queue.
 	 */
 	int prio;
 
@@ -161,6 +174,39 @@ bool task_finish(Task *task, void **result);
  */
 bool task_abort(Task *task);
 
+/**
+ * Initialize [group] for use with [mgr]. If [mgr] is NULL, the global task manager is used.
+ */
+void taskgroup_init(TaskGroup *group, TaskManager *mgr)
+	attr_nonnull(1);
+
+/**
+ * Submit a detached task as part of [group]. Unlike `taskmgr_submit`, no Task handle is returned;
+ * use `taskgroup_wait` to wait for all of the group's tasks at once.
+ *
+ * If there is no task manager to submit to, the task is executed immediately.
+ */
+void taskgroup_submit(TaskGroup *group, TaskParams params)
+	attr_nonnull(1);
+
+/**
+ * Wait for all tasks submitted to [group] to complete. Tasks of the group that haven't started
+ * yet are executed on the calling thread. Safe to call from within a task.
+ */
+void taskgroup_wait(TaskGroup *group)
+	attr_nonnull(1);
+
+/**
+ * Call [func] for consecutive ranges of [0, num_items), in parallel, and wait for all of them to
+ * complete. Ranges are at most [batch_size] items long; if it's 0, a size is chosen based on the
+ * number of worker threads. One of the ranges is processed on the calling thread.
+ *
+ * If [mgr] is NULL, the global task manager is used.
+ */
+void taskmgr_parallel_for(
+	TaskManager *mgr, uint num_items, uint batch_size, task_parallel_func_t func, void *userdata
+) attr_nonnull(4);
+
 /**
  * Initialize the global task manager with default parameters.
  */
@@ -172,6 +218,11 @@ void taskmgr_global_init(void);
  */
 void taskmgr_global_shutdown(void);
 
+/**
+ * Returns the global task manager, or NULL if it's not initialized.
+ */
+TaskManager *taskmgr_global(void);
+
 /**
  * Submit a task to the global task manager. See `taskmgr_submit`.
  */
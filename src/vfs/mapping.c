@@ -0,0 +1,108 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+ */
+
+#include "taisei.h"
+
+#include "private.h"
+
+typedef struct MappedRW {
+	VFSMapping mapping;
+	size_t pos;
+} MappedRW;
+
+#define MAPPED_RW(rw) ((MappedRW*)((rw)->hidden.unknown.data1))
+
+void vfs_unmap(VFSMapping *mapping) {
+	if(mapping->_unmap) {
+		mapping->_unmap(mapping);
+	}
+
+	*mapping = (VFSMapping) { 0 };
+}
+
+static int64_t maprw_seek(SDL_RWops *rw, int64_t offset, int whence) {
+	MappedRW *m = MAPPED_RW(rw);
+	int64_t pos;
+
+	switch(whence) {
+		case RW_SEEK_SET: pos = offset; break;
+		case RW_SEEK_CUR: pos = m->pos + offset; break;
+		case RW_SEEK_END: pos = m->mapping.size + offset; break;
+		default: return SDL_SetError("Bad whence value %i", whence);
+	}
+
+	m->pos = clamp(pos, 0, (int64_t)m->mapping.size);
+	return m->pos;
+}
+
+static int64_t maprw_size(SDL_RWops *rw) {
+	return MAPPED_RW(rw)->mapping.size;
+}
+
+static size_t maprw_read(SDL_RWops *rw, void *ptr, size_t size, size_t maxnum) {
+	MappedRW *m = MAPPED_RW(rw);
+
+	if(UNLIKELY(size == 0)) {
+		return 0;
+	}
+
+	size_t num = min(maxnum, (m->mapping.size - m->pos) / size);
+	memcpy(ptr, (const uint8_t*)m->mapping.data + m->pos, num * size);
+	m->pos += num * size;
+	return num;
+}
+
+static size_t maprw_write(SDL_RWops *rw, const void *ptr, size_t size, size_t maxnum) {
+	SDL_SetError("Memory-mapped streams are read-only");
+	return 0;
+}
+
+static int maprw_close(SDL_RWops *rw) {
+	if(rw) {
+		MappedRW *m = MAPPED_RW(rw);
+		vfs_unmap(&m->mapping);
+		mem_free(m);
+		SDL_FreeRW(rw);
+	}
+
+	return 0;
+}
+
+SDL_RWops *vfs_mapping_rwops(VFSMapping *mapping) {
+	SDL_RWops *rw = SDL_AllocRW();
+
+	if(UNLIKELY(!rw)) {
+		vfs_unmap(mapping);
+		return NULL;
+	}
+
+	memset(rw, 0, sizeof(SDL_RWops));
+
+	rw->type = SDL_RWOPS_UNKNOWN;
+	rw->seek = maprw_seek;
+	rw->size = maprw_size;
+	rw->read = maprw_read;
+	rw->write = maprw_write;
+	rw->close = maprw_close;
+	rw->hidden.unknown.data1 = ALLOC(MappedRW, {
+		.mapping = *mapping,
+	});
+
+	*mapping = (VFSMapping) { 0 };
+	return rw;
+}
+
+const void *vfs_stream_mapped_data(SDL_RWops *stream, size_t *remaining) {
+	if(stream->close != maprw_close) {
+		return NULL;
+	}
+
+	MappedRW *m = MAPPED_RW(stream);
+	*remaining = m->mapping.size - m->pos;
+	return (const uint8_t*)m->mapping.data + m->pos;
+}
@@ -139,7 +139,12 @@ bool vfs_node_mount(VFSNode *mountroot, const char *subname, VFSNode *mountee) {
 		return false;
 	}
 
-	return mountroot->funcs->mount(mountroot, subname, mountee);
+	if(!mountroot->funcs->mount(mountroot, subname, mountee)) {
+		return false;
+	}
+
+	vfs_invalidate_caches();
+	return true;
 }
 
 bool vfs_node_unmount(VFSNode *mountroot, const char *subname) {
@@ -150,7 +155,12 @@ bool vfs_node_unmount(VFSNode *mountroot, const char *subname) {
 		return false;
 	}
 
-	return mountroot->funcs->unmount(mountroot, subname);
+	if(!mountroot->funcs->unmount(mountroot, subname)) {
+		return false;
+	}
+
+	vfs_invalidate_caches();
+	return true;
 }
 
 bool vfs_node_mkdir(VFSNode *parent, const char *subdir) {
@@ -167,6 +177,22 @@ bool vfs_node_mkdir(VFSNode *parent, const char *subdir) {
 SDL_RWops *vfs_node_open(VFSNode *filenode, VFSOpenMode mode) {
 	assert(filenode->funcs != NULL);
 
+	if(mode & VFS_MODE_MAPPED) {
+		VFSMapping mapping;
+
+		if(!(mode & VFS_MODE_WRITE) && vfs_node_map(filenode, &mapping)) {
+			// Already read-only, no need for a wrapper
+			SDL_RWops *stream = vfs_mapping_rwops(&mapping);
+
+			if(stream) {
+				return stream;
+			}
+		}
+
+		// Just a hint, fall back to a regular stream
+		mode &= ~VFS_MODE_MAPPED;
+	}
+
 	if(filenode->funcs->open == NULL) {
 		vfs_set_error("Node can't be opened as a file");
 		return NULL;
@@ -184,3 +210,48 @@ SDL_RWops *vfs_node_open(VFSNode *filenode, VFSOpenMode mode) {
 
 	return stream;
 }
+
+bool vfs_node_map(VFSNode *filenode, VFSMapping *mapping) {
+	assert(filenode->funcs != NULL);
+
+	if(filenode->funcs->map == NULL) {
+		vfs_set_error("Node can't be memory-mapped");
+		return false;
+	}
+
+	*mapping = (VFSMapping) { 0 };
+	return filenode->funcs->map(filenode, mapping);
+}
+
+bool vfs_node_unlink(VFSNode *node) {
+	assert(node->funcs != NULL);
+
+	if(node->funcs->unlink == NULL) {
+		vfs_set_error("Node doesn't support removal");
+		return false;
+	}
+
+	return node->funcs->unlink(node);
+}
+
+bool vfs_node_rename(VFSNode *node, const char *new_name) {
+	assert(node->funcs != NULL);
+
+	if(node->funcs->rename == NULL) {
+		vfs_set_error("Node doesn't support renaming");
+		return false;
+	}
+
+	return node->funcs->rename(node, new_name);
+}
+
+bool vfs_node_touch(VFSNode *node) {
+	assert(node->funcs != NULL);
+
+	if(node->funcs->touch == NULL) {
+		vfs_set_error("Node doesn't support changing timestamps");
+		return false;
+	}
+
+	return node->funcs->touch(node);
+}
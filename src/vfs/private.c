@@ -26,6 +26,7 @@ typedef struct vfs_shutdownhook_t {
 static SDL_TLSID vfs_tls_id;
 static vfs_tls_t *vfs_tls_fallback;
 static vfs_shutdownhook_t *shutdown_hooks;
+static SDL_atomic_t vfs_generation;
 
 static void vfs_free(VFSNode *node);
 
@@ -86,6 +87,14 @@ void vfs_shutdown(void) {
 	vfs_tls_fallback = NULL;
 }
 
+uint vfs_get_generation(void) {
+	return SDL_AtomicGet(&vfs_generation);
+}
+
+void vfs_invalidate_caches(void) {
+	SDL_AtomicIncRef(&vfs_generation);
+}
+
 void vfs_hook_on_shutdown(VFSShutdownHandler func, void *arg) {
 	list_append(&shutdown_hooks, ALLOC(vfs_shutdownhook_t, {
 		.func = func,
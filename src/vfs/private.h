@@ -35,6 +35,10 @@ struct VFSNodeFuncs {
 	void        (*iter_stop)(VFSNode *dirnode, void **opaque) attr_nonnull(1);
 	bool        (*mkdir)(VFSNode *parent, const char *subdir) attr_nonnull(1);
 	SDL_RWops*  (*open)(VFSNode *filenode, VFSOpenMode mode) attr_nonnull(1);
+	bool        (*map)(VFSNode *filenode, VFSMapping *mapping) attr_nonnull(1, 2);
+	bool        (*unlink)(VFSNode *node) attr_nonnull(1);
+	bool        (*rename)(VFSNode *node, const char *new_name) attr_nonnull(1, 2);
+	bool        (*touch)(VFSNode *node) attr_nonnull(1);
 };
 
 struct VFSNode {
@@ -115,6 +119,10 @@ const char *vfs_node_iter(VFSNode *node, void **opaque) attr_nonnull(1);
 void vfs_node_iter_stop(VFSNode *node, void **opaque) attr_nonnull(1);
 bool vfs_node_mkdir(VFSNode *parent, const char *subdir) attr_nonnull(1);
 SDL_RWops *vfs_node_open(VFSNode *filenode, VFSOpenMode mode) attr_nonnull(1) attr_nodiscard;
+bool vfs_node_map(VFSNode *filenode, VFSMapping *mapping) attr_nonnull(1, 2) attr_nodiscard;
+bool vfs_node_unlink(VFSNode *node) attr_nonnull(1);
+bool vfs_node_rename(VFSNode *node, const char *new_name) attr_nonnull(1, 2);
+bool vfs_node_touch(VFSNode *node) attr_nonnull(1);
 
 // NOTE: convenience wrappers added on demand
 
@@ -131,5 +139,11 @@ SDL_RWops *vfs_node_open(VFSNode *filenode, VFSOpenMode mode) attr_nonnull(1) at
 	vfs_node_repr(VFS_NODE_AS_BASE(node), try_syspath)
 
 
+// Takes ownership of the mapping, even on failure
+SDL_RWops *vfs_mapping_rwops(VFSMapping *mapping) attr_nonnull(1) attr_nodiscard;
+
+// Changes whenever cached lookup results may have become stale; see vfs_invalidate_caches()
+uint vfs_get_generation(void);
+
 void vfs_hook_on_shutdown(VFSShutdownHandler, void *arg);
 void vfs_print_tree_recurse(SDL_RWops *dest, VFSNode *root, char *prefix, const char *name) attr_nonnull(1, 2, 3, 4);
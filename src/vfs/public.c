@@ -9,12 +9,50 @@
 #include "taisei.h"
 
 #include "private.h"
+#include "union.h"
 
 typedef struct VFSDir {
 	VFSNode *node;
 	void *opaque;
 } VFSDir;
 
+// Call after creating, removing or renaming a node at or directly under (normalized) path.
+// Only mounted unions cache lookups, so there's nothing to invalidate unless the path goes
+// through one. This matters for things like the texture cache, which writes and renames files
+// while resources are being looked up in res.
+// NOTE: doesn't notice the same directory being reachable through another, union-backed mount.
+static void vfs_invalidate_caches_for_path(const char *path) {
+	char buf[strlen(path) + 1];
+	memcpy(buf, path, sizeof(buf));
+
+	char *end = buf;
+
+	do {
+		// Every prefix, then the whole path
+		if((end = strchr(end, VFS_PATH_SEPARATOR))) {
+			*end = 0;
+		}
+
+		VFSNode *node = vfs_locate(vfs_root, buf);
+
+		if(end) {
+			*end++ = VFS_PATH_SEPARATOR;
+		}
+
+		if(!node) {
+			continue;
+		}
+
+		bool is_union = vfs_node_is_union(node);
+		vfs_decref(node);
+
+		if(is_union) {
+			vfs_invalidate_caches();
+			return;
+		}
+	} while(end);
+}
+
 bool vfs_mount_alias(const char *dst, const char *src) {
 	if(UNLIKELY(!vfs_initialized())) {
 		return false;
@@ -81,6 +119,104 @@ SDL_RWops* vfs_open(const char *path, VFSOpenMode mode) {
 	return rwops;
 }
 
+bool vfs_map(const char *path, VFSMapping *mapping) {
+	*mapping = (VFSMapping) { 0 };
+
+	if(UNLIKELY(!vfs_initialized())) {
+		return false;
+	}
+
+	bool ok = false;
+	char p[strlen(path)+1];
+	path = vfs_path_normalize(path, p);
+	VFSNode *node = vfs_locate(vfs_root, path);
+
+	if(node) {
+		if(!(ok = vfs_node_map(node, mapping))) {
+			vfs_set_error("Can't map '%s': %s", path, vfs_get_error());
+		}
+
+		vfs_decref(node);
+	} else {
+		vfs_set_error("Node '%s' does not exist", path);
+	}
+
+	return ok;
+}
+
+bool vfs_unlink(const char *path) {
+	if(UNLIKELY(!vfs_initialized())) {
+		return false;
+	}
+
+	bool ok = false;
+	char p[strlen(path)+1];
+	path = vfs_path_normalize(path, p);
+	VFSNode *node = vfs_locate(vfs_root, path);
+
+	if(node) {
+		ok = vfs_node_unlink(node);
+		vfs_decref(node);
+
+		if(ok) {
+			vfs_invalidate_caches_for_path(path);
+		}
+	} else {
+		vfs_set_error("Node '%s' does not exist", path);
+	}
+
+	return ok;
+}
+
+bool vfs_rename(const char *path, const char *new_name) {
+	if(UNLIKELY(!vfs_initialized())) {
+		return false;
+	}
+
+	if(strchr(new_name, VFS_PATH_SEPARATOR)) {
+		vfs_set_error("'%s' is not a plain file name", new_name);
+		return false;
+	}
+
+	bool ok = false;
+	char p[strlen(path)+1];
+	path = vfs_path_normalize(path, p);
+	VFSNode *node = vfs_locate(vfs_root, path);
+
+	if(node) {
+		ok = vfs_node_rename(node, new_name);
+		vfs_decref(node);
+
+		if(ok) {
+			vfs_invalidate_caches_for_path(path);
+		}
+	} else {
+		vfs_set_error("Node '%s' does not exist", path);
+	}
+
+	return ok;
+}
+
+bool vfs_touch(const char *path) {
+	if(UNLIKELY(!vfs_initialized())) {
+		return false;
+	}
+
+	bool ok = false;
+	char p[strlen(path)+1];
+	path = vfs_path_normalize(path, p);
+	VFSNode *node = vfs_locate(vfs_root, path);
+
+	if(node) {
+		ok = vfs_node_touch(node);
+		vfs_decref(node);
+	} else {
+		vfs_set_error("Node '%s' does not exist", path);
+	}
+
+	return ok;
+}
+
 VFSInfo vfs_query(const char *path) {
 	if(UNLIKELY(!vfs_initialized())) {
 		return VFSINFO_ERROR;
@@ -120,6 +256,7 @@ bool vfs_mkdir(const char *path) {
 		vfs_decref(node);
 
 		if(ok) {
+			vfs_invalidate_caches_for_path(path);
 			return ok;
 		}
 	}
@@ -131,6 +268,11 @@ bool vfs_mkdir(const char *path) {
 	if(node) {
 		ok = vfs_node_mkdir(node, subdir);
 		vfs_decref(node);
+
+		if(ok) {
+			vfs_invalidate_caches_for_path(parent);
+		}
+
 		return ok;
 	} else {
 		vfs_set_error("Node '%s' does not exist", parent);
@@ -22,6 +22,10 @@ typedef struct VFSInfo {
 	uchar exists      : 1;
 	uchar is_dir      : 1;
 	uchar is_readonly : 1;
+
+	// Only known for files on the real filesystem; 0 otherwise
+	uint64_t size;
+	int64_t mtime;  // seconds since the Unix epoch
 } VFSInfo;
 
 #define VFSINFO_ERROR ((VFSInfo) { .error = true, 0 })
@@ -30,6 +34,9 @@ typedef enum VFSOpenMode {
 	VFS_MODE_READ = 1,
 	VFS_MODE_WRITE = 2,
 	VFS_MODE_SEEKABLE  = 4,
+	// Read-only hint: back the stream with a memory mapping if the file allows it.
+	// See vfs_stream_mapped_data().
+	VFS_MODE_MAPPED = 8,
 } VFSOpenMode;
 
 typedef enum VFSSyncMode {
@@ -41,13 +48,43 @@ typedef enum VFSSyncMode {
 
 typedef struct VFSDir VFSDir;
 
+typedef struct VFSMapping {
+	const void *data;
+	size_t size;
+
+	// private
+	void (*_unmap)(struct VFSMapping *mapping);
+	void *_handle;
+} VFSMapping;
+
 SDL_RWops* vfs_open(const char *path, VFSOpenMode mode);
+
+// Maps a file into memory, read-only. This only works for plain files on platforms with mmap,
+// and for uncompressed entries of zip archives that can themselves be mapped. Returns false
+// otherwise; vfs_open() is the fallback.
+bool vfs_map(const char *path, VFSMapping *mapping) attr_nonnull_all attr_nodiscard;
+void vfs_unmap(VFSMapping *mapping) attr_nonnull_all;
+
+// If the stream was opened with VFS_MODE_MAPPED and is actually backed by a mapping, returns a
+// pointer to its data at the current position, and the number of bytes left. Returns NULL
+// otherwise. The pointer stays valid until the stream is closed.
+const void *vfs_stream_mapped_data(SDL_RWops *stream, size_t *remaining) attr_nonnull_all;
 VFSInfo vfs_query(const char *path);
 
 bool vfs_mkdir(const char *path);
 void vfs_mkdir_required(const char *path);
 bool vfs_mkparents(const char *path);
 
+// Removes a file or an empty directory.
+bool vfs_unlink(const char *path) attr_nonnull_all;
+
+// Renames a file within its directory, replacing any existing file called [new_name].
+// On the real filesystem, this is atomic.
+bool vfs_rename(const char *path, const char *new_name) attr_nonnull_all;
+
+// Sets the modification time of a file to the current time.
+bool vfs_touch(const char *path) attr_nonnull_all;
+
 bool vfs_mount_alias(const char *dst, const char *src);
 bool vfs_unmount(const char *path);
 
@@ -73,3 +110,7 @@ bool vfs_initialized(void);
 const char* vfs_get_error(void) attr_returns_nonnull;
 
 void vfs_sync(VFSSyncMode mode, CallChain next);
+
+// Drops cached lookup results. Call when files may have been created or removed (e.g. on
+// filewatch events). Mounting, unmounting and creating directories already take care of this.
+void vfs_invalidate_caches(void);
@@ -84,6 +84,10 @@ static SDL_RWops* vfs_ro_open(VFSNode *filenode, VFSOpenMode mode) {
 	return SDL_RWWrapReadOnly(vfs_node_open(WRAPPED(filenode), mode), true);
 }
 
+static bool vfs_ro_map(VFSNode *filenode, VFSMapping *mapping) {
+	return vfs_node_map(WRAPPED(filenode), mapping);
+}
+
 VFS_NODE_FUNCS(VFSReadOnlyNode, {
 	.repr = vfs_ro_repr,
 	.query = vfs_ro_query,
@@ -94,6 +98,7 @@ VFS_NODE_FUNCS(VFSReadOnlyNode, {
 	.iter_stop = vfs_ro_iter_stop,
 	.mkdir = vfs_ro_mkdir,
 	.open = vfs_ro_open,
+	.map = vfs_ro_map,
 	.mount = vfs_ro_mount,
 	.unmount = vfs_ro_unmount,
 });
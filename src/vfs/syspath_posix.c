@@ -13,6 +13,11 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+
+#ifdef TAISEI_BUILDCONF_HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include "syspath.h"
 
@@ -35,6 +40,8 @@ static VFSInfo vfs_syspath_query(VFSNode *node) {
 	if(stat(VFS_NODE_CAST(VFSSysPathNode, node)->path, &fstat) >= 0) {
 		i.exists = true;
 		i.is_dir = S_ISDIR(fstat.st_mode);
+		i.size = fstat.st_size;
+		i.mtime = fstat.st_mtime;
 	}
 
 	return i;
@@ -52,6 +59,61 @@ static SDL_RWops *vfs_syspath_open(VFSNode *node, VFSOpenMode mode) {
 	return rwops;
 }
 
+#ifdef TAISEI_BUILDCONF_HAVE_MMAP
+
+static void vfs_syspath_unmap(VFSMapping *mapping) {
+	munmap((void*)mapping->data, mapping->size);
+}
+
+static bool vfs_syspath_map(VFSNode *node, VFSMapping *mapping) {
+	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
+	int fd = open(pnode->path, O_RDONLY | O_CLOEXEC);
+
+	if(fd < 0) {
+		vfs_set_error("Can't open %s: %s", pnode->path, strerror(errno));
+		return false;
+	}
+
+	struct stat st;
+
+	if(fstat(fd, &st) < 0) {
+		vfs_set_error("Can't stat %s: %s", pnode->path, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	if(!S_ISREG(st.st_mode) || (uint64_t)st.st_size > SIZE_MAX) {
+		vfs_set_error("%s can't be memory-mapped", pnode->path);
+		close(fd);
+		return false;
+	}
+
+	if(st.st_size == 0) {
+		// mmap refuses zero-length mappings
+		close(fd);
+		mapping->data = "";
+		return true;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(data == MAP_FAILED) {
+		vfs_set_error("Can't map %s: %s", pnode->path, strerror(errno));
+		return false;
+	}
+
+	// Loaders almost always consume the whole file; start reading it in right away
+	posix_madvise(data, st.st_size, POSIX_MADV_WILLNEED);
+
+	mapping->data = data;
+	mapping->size = st.st_size;
+	mapping->_unmap = vfs_syspath_unmap;
+	return true;
+}
+
+#endif
+
 static VFSNode *vfs_syspath_locate(VFSNode *node, const char *path) {
 	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
 	return vfs_syspath_create_internal(strjoin(pnode->path, "/", path, NULL));
@@ -129,6 +191,49 @@ static bool vfs_syspath_mkdir(VFSNode *node, const char *subdir) {
 	return ok;
 }
 
+static bool vfs_syspath_unlink(VFSNode *node) {
+	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
+
+	if(remove(pnode->path) < 0) {
+		vfs_set_error("Can't remove %s: %s", pnode->path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+static bool vfs_syspath_rename(VFSNode *node, const char *new_name) {
+	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
+	const char *sep = strrchr(pnode->path, '/');
+	char *new_path;
+
+	if(sep) {
+		new_path = strfmt("%.*s/%s", (int)(sep - pnode->path), pnode->path, new_name);
+	} else {
+		new_path = strdup(new_name);
+	}
+
+	bool ok = !rename(pnode->path, new_path);
+
+	if(!ok) {
+		vfs_set_error("Can't rename %s to %s: %s", pnode->path, new_path, strerror(errno));
+	}
+
+	mem_free(new_path);
+	return ok;
+}
+
+static bool vfs_syspath_touch(VFSNode *node) {
+	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
+
+	if(utimensat(AT_FDCWD, pnode->path, NULL, 0) < 0) {
+		vfs_set_error("Can't update timestamps of %s: %s", pnode->path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
 VFS_NODE_FUNCS(VFSSysPathNode, {
 	.repr = vfs_syspath_repr,
 	.query = vfs_syspath_query,
@@ -139,6 +244,12 @@ VFS_NODE_FUNCS(VFSSysPathNode, {
 	.iter_stop = vfs_syspath_iter_stop,
 	.mkdir = vfs_syspath_mkdir,
 	.open = vfs_syspath_open,
+	.unlink = vfs_syspath_unlink,
+	.rename = vfs_syspath_rename,
+	.touch = vfs_syspath_touch,
+#ifdef TAISEI_BUILDCONF_HAVE_MMAP
+	.map = vfs_syspath_map,
+#endif
 });
 
 void vfs_syspath_normalize(char *buf, size_t bufsize, const char *path) {
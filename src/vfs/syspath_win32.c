@@ -81,15 +81,20 @@ static VFSInfo vfs_syspath_query(VFSNode *node) {
 		return i;
 	}
 
-	DWORD attrib = GetFileAttributes(pnode->wpath);
+	WIN32_FILE_ATTRIBUTE_DATA data;
 
-	if(attrib == INVALID_FILE_ATTRIBUTES) {
+	if(!GetFileAttributesEx(pnode->wpath, GetFileExInfoStandard, &data)) {
 		vfs_set_error_win32();
 		return VFSINFO_ERROR;
 	}
 
 	i.exists = true;
-	i.is_dir = (bool)(attrib & FILE_ATTRIBUTE_DIRECTORY);
+	i.is_dir = (bool)(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+	i.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+
+	// FILETIME counts 100ns intervals since 1601-01-01
+	uint64_t ft = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	i.mtime = (int64_t)(ft / 10000000) - 11644473600LL;
 
 	return i;
 }
@@ -226,6 +231,71 @@ static bool vfs_syspath_mkdir(VFSNode *node, const char *subdir) {
 	return ok;
 }
 
+static bool vfs_syspath_unlink(VFSNode *node) {
+	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
+	DWORD attrib = GetFileAttributes(pnode->wpath);
+	bool ok;
+
+	if(attrib != INVALID_FILE_ATTRIBUTES && (attrib & FILE_ATTRIBUTE_DIRECTORY)) {
+		ok = RemoveDirectory(pnode->wpath);
+	} else {
+		ok = DeleteFile(pnode->wpath);
+	}
+
+	if(!ok) {
+		vfs_set_error_win32();
+	}
+
+	return ok;
+}
+
+static bool vfs_syspath_rename(VFSNode *node, const char *new_name) {
+	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
+	const char *sep = strrchr(pnode->path, '\\');
+	char *new_path;
+
+	if(sep) {
+		new_path = strfmt("%.*s\\%s", (int)(sep - pnode->path), pnode->path, new_name);
+	} else {
+		new_path = strdup(new_name);
+	}
+
+	wchar_t *new_wpath = WIN_UTF8ToString(new_path);
+	bool ok = MoveFileEx(pnode->wpath, new_wpath, MOVEFILE_REPLACE_EXISTING);
+
+	if(!ok) {
+		vfs_set_error_win32();
+	}
+
+	mem_free(new_path);
+	mem_free(new_wpath);
+	return ok;
+}
+
+static bool vfs_syspath_touch(VFSNode *node) {
+	auto pnode = VFS_NODE_CAST(VFSSysPathNode, node);
+	HANDLE h = CreateFile(
+		pnode->wpath, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL
+	);
+
+	if(h == INVALID_HANDLE_VALUE) {
+		vfs_set_error_win32();
+		return false;
+	}
+
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	bool ok = SetFileTime(h, NULL, NULL, &now);
+
+	if(!ok) {
+		vfs_set_error_win32();
+	}
+
+	CloseHandle(h);
+	return ok;
+}
+
 VFS_NODE_FUNCS(VFSSysPathNode, {
 	.repr = vfs_syspath_repr,
 	.query = vfs_syspath_query,
@@ -236,6 +306,9 @@ VFS_NODE_FUNCS(VFSSysPathNode, {
 	.iter_stop = vfs_syspath_iter_stop,
 	.mkdir = vfs_syspath_mkdir,
 	.open = vfs_syspath_open,
+	.unlink = vfs_syspath_unlink,
+	.rename = vfs_syspath_rename,
+	.touch = vfs_syspath_touch,
 });
 
 void vfs_syspath_normalize(char *buf, size_t bufsize, const char *path) {
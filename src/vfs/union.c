@@ -10,18 +10,68 @@
 
 #include "union.h"
 
+typedef struct VFSUnionCacheEntry {
+	VFSNode *node;
+	uint cost;      // see vfs_union_lookup_cost
+} VFSUnionCacheEntry;
+
 VFS_NODE_TYPE(VFSUnionNode, {
 	DYNAMIC_ARRAY(VFSNode*) members;
+
+	// Path resolution cache. Only enabled on mounted unions, not on the temporary ones created
+	// to merge subdirectories. Flushed whenever the VFS generation changes. Only successful
+	// lookups are cached: files may appear behind our back, and a cached miss would hide them
+	// until the next invalidation.
+	struct {
+		SDL_mutex *mutex;
+		ht_str2ptr_t entries;
+		uint generation;
+		uint hits;
+		uint misses;
+		uint64_t lookups_saved;
+	} cache;
 });
 
+static void vfs_union_cache_flush(VFSUnionNode *unode) {
+	ht_str2ptr_iter_t iter;
+	ht_iter_begin(&unode->cache.entries, &iter);
+
+	for(; iter.has_data; ht_iter_next(&iter)) {
+		VFSUnionCacheEntry *e = iter.value;
+		vfs_decref(e->node);
+		mem_free(e);
+	}
+
+	ht_iter_end(&iter);
+	ht_unset_all(&unode->cache.entries);
+}
+
 static void vfs_union_free(VFSNode *node) {
 	auto unode = VFS_NODE_CAST(VFSUnionNode, node);
+
+	if(unode->cache.mutex) {
+		if(unode->cache.hits) {
+			char *r = vfs_node_repr(unode, false);
+			log_info("%s: %u lookups served from cache (%u misses), saving %"PRIu64" node queries",
+				r, unode->cache.hits, unode->cache.misses, unode->cache.lookups_saved);
+			mem_free(r);
+		}
+
+		vfs_union_cache_flush(unode);
+		ht_destroy(&unode->cache.entries);
+		SDL_DestroyMutex(unode->cache.mutex);
+	}
+
 	dynarray_foreach_elem(&unode->members, VFSNode **node, {
 		vfs_decref(*node);
 	});
 	dynarray_free_data(&unode->members);
 }
 
+bool vfs_node_is_union(VFSNode *node) {
+	return VFS_NODE_TRY_CAST(VFSUnionNode, node) != NULL;
+}
+
 static VFSNode *vfs_union_get_primary(VFSUnionNode *unode) {
 	if(UNLIKELY(unode->members.num_elements == 0)) {
 		vfs_set_error("The union is empty");
@@ -31,9 +81,24 @@ static VFSNode *vfs_union_get_primary(VFSUnionNode *unode) {
 	return NOT_NULL(dynarray_get(&unode->members, unode->members.num_elements - 1));
 }
 
-static VFSNode *vfs_union_locate(VFSNode *node, const char *path) {
-	auto unode = VFS_NODE_CAST(VFSUnionNode, node);
+// How many non-union nodes a lookup through this one has to query, at worst. For filesystem
+// paths, each of those is a stat() call.
+static uint vfs_union_lookup_cost(VFSNode *node) {
+	auto unode = VFS_NODE_TRY_CAST(VFSUnionNode, node);
+
+	if(!unode) {
+		return 1;
+	}
 
+	uint cost = 0;
+	dynarray_foreach_elem(&unode->members, VFSNode **member, {
+		cost += vfs_union_lookup_cost(*member);
+	});
+
+	return cost;
+}
+
+static VFSNode *vfs_union_locate_uncached(VFSUnionNode *unode, const char *path, uint *cost) {
 	if(!vfs_union_get_primary(unode)) {
 		return NULL;
 	}
@@ -42,6 +107,7 @@ static VFSNode *vfs_union_locate(VFSNode *node, const char *path) {
 	int num_dirs = 0;
 
 	dynarray_foreach_elem_reversed(&unode->members, VFSNode **member, {
+		*cost += vfs_union_lookup_cost(*member);
 		auto subnode = vfs_locate(*member, path);
 
 		if(!subnode) {
@@ -80,6 +146,101 @@ static VFSNode *vfs_union_locate(VFSNode *node, const char *path) {
 	return &subunion->as_generic;
 }
 
+static bool vfs_union_cache_lookup(VFSUnionNode *unode, const char *path, VFSNode **out_node) {
+	bool found = false;
+	SDL_LockMutex(unode->cache.mutex);
+
+	if(unode->cache.generation != vfs_get_generation()) {
+		vfs_union_cache_flush(unode);
+		unode->cache.generation = vfs_get_generation();
+	}
+
+	VFSUnionCacheEntry *e = ht_get(&unode->cache.entries, path, NULL);
+
+	if(e) {
+		found = true;
+		*out_node = e->node;
+		vfs_incref(e->node);
+		++unode->cache.hits;
+		unode->cache.lookups_saved += e->cost;
+	} else {
+		++unode->cache.misses;
+	}
+
+	SDL_UnlockMutex(unode->cache.mutex);
+	return found;
+}
+
+static void vfs_union_cache_store(
+	VFSUnionNode *unode, const char *path, VFSNode *node, uint cost, uint generation
+) {
+	SDL_LockMutex(unode->cache.mutex);
+
+	// Don't cache results that may already be stale
+	if(
+		generation == vfs_get_generation() &&
+		generation == unode->cache.generation &&
+		!ht_get(&unode->cache.entries, path, NULL)
+	) {
+		vfs_incref(node);
+		ht_set(&unode->cache.entries, path, ALLOC(VFSUnionCacheEntry, {
+			.node = node,
+			.cost = cost,
+		}));
+	}
+
+	SDL_UnlockMutex(unode->cache.mutex);
+}
+
+static VFSNode *vfs_union_locate(VFSNode *node, const char *path) {
+	auto unode = VFS_NODE_CAST(VFSUnionNode, node);
+	uint cost = 0;
+
+	if(!unode->cache.mutex) {
+		return vfs_union_locate_uncached(unode, path, &cost);
+	}
+
+	VFSNode *result;
+	uint generation = vfs_get_generation();
+
+	if(vfs_union_cache_lookup(unode, path, &result)) {
+		return result;
+	}
+
+	result = vfs_union_locate_uncached(unode, path, &cost);
+
+	if(result) {
+		vfs_union_cache_store(unode, path, result, cost, generation);
+	}
+
+	return result;
+}
+
+static uint vfs_union_prewarm_dir(VFSNode *root, VFSNode *dir, const char *dirpath) {
+	uint num_paths = 0;
+	void *opaque = NULL;
+
+	for(const char *name; (name = vfs_node_iter(dir, &opaque));) {
+		char *path = *dirpath ? strfmt("%s%c%s", dirpath, VFS_PATH_SEPARATOR, name) : strdup(name);
+		VFSNode *node = vfs_locate(root, path);
+
+		if(node) {
+			++num_paths;
+
+			if(vfs_node_query(node).is_dir) {
+				num_paths += vfs_union_prewarm_dir(root, node, path);
+			}
+
+			vfs_decref(node);
+		}
+
+		mem_free(path);
+	}
+
+	vfs_node_iter_stop(dir, &opaque);
+	return num_paths;
+}
+
 typedef struct VFSUnionIterData {
 	ht_strset_t visited;
 	void *opaque;
@@ -174,6 +335,11 @@ static SDL_RWops *vfs_union_open(VFSNode *node, VFSOpenMode mode) {
 	return primary ? vfs_node_open(primary, mode) : NULL;
 }
 
+static bool vfs_union_map(VFSNode *node, VFSMapping *mapping) {
+	auto primary = vfs_union_get_primary(VFS_NODE_CAST(VFSUnionNode, node));
+	return primary ? vfs_node_map(primary, mapping) : false;
+}
+
 static char *vfs_union_repr(VFSNode *node) {
 	auto unode = VFS_NODE_CAST(VFSUnionNode, node);
 	StringBuffer sb = {};
@@ -214,12 +380,43 @@ VFS_NODE_FUNCS(VFSUnionNode, {
 	.iter_stop = vfs_union_iter_stop,
 	.mkdir = vfs_union_mkdir,
 	.open = vfs_union_open,
+	.map = vfs_union_map,
 });
 
 VFSNode *vfs_union_create(void) {
-	return &VFS_ALLOC(VFSUnionNode)->as_generic;
+	auto unode = VFS_ALLOC(VFSUnionNode);
+
+	if(env_get("TAISEI_VFS_UNION_CACHE", true)) {
+		unode->cache.mutex = SDL_CreateMutex();
+		unode->cache.generation = vfs_get_generation();
+		ht_create(&unode->cache.entries);
+	}
+
+	return &unode->as_generic;
 }
 
 bool vfs_create_union_mountpoint(const char *mountpoint) {
 	return vfs_mount_or_decref(vfs_root, mountpoint, vfs_union_create());
 }
+
+int vfs_union_prewarm(const char *mountpoint) {
+	char p[strlen(mountpoint)+1];
+	mountpoint = vfs_path_normalize(mountpoint, p);
+	VFSNode *node = vfs_locate(vfs_root, mountpoint);
+
+	if(!node) {
+		return -1;
+	}
+
+	auto unode = VFS_NODE_TRY_CAST(VFSUnionNode, node);
+
+	if(!unode || !unode->cache.mutex) {
+		vfs_set_error("'%s' is not a union with a lookup cache", mountpoint);
+		vfs_decref(node);
+		return -1;
+	}
+
+	uint num_paths = vfs_union_prewarm_dir(node, node, "");
+	vfs_decref(node);
+	return num_paths;
+}
@@ -13,3 +13,4 @@
 #include "union_public.h"
 
 VFSNode *vfs_union_create(void);
+bool vfs_node_is_union(VFSNode *node) attr_nonnull_all;
@@ -11,3 +11,8 @@
 
 bool vfs_create_union_mountpoint(const char *mountpoint)
 	attr_nonnull(1);
+
+// Resolves every path in the union mounted at mountpoint, so that later lookups are served from
+// its cache. Returns the number of paths found, or -1 on error.
+int vfs_union_prewarm(const char *mountpoint)
+	attr_nonnull(1);
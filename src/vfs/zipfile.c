@@ -148,6 +148,13 @@ static void vfs_zipfile_free(VFSNode *node) {
 		}
 
 		ht_destroy(&znode->pathmap);
+
+		mem_free(znode->map.data_offsets);
+		vfs_unmap(&znode->map.archive);
+
+		if(znode->map.mutex) {
+			SDL_DestroyMutex(znode->map.mutex);
+		}
 	}
 }
 
@@ -301,6 +308,260 @@ static bool vfs_zipfile_init_pathmap(VFSZipNode *znode) {
 	return true;
 }
 
+/*
+ * libzip doesn't expose where an entry's data starts within the archive, so we walk the central
+ * directory of the mapped archive ourselves. Entries are indexed in central directory order, same
+ * as in libzip, and the names are cross-checked to make sure the two agree.
+ */
+
+#define ZIP_SIG_EOCD        0x06054b50
+#define ZIP_SIG_EOCD64      0x06064b50
+#define ZIP_SIG_EOCD64_LOC  0x07064b50
+#define ZIP_SIG_CDIR_ENTRY  0x02014b50
+#define ZIP_SIG_LOCAL_ENTRY 0x04034b50
+
+#define ZIP_EOCD_SIZE        22
+#define ZIP_EOCD64_SIZE      56
+#define ZIP_EOCD64_LOC_SIZE  20
+#define ZIP_CDIR_ENTRY_SIZE  46
+#define ZIP_LOCAL_ENTRY_SIZE 30
+
+#define ZIP_EXTRA_ZIP64 0x0001
+
+INLINE uint16_t zip_get16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+INLINE uint32_t zip_get32(const uint8_t *p) {
+	return zip_get16(p) | ((uint32_t)zip_get16(p + 2) << 16);
+}
+
+INLINE uint64_t zip_get64(const uint8_t *p) {
+	return zip_get32(p) | ((uint64_t)zip_get32(p + 4) << 32);
+}
+
+static int64_t vfs_zipfile_locate_entry_data(
+	const uint8_t *cdir_entry, const uint8_t *cdir_end, const uint8_t *base, uint64_t size
+) {
+	const uint8_t *e = cdir_entry;
+	uint16_t flags = zip_get16(e + 8);
+	uint16_t method = zip_get16(e + 10);
+	uint64_t comp_size = zip_get32(e + 20);
+	uint64_t uncomp_size = zip_get32(e + 24);
+	uint16_t name_len = zip_get16(e + 28);
+	uint16_t extra_len = zip_get16(e + 30);
+	uint64_t local_ofs = zip_get32(e + 42);
+
+	const uint8_t *extra = e + ZIP_CDIR_ENTRY_SIZE + name_len;
+	const uint8_t *extra_end = extra + extra_len;
+	assert(extra_end <= cdir_end);
+
+	while(extra + 4 <= extra_end) {
+		uint16_t id = zip_get16(extra);
+		uint16_t len = zip_get16(extra + 2);
+		const uint8_t *field = extra + 4;
+		const uint8_t *field_end = field + len;
+
+		if(field_end > extra_end) {
+			break;
+		}
+
+		if(id == ZIP_EXTRA_ZIP64) {
+			// Only the fields that overflowed are present, in this order
+			if(uncomp_size == UINT32_MAX && field + 8 <= field_end) {
+				uncomp_size = zip_get64(field);
+				field += 8;
+			}
+
+			if(comp_size == UINT32_MAX && field + 8 <= field_end) {
+				comp_size = zip_get64(field);
+				field += 8;
+			}
+
+			if(local_ofs == UINT32_MAX && field + 8 <= field_end) {
+				local_ofs = zip_get64(field);
+			}
+
+			break;
+		}
+
+		extra = field_end;
+	}
+
+	if((flags & 1) || method != ZIP_CM_STORE || comp_size != uncomp_size) {
+		// encrypted or compressed
+		return -1;
+	}
+
+	if(local_ofs > size || size - local_ofs < ZIP_LOCAL_ENTRY_SIZE) {
+		return -1;
+	}
+
+	const uint8_t *l = base + local_ofs;
+
+	if(zip_get32(l) != ZIP_SIG_LOCAL_ENTRY) {
+		return -1;
+	}
+
+	uint64_t data_ofs = local_ofs + ZIP_LOCAL_ENTRY_SIZE + zip_get16(l + 26) + zip_get16(l + 28);
+
+	if(data_ofs > size || size - data_ofs < comp_size) {
+		return -1;
+	}
+
+	return data_ofs;
+}
+
+static bool vfs_zipfile_build_offset_table(VFSZipNode *znode, zip_t *zip) {
+	const uint8_t *base = znode->map.archive.data;
+	uint64_t size = znode->map.archive.size;
+
+	if(size < ZIP_EOCD_SIZE) {
+		vfs_set_error("Archive is too small");
+		return false;
+	}
+
+	// The end of central directory record is followed by a comment of up to 64k
+	const uint8_t *eocd = NULL;
+	uint64_t search_limit = min(size, ZIP_EOCD_SIZE + UINT16_MAX);
+
+	for(uint64_t ofs = ZIP_EOCD_SIZE; ofs <= search_limit; ++ofs) {
+		if(zip_get32(base + size - ofs) == ZIP_SIG_EOCD) {
+			eocd = base + size - ofs;
+			break;
+		}
+	}
+
+	if(!eocd) {
+		vfs_set_error("End of central directory not found");
+		return false;
+	}
+
+	uint64_t num_entries = zip_get16(eocd + 10);
+	uint64_t cdir_size = zip_get32(eocd + 12);
+	uint64_t cdir_ofs = zip_get32(eocd + 16);
+
+	if(num_entries == UINT16_MAX || cdir_size == UINT32_MAX || cdir_ofs == UINT32_MAX) {
+		if(eocd - base < ZIP_EOCD64_LOC_SIZE) {
+			vfs_set_error("ZIP64 end of central directory locator not found");
+			return false;
+		}
+
+		const uint8_t *loc = eocd - ZIP_EOCD64_LOC_SIZE;
+
+		if(zip_get32(loc) != ZIP_SIG_EOCD64_LOC) {
+			vfs_set_error("ZIP64 end of central directory locator not found");
+			return false;
+		}
+
+		uint64_t eocd64_ofs = zip_get64(loc + 8);
+
+		if(eocd64_ofs > size || size - eocd64_ofs < ZIP_EOCD64_SIZE) {
+			vfs_set_error("Bad ZIP64 end of central directory offset");
+			return false;
+		}
+
+		const uint8_t *eocd64 = base + eocd64_ofs;
+
+		if(zip_get32(eocd64) != ZIP_SIG_EOCD64) {
+			vfs_set_error("ZIP64 end of central directory not found");
+			return false;
+		}
+
+		num_entries = zip_get64(eocd64 + 32);
+		cdir_size = zip_get64(eocd64 + 40);
+		cdir_ofs = zip_get64(eocd64 + 48);
+	}
+
+	if(num_entries != (uint64_t)zip_get_num_entries(zip, 0)) {
+		vfs_set_error("Central directory disagrees with libzip on the number of entries");
+		return false;
+	}
+
+	if(cdir_ofs > size || size - cdir_ofs < cdir_size) {
+		vfs_set_error("Central directory is out of bounds");
+		return false;
+	}
+
+	const uint8_t *e = base + cdir_ofs;
+	const uint8_t *cdir_end = e + cdir_size;
+	int64_t *offsets = ALLOC_ARRAY(max(num_entries, 1), int64_t);
+
+	for(uint64_t i = 0; i < num_entries; ++i) {
+		if(cdir_end - e < ZIP_CDIR_ENTRY_SIZE || zip_get32(e) != ZIP_SIG_CDIR_ENTRY) {
+			vfs_set_error("Bad central directory entry %"PRIu64, i);
+			mem_free(offsets);
+			return false;
+		}
+
+		size_t name_len = zip_get16(e + 28);
+		size_t entry_size = ZIP_CDIR_ENTRY_SIZE + name_len + zip_get16(e + 30) + zip_get16(e + 32);
+		const char *name = zip_get_name(zip, i, ZIP_FL_ENC_RAW);
+
+		if(
+			(size_t)(cdir_end - e) < entry_size || !name ||
+			strlen(name) != name_len || memcmp(name, e + ZIP_CDIR_ENTRY_SIZE, name_len)
+		) {
+			vfs_set_error("Central directory entry %"PRIu64" disagrees with libzip", i);
+			mem_free(offsets);
+			return false;
+		}
+
+		offsets[i] = vfs_zipfile_locate_entry_data(e, cdir_end, base, size);
+		e += entry_size;
+	}
+
+	znode->map.data_offsets = offsets;
+	znode->map.num_entries = num_entries;
+	return true;
+}
+
+static void vfs_zipfile_init_map(VFSZipNode *znode) {
+	VFSZipFileTLS *tls = vfs_zipfile_get_tls(znode, true);
+	bool ok = (
+		tls &&
+		vfs_node_map(znode->source, &znode->map.archive) &&
+		vfs_zipfile_build_offset_table(znode, tls->zip)
+	);
+
+	if(!ok) {
+		char *r = vfs_node_repr(znode->source, true);
+		log_debug("Entries of zip archive '%s' won't be memory-mapped: %s", r, vfs_get_error());
+		mem_free(r);
+		vfs_unmap(&znode->map.archive);
+	}
+}
+
+const void *vfs_zipfile_map_entry(VFSZipNode *znode, uint64_t idx, size_t size) {
+	if(UNLIKELY(!znode->map.mutex)) {
+		vfs_set_error("Archive can't be memory-mapped");
+		return NULL;
+	}
+
+	SDL_LockMutex(znode->map.mutex);
+
+	if(!znode->map.initialized) {
+		vfs_zipfile_init_map(znode);
+		znode->map.initialized = true;
+	}
+
+	SDL_UnlockMutex(znode->map.mutex);
+
+	if(!znode->map.data_offsets) {
+		vfs_set_error("Archive can't be memory-mapped");
+		return NULL;
+	}
+
+	if(idx >= znode->map.num_entries || znode->map.data_offsets[idx] < 0) {
+		vfs_set_error("Entry can't be memory-mapped");
+		return NULL;
+	}
+
+	int64_t ofs = znode->map.data_offsets[idx];
+	assert(ofs + size <= znode->map.archive.size);
+	return (const uint8_t*)znode->map.archive.data + ofs;
+}
+
 VFSZipFileTLS *vfs_zipfile_get_tls(VFSZipNode *znode, bool create) {
 	VFSZipFileTLS *tls = SDL_TLSGet(znode->tls_id);
 
@@ -340,6 +601,7 @@ VFSNode *vfs_zipfile_create(VFSNode *source) {
 	auto znode = VFS_ALLOC(VFSZipNode, {
 		.source = source,
 		.tls_id = tls,
+		.map.mutex = SDL_CreateMutex(),
 	});
 
 	if(!vfs_zipfile_init_pathmap(znode)) {
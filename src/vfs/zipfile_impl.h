@@ -27,6 +27,15 @@ VFS_NODE_TYPE(VFSZipNode, {
 	VFSNode *source;
 	ht_str2int_t pathmap;
 	SDL_TLSID tls_id;
+
+	// Set up on the first attempt to map an entry
+	struct {
+		SDL_mutex *mutex;
+		VFSMapping archive;
+		int64_t *data_offsets;  // per entry; -1 if the entry can't be mapped
+		uint64_t num_entries;
+		bool initialized;
+	} map;
 });
 
 typedef struct VFSZipFileTLS {
@@ -46,6 +55,7 @@ typedef struct VFSZipFileIterData {
 const char *vfs_zipfile_iter_shared(VFSZipFileIterData *idata, VFSZipFileTLS *tls);
 void vfs_zipfile_iter_stop(VFSNode *node, void **opaque);
 VFSZipFileTLS *vfs_zipfile_get_tls(VFSZipNode *znode, bool create);
+const void *vfs_zipfile_map_entry(VFSZipNode *znode, uint64_t idx, size_t size);
 
 /* zippath */
 
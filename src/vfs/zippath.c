@@ -95,6 +95,40 @@ static SDL_RWops *vfs_zippath_open(VFSNode *node, VFSOpenMode mode) {
 	return vfs_zippath_make_rwops(zpnode);
 }
 
+static void vfs_zippath_unmap(VFSMapping *mapping) {
+	VFSNode *node = mapping->_handle;
+	vfs_decref(node);
+}
+
+static bool vfs_zippath_map(VFSNode *node, VFSMapping *mapping) {
+	auto zpnode = VFS_NODE_CAST(VFSZipPathNode, node);
+
+	if(zpnode->info.is_dir || zpnode->size < 0) {
+		vfs_set_error("Not a file");
+		return false;
+	}
+
+	if(zpnode->compression != ZIP_CM_STORE) {
+		vfs_set_error("Compressed files can't be memory-mapped");
+		return false;
+	}
+
+	const void *data = vfs_zipfile_map_entry(zpnode->zipnode, zpnode->index, zpnode->size);
+
+	if(!data) {
+		return false;
+	}
+
+	// Keeps the zip node, and with it the archive mapping, alive
+	vfs_incref(node);
+
+	mapping->data = data;
+	mapping->size = zpnode->size;
+	mapping->_unmap = vfs_zippath_unmap;
+	mapping->_handle = node;
+	return true;
+}
+
 VFS_NODE_FUNCS(VFSZipPathNode, {
 	.repr = vfs_zippath_repr,
 	.query = vfs_zippath_query,
@@ -106,6 +140,7 @@ VFS_NODE_FUNCS(VFSZipPathNode, {
 	.iter_stop = vfs_zippath_iter_stop,
 	//.mkdir = vfs_zippath_mkdir,
 	.open = vfs_zippath_open,
+	.map = vfs_zippath_map,
 });
 
 VFSNode *vfs_zippath_create(VFSZipNode *zipnode, zip_int64_t idx) {
@@ -191,10 +191,13 @@ SDL_RWops *vfs_zippath_make_rwops(VFSZipPathNode *zpnode) {
 	DIAGNOSTIC(push)
 	DIAGNOSTIC(ignored "-Wunreachable-code")
 
+	// zstd is always decompressed manually: libzip can only seek by decompressing from the start,
+	// while our reader can make use of a seek table if the entry has one.
 	if(zpnode->compression == ZIP_CM_STORE) {
 		rw->seek = ziprw_seek;
 	} else if(
 		!FORCE_MANUAL_DECOMPRESSION &&
+		zpnode->compression != ZIP_CM_ZSTD &&
 		zip_compression_method_supported(zpnode->compression, false)
 	) {
 		rw->seek = ziprw_seek_emulated;
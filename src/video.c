@@ -16,6 +16,7 @@
 #include "util/graphics.h"
 #include "taskmanager.h"
 #include "video_postprocess.h"
+#include "video_framedump.h"
 #include "dynarray.h"
 #include "version.h"
 #include "stagedraw.h"
@@ -44,6 +45,7 @@ static struct {
 		size_t frame_count;
 		int compression;
 		FramedumpSource source;
+		FramedumpStream *stream;  // if set, frames go here instead of into PNG files
 	} framedump;
 } video;
 
@@ -729,6 +731,16 @@ void video_take_screenshot(bool viewport_only) {
 		fb, attachment, tdata, video_take_screenshot_callback);
 }
 
+static void video_framedump_stream_callback(const Pixmap *px, void *userdata) {
+	if(!px) {
+		log_error("Failed to capture image");
+		return;
+	}
+
+	// Converts directly into a pooled buffer; may block if the writer is behind
+	framedump_stream_submit(NOT_NULL(video.framedump.stream), px);
+}
+
 static void video_take_framedump(void) {
 	Framebuffer *fb = NULL;
 	FramebufferAttachment attachment = FRAMEBUFFER_ATTACH_NONE;
@@ -742,6 +754,12 @@ static void video_take_framedump(void) {
 		attachment = FRAMEBUFFER_ATTACH_COLOR0;
 	}
 
+	if(video.framedump.stream) {
+		++video.framedump.frame_count;
+		r_framebuffer_read_viewport_async(fb, attachment, NULL, video_framedump_stream_callback);
+		return;
+	}
+
 	auto tdata = ALLOC(ScreenshotTaskData);
 	tdata->frame_num = video.framedump.frame_count++;
 
@@ -946,6 +964,7 @@ uint video_current_display(void) {
 static void video_init_framedump(void) {
 	const char *framedump_dir = env_get("TAISEI_FRAMEDUMP", NULL);
 	const char *framedump_src = env_get("TAISEI_FRAMEDUMP_SOURCE", "screen");
+	const char *framedump_fmt = env_get("TAISEI_FRAMEDUMP_FORMAT", "png");
 
 	if(framedump_dir == NULL) {
 		return;
@@ -960,6 +979,24 @@ static void video_init_framedump(void) {
 		video.framedump.source = FRAMEDUMP_SRC_SCREEN;
 	}
 
+	if(strcasecmp(framedump_fmt, "png")) {
+		// Streaming modes: TAISEI_FRAMEDUMP is a single output file (or pipe), not a prefix
+		FramedumpStreamFormat fmt;
+
+		if(!strcasecmp(framedump_fmt, "y4m")) {
+			fmt = FRAMEDUMP_STREAM_Y4M;
+		} else if(!strcasecmp(framedump_fmt, "rgb")) {
+			fmt = FRAMEDUMP_STREAM_RGB;
+		} else {
+			log_warn("Unknown format '%s'; frame dumping disabled", framedump_fmt);
+			return;
+		}
+
+		uint num_buffers = env_get("TAISEI_FRAMEDUMP_BUFFERS", 4);
+		video.framedump.stream = framedump_stream_open(framedump_dir, fmt, num_buffers);
+		return;
+	}
+
 	video.framedump.compression = env_get("TAISEI_FRAMEDUMP_COMPRESSION", 1);
 
 	video.framedump.name_prefix_len = strlen(framedump_dir);
@@ -1062,6 +1099,13 @@ void video_shutdown(void) {
 	events_unregister_handler(video_handle_window_event);
 	events_unregister_handler(video_handle_config_event);
 	r_shutdown();
+
+	// After r_shutdown, which completes any in-flight readbacks
+	if(video.framedump.stream) {
+		framedump_stream_close(video.framedump.stream);
+		video.framedump.stream = NULL;
+	}
+
 	SDL_DestroyWindow(video.window);
 	dynarray_free_data(&video.win_modes);
 	dynarray_free_data(&video.fs_modes);
@@ -1097,7 +1141,7 @@ void video_swap_buffers(void) {
 		r_swap(video.window);
 	}
 
-	if(video.framedump.name_prefix) {
+	if(video.framedump.name_prefix || video.framedump.stream) {
 		video_take_framedump();
 	}
 
@@ -0,0 +1,326 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#include "taisei.h"
+
+#include "video_framedump.h"
+#include "global.h"
+#include "thread.h"
+#include "util.h"
+
+struct FramedumpStream {
+	SDL_RWops *out;
+	char *path;
+	FramedumpStreamFormat format;
+
+	uint32_t width;
+	uint32_t height;
+	size_t frame_size;
+
+	// Fallback for readback formats without a direct conversion path; allocated once
+	Pixmap scratch;
+
+	uint num_buffers;
+	uint8_t **buffers;
+
+	// Everything below is protected by mutex
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+	Thread *thread;
+
+	// Indices into buffers. Filled buffers form a FIFO, so that frames are written in order.
+	uint *free_stack;
+	uint num_free;
+	uint *filled_queue;
+	uint filled_head;
+	uint num_filled;
+
+	uint64_t frames_written;
+	bool write_failed;
+	bool size_mismatch_logged;
+	bool quit;
+};
+
+static bool fds_write_frame(FramedumpStream *fds, const uint8_t *frame) {
+	if(fds->format == FRAMEDUMP_STREAM_Y4M) {
+		static const char frame_header[] = "FRAME\n";
+
+		if(SDL_RWwrite(fds->out, frame_header, sizeof(frame_header) - 1, 1) != 1) {
+			return false;
+		}
+	}
+
+	return SDL_RWwrite(fds->out, frame, fds->frame_size, 1) == 1;
+}
+
+static void *fds_writer_thread(void *arg) {
+	FramedumpStream *fds = arg;
+
+	SDL_LockMutex(fds->mutex);
+
+	for(;;) {
+		while(!fds->num_filled && !fds->quit) {
+			SDL_CondWait(fds->cond, fds->mutex);
+		}
+
+		if(!fds->num_filled) {
+			// quit requested and everything has been written
+			break;
+		}
+
+		uint idx = fds->filled_queue[fds->filled_head];
+		fds->filled_head = (fds->filled_head + 1) % fds->num_buffers;
+		--fds->num_filled;
+		bool skip = fds->write_failed;
+
+		SDL_UnlockMutex(fds->mutex);
+		bool ok = skip || fds_write_frame(fds, fds->buffers[idx]);
+		SDL_LockMutex(fds->mutex);
+
+		if(!ok) {
+			log_sdl_error(LOG_ERROR, "SDL_RWwrite");
+			log_error("Frame dump to %s failed; the remaining frames will be dropped", fds->path);
+			fds->write_failed = true;
+		} else if(!skip) {
+			++fds->frames_written;
+		}
+
+		fds->free_stack[fds->num_free++] = idx;
+		SDL_CondBroadcast(fds->cond);
+	}
+
+	SDL_UnlockMutex(fds->mutex);
+	return NULL;
+}
+
+FramedumpStream *framedump_stream_open(const char *path, FramedumpStreamFormat format, uint num_buffers) {
+	SDL_RWops *out = SDL_RWFromFile(path, "wb");
+
+	if(!out) {
+		log_sdl_error(LOG_ERROR, "SDL_RWFromFile");
+		return NULL;
+	}
+
+	num_buffers = max(1, num_buffers);
+
+	auto fds = ALLOC(FramedumpStream, {
+		.out = out,
+		.path = strdup(path),
+		.format = format,
+		.num_buffers = num_buffers,
+		.buffers = ALLOC_ARRAY(num_buffers, uint8_t*),
+		.free_stack = ALLOC_ARRAY(num_buffers, uint),
+		.filled_queue = ALLOC_ARRAY(num_buffers, uint),
+		.mutex = SDL_CreateMutex(),
+		.cond = SDL_CreateCond(),
+	});
+
+	if(fds->mutex && fds->cond) {
+		fds->thread = thread_create("framedump", fds_writer_thread, fds, THREAD_PRIO_NORMAL);
+	}
+
+	if(!fds->thread) {
+		log_warn("Failed to start the writer thread, frames will be written synchronously");
+	}
+
+	log_info("Dumping frames to %s (%s, %u buffers)",
+		path, format == FRAMEDUMP_STREAM_Y4M ? "y4m" : "raw rgb24", num_buffers);
+
+	return fds;
+}
+
+static bool fds_setup(FramedumpStream *fds, uint32_t width, uint32_t height) {
+	fds->width = width;
+	fds->height = height;
+	// Both RGB24 and planar 4:4:4 YUV take 3 bytes per pixel
+	fds->frame_size = (size_t)width * height * 3;
+
+	for(uint i = 0; i < fds->num_buffers; ++i) {
+		fds->buffers[i] = mem_alloc(fds->frame_size);
+		fds->free_stack[i] = i;
+	}
+
+	fds->num_free = fds->num_buffers;
+
+	if(fds->format == FRAMEDUMP_STREAM_Y4M) {
+		// Limited range BT.601, which is what most tools assume for Y4M input
+		char header[128];
+		int len = snprintf(header, sizeof(header),
+			"YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444 XYSCSS=444 XCOLORRANGE=LIMITED\n",
+			width, height, FPS
+		);
+
+		if(SDL_RWwrite(fds->out, header, len, 1) != 1) {
+			log_sdl_error(LOG_ERROR, "SDL_RWwrite");
+			fds->write_failed = true;
+		}
+	} else {
+		log_info("Frame dump geometry: %ux%u, rgb24, %u fps", width, height, FPS);
+	}
+
+	return !fds->write_failed;
+}
+
+static const uint8_t *fds_get_row(const Pixmap *px, uint y, uint pixel_size) {
+	if(px->origin == PIXMAP_ORIGIN_BOTTOMLEFT) {
+		y = px->height - 1 - y;
+	}
+
+	return (const uint8_t*)px->data.untyped + (size_t)y * px->width * pixel_size;
+}
+
+static void fds_convert_rgb(FramedumpStream *fds, const Pixmap *px, uint pixel_size, uint8_t *dst) {
+	uint w = fds->width;
+
+	for(uint y = 0; y < fds->height; ++y) {
+		const uint8_t *src = fds_get_row(px, y, pixel_size);
+
+		if(pixel_size == 3) {
+			memcpy(dst, src, w * 3);
+			dst += w * 3;
+		} else {
+			for(uint x = 0; x < w; ++x, src += pixel_size, dst += 3) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+			}
+		}
+	}
+}
+
+static void fds_convert_y4m(FramedumpStream *fds, const Pixmap *px, uint pixel_size, uint8_t *dst) {
+	uint w = fds->width;
+	size_t plane_size = (size_t)w * fds->height;
+	uint8_t *py = dst;
+	uint8_t *pu = dst + plane_size;
+	uint8_t *pv = dst + plane_size * 2;
+
+	for(uint y = 0; y < fds->height; ++y) {
+		const uint8_t *src = fds_get_row(px, y, pixel_size);
+
+		for(uint x = 0; x < w; ++x, src += pixel_size) {
+			int r = src[0], g = src[1], b = src[2];
+			*py++ = (( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16;
+			*pu++ = ((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128;
+			*pv++ = ((112 * r -  94 * g -  18 * b + 128) >> 8) + 128;
+		}
+	}
+}
+
+static void fds_convert(FramedumpStream *fds, const Pixmap *px, uint8_t *dst) {
+	uint pixel_size;
+
+	if(px->format == PIXMAP_FORMAT_RGB8 || px->format == PIXMAP_FORMAT_RGBA8) {
+		pixel_size = PIXMAP_FORMAT_PIXEL_SIZE(px->format);
+	} else {
+		// Uncommon readback format; go through RGB8 once
+		if(!fds->scratch.data.untyped) {
+			fds->scratch.data.untyped = pixmap_alloc_buffer_for_conversion(px, PIXMAP_FORMAT_RGB8, &fds->scratch.data_size);
+		}
+
+		pixmap_convert(px, &fds->scratch, PIXMAP_FORMAT_RGB8);
+		px = &fds->scratch;
+		pixel_size = 3;
+	}
+
+	if(fds->format == FRAMEDUMP_STREAM_Y4M) {
+		fds_convert_y4m(fds, px, pixel_size, dst);
+	} else {
+		fds_convert_rgb(fds, px, pixel_size, dst);
+	}
+}
+
+void framedump_stream_submit(FramedumpStream *fds, const Pixmap *px) {
+	if(!fds->width) {
+		if(!fds_setup(fds, px->width, px->height)) {
+			return;
+		}
+	}
+
+	if(px->width != fds->width || px->height != fds->height) {
+		if(!fds->size_mismatch_logged) {
+			log_warn("Frame size changed from %ux%u to %ux%u; dropping frames until it's restored",
+				fds->width, fds->height, px->width, px->height);
+			fds->size_mismatch_logged = true;
+		}
+
+		return;
+	}
+
+	if(!fds->thread) {
+		if(!fds->write_failed) {
+			fds_convert(fds, px, fds->buffers[0]);
+
+			if(fds_write_frame(fds, fds->buffers[0])) {
+				++fds->frames_written;
+			} else {
+				log_sdl_error(LOG_ERROR, "SDL_RWwrite");
+				fds->write_failed = true;
+			}
+		}
+
+		return;
+	}
+
+	SDL_LockMutex(fds->mutex);
+
+	if(fds->write_failed) {
+		SDL_UnlockMutex(fds->mutex);
+		return;
+	}
+
+	// Back-pressure: wait for the writer instead of allocating more buffers
+	while(!fds->num_free) {
+		SDL_CondWait(fds->cond, fds->mutex);
+	}
+
+	uint idx = fds->free_stack[--fds->num_free];
+	SDL_UnlockMutex(fds->mutex);
+
+	// Nobody else touches a buffer that's in neither list
+	fds_convert(fds, px, fds->buffers[idx]);
+
+	SDL_LockMutex(fds->mutex);
+	fds->filled_queue[(fds->filled_head + fds->num_filled) % fds->num_buffers] = idx;
+	++fds->num_filled;
+	SDL_CondBroadcast(fds->cond);
+	SDL_UnlockMutex(fds->mutex);
+}
+
+void framedump_stream_close(FramedumpStream *fds) {
+	if(fds->thread) {
+		SDL_LockMutex(fds->mutex);
+		fds->quit = true;
+		SDL_CondBroadcast(fds->cond);
+		SDL_UnlockMutex(fds->mutex);
+		thread_wait(fds->thread);
+	}
+
+	log_info("Frame dump finished: %"PRIu64" frames written to %s", fds->frames_written, fds->path);
+
+	SDL_RWclose(fds->out);
+
+	for(uint i = 0; i < fds->num_buffers; ++i) {
+		mem_free(fds->buffers[i]);
+	}
+
+	if(fds->cond) {
+		SDL_DestroyCond(fds->cond);
+	}
+
+	if(fds->mutex) {
+		SDL_DestroyMutex(fds->mutex);
+	}
+
+	mem_free(fds->scratch.data.untyped);
+	mem_free(fds->buffers);
+	mem_free(fds->free_stack);
+	mem_free(fds->filled_queue);
+	mem_free(fds->path);
+	mem_free(fds);
+}
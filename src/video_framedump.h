@@ -0,0 +1,40 @@
+/*
+ * This software is licensed under the terms of the MIT License.
+ * See COPYING for further information.
+ * ---
+ * Copyright (c) 2011-2019, Lukas Weber <laochailan@web.de>.
+ * Copyright (c) 2012-2019, Andrei Alexeyev <akari@taisei-project.org>.
+*/
+
+#pragma once
+#include "taisei.h"
+
+#include "pixmap/pixmap.h"
+
+/*
+ * Streaming frame dump sink: writes every frame into a single file (or named pipe), either as
+ * headerless packed RGB24 or as a YUV4MPEG2 (C444) stream.
+ *
+ * Frames are converted straight from the readback into one of a fixed number of buffers, and
+ * written out by a dedicated thread. If all buffers are waiting to be written, submitting a frame
+ * blocks until one is free, so the game slows down to the writer's pace instead of piling up
+ * frames in memory.
+ */
+
+typedef struct FramedumpStream FramedumpStream;
+
+typedef enum FramedumpStreamFormat {
+	FRAMEDUMP_STREAM_RGB,
+	FRAMEDUMP_STREAM_Y4M,
+} FramedumpStreamFormat;
+
+FramedumpStream *framedump_stream_open(const char *path, FramedumpStreamFormat format, uint num_buffers)
+	attr_nonnull_all;
+
+// Frame dimensions are fixed by the first frame; frames of any other size are dropped.
+void framedump_stream_submit(FramedumpStream *fds, const Pixmap *px)
+	attr_nonnull_all;
+
+// Writes out all pending frames, then closes the output.
+void framedump_stream_close(FramedumpStream *fds)
+	attr_nonnull_all;
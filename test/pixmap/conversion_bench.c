@@ -0,0 +1,135 @@
+
+#include "taisei.h"
+
+#include "pixmap/pixmap.h"
+#include "pixmap/conversion_kernels.h"
+#include "log.h"
+#include "util.h"
+
+/*
+ * Times every specialized pixmap kernel set against the generic converter, and checks that they
+ * produce identical output. Exits with a non-zero status on mismatch.
+ */
+
+#define BENCH_WIDTH 1024
+#define BENCH_HEIGHT 1024
+#define BENCH_RUNS 16
+
+typedef struct BenchCase {
+	const char *name;
+	PixmapFormat src_format;
+	PixmapFormat dst_format;
+	const char *swizzle;  // if set, swizzle src_format in place instead of converting
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+	{ "RGBA8 -> RGB8",      PIXMAP_FORMAT_RGBA8,   PIXMAP_FORMAT_RGB8 },
+	{ "RGB8 -> RGBA8",      PIXMAP_FORMAT_RGB8,    PIXMAP_FORMAT_RGBA8 },
+	{ "R8 -> RGBA8",        PIXMAP_FORMAT_R8,      PIXMAP_FORMAT_RGBA8 },
+	{ "RGBA8 -> RGBA32F",   PIXMAP_FORMAT_RGBA8,   PIXMAP_FORMAT_RGBA32F },
+	{ "RGBA32F -> RGBA8",   PIXMAP_FORMAT_RGBA32F, PIXMAP_FORMAT_RGBA8 },
+	{ "RGBA16 -> RGBA8",    PIXMAP_FORMAT_RGBA16,  PIXMAP_FORMAT_RGBA8 },
+	{ "RGBA8 swizzle bgra", PIXMAP_FORMAT_RGBA8,   PIXMAP_FORMAT_RGBA8, "bgra" },
+	{ "RGBA8 swizzle rrr1", PIXMAP_FORMAT_RGBA8,   PIXMAP_FORMAT_RGBA8, "rrr1" },
+	{ "RGBA8 swizzle 1rg0", PIXMAP_FORMAT_RGBA8,   PIXMAP_FORMAT_RGBA8, "1rg0" },
+};
+
+static void fill_source(Pixmap *px) {
+	uint32_t state = 0x9e3779b9;
+	size_t size = px->data_size;
+	uint8_t *data = px->data.untyped;
+
+	for(size_t i = 0; i < size; ++i) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		data[i] = state;
+	}
+
+	if(!pixmap_format_is_float(px->format)) {
+		return;
+	}
+
+	// Random bytes are mostly huge, tiny or NaN; make most of them land in and around [0, 1]
+	float *f = px->data.untyped;
+	size_t num = size / sizeof(*f);
+
+	for(size_t i = 0; i < num; ++i) {
+		if(i % 16) {
+			f[i] = (((uint8_t*)(f + i))[0] - 8) / 240.0f;
+		}
+	}
+}
+
+static double run_case(const BenchCase *c, const Pixmap *src, Pixmap *dst) {
+	uint64_t best = UINT64_MAX;
+
+	for(int run = 0; run < BENCH_RUNS; ++run) {
+		uint64_t t;
+
+		if(c->swizzle) {
+			pixmap_copy(src, dst);
+			t = SDL_GetPerformanceCounter();
+			pixmap_swizzle_inplace(dst, (SwizzleMask) { .rgba = {
+				c->swizzle[0], c->swizzle[1], c->swizzle[2], c->swizzle[3]
+			}});
+		} else {
+			t = SDL_GetPerformanceCounter();
+			pixmap_convert(src, dst, c->dst_format);
+		}
+
+		best = min(best, SDL_GetPerformanceCounter() - t);
+	}
+
+	return best * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char **argv) {
+	log_init(LOG_ALL);
+	log_add_output(LOG_ALL, SDL_RWFromFP(stderr, false), log_formatter_console);
+
+	bool mismatch = false;
+
+	for(uint i = 0; i < ARRAY_SIZE(bench_cases); ++i) {
+		const BenchCase *c = bench_cases + i;
+
+		Pixmap src = {
+			.width = BENCH_WIDTH,
+			.height = BENCH_HEIGHT,
+			.format = c->src_format,
+			.origin = PIXMAP_ORIGIN_TOPLEFT,
+		};
+
+		src.data.untyped = pixmap_alloc_buffer(src.format, src.width, src.height, &src.data_size);
+		fill_source(&src);
+
+		Pixmap ref = { 0 }, dst = { 0 };
+		ref.data.untyped = pixmap_alloc_buffer_for_conversion(&src, c->dst_format, &ref.data_size);
+		dst.data.untyped = pixmap_alloc_buffer_for_conversion(&src, c->dst_format, &dst.data_size);
+
+		pixmap_kernels_set(PIXMAP_KERNELS_GENERIC);
+		double generic_ms = run_case(c, &src, &ref);
+		log_info("%-20s %-8s %8.3f ms", c->name, pixmap_kernel_set_name(PIXMAP_KERNELS_GENERIC), generic_ms);
+
+		for(PixmapKernelSet ks = PIXMAP_KERNELS_SCALAR; ks < PIXMAP_KERNELS_NUM_SETS; ++ks) {
+			if(!pixmap_kernel_set_supported(ks)) {
+				continue;
+			}
+
+			pixmap_kernels_set(ks);
+			double ms = run_case(c, &src, &dst);
+			bool ok = !memcmp(ref.data.untyped, dst.data.untyped, ref.data_size);
+			mismatch |= !ok;
+
+			log_info("%-20s %-8s %8.3f ms  %5.2fx%s",
+				c->name, pixmap_kernel_set_name(ks), ms, generic_ms / ms, ok ? "" : "  MISMATCH");
+		}
+
+		mem_free(src.data.untyped);
+		mem_free(ref.data.untyped);
+		mem_free(dst.data.untyped);
+	}
+
+	log_shutdown();
+	return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+
+#include "taisei.h"
+
+#include "resource/resource.h"
+#include "renderer/api.h"
+#include "vfs/setup.h"
+#include "taskmanager.h"
+#include "events.h"
+#include "filewatch/filewatch.h"
+#include "hirestime.h"
+#include "video.h"
+#include "log.h"
+#include "util.h"
+
+/*
+ * Requests resources synchronously right after preloading them, while their async loads are
+ * (most of the time) parked waiting for dependencies that can only be finalized on the main thread.
+ * An animation depends on sprites, which depend on textures.
+ *
+ * Usage: parked_load <resource directory> <scratch directory>
+ */
+
+#define ITERATIONS 64
+
+static const char *const anims[] = {
+	"fire",
+};
+
+int main(int argc, char **argv) {
+	if(argc < 3) {
+		tsfprintf(stderr, "Usage: %s <resource directory> <scratch directory>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	log_init(LOG_ALL);
+	log_add_output(LOG_ALERT, SDL_RWFromFP(stderr, false), log_formatter_console);
+
+	env_set("SDL_VIDEODRIVER", "dummy", true);
+	env_set("TAISEI_RENDERER", "null", true);
+
+	mem_install_sdl_callbacks();
+
+	if(SDL_Init(SDL_INIT_EVENTS) < 0) {
+		log_fatal("SDL_Init() failed: %s", SDL_GetError());
+	}
+
+	taskmgr_global_init();
+	time_init();
+	events_init();
+
+	char *storage_path = strfmt("%s/storage", argv[2]);
+	char *cache_path = strfmt("%s/cache", argv[2]);
+
+	vfs_init();
+	vfs_setup_fixedpaths(&(VfsSetupFixedPaths) {
+		.res_path = argv[1],
+		.storage_path = storage_path,
+		.cache_path = cache_path,
+	});
+
+	video_init(&(VideoInitParams) { 0 });
+	filewatch_init();
+	res_init();
+	r_post_init();
+
+	int failures = 0;
+
+	for(int i = 0; i < ITERATIONS; ++i) {
+		for(uint a = 0; a < ARRAY_SIZE(anims); ++a) {
+			ResourceGroup rg;
+			res_group_init(&rg);
+			res_group_preload(&rg, RES_ANIM, RESF_DEFAULT, anims[a], NULL);
+
+			if(!res_get_data(RES_ANIM, anims[a], RESF_DEFAULT)) {
+				log_error("Iteration %i: failed to load animation '%s'", i, anims[a]);
+				++failures;
+			}
+
+			res_group_release(&rg);
+			res_purge();
+		}
+	}
+
+	res_shutdown();
+	taskmgr_global_shutdown();
+	video_shutdown();
+	filewatch_shutdown();
+	vfs_shutdown();
+	events_shutdown();
+	time_shutdown();
+	mem_free(storage_path);
+	mem_free(cache_path);
+	log_shutdown();
+	SDL_Quit();
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}